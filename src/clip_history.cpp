@@ -0,0 +1,209 @@
+#include "clip_history.hpp"
+#include "fs_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr std::string_view file_header = "winenv-clip\t1\n";
+// Длина записи (4 байта) и хэш текста (8 байт) в порядке little-endian.
+// Хэш при загрузке проверяет, что запись дописана целиком
+constexpr size_t record_head_size = 12;
+
+constexpr std::uint64_t hash_mul = 0x9E3779B97F4A7C15;
+
+std::uint64_t mix(std::uint64_t value) noexcept {
+  value ^= value >> 32;
+  value *= hash_mul;
+  value ^= value >> 29;
+  return value;
+}
+
+void put_le(char *out, std::uint64_t value, size_t n_bytes) noexcept {
+  for (size_t i = 0; i < n_bytes; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+std::uint64_t get_le(const char *in, size_t n_bytes) noexcept {
+  std::uint64_t value{0};
+  for (size_t i = n_bytes; i-- > 0;) {
+    value = value << 8 | static_cast<unsigned char>(in[i]);
+  }
+  return value;
+}
+} // namespace
+
+namespace winenv {
+std::uint64_t hash_text(std::string_view text) noexcept {
+  std::uint64_t hash = text.size() * hash_mul;
+  size_t pos = 0;
+  for (; pos + 8 <= text.size(); pos += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, text.data() + pos, 8);
+    hash = mix(hash ^ word) + hash_mul;
+  }
+  if (pos < text.size()) {
+    std::uint64_t word{0};
+    std::memcpy(&word, text.data() + pos, text.size() - pos);
+    hash = mix(hash ^ word) + hash_mul;
+  }
+  return mix(hash);
+}
+
+ClipHistory::ClipHistory(size_t max_entries, size_t max_bytes)
+    : m_max_entries{std::max<size_t>(max_entries, 1)}, m_arena(max_bytes) {}
+
+bool ClipHistory::add(std::string_view text) {
+  if (text.empty() || text.size() > m_arena.size()) {
+    return false;
+  }
+  std::uint64_t hash = hash_text(text);
+  auto is_same = [this, hash, text](const Entry &entry) {
+    return entry.m_hash == hash && view(entry) == text;
+  };
+  if (!m_entries.empty() && is_same(m_entries.back())) {
+    return false;
+  }
+  auto duplicate = std::find_if(m_entries.begin(), m_entries.end(), is_same);
+  if (duplicate != m_entries.end()) {
+    m_bytes_used -= duplicate->m_size;
+    m_entries.erase(duplicate);
+  }
+
+  bool f_wrap = m_head + text.size() > m_arena.size();
+  size_t pos = f_wrap ? 0 : m_head;
+  size_t end = pos + text.size();
+  // Записи в пропущенном конце арены - самые старые, они вытесняются вместе
+  // с перекрытыми новой записью
+  auto is_overwritten = [&](const Entry &entry) {
+    return (f_wrap && entry.m_offset >= m_head) ||
+           (entry.m_offset < end && pos < entry.m_offset + entry.m_size);
+  };
+  while (!m_entries.empty() && (m_entries.size() >= m_max_entries ||
+                                is_overwritten(m_entries.front()))) {
+    m_bytes_used -= m_entries.front().m_size;
+    m_entries.pop_front();
+  }
+  std::copy(text.begin(), text.end(), m_arena.begin() + pos);
+  m_entries.push_back({pos, text.size(), hash});
+  m_head = end;
+  m_bytes_used += text.size();
+
+  if (m_out.is_open()) {
+    // Файл переписывается, когда в нем вдвое больше данных, чем в арене
+    if (m_file_size >
+        2 * (m_arena.size() + m_max_entries * record_head_size)) {
+      rewrite_file();
+    } else {
+      append_record(m_entries.back());
+    }
+  }
+  return true;
+}
+
+size_t ClipHistory::size() const noexcept { return m_entries.size(); }
+
+std::string_view ClipHistory::get(size_t index) const noexcept {
+  if (index >= m_entries.size()) {
+    return {};
+  }
+  return view(m_entries[m_entries.size() - 1 - index]);
+}
+
+size_t ClipHistory::bytes_used() const noexcept { return m_bytes_used; }
+
+void ClipHistory::open_file(const std::filesystem::path &file) {
+  m_out.close();
+  m_entries.clear();
+  m_head = 0;
+  m_bytes_used = 0;
+  std::ifstream in(file, std::ios::binary);
+  std::string data{std::istreambuf_iterator<char>{in},
+                   std::istreambuf_iterator<char>{}};
+  in.close();
+  std::vector<std::string_view> records;
+  size_t pos = file_header.size();
+  if (data.compare(0, pos, file_header) == 0) {
+    while (data.size() - pos >= record_head_size) {
+      size_t size = get_le(data.data() + pos, 4);
+      std::uint64_t hash = get_le(data.data() + pos + 4, 8);
+      pos += record_head_size;
+      if (size > data.size() - pos) {
+        break;
+      }
+      std::string_view text{data.data() + pos, size};
+      if (hash_text(text) != hash) {
+        break;
+      }
+      records.push_back(text);
+      pos += size;
+    }
+  }
+  // Новые записи без повторов, пока помещаются. В арене они ложатся подряд
+  // с начала, поэтому после перезапуска записей не меньше, чем было
+  std::vector<std::string_view> kept;
+  size_t kept_size{0};
+  for (auto iter = records.rbegin(); iter != records.rend(); ++iter) {
+    if (std::find(kept.begin(), kept.end(), *iter) != kept.end()) {
+      continue;
+    }
+    if (kept.size() == m_max_entries || iter->empty() ||
+        iter->size() > m_arena.size() - kept_size) {
+      break;
+    }
+    kept.push_back(*iter);
+    kept_size += iter->size();
+  }
+  for (auto iter = kept.rbegin(); iter != kept.rend(); ++iter) {
+    add(*iter);
+  }
+  m_file = file;
+  rewrite_file();
+}
+
+std::string_view ClipHistory::view(const Entry &entry) const noexcept {
+  return {m_arena.data() + entry.m_offset, entry.m_size};
+}
+
+void ClipHistory::append_record(const Entry &entry) {
+  char head[record_head_size];
+  put_le(head, entry.m_size, 4);
+  put_le(head + 4, entry.m_hash, 8);
+  m_out.write(head, record_head_size);
+  std::string_view text = view(entry);
+  m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  m_out.flush();
+  if (!m_out.good()) {
+    throw std::runtime_error("Failed to write clipboard history: " +
+                             path_to_utf8(m_file));
+  }
+  m_file_size += record_head_size + text.size();
+}
+
+void ClipHistory::rewrite_file() {
+  m_out.close();
+  std::filesystem::path temp_file = m_file;
+  temp_file += ".tmp";
+  m_out.open(temp_file, std::ios::binary | std::ios::trunc);
+  if (!m_out.good()) {
+    throw std::runtime_error("Failed to open clipboard history for write: " +
+                             path_to_utf8(temp_file));
+  }
+  m_out.write(file_header.data(), file_header.size());
+  m_file_size = file_header.size();
+  for (const Entry &entry : m_entries) {
+    append_record(entry);
+  }
+  m_out.close();
+  std::filesystem::rename(temp_file, m_file);
+  m_out.open(m_file, std::ios::binary | std::ios::app);
+  if (!m_out.good()) {
+    throw std::runtime_error("Failed to open clipboard history for write: " +
+                             path_to_utf8(m_file));
+  }
+}
+} // namespace winenv
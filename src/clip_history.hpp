@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+// Быстрый некриптографический хэш текста, по 8 байт за шаг
+std::uint64_t hash_text(std::string_view text) noexcept;
+
+// Последние тексты буфера обмена в UTF-8. Тексты лежат подряд в арене
+// фиксированного размера, используемой как кольцо: новая запись вытесняет
+// самые старые, с которыми пересекается. Запись не разрывается: если она
+// не помещается в конце арены, конец пропускается. Повтор последней записи
+// отбрасывается после сравнения хэшей, повтор более старой переносит ее в
+// начало истории.
+// С open_file история сохраняется между запусками: каждая запись
+// дописывается в конец файла, при загрузке и разрастании файла он
+// переписывается с одними действующими записями.
+// Пример:
+// ClipHistory history{100, 1 << 20};
+// history.open_file("clip_history.bin");
+// history.add("text");
+// std::string_view last = history.get(0);
+class ClipHistory {
+public:
+  // max_bytes - размер арены, он же предел длины одной записи
+  ClipHistory(size_t max_entries, size_t max_bytes);
+  ClipHistory(const ClipHistory &other) = delete;
+  ClipHistory &operator=(const ClipHistory &other) = delete;
+
+  // Возвращает false, если текст пуст, длиннее арены или совпадает с
+  // последней записью. Выбрасывает std::runtime_error, если не удалось
+  // дописать файл
+  bool add(std::string_view text);
+  size_t size() const noexcept;
+  // Запись по номеру от новой к старой: 0 - последняя
+  std::string_view get(size_t index) const noexcept;
+  // Суммарная длина записей
+  size_t bytes_used() const noexcept;
+
+  // Заменяет историю новейшими записями файла без повторов, сколько их
+  // помещается, и переписывает файл. Испорченный конец файла отбрасывается.
+  // Дальнейшие записи дописываются в файл. Отсутствующий файл создается.
+  // Выбрасывает std::runtime_error, если файл не записать
+  void open_file(const std::filesystem::path &file);
+
+private:
+  struct Entry {
+    size_t m_offset;
+    size_t m_size;
+    std::uint64_t m_hash;
+  };
+
+  std::string_view view(const Entry &entry) const noexcept;
+  void append_record(const Entry &entry);
+  // Записывает действующие записи во временный файл и заменяет им прежний
+  void rewrite_file();
+
+  size_t m_max_entries;
+  std::vector<char> m_arena;
+  // От старой записи к новой, смещения растут по кольцу от m_head
+  std::deque<Entry> m_entries;
+  // Позиция в арене сразу за последней записью
+  size_t m_head{0};
+  size_t m_bytes_used{0};
+  std::filesystem::path m_file;
+  std::ofstream m_out;
+  size_t m_file_size{0};
+};
+} // namespace winenv
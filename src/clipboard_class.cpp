@@ -0,0 +1,290 @@
+#include "clipboard_class.hpp"
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+namespace {
+using winenv::EnvChar;
+using winenv::EnvStringView;
+
+// Классы символов ASCII. Символы вне ASCII допустимы в путях и адресах
+enum CharFlag : std::uint8_t {
+  dec_digit = 1 << 0,
+  hex_digit = 1 << 1,
+  hex_letter = 1 << 2,
+  path_char = 1 << 3,
+  url_char = 1 << 4,
+  // Разделитель директорий или точка перед расширением
+  path_mark = 1 << 5,
+  line_break = 1 << 6,
+  blank = 1 << 7
+};
+constexpr std::uint8_t non_ascii_flags = path_char | url_char;
+
+constexpr std::array<std::uint8_t, 128> make_char_table() {
+  std::array<std::uint8_t, 128> table{};
+  constexpr std::string_view not_in_path = "\"<>|?*";
+  constexpr std::string_view not_in_url = " \"<>\\^`{|}";
+  for (char c = 0x20; c < 0x7F; ++c) {
+    auto &flags = table[static_cast<size_t>(c)];
+    if (not_in_path.find(c) == std::string_view::npos) {
+      flags |= path_char;
+    }
+    if (not_in_url.find(c) == std::string_view::npos) {
+      flags |= url_char;
+    }
+    if (c >= '0' && c <= '9') {
+      flags |= dec_digit | hex_digit;
+    } else if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
+      flags |= hex_digit | hex_letter;
+    }
+  }
+  table['/'] |= path_mark;
+  table['\\'] |= path_mark;
+  table['.'] |= path_mark;
+  table[' '] |= blank;
+  table['\t'] |= blank;
+  table['\r'] |= blank | line_break;
+  table['\n'] |= blank | line_break;
+  return table;
+}
+constexpr std::array<std::uint8_t, 128> char_table = make_char_table();
+
+// Предел длины пути и командной строки в Windows. Более длинный текст не
+// открыть ни в браузере, ни в редакторе, и он не просматривается
+constexpr size_t max_routed_size = 32767;
+// Более длинный текст не проверяется как путь: разбор пути на тысячи
+// компонентов дороже остальной классификации
+constexpr size_t max_path_size = 4096;
+// Длиннее 9 цифр номер строки не бывает, и он не переполняется
+constexpr size_t max_number_digits = 9;
+constexpr size_t min_hash_size = 7;
+constexpr size_t max_hash_size = 128;
+constexpr size_t guid_size = 36;
+
+std::uint8_t char_flags(EnvChar c) noexcept {
+  auto code = static_cast<std::make_unsigned_t<EnvChar>>(c);
+  return code < 0x80 ? char_table[code] : non_ascii_flags;
+}
+
+// Флаги, общие для всех символов, и флаги хотя бы одного символа
+struct ScanResult {
+  std::uint8_t m_all{0xFF};
+  std::uint8_t m_any{0};
+};
+
+// Останавливается на первом переводе строки: такой текст уже не путь,
+// не адрес и не хэш
+ScanResult scan(EnvStringView text) noexcept {
+  ScanResult result;
+  for (EnvChar c : text) {
+    std::uint8_t flags = char_flags(c);
+    result.m_all &= flags;
+    result.m_any |= flags;
+    if (flags & line_break) {
+      break;
+    }
+  }
+  return result;
+}
+
+EnvStringView trim(EnvStringView text) noexcept {
+  while (!text.empty() && (char_flags(text.front()) & blank)) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && (char_flags(text.back()) & blank)) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+bool is_ascii_letter(EnvChar c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Схема RFC 3986 перед "://". Однобуквенная схема - скорее диск Windows
+bool has_url_scheme(EnvStringView text) noexcept {
+  size_t pos = 0;
+  while (pos < text.size() && pos < 32 &&
+         (is_ascii_letter(text[pos]) ||
+          (pos != 0 && ((char_flags(text[pos]) & dec_digit) ||
+                        text[pos] == '+' || text[pos] == '-' ||
+                        text[pos] == '.')))) {
+    ++pos;
+  }
+  return pos >= 2 && pos + 3 <= text.size() && text[pos] == ':' &&
+         text[pos + 1] == '/' && text[pos + 2] == '/';
+}
+
+bool starts_with_www(EnvStringView text) noexcept {
+  if (text.size() < 5) {
+    return false;
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    if (text[i] != 'w' && text[i] != 'W') {
+      return false;
+    }
+  }
+  return text[3] == '.';
+}
+
+bool is_guid(EnvStringView text) noexcept {
+  if (text.size() == guid_size + 2 && text.front() == '{' &&
+      text.back() == '}') {
+    text = text.substr(1, guid_size);
+  }
+  if (text.size() != guid_size) {
+    return false;
+  }
+  for (size_t i = 0; i < guid_size; ++i) {
+    bool is_dash_pos = i == 8 || i == 13 || i == 18 || i == 23;
+    if (is_dash_pos ? text[i] != '-' : !(char_flags(text[i]) & hex_digit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Число из цифр, заканчивающихся перед end. Сдвигает end к первой цифре.
+// 0, если цифр нет или их слишком много
+size_t parse_number_back(EnvStringView text, size_t &end) noexcept {
+  size_t begin = end;
+  while (begin > 0 && end - begin < max_number_digits + 1 &&
+         (char_flags(text[begin - 1]) & dec_digit)) {
+    --begin;
+  }
+  if (begin == end || end - begin > max_number_digits) {
+    return 0;
+  }
+  size_t value = 0;
+  for (size_t i = begin; i < end; ++i) {
+    value = value * 10 + static_cast<size_t>(text[i] - '0');
+  }
+  end = begin;
+  return value;
+}
+
+struct Location {
+  EnvStringView m_file;
+  size_t m_line{0};
+  size_t m_column{0};
+};
+
+// Отделяет от текста строку и столбец: "file:12", "file:12:5:" (вывод
+// grep и компиляторов), "file(12)", "file(12,5)" (вывод MSVC)
+std::optional<Location> split_location(EnvStringView text) noexcept {
+  size_t end = text.size();
+  bool f_msvc = end != 0 && text[end - 1] == ')';
+  if (f_msvc || (end != 0 && text[end - 1] == ':')) {
+    --end;
+  }
+  char separator = f_msvc ? ',' : ':';
+  size_t first = parse_number_back(text, end);
+  if (first == 0 || end == 0) {
+    return std::nullopt;
+  }
+  Location location{{}, first};
+  if (text[end - 1] == separator) {
+    size_t number_end = end - 1;
+    size_t line = parse_number_back(text, number_end);
+    if (line != 0 && number_end != 0) {
+      location.m_line = line;
+      location.m_column = first;
+      end = number_end;
+    }
+  }
+  if (text[end - 1] != (f_msvc ? '(' : ':') || end == 1) {
+    return std::nullopt;
+  }
+  location.m_file = text.substr(0, end - 1);
+  return location;
+}
+
+std::filesystem::path resolve(EnvStringView file,
+                              const std::filesystem::path &base_dir) {
+  std::filesystem::path path{file};
+  return path.is_absolute() ? path : base_dir / path;
+}
+} // namespace
+
+namespace winenv {
+std::string_view clipboard_kind_name(ClipboardKind kind) noexcept {
+  switch (kind) {
+  case ClipboardKind::url:
+    return "url";
+  case ClipboardKind::path:
+    return "path";
+  case ClipboardKind::location:
+    return "location";
+  case ClipboardKind::hash:
+    return "hash";
+  case ClipboardKind::text:
+    break;
+  }
+  return "text";
+}
+
+std::optional<ClipboardKind> parse_clipboard_kind(std::string_view name) {
+  for (size_t i = 0; i < g_n_clipboard_kinds; ++i) {
+    auto kind = static_cast<ClipboardKind>(i);
+    if (clipboard_kind_name(kind) == name) {
+      return kind;
+    }
+  }
+  return std::nullopt;
+}
+
+ClipboardClass classify_clipboard(EnvStringView text,
+                                  const std::filesystem::path &base_dir,
+                                  StatCache &stats) {
+  ClipboardClass result;
+  text = trim(text);
+  if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+    text = trim(text.substr(1, text.size() - 2));
+  }
+  result.m_text = text;
+  if (text.size() > max_routed_size) {
+    return result;
+  }
+  ScanResult scanned = scan(text);
+  if (text.empty() || (scanned.m_any & line_break)) {
+    return result;
+  }
+  if ((scanned.m_all & url_char) &&
+      (has_url_scheme(text) || starts_with_www(text))) {
+    result.m_kind = ClipboardKind::url;
+    return result;
+  }
+  if (is_guid(text) ||
+      ((scanned.m_all & hex_digit) && (scanned.m_any & dec_digit) &&
+       (scanned.m_any & hex_letter) && text.size() >= min_hash_size &&
+       text.size() <= max_hash_size)) {
+    result.m_kind = ClipboardKind::hash;
+    return result;
+  }
+  if (!(scanned.m_all & path_char) || !(scanned.m_any & path_mark) ||
+      text.size() > max_path_size) {
+    return result;
+  }
+  try {
+    if (std::optional<Location> location = split_location(text)) {
+      std::filesystem::path path = resolve(location->m_file, base_dir);
+      if (stats.status(path) == std::filesystem::file_type::regular) {
+        result.m_kind = ClipboardKind::location;
+        result.m_path = std::move(path);
+        result.m_line = location->m_line;
+        result.m_column = location->m_column;
+        return result;
+      }
+    }
+    std::filesystem::path path = resolve(text, base_dir);
+    if (stats.status(path) != std::filesystem::file_type::not_found) {
+      result.m_kind = ClipboardKind::path;
+      result.m_path = std::move(path);
+    }
+  } catch (std::exception &) { // Текст, не преобразуемый в путь
+  }
+  return result;
+}
+} // namespace winenv
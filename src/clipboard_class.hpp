@@ -0,0 +1,55 @@
+#pragma once
+#include "env_snapshot.hpp"
+#include "fs_cache.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace winenv {
+// Вид текста в буфере обмена
+enum class ClipboardKind {
+  // Адрес со схемой ("https://...", "ftp://...") или начинающийся с "www."
+  url,
+  // Существующий файл или директория
+  path,
+  // Существующий файл со строкой: "main.cpp:12", "main.cpp:12:5",
+  // "main.cpp(12)", "main.cpp(12,5)"
+  location,
+  // GUID или шестнадцатеричный хэш длиной от 7 до 128 символов
+  hash,
+  // Все остальное, в том числе многострочный текст
+  text
+};
+constexpr size_t g_n_clipboard_kinds = 5;
+
+// Названия видов в CLIPBOARD_ROUTES: "url", "path", "location", "hash",
+// "text"
+std::string_view clipboard_kind_name(ClipboardKind kind) noexcept;
+std::optional<ClipboardKind> parse_clipboard_kind(std::string_view name);
+
+struct ClipboardClass {
+  ClipboardKind m_kind{ClipboardKind::text};
+  // Текст без пробельных символов по краям. Ссылается на исходный текст
+  EnvStringView m_text;
+  // Для path и location - путь, для относительного пути - от base_dir
+  std::filesystem::path m_path;
+  // Для location - номер строки и столбца с единицы, 0 - столбец не задан
+  size_t m_line{0};
+  size_t m_column{0};
+};
+
+// Определяет вид текста за один проход по таблице классов символов.
+// Многострочный текст определяется по первому переводу строки без
+// просмотра остатка. Файловая система проверяется только для текста,
+// похожего на путь: без запрещенных в путях символов, с разделителем
+// директорий или точкой. Путь можно заключить в кавычки, как при
+// копировании пути в проводнике.
+// Пример:
+// StatCache stats;
+// ClipboardClass cls = classify_clipboard(L"src\\main.cpp:12", dir, stats);
+// // cls.m_kind == ClipboardKind::location, cls.m_line == 12
+ClipboardClass classify_clipboard(EnvStringView text,
+                                  const std::filesystem::path &base_dir,
+                                  StatCache &stats);
+} // namespace winenv
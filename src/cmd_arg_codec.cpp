@@ -0,0 +1,222 @@
+#include "cmd_arg_codec.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+// Первый символ диапазона: 4096 подряд идущих иероглифов CJK
+constexpr std::uint32_t base_char = 0x4E00;
+constexpr std::uint32_t unit_values = 1 << 12;
+// Версия, 3 нулевых байта, длина и контрольная сумма в порядке little-endian
+constexpr size_t header_size = 12;
+constexpr size_t header_units = header_size / 3 * 2;
+
+std::uint32_t fnv1a(const unsigned char *data, size_t size) noexcept {
+  std::uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+void write_le32(unsigned char *out, std::uint32_t value) noexcept {
+  for (size_t i = 0; i < 4; ++i) {
+    out[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+std::uint32_t read_le32(const unsigned char *in) noexcept {
+  std::uint32_t value{0};
+  for (size_t i = 0; i < 4; ++i) {
+    value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+size_t encoded_units(size_t size) noexcept { return (size + 2) / 3 * 2; }
+
+wchar_t *encode_group(std::uint32_t group, wchar_t *out) noexcept {
+  out[0] = static_cast<wchar_t>(base_char + (group & (unit_values - 1)));
+  out[1] = static_cast<wchar_t>(base_char + (group >> 12));
+  return out + 2;
+}
+
+#ifdef WINENV_SIMD_X86
+// 8 символов в 16-битных полях регистра
+WINENV_TARGET("ssse3") void store_units(wchar_t *out, __m128i units) {
+  if constexpr (sizeof(wchar_t) == 2) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), units);
+  } else {
+    __m128i zero = _mm_setzero_si128();
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                     _mm_unpacklo_epi16(units, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4),
+                     _mm_unpackhi_epi16(units, zero));
+  }
+}
+
+// Символы вне 16 бит насыщаются и не проходят проверку диапазона
+WINENV_TARGET("ssse3") __m128i load_units(const wchar_t *in) {
+  if constexpr (sizeof(wchar_t) == 2) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+  } else {
+    return _mm_packs_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 4)));
+  }
+}
+
+// Кодирует блоки по 12 байт. Читает по 16 байт, поэтому останавливается
+// раньше конца данных. Возвращает число закодированных байт
+WINENV_TARGET("ssse3")
+size_t encode_blocks_ssse3(const unsigned char *in, size_t size,
+                           wchar_t *out) {
+  // Для каждой тройки байт b0 b1 b2: поле (b0, b1) и поле (b1, b2)
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+  const __m128i low_mask = _mm_set1_epi32(0x00000FFF);
+  const __m128i high_mask = _mm_set1_epi32(static_cast<int>(0xFFFF0000));
+  const __m128i base = _mm_set1_epi16(static_cast<short>(base_char));
+  size_t i = 0;
+  for (; i + 16 <= size; i += 12, out += 8) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    __m128i pairs = _mm_shuffle_epi8(bytes, shuffle);
+    // Младшие 12 бит тройки в четных полях, старшие - в нечетных
+    __m128i units =
+        _mm_or_si128(_mm_and_si128(pairs, low_mask),
+                     _mm_and_si128(_mm_srli_epi16(pairs, 4), high_mask));
+    store_units(out, _mm_add_epi16(units, base));
+  }
+  return i;
+}
+
+// Раскодирует блоки по 8 символов. Записывает по 16 байт, поэтому
+// останавливается раньше конца. Возвращает число раскодированных символов
+WINENV_TARGET("ssse3")
+size_t decode_blocks_ssse3(const wchar_t *in, size_t n_units,
+                           unsigned char *out, bool &is_valid) {
+  const __m128i base = _mm_set1_epi16(static_cast<short>(base_char));
+  const __m128i over_mask = _mm_set1_epi16(static_cast<short>(0xF000));
+  // Пара полей (v0, v1) складывается в v0 + v1 * 4096
+  const __m128i weights = _mm_set1_epi32(0x10000001);
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13,
+                                        14, -1, -1, -1, -1);
+  __m128i over = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 12 <= n_units; i += 8, out += 12) {
+    __m128i units = _mm_sub_epi16(load_units(in + i), base);
+    over = _mm_or_si128(over, _mm_and_si128(units, over_mask));
+    __m128i groups = _mm_madd_epi16(units, weights);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                     _mm_shuffle_epi8(groups, shuffle));
+  }
+  is_valid = _mm_movemask_epi8(_mm_cmpeq_epi8(over, _mm_setzero_si128())) ==
+             0xFFFF;
+  return i;
+}
+#endif
+
+// Дописывает нули до целой тройки байт
+wchar_t *encode_bytes(const unsigned char *in, size_t size, wchar_t *out) {
+  size_t i = 0;
+#ifdef WINENV_SIMD_X86
+  if (winenv::has_ssse3()) {
+    i = encode_blocks_ssse3(in, size, out);
+    out += i / 3 * 2;
+  }
+#endif
+  for (; i + 3 <= size; i += 3) {
+    out = encode_group(in[i] | in[i + 1] << 8 | in[i + 2] << 16, out);
+  }
+  if (i < size) {
+    std::uint32_t group = in[i];
+    if (i + 1 < size) {
+      group |= in[i + 1] << 8;
+    }
+    out = encode_group(group, out);
+  }
+  return out;
+}
+
+// n_units должно быть четным. Возвращает false, если встретился символ вне
+// диапазона
+bool decode_units(const wchar_t *in, size_t n_units, unsigned char *out) {
+  size_t i = 0;
+#ifdef WINENV_SIMD_X86
+  if (winenv::has_ssse3()) {
+    bool is_valid{false};
+    i = decode_blocks_ssse3(in, n_units, out, is_valid);
+    if (!is_valid) {
+      return false;
+    }
+    out += i / 2 * 3;
+  }
+#endif
+  for (; i < n_units; i += 2, out += 3) {
+    std::uint32_t low = static_cast<std::uint32_t>(in[i]) - base_char;
+    std::uint32_t high = static_cast<std::uint32_t>(in[i + 1]) - base_char;
+    if (low >= unit_values || high >= unit_values) {
+      return false;
+    }
+    std::uint32_t group = low | high << 12;
+    out[0] = static_cast<unsigned char>(group);
+    out[1] = static_cast<unsigned char>(group >> 8);
+    out[2] = static_cast<unsigned char>(group >> 16);
+  }
+  return true;
+}
+} // namespace
+
+namespace winenv {
+std::wstring encode_cmd_arg(const void *data, size_t size) {
+  if (size > UINT32_MAX) {
+    throw std::length_error("Command line argument is too long");
+  }
+  auto bytes = static_cast<const unsigned char *>(data);
+  unsigned char header[header_size]{};
+  header[0] = g_cmd_arg_version;
+  write_le32(header + 4, static_cast<std::uint32_t>(size));
+  write_le32(header + 8, fnv1a(bytes, size));
+
+  std::wstring arg_str(header_units + encoded_units(size), L'\0');
+  wchar_t *out = encode_bytes(header, header_size, arg_str.data());
+  encode_bytes(bytes, size, out);
+  return arg_str;
+}
+
+std::pair<std::vector<unsigned char>, size_t>
+decode_cmd_arg(std::wstring_view arg_str) {
+  size_t arg_end = std::min(arg_str.find(L' '), arg_str.size());
+  std::wstring_view arg = arg_str.substr(0, arg_end);
+  unsigned char header[header_size];
+  if (arg.size() < header_units ||
+      !decode_units(arg.data(), header_units, header)) {
+    throw std::runtime_error("Command line argument header is malformed");
+  }
+  if (header[0] != g_cmd_arg_version) {
+    throw std::runtime_error("Command line argument version " +
+                             std::to_string(header[0]) + " is not supported");
+  }
+  std::uint32_t size = read_le32(header + 4);
+  if (header[1] != 0 || header[2] != 0 || header[3] != 0 ||
+      arg.size() - header_units != encoded_units(size)) {
+    throw std::runtime_error("Command line argument length is malformed");
+  }
+  size_t n_units = arg.size() - header_units;
+  std::vector<unsigned char> bytes(n_units / 2 * 3);
+  if (!decode_units(arg.data() + header_units, n_units, bytes.data())) {
+    throw std::runtime_error("Command line argument is malformed");
+  }
+  // Дописанные при кодировании байты должны быть нулевыми
+  if (std::any_of(bytes.begin() + size, bytes.end(),
+                  [](unsigned char byte) { return byte != 0; })) {
+    throw std::runtime_error("Command line argument padding is malformed");
+  }
+  bytes.resize(size);
+  if (fnv1a(bytes.data(), bytes.size()) != read_le32(header + 8)) {
+    throw std::runtime_error("Command line argument checksum mismatch");
+  }
+  return {std::move(bytes), arg_end};
+}
+} // namespace winenv
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace winenv {
+// Кодирование двоичных данных в аргумент командной строки.
+// Каждые 3 байта записываются двумя символами из диапазона
+// [U+4E00, U+5DFF], по 12 бит в символе. В нем нет пробелов, кавычек,
+// обратной косой черты и суррогатов, поэтому аргумент передается без
+// экранирования. Перед данными - заголовок из 8 символов: версия формата,
+// длина данных и контрольная сумма FNV-1a. Кодирование и раскодирование
+// выполняются блоками по 12 байт командами SSSE3, если процессор их
+// поддерживает
+constexpr unsigned g_cmd_arg_version = 1;
+
+std::wstring encode_cmd_arg(const void *data, size_t size);
+// Раскодирует аргумент в начале строки. Аргумент заканчивается пробелом
+// или концом строки. Вторым элементом возвращает позицию после аргумента.
+// Выбрасывает std::runtime_error, если аргумент поврежден, обрезан или
+// записан другой версией формата
+std::pair<std::vector<unsigned char>, size_t>
+decode_cmd_arg(std::wstring_view arg_str);
+
+// Создает широкую строку, которую можно передать как параметр командной
+// строки
+template <class Ty> std::wstring cmd_arg_from(const Ty &data) {
+  static_assert(std::is_trivially_copyable_v<Ty>);
+  return encode_cmd_arg(&data, sizeof(Ty));
+}
+
+// Создает объект из аргумента командой строки, полученного методом
+// cmd_arg_from. Вторым элементом возвращает позицию после аргумента.
+// Данные длиннее Ty допустимы: их записала более новая версия структуры,
+// дописавшая поля в конец
+template <class Ty>
+std::pair<Ty, size_t> cmd_arg_to(std::wstring_view arg_str) {
+  static_assert(std::is_trivially_copyable_v<Ty>);
+  auto [bytes, arg_end] = decode_cmd_arg(arg_str);
+  if (bytes.size() < sizeof(Ty)) {
+    throw std::runtime_error("Command line argument is too short");
+  }
+  Ty data;
+  std::memcpy(&data, bytes.data(), sizeof(Ty));
+  return {data, arg_end};
+}
+} // namespace winenv
@@ -0,0 +1,236 @@
+#include "command_line.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+using winenv::ArgQuoting;
+using winenv::ProcString;
+using winenv::ProcStringView;
+using Char = ProcString::value_type;
+
+bool is_blank(Char c) noexcept { return c == Char(' ') || c == Char('\t'); }
+
+bool needs_quotes(ProcStringView arg) noexcept {
+  return arg.empty() ||
+         std::any_of(arg.begin(), arg.end(), [](Char c) {
+           return is_blank(c) || c == Char('\n') || c == Char('\v') ||
+                  c == Char('"');
+         });
+}
+
+bool is_shell_meta(Char c) noexcept {
+  switch (c) {
+  case Char('('):
+  case Char(')'):
+  case Char('%'):
+  case Char('!'):
+  case Char('^'):
+  case Char('"'):
+  case Char('<'):
+  case Char('>'):
+  case Char('&'):
+  case Char('|'):
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Записывает символ, для cmd.exe экранируя метасимволы
+Char *put(Char c, Char *out, ArgQuoting quoting) noexcept {
+  if (quoting == ArgQuoting::shell && is_shell_meta(c)) {
+    *out++ = Char('^');
+  }
+  *out++ = c;
+  return out;
+}
+
+Char *write_quoted_arg(ProcStringView arg, Char *out,
+                       ArgQuoting quoting) noexcept {
+  if (!needs_quotes(arg)) {
+    for (Char c : arg) {
+      out = put(c, out, quoting);
+    }
+    return out;
+  }
+  out = put(Char('"'), out, quoting);
+  size_t n_backslashes = 0;
+  for (Char c : arg) {
+    if (c == Char('\\')) {
+      ++n_backslashes;
+      continue;
+    }
+    // Обратные косые черты перед кавычкой экранируются, как и сама кавычка
+    size_t n_escaped = c == Char('"') ? n_backslashes * 2 + 1 : n_backslashes;
+    out = std::fill_n(out, n_escaped, Char('\\'));
+    out = put(c, out, quoting);
+    n_backslashes = 0;
+  }
+  // Перед закрывающей кавычкой
+  out = std::fill_n(out, n_backslashes * 2, Char('\\'));
+  return put(Char('"'), out, quoting);
+}
+
+size_t skip_blanks(ProcStringView cmd_line, size_t pos) noexcept {
+  while (pos < cmd_line.size() && is_blank(cmd_line[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+} // namespace
+
+namespace winenv {
+size_t quoted_arg_size(ProcStringView arg, ArgQuoting quoting) noexcept {
+  // По одной ^ на каждый метасимвол аргумента и на добавленные кавычки
+  size_t n_carets{0};
+  if (quoting == ArgQuoting::shell) {
+    n_carets = std::count_if(arg.begin(), arg.end(), is_shell_meta) +
+               (needs_quotes(arg) ? 2 : 0);
+  }
+  if (!needs_quotes(arg)) {
+    return arg.size() + n_carets;
+  }
+  size_t size = 2 + n_carets;
+  size_t n_backslashes = 0;
+  for (Char c : arg) {
+    if (c == Char('\\')) {
+      ++n_backslashes;
+      continue;
+    }
+    size += (c == Char('"') ? n_backslashes * 2 + 1 : n_backslashes) + 1;
+    n_backslashes = 0;
+  }
+  return size + n_backslashes * 2;
+}
+
+ProcString build_command_line(ProcStringView program,
+                              const std::vector<ProcString> &args,
+                              ArgQuoting quoting) {
+  if (program.find(Char('"')) != ProcStringView::npos) {
+    throw std::invalid_argument("Program name must not contain quotes");
+  }
+  bool is_program_quoted =
+      program.empty() ||
+      std::any_of(program.begin(), program.end(), is_blank);
+  size_t size = program.size() + (is_program_quoted ? 2 : 0);
+  for (const ProcString &arg : args) {
+    size += 1 + quoted_arg_size(arg, quoting);
+  }
+  if (size >= g_max_command_line) {
+    throw std::length_error("Command line of " + std::to_string(size) +
+                            " characters exceeds the limit of " +
+                            std::to_string(g_max_command_line - 1));
+  }
+
+  ProcString cmd_line(size, Char('\0'));
+  Char *out = cmd_line.data();
+  if (is_program_quoted) {
+    *out++ = Char('"');
+  }
+  out = std::copy(program.begin(), program.end(), out);
+  if (is_program_quoted) {
+    *out++ = Char('"');
+  }
+  for (const ProcString &arg : args) {
+    *out++ = Char(' ');
+    out = write_quoted_arg(arg, out, quoting);
+  }
+  return cmd_line;
+}
+
+std::vector<ProcString> parse_command_line(ProcStringView cmd_line) {
+  std::vector<ProcString> args;
+  if (cmd_line.empty()) {
+    return args;
+  }
+  // Имя программы заканчивается на следующей кавычке или пробеле
+  size_t pos{0};
+  if (cmd_line[0] == Char('"')) {
+    size_t end = std::min(cmd_line.find(Char('"'), 1), cmd_line.size());
+    args.emplace_back(cmd_line.substr(1, end - 1));
+    pos = std::min(end + 1, cmd_line.size());
+  } else {
+    pos = std::find_if(cmd_line.begin(), cmd_line.end(), is_blank) -
+          cmd_line.begin();
+    args.emplace_back(cmd_line.substr(0, pos));
+  }
+
+  for (pos = skip_blanks(cmd_line, pos); pos < cmd_line.size();
+       pos = skip_blanks(cmd_line, pos)) {
+    ProcString arg;
+    size_t n_backslashes = 0;
+    // Нечетное - внутри кавычек. Три кавычки подряд дают одну литеральную
+    unsigned n_quotes = 0;
+    for (; pos < cmd_line.size(); ++pos) {
+      Char c = cmd_line[pos];
+      if (is_blank(c) && n_quotes == 0) {
+        break;
+      }
+      if (c != Char('"')) {
+        n_backslashes = c == Char('\\') ? n_backslashes + 1 : 0;
+        arg += c;
+        continue;
+      }
+      // Из 2n обратных косых черт перед кавычкой остается n, кавычка
+      // переключает режим. Из 2n + 1 остается n и литеральная кавычка
+      if (n_backslashes % 2 == 0) {
+        arg.resize(arg.size() - n_backslashes / 2);
+        ++n_quotes;
+      } else {
+        arg.resize(arg.size() - n_backslashes / 2 - 1);
+        arg += Char('"');
+      }
+      n_backslashes = 0;
+      while (pos + 1 < cmd_line.size() && cmd_line[pos + 1] == Char('"')) {
+        ++pos;
+        if (++n_quotes == 3) {
+          arg += Char('"');
+          n_quotes = 0;
+        }
+      }
+      if (n_quotes == 2) {
+        n_quotes = 0;
+      }
+    }
+    args.push_back(std::move(arg));
+  }
+  return args;
+}
+
+ArgBatchPlan plan_arg_batches(size_t base_size,
+                              const std::vector<ProcString> &args,
+                              size_t max_args, size_t max_size,
+                              ArgQuoting quoting) {
+  ArgBatchPlan plan;
+  ArgBatch batch{0, 0, base_size};
+  for (size_t i = 0; i < args.size(); ++i) {
+    size_t arg_size = 1 + quoted_arg_size(args[i], quoting);
+    if (base_size + arg_size >= max_size) {
+      // Пакет - непрерывный диапазон, поэтому пропуск его завершает
+      if (batch.m_count != 0) {
+        plan.m_batches.push_back(batch);
+        batch = {0, 0, base_size};
+      }
+      plan.m_oversized.push_back(i);
+      continue;
+    }
+    bool is_full = (max_args != 0 && batch.m_count == max_args) ||
+                   batch.m_size + arg_size >= max_size;
+    if (batch.m_count != 0 && is_full) {
+      plan.m_batches.push_back(batch);
+      batch = {i, 0, base_size};
+    }
+    if (batch.m_count == 0) {
+      batch.m_first = i;
+    }
+    ++batch.m_count;
+    batch.m_size += arg_size;
+  }
+  if (batch.m_count != 0) {
+    plan.m_batches.push_back(batch);
+  }
+  return plan;
+}
+} // namespace winenv
@@ -0,0 +1,82 @@
+#pragma once
+#include "process.hpp"
+
+#include <vector>
+
+namespace winenv {
+// Предел длины командной строки CreateProcessW, включая завершающий ноль
+constexpr size_t g_max_command_line = 32767;
+// Предел длины команды cmd.exe, меньший, чем у CreateProcessW
+constexpr size_t g_max_shell_command_line = 8191;
+
+// Сборка и разбор командной строки по правилам CommandLineToArgvW.
+// Первый аргумент - имя программы, у него особые правила: он заканчивается
+// на следующей кавычке или пробеле, обратная косая черта не экранирует,
+// поэтому кавычки в нем недопустимы. Остальные аргументы берутся в кавычки,
+// если содержат пробельные символы или кавычки, а обратные косые черты
+// перед кавычкой удваиваются. Для любых аргументов без нулевых символов
+// parse_command_line(build_command_line(program, args)) возвращает
+// {program, args...}.
+// Пример:
+// ProcString cmd_line =
+//     build_command_line(L"C:\\Program Files\\nvim\\nvim-qt.exe",
+//                        {L"C:\\my files\\a.txt", L"b.txt"});
+// // "C:\Program Files\nvim\nvim-qt.exe" "C:\my files\a.txt" b.txt
+
+// Правила записи аргументов
+enum class ArgQuoting {
+  // По правилам CommandLineToArgvW
+  argv,
+  // Для команды, которую выполняет cmd.exe: после кавычек по правилам
+  // CommandLineToArgvW перед каждым из ( ) % ! ^ " < > & | ставится ^.
+  // cmd.exe убирает ^ и не видит ни кавычек, ни перенаправлений, а в
+  // ^%VAR^% ищет переменную VAR^, которой нет, и оставляет %VAR%
+  shell
+};
+
+// Длина аргумента в командной строке
+size_t quoted_arg_size(ProcStringView arg,
+                       ArgQuoting quoting = ArgQuoting::argv) noexcept;
+// Собирает командную строку с одним выделением памяти: длина вычисляется
+// заранее. Имя программы всегда записывается по правилам argv, quoting
+// относится к аргументам. Выбрасывает std::length_error, если строка не
+// помещается в g_max_command_line, и std::invalid_argument, если в имени
+// программы есть кавычки
+ProcString build_command_line(ProcStringView program,
+                              const std::vector<ProcString> &args,
+                              ArgQuoting quoting = ArgQuoting::argv);
+// Разбивает командную строку на аргументы, первый - имя программы. Для
+// пустой строки возвращает пустой список, а не путь текущей программы,
+// как CommandLineToArgvW
+std::vector<ProcString> parse_command_line(ProcStringView cmd_line);
+
+// Подряд идущие аргументы одной командной строки: [m_first, m_first + m_count)
+struct ArgBatch {
+  size_t m_first{0};
+  size_t m_count{0};
+  // Длина командной строки вместе с base_size
+  size_t m_size{0};
+};
+
+// Раскладка аргументов по командным строкам. Аргументы, которые не
+// помещаются даже поодиночке, пропускаются и перечисляются в m_oversized
+struct ArgBatchPlan {
+  std::vector<ArgBatch> m_batches;
+  std::vector<size_t> m_oversized;
+};
+
+// Делит args на пакеты с сохранением порядка так, чтобы каждая командная
+// строка из base_size символов и аргументов пакета была короче max_size.
+// base_size - длина строки без пакета: имя программы и общие аргументы,
+// max_args - предел числа аргументов в пакете, 0 - без предела, quoting -
+// правила записи аргументов, как в build_command_line.
+// Пример:
+// ProcString base = build_command_line(exe_path, {});
+// for (const ArgBatch &batch : plan_arg_batches(base.size(), files).m_batches)
+//   ... // Запуск с files[batch.m_first .. batch.m_first + batch.m_count)
+ArgBatchPlan plan_arg_batches(size_t base_size,
+                              const std::vector<ProcString> &args,
+                              size_t max_args = 0,
+                              size_t max_size = g_max_command_line,
+                              ArgQuoting quoting = ArgQuoting::argv);
+} // namespace winenv
@@ -11,6 +11,13 @@ extern std::mt19937 g_rand_gen;
 
 using Path = std::filesystem::path;
 constexpr size_t g_max_file_path = MAX_PATH;
+// Сообщения главному потоку от фоновых потоков
+// Завершился дочерний процесс, записи забираются у ProcessSupervisor
+constexpr UINT g_wm_child_exit = WM_APP + 1;
+// Отметка этапа запуска от дочерней консоли, см. StageReporter
+constexpr UINT g_wm_spawn_stage = WM_APP + 2;
+// Фоновый поток построил индекс файлов для HK_FILE_PICK
+constexpr UINT g_wm_file_index = WM_APP + 3;
 // Сигнатура обработчика оконных событий windows
 using WindowProcedure = LRESULT(HWND, UINT, WPARAM, LPARAM);
 } // namespace winenv
@@ -14,8 +14,36 @@ boost::json::value parse_config(std::string_view file_name) {
 AppConfig::AppConfig(std::string_view file_name) {
   *this = boost::json::value_to<AppConfig>(parse_config(file_name));
 }
+
+const ActionConfig &AppConfig::get_action(const std::string &name) const {
+  static const ActionConfig default_action{};
+  auto iter = actions.find(name);
+  return iter == actions.end() ? default_action : iter->second;
+}
 } // namespace winenv
 
+namespace {
+// Числа и размеры из .json. Отрицательное значение или значение больше
+// max - ошибка конфигурации, а не огромное беззнаковое число
+std::uint64_t to_unsigned(const boost::json::value &number, const char *name,
+                          std::uint64_t max = SIZE_MAX) {
+  if (!number.is_uint64()) {
+    std::int64_t signed_number = number.as_int64();
+    if (signed_number < 0) {
+      throw std::runtime_error(std::string{"Negative "} + name + ": " +
+                               std::to_string(signed_number));
+    }
+  }
+  std::uint64_t unsigned_number = number.to_number<std::uint64_t>();
+  if (unsigned_number > max) {
+    throw std::runtime_error(std::string{name} + " is out of range 0.." +
+                             std::to_string(max) + ": " +
+                             std::to_string(unsigned_number));
+  }
+  return unsigned_number;
+}
+} // namespace
+
 namespace boost::json {
 winenv::Path tag_invoke(value_to_tag<winenv::Path>, value const &jv) {
   return jv.as_string().c_str();
@@ -38,6 +66,55 @@ winenv::Hotkey tag_invoke(value_to_tag<winenv::Hotkey>, value const &jv) {
   return winenv::operator""_hk(jstring.c_str(), jstring.size());
 }
 
+winenv::ProcessPriority tag_invoke(value_to_tag<winenv::ProcessPriority>,
+                                   value const &jv) {
+  using winenv::ProcessPriority;
+  static constexpr std::pair<std::string_view, ProcessPriority> names[] = {
+      {"idle", ProcessPriority::idle},
+      {"below_normal", ProcessPriority::below_normal},
+      {"normal", ProcessPriority::normal},
+      {"above_normal", ProcessPriority::above_normal},
+      {"high", ProcessPriority::high}};
+  std::string_view name = jv.as_string();
+  for (auto &[brief, priority] : names) {
+    if (brief == name) {
+      return priority;
+    }
+  }
+  throw std::runtime_error("Unknown PRIORITY: " + std::string{name});
+}
+
+winenv::ProcessLimits tag_invoke(value_to_tag<winenv::ProcessLimits>,
+                                 value const &jv) {
+  constexpr size_t mebibyte = 1024 * 1024;
+  const object &jobj = jv.as_object();
+  winenv::ProcessLimits limits;
+  if (const value *priority = jobj.if_contains("PRIORITY")) {
+    limits.m_priority = value_to<winenv::ProcessPriority>(*priority);
+  }
+  if (const value *affinity = jobj.if_contains("AFFINITY")) {
+    if (affinity->is_array()) {
+      for (const value &cpu : affinity->as_array()) {
+        std::uint64_t index = to_unsigned(cpu, "AFFINITY CPU", 63);
+        limits.m_affinity_mask |= std::uint64_t{1} << index;
+      }
+    } else {
+      limits.m_affinity_mask = to_unsigned(*affinity, "AFFINITY");
+    }
+  }
+  if (const value *working_set = jobj.if_contains("WORKING_SET_MB")) {
+    limits.m_working_set_limit =
+        to_unsigned(*working_set, "WORKING_SET_MB", SIZE_MAX / mebibyte) *
+        mebibyte;
+  }
+  if (const value *job_memory = jobj.if_contains("JOB_MEMORY_MB")) {
+    limits.m_job_memory_limit =
+        to_unsigned(*job_memory, "JOB_MEMORY_MB", SIZE_MAX / mebibyte) *
+        mebibyte;
+  }
+  return limits;
+}
+
 winenv::AppConfig tag_invoke(boost::json::value_to_tag<winenv::AppConfig>,
                              boost::json::value const &jv) {
   using namespace winenv;
@@ -46,11 +123,114 @@ winenv::AppConfig tag_invoke(boost::json::value_to_tag<winenv::AppConfig>,
   boost::json::object jobj = jv.as_object();
   AppConfig c;
 
-  c.root_offset = value_to<Path>(jobj["ROOT_OFFSET"]);
-  c.apps_dir = value_to<Path>(jobj["APPS_DIR"]);
-  c.apps_data = value_to<Path>(jobj["APPS_DATA"]);
-  c.xdg_home = value_to<Path>(jobj["XDGHOME"]);
-  c.apps_bin_paths = value_to<std::vector<Path>>(jobj["APPS_BIN_PATHS"]);
+  // Шаблоны только разбираются, значения раскрываются при настройке среды
+  for (const char *name : {"ROOT_OFFSET", "APPS_DIR", "APPS_DATA", "XDGHOME"}) {
+    c.variables.define(name, jobj[name].as_string());
+  }
+  if (boost::json::value *user_vars = jobj.if_contains("VARIABLES")) {
+    for (auto &[name, raw_value] : user_vars->as_object()) {
+      c.variables.define(std::string{name}, raw_value.as_string());
+    }
+  }
+  c.apps_bin_paths =
+      value_to<std::vector<std::string>>(jobj["APPS_BIN_PATHS"]);
+  if (boost::json::value *use_shims = jobj.if_contains("USE_SHIMS")) {
+    c.use_shims = use_shims->as_bool();
+  }
+  if (boost::json::value *env = jobj.if_contains("ENVIRONMENT")) {
+    for (auto &[name, raw_value] : env->as_object()) {
+      c.environment.push_back(
+          {std::string{name}, ExpandTemplate{raw_value.as_string()}});
+    }
+  }
+  if (boost::json::value *actions = jobj.if_contains("ACTIONS")) {
+    for (auto &[name, raw_action] : actions->as_object()) {
+      ActionConfig action;
+      action.limits = value_to<ProcessLimits>(raw_action);
+      action.limits.m_group_name = name;
+      const object &action_obj = raw_action.as_object();
+      if (const value *exe = action_obj.if_contains("EXECUTABLE")) {
+        action.executable = exe->as_string().c_str();
+      }
+      if (const value *shell = action_obj.if_contains("USE_SHELL")) {
+        action.use_shell = shell->as_bool();
+      }
+      if (const value *max_args = action_obj.if_contains("MAX_BATCH_ARGS")) {
+        action.max_batch_args = to_unsigned(*max_args, "MAX_BATCH_ARGS");
+      }
+      if (const value *parallel = action_obj.if_contains("PARALLEL_BATCHES")) {
+        action.parallel_batches = parallel->as_bool();
+      }
+      if (const value *to_stdin = action_obj.if_contains("CLIPBOARD_STDIN")) {
+        action.clipboard_stdin = to_stdin->as_bool();
+      }
+      c.actions.insert({std::string{name}, std::move(action)});
+    }
+  }
+  if (boost::json::value *pool_size = jobj.if_contains("CONSOLE_POOL_SIZE")) {
+    c.console_pool_size = to_unsigned(*pool_size, "CONSOLE_POOL_SIZE");
+  }
+  if (boost::json::value *include = jobj.if_contains("DROP_INCLUDE")) {
+    c.drop_filter.m_include = value_to<std::vector<std::string>>(*include);
+  }
+  if (boost::json::value *exclude = jobj.if_contains("DROP_EXCLUDE")) {
+    c.drop_filter.m_exclude = value_to<std::vector<std::string>>(*exclude);
+  }
+  if (boost::json::value *max_files = jobj.if_contains("DROP_MAX_FILES")) {
+    c.drop_max_files = to_unsigned(*max_files, "DROP_MAX_FILES");
+  }
+  if (boost::json::value *dirs = jobj.if_contains("FILE_PICK_DIRS")) {
+    c.file_pick_dirs = value_to<std::vector<std::string>>(*dirs);
+  }
+  c.file_pick_filter.m_exclude = c.drop_filter.m_exclude;
+  if (boost::json::value *exclude = jobj.if_contains("FILE_PICK_EXCLUDE")) {
+    c.file_pick_filter.m_exclude =
+        value_to<std::vector<std::string>>(*exclude);
+  }
+  if (boost::json::value *max_files =
+          jobj.if_contains("FILE_PICK_MAX_FILES")) {
+    c.file_pick_max_files = to_unsigned(*max_files, "FILE_PICK_MAX_FILES");
+  }
+  if (boost::json::value *engines = jobj.if_contains("SEARCH_ENGINES")) {
+    for (auto &[prefix, url_template] : engines->as_object()) {
+      c.search_engines.add(std::string{prefix},
+                           url_template.as_string().c_str());
+    }
+  }
+  if (c.search_engines.empty()) {
+    c.search_engines.add("", "https://www.google.com/search?q=${query}");
+  }
+  if (boost::json::value *routes = jobj.if_contains("CLIPBOARD_ROUTES")) {
+    for (auto &[name, raw_route] : routes->as_object()) {
+      std::optional<ClipboardKind> kind = parse_clipboard_kind(name);
+      if (!kind) {
+        throw std::runtime_error("Unknown CLIPBOARD_ROUTES kind: " +
+                                 std::string{name});
+      }
+      std::string route = raw_route.as_string().c_str();
+      bool f_file =
+          *kind == ClipboardKind::path || *kind == ClipboardKind::location;
+      if (route != "browser" && (route != "editor" || !f_file)) {
+        throw std::runtime_error("Unsupported CLIPBOARD_ROUTES action for " +
+                                 std::string{name} + ": " + route);
+      }
+      c.clipboard_routes[static_cast<size_t>(*kind)] = std::move(route);
+    }
+  }
+  if (boost::json::value *history = jobj.if_contains("CLIP_HISTORY_SIZE")) {
+    c.clip_history_size = to_unsigned(*history, "CLIP_HISTORY_SIZE");
+  }
+  if (boost::json::value *history_kb = jobj.if_contains("CLIP_HISTORY_KB")) {
+    // Размер в байтах не должен переполнять size_t
+    c.clip_history_kb =
+        to_unsigned(*history_kb, "CLIP_HISTORY_KB", SIZE_MAX / 1024);
+  }
+  if (boost::json::value *server = jobj.if_contains("EDITOR_SERVER")) {
+    c.editor_server = server->as_string().c_str();
+  }
+  if (boost::json::value *open_cmd = jobj.if_contains("EDITOR_OPEN_COMMAND")) {
+    c.editor_open_command = open_cmd->as_string().c_str();
+  }
   c.term_color_table =
       value_to<std::vector<RgbColor>>(jobj["TERM_COLOR_TABLE"]);
   c.foreground = value_to<ConsoleColor>(jobj["COLOR_FG"]);
@@ -63,6 +243,12 @@ winenv::AppConfig tag_invoke(boost::json::value_to_tag<winenv::AppConfig>,
   c.launch_browser_hk = value_to<Hotkey>(jobj["HK_LAUNCH_BROWSER"]);
   c.file_pick_hk = value_to<Hotkey>(jobj["HK_FILE_PICK"]);
   c.exit_hk = value_to<Hotkey>(jobj["HK_EXIT"]);
+  if (boost::json::value *hk = jobj.if_contains("HK_SHOW_PROCESSES")) {
+    c.show_processes_hk = value_to<Hotkey>(*hk);
+  }
+  if (boost::json::value *hk = jobj.if_contains("HK_CLIP_HISTORY")) {
+    c.clip_history_hk = value_to<Hotkey>(*hk);
+  }
 
   return c;
 }
@@ -1,25 +1,92 @@
 #pragma once
+#include "clipboard_class.hpp"
 #include "color.hpp"
 #include "common.hpp"
+#include "expand.hpp"
+#include "file_walker.hpp"
 #include "hkey.hpp"
+#include "process.hpp"
+#include "search_url.hpp"
 
 #include <boost/json.hpp>
 
+#include <array>
 #include <fstream>
+#include <map>
+#include <optional>
 
 namespace winenv {
 // Считывает файл в json объект
 boost::json::value parse_config(std::string_view file_name);
+// Параметры одного действия из ACTIONS: spawn_cmd, browser, editor
+struct ActionConfig {
+  ProcessLimits limits;
+  // Программа действия: имя для поиска в APPS_BIN_PATHS и PATH или полный
+  // путь. Пустая строка - программа действия по умолчанию
+  std::string executable;
+  // Запускать через "cmd /C start" вместо прямого запуска
+  bool use_shell{false};
+  // Предел числа аргументов одного запуска, 0 - без предела. Аргументы
+  // сверх предела или длины командной строки передаются следующим запускам
+  size_t max_batch_args{0};
+  // Запускать процессы нескольких пакетов аргументов параллельно
+  bool parallel_batches{false};
+  // Передавать текст буфера обмена в стандартный ввод в UTF-8 вместо
+  // аргумента командной строки
+  bool clipboard_stdin{false};
+};
+
 // Параметры приложения, хранящиеся в .json файле
 struct AppConfig {
   AppConfig() = default;
   AppConfig(std::string_view file_name);
+  // Параметры действия или параметры по умолчанию, если их нет в ACTIONS
+  const ActionConfig &get_action(const std::string &name) const;
 
-  Path root_offset;
-  Path apps_dir;
-  Path apps_data;
-  Path xdg_home;
-  std::vector<Path> apps_bin_paths;
+  // Пути ROOT_OFFSET, APPS_DIR, APPS_DATA, XDGHOME и пользовательские
+  // переменные из VARIABLES. Могут ссылаться друг на друга, на flash_root и
+  // на переменные среды: "${flash_root}/cache", "%LOCALAPPDATA%"
+  VarExpander variables;
+  // Шаблоны путей, раскрываются через variables
+  std::vector<std::string> apps_bin_paths;
+  // Добавлять в PATH одну директорию прокладок вместо APPS_BIN_PATHS
+  bool use_shims{false};
+  // Дополнительные переменные среды дочерних процессов из ENVIRONMENT.
+  // Значения - шаблоны, раскрываемые через variables
+  std::vector<std::pair<std::string, ExpandTemplate>> environment;
+  std::map<std::string, ActionConfig> actions;
+  // Число заранее настроенных скрытых консолей, 0 - без пула
+  size_t console_pool_size{0};
+  // Отбор текстовых файлов в перетащенных директориях: DROP_INCLUDE и
+  // DROP_EXCLUDE
+  FileFilter drop_filter;
+  // Предел числа файлов из перетащенных директорий, 0 - без предела
+  size_t drop_max_files{0};
+  // Директории, кроме flash_root, в которых HK_FILE_PICK ищет файлы по
+  // набранным буквам. Шаблоны путей от flash_root, раскрываются через
+  // variables
+  std::vector<std::string> file_pick_dirs;
+  // Исключения FILE_PICK_EXCLUDE, по умолчанию - как у DROP_EXCLUDE
+  FileFilter file_pick_filter;
+  // Предел числа файлов в индексе, 0 - без предела
+  size_t file_pick_max_files{1'000'000};
+  // Адрес --listen редактора Neovim, которому передаются перетащенные
+  // файлы. Пустая строка - каждый раз запускать новый редактор
+  std::string editor_server;
+  // Команда Ex, которой редактор открывает переданные файлы
+  std::string editor_open_command{"tabedit"};
+  // Шаблоны адресов поиска из SEARCH_ENGINES по префиксам запроса
+  SearchEngines search_engines;
+  // Действия для видов текста в буфере обмена из CLIPBOARD_ROUTES, по
+  // порядку ClipboardKind: "browser" или "editor". Редактор открывает
+  // только path и location
+  std::array<std::string, g_n_clipboard_kinds> clipboard_routes{
+      "browser", "editor", "editor", "browser", "browser"};
+  // Число запоминаемых текстов буфера обмена, 0 - без истории
+  size_t clip_history_size{0};
+  // Память под тексты истории буфера обмена в КиБ, она же предел длины
+  // одного текста в UTF-8
+  size_t clip_history_kb{1024};
   std::vector<RgbColor> term_color_table;
   ConsoleColor foreground;
   ConsoleColor background;
@@ -31,6 +98,10 @@ struct AppConfig {
   Hotkey launch_browser_hk{'B'};
   Hotkey file_pick_hk{'C'};
   Hotkey exit_hk{'D'};
+  // Необязательное сочетание для вывода сводки по дочерним процессам
+  std::optional<Hotkey> show_processes_hk;
+  // Необязательное сочетание для перебора истории буфера обмена
+  std::optional<Hotkey> clip_history_hk;
 };
 
 } // namespace winenv
@@ -42,6 +113,13 @@ winenv::ConsoleColor tag_invoke(value_to_tag<winenv::ConsoleColor>,
                                 value const &jv);
 winenv::RgbColor tag_invoke(value_to_tag<winenv::RgbColor>, value const &jv);
 winenv::Hotkey tag_invoke(value_to_tag<winenv::Hotkey>, value const &jv);
+// "idle", "below_normal", "normal", "above_normal", "high"
+winenv::ProcessPriority tag_invoke(value_to_tag<winenv::ProcessPriority>,
+                                   value const &jv);
+// PRIORITY, AFFINITY (маска или массив номеров процессоров),
+// WORKING_SET_MB, JOB_MEMORY_MB. Все параметры необязательны
+winenv::ProcessLimits tag_invoke(value_to_tag<winenv::ProcessLimits>,
+                                 value const &jv);
 // Для приведения к типу AppConfig. Определяет названия соответсвующих
 // параметров в .json файле
 winenv::AppConfig tag_invoke(boost::json::value_to_tag<winenv::AppConfig>,
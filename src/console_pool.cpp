@@ -0,0 +1,202 @@
+#include "console_pool.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr std::wstring_view pool_prefix = L"pool ";
+
+// Читает десятичное число до пробела
+template <class Ty>
+bool parse_number(std::wstring_view str, size_t &pos, Ty &value) {
+  size_t end = str.find(L' ', pos);
+  if (end == std::wstring_view::npos || end == pos) {
+    return false;
+  }
+  std::string digits;
+  for (size_t i = pos; i < end; ++i) {
+    if (str[i] < L'0' || str[i] > L'9') {
+      return false;
+    }
+    digits += static_cast<char>(str[i]);
+  }
+  auto [last, error_code] =
+      std::from_chars(digits.data(), digits.data() + digits.size(), value);
+  if (error_code != std::errc{}) {
+    return false;
+  }
+  pos = end + 1;
+  return true;
+}
+
+HANDLE open_event(const std::wstring &name) {
+  HANDLE event = OpenEventW(SYNCHRONIZE | EVENT_MODIFY_STATE, false,
+                            name.c_str());
+  if (event == nullptr) {
+    throw winenv::WinError("Failed to open pool event " +
+                               winenv::narrow_string(name),
+                           GetLastError());
+  }
+  return event;
+}
+} // namespace
+
+namespace winenv {
+std::wstring PoolTicket::to_cmd_prefix() const {
+  return std::wstring{pool_prefix} + std::to_wstring(m_parent_pid) + L' ' +
+         std::to_wstring(m_seq) + L' ';
+}
+
+std::optional<std::pair<PoolTicket, size_t>>
+PoolTicket::parse(std::wstring_view cmdline) {
+  // Закодированные настройки консоли не содержат пробелов, поэтому не
+  // могут начинаться с префикса
+  if (cmdline.substr(0, pool_prefix.size()) != pool_prefix) {
+    return std::nullopt;
+  }
+  PoolTicket ticket;
+  size_t pos = pool_prefix.size();
+  if (!parse_number(cmdline, pos, ticket.m_parent_pid) ||
+      !parse_number(cmdline, pos, ticket.m_seq)) {
+    throw std::runtime_error("Malformed console pool command line");
+  }
+  return std::pair{ticket, pos};
+}
+
+std::wstring PoolTicket::event_name(std::wstring_view kind) const {
+  return L"Local\\WinEnvPool." + std::to_wstring(m_parent_pid) + L'.' +
+         std::to_wstring(m_seq) + L'.' + std::wstring{kind};
+}
+
+PooledConsole::PooledConsole(PoolTicket ticket) : m_ticket{ticket} {
+  m_ready = CreateEventW(nullptr, false, false,
+                         m_ticket.event_name(L"ready").c_str());
+  m_go =
+      CreateEventW(nullptr, false, false, m_ticket.event_name(L"go").c_str());
+  if (m_ready == nullptr || m_go == nullptr) {
+    DWORD err = GetLastError();
+    release();
+    throw WinError("Failed to create console pool events", err);
+  }
+}
+
+PooledConsole::~PooledConsole() { release(); }
+
+PooledConsole::PooledConsole(PooledConsole &&other) {
+  *this = std::move(other);
+}
+
+PooledConsole &PooledConsole::operator=(PooledConsole &&other) {
+  if (this == &other) {
+    return *this;
+  }
+  release();
+  m_ticket = other.m_ticket;
+  m_ready = std::exchange(other.m_ready, nullptr);
+  m_go = std::exchange(other.m_go, nullptr);
+  m_process = std::move(other.m_process);
+  return *this;
+}
+
+void PooledConsole::set_process(Process process) {
+  m_process = std::move(process);
+}
+
+void PooledConsole::wait_ready(DWORD milliseconds, HANDLE cancel) {
+  HANDLE handles[] = {m_ready, m_process.get_handle(), cancel};
+  DWORD n_handles = cancel != nullptr ? 3 : 2;
+  DWORD result =
+      WaitForMultipleObjects(n_handles, handles, false, milliseconds);
+  if (result == WAIT_OBJECT_0) {
+    return;
+  }
+  if (result == WAIT_OBJECT_0 + 1) {
+    DWORD exit_code{0};
+    GetExitCodeProcess(m_process.get_handle(), &exit_code);
+    throw std::runtime_error("Pooled console exited during setup with code " +
+                             std::to_string(exit_code));
+  }
+  if (result == WAIT_OBJECT_0 + 2) {
+    throw std::runtime_error("Pooled console setup was cancelled");
+  }
+  if (result == WAIT_TIMEOUT) {
+    throw std::runtime_error("Pooled console setup timed out");
+  }
+  throw WinError("Failed while waiting pooled console", GetLastError());
+}
+
+bool PooledConsole::is_alive() {
+  return m_process.get_handle() != nullptr && !m_process.wait_for(0);
+}
+
+Process PooledConsole::hand_over() {
+  // Родитель только что получил WM_HOTKEY и может передать право вывести
+  // окно на передний план
+  AllowSetForegroundWindow(m_process.get_id());
+  if (!SetEvent(m_go)) {
+    throw WinError("Failed to hand over pooled console", GetLastError());
+  }
+  return std::move(m_process);
+}
+
+void PooledConsole::release() noexcept {
+  // Консоль не передана пользователю: она больше не нужна
+  if (m_process.get_handle() != nullptr) {
+    TerminateProcess(m_process.get_handle(), 0);
+    m_process = Process{};
+  }
+  if (m_ready != nullptr) {
+    CloseHandle(m_ready);
+    m_ready = nullptr;
+  }
+  if (m_go != nullptr) {
+    CloseHandle(m_go);
+    m_go = nullptr;
+  }
+}
+
+PoolHandoff::PoolHandoff(PoolTicket ticket) {
+  m_parent = OpenProcess(SYNCHRONIZE, false, ticket.m_parent_pid);
+  if (m_parent == nullptr) {
+    throw WinError("Failed to open console pool owner", GetLastError());
+  }
+  try {
+    m_ready = open_event(ticket.event_name(L"ready"));
+    m_go = open_event(ticket.event_name(L"go"));
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+PoolHandoff::~PoolHandoff() { release(); }
+
+void PoolHandoff::release() noexcept {
+  for (HANDLE *handle : {&m_ready, &m_go, &m_parent}) {
+    if (*handle != nullptr) {
+      CloseHandle(*handle);
+      *handle = nullptr;
+    }
+  }
+}
+
+void PoolHandoff::signal_ready() {
+  if (!SetEvent(m_ready)) {
+    throw WinError("Failed to signal pooled console readiness",
+                   GetLastError());
+  }
+}
+
+bool PoolHandoff::wait_for_hand_over() {
+  HANDLE handles[] = {m_go, m_parent};
+  DWORD result = WaitForMultipleObjects(2, handles, false, INFINITE);
+  if (result == WAIT_OBJECT_0) {
+    return true;
+  }
+  if (result == WAIT_OBJECT_0 + 1) {
+    return false;
+  }
+  throw WinError("Failed while waiting console hand over", GetLastError());
+}
+} // namespace winenv
@@ -0,0 +1,76 @@
+#pragma once
+#include "process.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace winenv {
+// Номер консоли пула. По нему родительский и дочерний процессы находят
+// именованные события передачи консоли
+struct PoolTicket {
+  DWORD m_parent_pid{0};
+  size_t m_seq{0};
+
+  // Префикс командной строки дочернего процесса: "pool <pid> <seq> "
+  std::wstring to_cmd_prefix() const;
+  // Разбирает префикс командной строки. Вторым элементом возвращает длину
+  // префикса
+  static std::optional<std::pair<PoolTicket, size_t>>
+  parse(std::wstring_view cmdline);
+  std::wstring event_name(std::wstring_view kind) const;
+};
+
+// Скрытая настроенная консоль пула на стороне родительского процесса.
+// Если консоль не была передана пользователю, процесс завершается вместе с
+// объектом
+class PooledConsole {
+public:
+  // События создаются до запуска дочернего процесса
+  explicit PooledConsole(PoolTicket ticket);
+  ~PooledConsole();
+  PooledConsole(const PooledConsole &other) = delete;
+  PooledConsole(PooledConsole &&other);
+  PooledConsole &operator=(const PooledConsole &other) = delete;
+  PooledConsole &operator=(PooledConsole &&other);
+
+  void set_process(Process process);
+  // Ждет, пока дочерний процесс настроит консоль. Выбрасывает исключение,
+  // если процесс завершился, не успел или установлено событие cancel
+  void wait_ready(DWORD milliseconds, HANDLE cancel = nullptr);
+  bool is_alive();
+  // Показывает консоль и запускает в ней командную строку
+  Process hand_over();
+
+private:
+  void release() noexcept;
+
+  PoolTicket m_ticket;
+  HANDLE m_ready{nullptr};
+  HANDLE m_go{nullptr};
+  Process m_process;
+};
+
+// Сторона дочернего процесса: сообщает о готовности и ждет передачи
+// консоли пользователю
+class PoolHandoff {
+public:
+  explicit PoolHandoff(PoolTicket ticket);
+  ~PoolHandoff();
+  PoolHandoff(const PoolHandoff &other) = delete;
+  PoolHandoff &operator=(const PoolHandoff &other) = delete;
+
+  void signal_ready();
+  // true - консоль передана пользователю, false - родительский процесс
+  // завершился и консоль больше не нужна
+  bool wait_for_hand_over();
+
+private:
+  void release() noexcept;
+
+  HANDLE m_ready{nullptr};
+  HANDLE m_go{nullptr};
+  HANDLE m_parent{nullptr};
+};
+} // namespace winenv
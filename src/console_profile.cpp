@@ -0,0 +1,80 @@
+#include "console_profile.hpp"
+#include "cmd_arg_codec.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace {
+using winenv::ConsoleProfile;
+
+constexpr std::wstring_view profile_prefix = L"profile ";
+
+// Размер профиля первой версии: меньше не бывает
+constexpr size_t v1_size = offsetof(ConsoleProfile, m_parent_thread_id);
+
+// available - сколько байт профиля доступно для чтения
+void check_profile(const ConsoleProfile &profile, size_t available) {
+  winenv::check_versioned_header(profile.m_header, ConsoleProfile::g_magic,
+                                 v1_size, available, "Console profile");
+}
+} // namespace
+
+namespace winenv {
+std::uint32_t ConsoleProfile::get_parent_thread_id() const noexcept {
+  return m_header.has_field(offsetof(ConsoleProfile, m_parent_thread_id) +
+                            sizeof(m_parent_thread_id))
+             ? m_parent_thread_id
+             : 0;
+}
+
+ConsoleProfileChannel::ConsoleProfileChannel(const ConsoleProfile &profile)
+    : m_copy{profile} {
+  try {
+    m_memory = SharedMemory::create(sizeof(ConsoleProfile));
+    new (m_memory.data()) ConsoleProfile{profile};
+    m_memory.seal();
+  } catch (std::exception &ex) {
+    *g_logger << "Console profile is passed by command line: " << ex.what()
+              << std::endl;
+    m_memory = SharedMemory{};
+  }
+}
+
+std::pair<ConsoleProfileChannel, size_t>
+ConsoleProfileChannel::from_cmd_arg(std::wstring_view cmdline) {
+  ConsoleProfileChannel channel;
+  if (cmdline.substr(0, profile_prefix.size()) != profile_prefix) {
+    // Закодированный профиль не содержит пробелов, поэтому не может
+    // начинаться с префикса
+    // Профиль другой версии может быть короче или длиннее ConsoleProfile
+    auto [bytes, arg_end] = decode_cmd_arg(cmdline);
+    std::memcpy(&channel.m_copy, bytes.data(),
+                std::min(bytes.size(), sizeof(ConsoleProfile)));
+    check_profile(channel.m_copy, bytes.size());
+    return {std::move(channel), arg_end};
+  }
+  size_t handle_pos = profile_prefix.size();
+  size_t arg_end = std::min(cmdline.find(L' ', handle_pos), cmdline.size());
+  channel.m_memory =
+      SharedMemory::open(cmdline.substr(handle_pos, arg_end - handle_pos));
+  check_profile(channel.get(), channel.m_memory.size());
+  return {std::move(channel), arg_end};
+}
+
+std::wstring ConsoleProfileChannel::to_cmd_arg() const {
+  if (m_memory.data() == nullptr) {
+    return cmd_arg_from(m_copy);
+  }
+  return std::wstring{profile_prefix} + m_memory.get_handle();
+}
+
+const ConsoleProfile &ConsoleProfileChannel::get() const noexcept {
+  if (m_memory.data() == nullptr) {
+    return m_copy;
+  }
+  return *static_cast<const ConsoleProfile *>(m_memory.data());
+}
+} // namespace winenv
@@ -0,0 +1,60 @@
+#pragma once
+#include "color.hpp"
+#include "shared_memory.hpp"
+#include "versioned_header.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace winenv {
+// Настройки консоли, общие для всех дочерних консолей. Дочерний процесс
+// читает их прямо из общей памяти без разбора, поля добавляются по
+// правилам VersionedHeader
+struct ConsoleProfile {
+  static constexpr std::uint32_t g_magic = 0x50434557; // "WECP"
+  static constexpr std::uint32_t g_version = 2;
+
+  VersionedHeader m_header{g_magic, g_version, sizeof(ConsoleProfile)};
+  RgbColor m_term_colors[16]{};
+  char m_font_name[32]{};
+  std::uint32_t m_font_size{0};
+  // Версия 2. Поток RootApp, принимающий отметки этапов запуска
+  std::uint32_t m_parent_thread_id{0};
+
+  // 0, если профиль записан версией 1
+  std::uint32_t get_parent_thread_id() const noexcept;
+};
+
+// Передача профиля консоли дочерним процессам. Родительский процесс один раз
+// записывает профиль в общую память, в командную строку дочернего процесса
+// попадает только "profile <метка>". Если общую память создать не удалось,
+// профиль кодируется в командную строку целиком.
+// Пример:
+// ConsoleProfileChannel channel{profile}; // В родительском процессе
+// std::wstring cmd_args = L"_ " + channel.to_cmd_arg();
+// auto [received, arg_end] = ConsoleProfileChannel::from_cmd_arg(cmdline);
+// received.get().m_font_size; // В дочернем процессе
+class ConsoleProfileChannel {
+public:
+  explicit ConsoleProfileChannel(const ConsoleProfile &profile);
+
+  // Читает профиль из начала командной строки. Вторым элементом возвращает
+  // позицию после аргумента. Выбрасывает исключение, если профиль записан
+  // несовместимой версией или поврежден
+  static std::pair<ConsoleProfileChannel, size_t>
+  from_cmd_arg(std::wstring_view cmdline);
+  // Аргумент командной строки без пробелов внутри
+  std::wstring to_cmd_arg() const;
+  const ConsoleProfile &get() const noexcept;
+
+private:
+  ConsoleProfileChannel() = default;
+
+  SharedMemory m_memory;
+  // Используется, если профиль передан в командной строке
+  ConsoleProfile m_copy;
+};
+} // namespace winenv
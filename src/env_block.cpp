@@ -0,0 +1,117 @@
+#include "env_block.hpp"
+
+#include <algorithm>
+
+namespace {
+using Override = winenv::EnvBlock::Delta::value_type;
+
+// Слияние упорядоченного снимка с упорядоченными переопределениями
+winenv::SharedEnvBlock merge(const winenv::EnvSnapshot &base,
+                             const std::vector<const Override *> &overrides) {
+  using winenv::EnvChar;
+  size_t total_size = 1;
+  for (winenv::EnvSnapshot::Variable var : base) {
+    total_size += var.m_entry.size() + 1;
+  }
+  for (const Override *var : overrides) {
+    total_size += var->first.size() + var->second.size() + 2;
+  }
+  auto block = std::make_shared<winenv::EnvString>();
+  block->reserve(total_size);
+  auto append_override = [&block](const Override &v) {
+    if (v.second.empty()) { // Удаление переменной
+      return;
+    }
+    *block += v.first;
+    *block += EnvChar('=');
+    *block += v.second;
+    *block += EnvChar('\0');
+  };
+  auto over_iter = overrides.begin();
+  for (winenv::EnvSnapshot::Variable var : base) {
+    while (over_iter != overrides.end() &&
+           winenv::env_name_less((*over_iter)->first, var.m_name)) {
+      append_override(**over_iter++);
+    }
+    if (over_iter != overrides.end() &&
+        winenv::env_name_equal((*over_iter)->first, var.m_name)) {
+      append_override(**over_iter++);
+    } else {
+      *block += var.m_entry;
+      *block += EnvChar('\0');
+    }
+  }
+  while (over_iter != overrides.end()) {
+    append_override(**over_iter++);
+  }
+  // Пустой блок тоже должен заканчиваться двумя нулевыми символами.
+  // Второй завершающий ноль добавит c_str()
+  if (block->empty()) {
+    *block += EnvChar('\0');
+  }
+  return block;
+}
+} // namespace
+
+namespace winenv {
+EnvBlock EnvBlock::capture() { return EnvBlock{EnvSnapshot::capture()}; }
+
+EnvBlock::EnvBlock(EnvSnapshot base) : m_base{std::move(base)} {}
+
+void EnvBlock::set(EnvStringView name, EnvStringView value) {
+  auto iter = std::lower_bound(m_overrides.begin(), m_overrides.end(), name,
+                               [](const Override &var, EnvStringView n) {
+                                 return env_name_less(var.first, n);
+                               });
+  if (iter != m_overrides.end() && env_name_equal(iter->first, name)) {
+    iter->second = value;
+  } else {
+    m_overrides.insert(iter, {EnvString{name}, EnvString{value}});
+  }
+}
+
+void EnvBlock::unset(EnvStringView name) { set(name, {}); }
+
+const EnvSnapshot &EnvBlock::base() const noexcept { return m_base; }
+
+SharedEnvBlock EnvBlock::build() const {
+  std::vector<const Override *> overrides;
+  overrides.reserve(m_overrides.size());
+  for (const Override &var : m_overrides) {
+    overrides.push_back(&var);
+  }
+  return merge(m_base, overrides);
+}
+
+SharedEnv::SharedEnv(SharedEnvBlock block)
+    : m_block{std::move(block)},
+      mp_snapshot{std::make_shared<const EnvSnapshot>(*m_block)} {}
+
+const SharedEnvBlock &SharedEnv::block() const noexcept { return m_block; }
+
+const EnvSnapshot &SharedEnv::snapshot() const noexcept {
+  return *mp_snapshot;
+}
+
+SharedEnvBlock SharedEnv::with_delta(const EnvBlock::Delta &delta) const {
+  if (delta.empty()) {
+    return m_block;
+  }
+  std::vector<const Override *> overrides;
+  overrides.reserve(delta.size());
+  for (const Override &var : delta) {
+    overrides.push_back(&var);
+  }
+  std::stable_sort(overrides.begin(), overrides.end(),
+                   [](const Override *l, const Override *r) {
+                     return env_name_less(l->first, r->first);
+                   });
+  // Повторное переопределение: остается последнее
+  auto last = std::unique(overrides.rbegin(), overrides.rend(),
+                          [](const Override *l, const Override *r) {
+                            return env_name_equal(l->first, r->first);
+                          });
+  overrides.erase(overrides.begin(), last.base());
+  return merge(*mp_snapshot, overrides);
+}
+} // namespace winenv
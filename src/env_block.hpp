@@ -0,0 +1,67 @@
+#pragma once
+#include "env_snapshot.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+// Готовый блок переменных среды для CreateProcessW:
+// "NAME=value\0NAME=value\0\0"
+using SharedEnvBlock = std::shared_ptr<const EnvString>;
+
+// Построитель блока переменных среды для дочерних процессов.
+// Изменения хранятся отдельно от снимка и сливаются с ним при сборке,
+// записи упорядочены по имени, как того требует CreateProcessW. Среда
+// самого процесса WinEnv не меняется.
+// Пример:
+// EnvBlock env = EnvBlock::capture();
+// env.set(L"XDG_CONFIG_HOME", xdg_home);
+// SharedEnvBlock block = env.build(); // Общий для всех запусков
+class EnvBlock {
+public:
+  // Переопределения одного действия: пустое значение удаляет переменную
+  using Delta = std::vector<std::pair<EnvString, EnvString>>;
+
+  // Снимок среды текущего процесса
+  static EnvBlock capture();
+  EnvBlock() = default;
+  explicit EnvBlock(EnvSnapshot base);
+
+  // Пустое значение удаляет переменную, как и в Delta
+  void set(EnvStringView name, EnvStringView value);
+  void unset(EnvStringView name);
+  // Исходный снимок без изменений
+  const EnvSnapshot &base() const noexcept;
+  // Строит блок один раз, результат можно передавать в каждый запуск
+  SharedEnvBlock build() const;
+
+private:
+  EnvSnapshot m_base;
+  // Упорядочены по имени, имена не повторяются
+  Delta m_overrides;
+};
+
+// Собранный блок вместе с его разбором. Блок разбирается один раз при
+// создании, копии разделяют и блок, и разбор. Переопределения действий
+// сливаются с готовым разбором без повторного разбора блока.
+// Пример:
+// SharedEnv env{builder.build()};
+// SharedEnvBlock block = env.with_delta({{L"LANG", L"C"}});
+class SharedEnv {
+public:
+  SharedEnv() = default;
+  explicit SharedEnv(SharedEnvBlock block);
+
+  const SharedEnvBlock &block() const noexcept;
+  const EnvSnapshot &snapshot() const noexcept;
+  // Блок с переопределениями. Без переопределений возвращает block() без
+  // копирования, иначе объединяет за один проход
+  SharedEnvBlock with_delta(const EnvBlock::Delta &delta) const;
+
+private:
+  SharedEnvBlock m_block;
+  std::shared_ptr<const EnvSnapshot> mp_snapshot;
+};
+} // namespace winenv
@@ -0,0 +1,177 @@
+#include "env_snapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include "utils.hpp"
+#else
+extern char **environ;
+#endif
+
+namespace {
+// Длина имени записи "NAME=value". Скрытые переменные Windows вида
+// "=C:=C:\\" начинаются с '='
+size_t entry_name_size(winenv::EnvStringView entry) noexcept {
+  size_t eq_pos = entry.find(winenv::EnvChar('='), 1);
+  return eq_pos == winenv::EnvStringView::npos ? entry.size() : eq_pos;
+}
+} // namespace
+
+namespace winenv {
+bool env_name_less(EnvStringView left, EnvStringView right) noexcept {
+#ifdef _WIN32
+  size_t n = std::min(left.size(), right.size());
+  for (size_t i = 0; i < n; ++i) {
+    wint_t l = std::towupper(left[i]), r = std::towupper(right[i]);
+    if (l != r) {
+      return l < r;
+    }
+  }
+  return left.size() < right.size();
+#else
+  return left < right;
+#endif
+}
+
+bool env_name_equal(EnvStringView left, EnvStringView right) noexcept {
+  return left.size() == right.size() && !env_name_less(left, right) &&
+         !env_name_less(right, left);
+}
+
+EnvSnapshot::Iterator::Iterator(const EnvSnapshot *owner,
+                                size_t index) noexcept
+    : mp_owner{owner}, m_index{index} {}
+
+EnvSnapshot::Variable EnvSnapshot::Iterator::operator*() const noexcept {
+  return mp_owner->variable(mp_owner->m_vars[m_index]);
+}
+
+EnvSnapshot::Iterator &EnvSnapshot::Iterator::operator++() noexcept {
+  ++m_index;
+  return *this;
+}
+
+bool EnvSnapshot::Iterator::operator==(const Iterator &other) const noexcept {
+  return mp_owner == other.mp_owner && m_index == other.m_index;
+}
+
+bool EnvSnapshot::Iterator::operator!=(const Iterator &other) const noexcept {
+  return !(*this == other);
+}
+
+EnvSnapshot EnvSnapshot::capture() {
+#ifdef _WIN32
+  wchar_t *raw_block = GetEnvironmentStringsW();
+  if (raw_block == nullptr) {
+    throw WinError("Failed to get environment strings", GetLastError());
+  }
+  // Блок заканчивается пустой строкой
+  const wchar_t *end = raw_block;
+  while (*end != L'\0') {
+    end += std::wcslen(end) + 1;
+  }
+  EnvSnapshot snapshot{EnvStringView(raw_block, end - raw_block)};
+  FreeEnvironmentStringsW(raw_block);
+  return snapshot;
+#else
+  // Записи environ разбросаны по памяти: сначала считаем общий размер
+  size_t total_size = 0;
+  for (char **var = environ; *var != nullptr; ++var) {
+    total_size += std::strlen(*var) + 1;
+  }
+  EnvString block;
+  block.reserve(total_size);
+  for (char **var = environ; *var != nullptr; ++var) {
+    block += *var;
+    block += '\0';
+  }
+  return EnvSnapshot{block};
+#endif
+}
+
+EnvSnapshot::EnvSnapshot(EnvStringView block) : m_arena{block} {
+  size_t pos = 0;
+  while (pos < m_arena.size() && m_arena[pos] != EnvChar('\0')) {
+    size_t entry_end = m_arena.find(EnvChar('\0'), pos);
+    if (entry_end == EnvString::npos) {
+      entry_end = m_arena.size();
+    }
+    EnvStringView entry{m_arena.data() + pos, entry_end - pos};
+    m_vars.push_back({pos, entry_name_size(entry), entry.size()});
+    pos = entry_end + 1;
+  }
+  auto less = [this](const Var &l, const Var &r) {
+    return env_name_less(name_of(l), name_of(r));
+  };
+  // Блоки, построенные EnvBlock, уже упорядочены
+  if (!std::is_sorted(m_vars.begin(), m_vars.end(), less)) {
+    std::stable_sort(m_vars.begin(), m_vars.end(), less);
+  }
+  auto last = std::unique(m_vars.rbegin(), m_vars.rend(),
+                          [this](const Var &l, const Var &r) {
+                            return env_name_equal(name_of(l), name_of(r));
+                          });
+  m_vars.erase(m_vars.begin(), last.base());
+}
+
+std::optional<EnvStringView> EnvSnapshot::find(EnvStringView name) const {
+  auto iter = std::lower_bound(m_vars.begin(), m_vars.end(), name,
+                               [this](const Var &var, EnvStringView n) {
+                                 return env_name_less(name_of(var), n);
+                               });
+  if (iter == m_vars.end() || !env_name_equal(name_of(*iter), name)) {
+    return std::nullopt;
+  }
+  return variable(*iter).m_value;
+}
+
+size_t EnvSnapshot::size() const noexcept { return m_vars.size(); }
+
+EnvSnapshot::Iterator EnvSnapshot::begin() const noexcept {
+  return {this, 0};
+}
+
+EnvSnapshot::Iterator EnvSnapshot::end() const noexcept {
+  return {this, m_vars.size()};
+}
+
+EnvSnapshot::Difference EnvSnapshot::diff(const EnvSnapshot &newer) const {
+  // Слияние двух упорядоченных последовательностей
+  Difference difference;
+  auto old_iter = m_vars.begin();
+  auto new_iter = newer.m_vars.begin();
+  while (old_iter != m_vars.end() || new_iter != newer.m_vars.end()) {
+    if (new_iter == newer.m_vars.end() ||
+        (old_iter != m_vars.end() &&
+         env_name_less(name_of(*old_iter), newer.name_of(*new_iter)))) {
+      difference.m_removed.push_back(variable(*old_iter++));
+    } else if (old_iter == m_vars.end() ||
+               env_name_less(newer.name_of(*new_iter), name_of(*old_iter))) {
+      difference.m_added.push_back(newer.variable(*new_iter++));
+    } else {
+      Variable old_var = variable(*old_iter++);
+      Variable new_var = newer.variable(*new_iter++);
+      if (old_var.m_value != new_var.m_value) {
+        difference.m_changed.push_back({old_var, new_var});
+      }
+    }
+  }
+  return difference;
+}
+
+EnvSnapshot::Variable EnvSnapshot::variable(const Var &var) const noexcept {
+  EnvStringView entry{m_arena.data() + var.m_offset, var.m_size};
+  EnvStringView value = var.m_name_size < entry.size()
+                            ? entry.substr(var.m_name_size + 1)
+                            : EnvStringView{};
+  return {entry.substr(0, var.m_name_size), value, entry};
+}
+
+EnvStringView EnvSnapshot::name_of(const Var &var) const noexcept {
+  return {m_arena.data() + var.m_offset, var.m_name_size};
+}
+} // namespace winenv
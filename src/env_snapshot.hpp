@@ -0,0 +1,90 @@
+#pragma once
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+// Windows хранит переменные среды в широких строках
+#ifdef _WIN32
+using EnvChar = wchar_t;
+#else
+using EnvChar = char;
+#endif
+using EnvString = std::basic_string<EnvChar>;
+using EnvStringView = std::basic_string_view<EnvChar>;
+
+// Сравнение имен переменных среды. В Windows регистр не учитывается,
+// в остальных системах имена сравниваются точно
+bool env_name_less(EnvStringView left, EnvStringView right) noexcept;
+bool env_name_equal(EnvStringView left, EnvStringView right) noexcept;
+
+// Снимок переменных среды. Весь блок копируется одним вызовом в одну
+// строку-арену, записи упорядочены по имени, поиск - двоичный.
+// Пример:
+// EnvSnapshot env = EnvSnapshot::capture();
+// std::optional<EnvStringView> path = env.find(L"PATH");
+class EnvSnapshot {
+public:
+  struct Variable {
+    EnvStringView m_name;
+    EnvStringView m_value;
+    // Запись целиком: "NAME=value"
+    EnvStringView m_entry;
+  };
+
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Variable;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Variable;
+
+    Iterator(const EnvSnapshot *owner, size_t index) noexcept;
+    Variable operator*() const noexcept;
+    Iterator &operator++() noexcept;
+    bool operator==(const Iterator &other) const noexcept;
+    bool operator!=(const Iterator &other) const noexcept;
+
+  private:
+    const EnvSnapshot *mp_owner;
+    size_t m_index;
+  };
+
+  // Изменения между двумя снимками
+  struct Difference {
+    std::vector<Variable> m_added;
+    std::vector<Variable> m_removed;
+    // Пары (прежнее значение, новое значение)
+    std::vector<std::pair<Variable, Variable>> m_changed;
+  };
+
+  // Снимок среды текущего процесса
+  static EnvSnapshot capture();
+  EnvSnapshot() = default;
+  // Разбирает блок "NAME=value\0NAME=value\0\0". При повторе имени
+  // остается последнее определение
+  explicit EnvSnapshot(EnvStringView block);
+
+  std::optional<EnvStringView> find(EnvStringView name) const;
+  size_t size() const noexcept;
+  Iterator begin() const noexcept;
+  Iterator end() const noexcept;
+  // Что нужно изменить в этом снимке, чтобы получить newer
+  Difference diff(const EnvSnapshot &newer) const;
+
+private:
+  struct Var {
+    size_t m_offset{0};
+    size_t m_name_size{0};
+    size_t m_size{0};
+  };
+  Variable variable(const Var &var) const noexcept;
+  EnvStringView name_of(const Var &var) const noexcept;
+
+  EnvString m_arena;
+  std::vector<Var> m_vars;
+};
+} // namespace winenv
@@ -0,0 +1,189 @@
+#include "exe_index.hpp"
+#include "fs_cache.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+constexpr std::string_view cache_kind = "exe_index";
+
+// В Windows регистр в именах файлов не учитывается
+std::string fold_case(std::string_view name) {
+  std::string key{name};
+#ifdef _WIN32
+  std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+#endif
+  return key;
+}
+} // namespace
+
+namespace winenv {
+ExecutableIndex::ExecutableIndex(std::filesystem::path cache_file,
+                                 std::vector<std::string> extensions)
+    : m_cache_file{std::move(cache_file)},
+      m_extensions{std::move(extensions)} {
+  for (std::string &ext : m_extensions) {
+    ext = fold_case(ext);
+  }
+  if (m_cache_file.empty()) {
+    return;
+  }
+  // Запись: директория, время изменения, имена файлов
+  for (CacheRecord &record : read_cache_file(m_cache_file, cache_kind)) {
+    if (record.size() < 2) {
+      continue;
+    }
+    try {
+      DirState state{path_from_utf8(record[0]), std::stoll(record[1]), {}};
+      state.m_names.assign(std::make_move_iterator(record.begin() + 2),
+                           std::make_move_iterator(record.end()));
+      m_dirs.push_back(std::move(state));
+    } catch (std::logic_error &) { // Испорченная запись
+    }
+  }
+}
+
+size_t
+ExecutableIndex::refresh(const std::vector<std::filesystem::path> &dirs) {
+  std::unordered_map<std::string, DirState *> known;
+  for (DirState &state : m_dirs) {
+    known.insert({path_to_utf8(state.m_dir), &state});
+  }
+  std::vector<DirState> new_dirs(dirs.size());
+  std::vector<char> rescanned(dirs.size(), false);
+  parallel_for(dirs.size(), [&](size_t i) {
+    DirState &state = new_dirs[i];
+    state.m_dir = dirs[i];
+    // Ошибки директории остаются в ней, чтобы не прерывать обновление
+    // остальных: она считается пустой и будет перечитана при следующем
+    // обновлении
+    try {
+      std::error_code ec;
+      state.m_stamp = get_write_stamp(state.m_dir, ec);
+      if (ec) {
+        return;
+      }
+      auto iter = known.find(path_to_utf8(state.m_dir));
+      if (iter != known.end() && iter->second->m_stamp == state.m_stamp) {
+        state.m_names = iter->second->m_names;
+        return;
+      }
+      rescanned[i] = true;
+      std::filesystem::directory_iterator entry{state.m_dir, ec};
+      for (; !ec && entry != std::filesystem::directory_iterator{};
+           entry.increment(ec)) {
+        std::error_code file_ec;
+        if (!entry->is_regular_file(file_ec)) {
+          continue;
+        }
+        std::string name;
+        try {
+          name = path_to_utf8(entry->path().filename());
+        } catch (std::system_error &) { // Имя не представимо в UTF-8
+          continue;
+        }
+        if (extension_rank(name) != std::string::npos) {
+          state.m_names.push_back(std::move(name));
+        }
+      }
+      if (ec) {
+        state.m_stamp = 0;
+      }
+    } catch (std::exception &) {
+      state.m_names.clear();
+      state.m_stamp = 0;
+    }
+  });
+  m_dirs = std::move(new_dirs);
+  rebuild_index();
+
+  size_t n_rescanned = std::count(rescanned.begin(), rescanned.end(), true);
+  if (!m_cache_file.empty() && n_rescanned != 0) {
+    std::vector<CacheRecord> records;
+    records.reserve(m_dirs.size());
+    for (const DirState &state : m_dirs) {
+      CacheRecord record{path_to_utf8(state.m_dir),
+                         std::to_string(state.m_stamp)};
+      record.insert(record.end(), state.m_names.begin(), state.m_names.end());
+      records.push_back(std::move(record));
+    }
+    // Без кэша следующий запуск лишь перечитает директории
+    try {
+      write_cache_file(m_cache_file, cache_kind, records);
+      m_save_error.clear();
+    } catch (std::exception &err) {
+      m_save_error = err.what();
+    }
+  }
+  return n_rescanned;
+}
+
+std::optional<std::filesystem::path>
+ExecutableIndex::find(std::string_view name) const {
+  auto iter = m_index.find(fold_case(name));
+  if (iter == m_index.end()) {
+    return std::nullopt;
+  }
+  return iter->second;
+}
+
+size_t ExecutableIndex::size() const noexcept { return m_index.size(); }
+
+const std::string &ExecutableIndex::save_error() const noexcept {
+  return m_save_error;
+}
+
+const std::unordered_map<std::string, std::filesystem::path> &
+ExecutableIndex::commands() const noexcept {
+  return m_commands;
+}
+
+size_t ExecutableIndex::extension_rank(std::string_view file_name) const {
+  std::string folded = fold_case(file_name);
+  for (size_t i = 0; i < m_extensions.size(); ++i) {
+    const std::string &ext = m_extensions[i];
+    if (folded.size() > ext.size() &&
+        folded.compare(folded.size() - ext.size(), ext.size(), ext) == 0) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+void ExecutableIndex::rebuild_index() {
+  m_index.clear();
+  m_commands.clear();
+  for (const DirState &state : m_dirs) {
+    // Внутри директории имя без расширения достается файлу с наиболее
+    // приоритетным расширением
+    std::vector<std::pair<size_t, const std::string *>> ranked;
+    ranked.reserve(state.m_names.size());
+    for (const std::string &name : state.m_names) {
+      ranked.push_back({extension_rank(name), &name});
+    }
+    std::stable_sort(
+        ranked.begin(), ranked.end(),
+        [](const auto &l, const auto &r) { return l.first < r.first; });
+    for (auto [rank, name] : ranked) {
+      if (rank == std::string::npos) { // Список расширений изменился
+        continue;
+      }
+      std::filesystem::path full_path = state.m_dir / path_from_utf8(*name);
+      std::string key = fold_case(*name);
+      // Первая директория выигрывает: существующие ключи не перезаписываются
+      m_index.insert({key, full_path});
+      size_t ext_size = m_extensions[rank].size();
+      if (ext_size != 0) {
+        key.resize(key.size() - ext_size);
+        m_index.insert({key, full_path});
+      }
+      m_commands.insert({std::move(key), std::move(full_path)});
+    }
+  }
+}
+} // namespace winenv
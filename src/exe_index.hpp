@@ -0,0 +1,64 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace winenv {
+// Индекс исполняемых файлов в директориях APPS_BIN_PATHS.
+// Сопоставляет имени программы ("chrome.exe" или "chrome") полный путь по
+// тем же правилам, что и поиск по PATH: выигрывает первая директория, внутри
+// директории - первое подходящее расширение. Содержимое директорий
+// сохраняется в файле кэша вместе с временем изменения директории и
+// перечитывается только для изменившихся директорий.
+// Пример:
+// ExecutableIndex index{"exe_index.txt"};
+// index.refresh(bin_dirs);
+// std::optional<Path> chrome = index.find("chrome.exe");
+class ExecutableIndex {
+public:
+  // Если cache_file пустой, кэш не используется.
+  // Расширения перечислены в порядке приоритета, как в PATHEXT
+  explicit ExecutableIndex(std::filesystem::path cache_file = {},
+                           std::vector<std::string> extensions =
+#ifdef _WIN32
+                               {".com", ".exe", ".bat", ".cmd"}
+#else
+                               {""}
+#endif
+  );
+  // Приводит индекс к содержимому директорий. Возвращает число
+  // перечитанных директорий. Недоступные директории считаются пустыми,
+  // ошибка записи кэша запоминается в save_error
+  size_t refresh(const std::vector<std::filesystem::path> &dirs);
+  // Полный путь к программе. Один поиск в хеш-таблице
+  std::optional<std::filesystem::path> find(std::string_view name) const;
+  size_t size() const noexcept;
+  // Причина, по которой последний refresh не записал кэш, или пустая строка
+  const std::string &save_error() const noexcept;
+  // Команды, которые можно набрать без расширения, и пути к ним.
+  // Ключи - имена в UTF-8 без расширения
+  const std::unordered_map<std::string, std::filesystem::path> &
+  commands() const noexcept;
+
+private:
+  struct DirState {
+    std::filesystem::path m_dir;
+    long long m_stamp{0};
+    // Имена исполняемых файлов в UTF-8
+    std::vector<std::string> m_names;
+  };
+  // Позиция расширения в списке приоритетов или npos
+  size_t extension_rank(std::string_view file_name) const;
+  void rebuild_index();
+
+  std::filesystem::path m_cache_file;
+  std::vector<std::string> m_extensions;
+  std::vector<DirState> m_dirs;
+  std::unordered_map<std::string, std::filesystem::path> m_index;
+  std::unordered_map<std::string, std::filesystem::path> m_commands;
+  std::string m_save_error;
+};
+} // namespace winenv
@@ -0,0 +1,234 @@
+#include "expand.hpp"
+
+namespace winenv {
+ExpansionError::ExpansionError(const std::string &str)
+    : std::runtime_error("[Expansion error] " + str) {}
+
+ExpandTemplate::ExpandTemplate(std::string_view raw) {
+  m_text.reserve(raw.size());
+  // Добавляет литерал, объединяя его с предыдущим литералом
+  auto push_literal = [this](std::string_view literal) {
+    if (literal.empty()) {
+      return;
+    }
+    if (!m_segments.empty() && !m_segments.back().mf_variable) {
+      m_segments.back().m_size += literal.size();
+    } else {
+      m_segments.push_back({m_text.size(), literal.size(), false});
+    }
+    m_text += literal;
+  };
+  auto push_variable = [this](std::string_view name) {
+    m_segments.push_back({m_text.size(), name.size(), true});
+    m_text += name;
+  };
+
+  size_t pos = 0;
+  while (pos < raw.size()) {
+    size_t special_pos = raw.find_first_of("$%", pos);
+    if (special_pos == std::string_view::npos) {
+      push_literal(raw.substr(pos));
+      break;
+    }
+    push_literal(raw.substr(pos, special_pos - pos));
+    if (raw[special_pos] == '$') {
+      // Знак '$' без фигурной скобки остается литералом
+      if (special_pos + 1 >= raw.size() || raw[special_pos + 1] != '{') {
+        push_literal(raw.substr(special_pos, 1));
+        pos = special_pos + 1;
+        continue;
+      }
+      size_t close_pos = raw.find('}', special_pos + 2);
+      if (close_pos == std::string_view::npos) {
+        throw ExpansionError("Unterminated \"${\" in \"" + std::string{raw} +
+                             '"');
+      }
+      std::string_view name =
+          raw.substr(special_pos + 2, close_pos - special_pos - 2);
+      if (name.empty()) {
+        throw ExpansionError("Empty variable name in \"" + std::string{raw} +
+                             '"');
+      }
+      push_variable(name);
+      pos = close_pos + 1;
+    } else {
+      size_t close_pos = raw.find('%', special_pos + 1);
+      if (close_pos == special_pos + 1) { // "%%"
+        push_literal("%");
+        pos = close_pos + 1;
+      } else if (close_pos == std::string_view::npos) {
+        // Как и в cmd.exe, одиночный '%' остается литералом
+        push_literal("%");
+        pos = special_pos + 1;
+      } else {
+        push_variable(
+            raw.substr(special_pos + 1, close_pos - special_pos - 1));
+        pos = close_pos + 1;
+      }
+    }
+  }
+}
+
+std::vector<std::string_view> ExpandTemplate::dependencies() const {
+  std::vector<std::string_view> names;
+  for (const Segment &s : m_segments) {
+    if (s.mf_variable) {
+      names.push_back(std::string_view{m_text}.substr(s.m_offset, s.m_size));
+    }
+  }
+  return names;
+}
+
+bool ExpandTemplate::is_literal() const noexcept {
+  for (const Segment &s : m_segments) {
+    if (s.mf_variable) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string ExpandTemplate::render(const Lookup &lookup) const {
+  // Значения запрашиваются один раз. Для типичных шаблонов хватает массива
+  // на стеке
+  static constexpr size_t n_inline_values = 16;
+  std::string_view inline_values[n_inline_values];
+  std::vector<std::string_view> heap_values;
+  std::string_view *values = inline_values;
+  if (m_segments.size() > n_inline_values) {
+    heap_values.resize(m_segments.size());
+    values = heap_values.data();
+  }
+
+  std::string_view text{m_text};
+  size_t total_size = 0;
+  for (size_t i = 0; i < m_segments.size(); ++i) {
+    const Segment &s = m_segments[i];
+    std::string_view piece = text.substr(s.m_offset, s.m_size);
+    if (s.mf_variable) {
+      std::optional<std::string_view> value = lookup(piece);
+      if (!value) {
+        throw ExpansionError("Unknown variable \"" + std::string{piece} +
+                             '"');
+      }
+      piece = *value;
+    }
+    values[i] = piece;
+    total_size += piece.size();
+  }
+
+  std::string result;
+  result.reserve(total_size);
+  for (size_t i = 0; i < m_segments.size(); ++i) {
+    result += values[i];
+  }
+  return result;
+}
+
+VarExpander::VarExpander(Fallback fallback) : m_fallback{std::move(fallback)} {}
+
+void VarExpander::set_fallback(Fallback fallback) {
+  m_fallback = std::move(fallback);
+  invalidate();
+}
+
+void VarExpander::define(std::string name, std::string_view raw_value) {
+  Entry entry{ExpandTemplate{raw_value}, {}, State::pending};
+  invalidate();
+  m_entries.insert_or_assign(std::move(name), std::move(entry));
+}
+
+void VarExpander::define_literal(std::string name, std::string value) {
+  invalidate();
+  // Пустой шаблон не используется: значение уже раскрыто
+  m_entries.insert_or_assign(std::move(name),
+                             Entry{{}, std::move(value), State::resolved});
+}
+
+bool VarExpander::contains(const std::string &name) const {
+  return m_entries.find(name) != m_entries.end();
+}
+
+const std::string &VarExpander::get(const std::string &name) {
+  auto iter = m_entries.find(name);
+  if (iter == m_entries.end()) {
+    throw ExpansionError("Variable \"" + name + "\" is not defined");
+  }
+  return resolve(iter->first, iter->second);
+}
+
+void VarExpander::resolve_all() {
+  for (auto &[name, entry] : m_entries) {
+    resolve(name, entry);
+  }
+}
+
+std::string VarExpander::expand(std::string_view raw) {
+  return render(ExpandTemplate{raw});
+}
+
+std::string VarExpander::render(const ExpandTemplate &tmpl) {
+  return tmpl.render(
+      [this](std::string_view name) { return lookup(name); });
+}
+
+void VarExpander::invalidate() noexcept {
+  for (auto &[name, entry] : m_entries) {
+    // Значения без ссылок на переменные (в том числе заданные
+    // define_literal) не зависят от других определений
+    if (!entry.m_template.is_literal()) {
+      entry.m_state = State::pending;
+      entry.m_value.clear();
+    }
+  }
+  m_fallback_cache.clear();
+}
+
+const std::string &VarExpander::resolve(const std::string &name,
+                                        Entry &entry) {
+  if (entry.m_state == State::resolved) {
+    return entry.m_value;
+  }
+  if (entry.m_state == State::in_progress) {
+    std::string cycle;
+    for (const std::string &n : m_resolve_stack) {
+      cycle += n + " -> ";
+    }
+    cycle += name;
+    m_resolve_stack.clear();
+    throw ExpansionError("Cyclic variable dependency: " + cycle);
+  }
+  entry.m_state = State::in_progress;
+  m_resolve_stack.push_back(name);
+  try {
+    // Зависимости раскрываются рекурсивно внутри lookup
+    entry.m_value = render(entry.m_template);
+  } catch (...) {
+    entry.m_state = State::pending;
+    m_resolve_stack.clear();
+    throw;
+  }
+  m_resolve_stack.pop_back();
+  entry.m_state = State::resolved;
+  return entry.m_value;
+}
+
+std::optional<std::string_view> VarExpander::lookup(std::string_view name) {
+  std::string name_str{name};
+  if (auto iter = m_entries.find(name_str); iter != m_entries.end()) {
+    return std::string_view{resolve(iter->first, iter->second)};
+  }
+  if (!m_fallback) {
+    return std::nullopt;
+  }
+  auto cached = m_fallback_cache.find(name_str);
+  if (cached == m_fallback_cache.end()) {
+    cached =
+        m_fallback_cache.emplace(std::move(name_str), m_fallback(name)).first;
+  }
+  if (!cached->second) {
+    return std::nullopt;
+  }
+  return std::string_view{*cached->second};
+}
+} // namespace winenv
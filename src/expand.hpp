@@ -0,0 +1,96 @@
+#pragma once
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace winenv {
+// Выбрасывается при ошибке разбора шаблона или циклической зависимости
+// переменных
+class ExpansionError : public std::runtime_error {
+public:
+  ExpansionError(const std::string &str);
+};
+
+// Скомпилированный шаблон строки из литералов и ссылок на переменные.
+// Поддерживает записи ${name} и %NAME%, "%%" означает символ '%'.
+// Разбирается один раз, подстановка значений не требует повторного разбора.
+// Пример:
+// ExpandTemplate tmpl{"${flash_root}/cache"};
+// std::string value = tmpl.render(lookup);
+class ExpandTemplate {
+public:
+  // Возвращает значение переменной по имени или std::nullopt
+  using Lookup =
+      std::function<std::optional<std::string_view>(std::string_view)>;
+
+  ExpandTemplate() = default;
+  explicit ExpandTemplate(std::string_view raw);
+  // Имена переменных, на которые ссылается шаблон
+  std::vector<std::string_view> dependencies() const;
+  // Шаблон не содержит ссылок на переменные
+  bool is_literal() const noexcept;
+  // Подставляет значения переменных. Сначала вычисляет итоговый размер,
+  // поэтому строка результата выделяется один раз.
+  // Если значение переменной не найдено, выбросит исключение
+  std::string render(const Lookup &lookup) const;
+
+private:
+  struct Segment {
+    size_t m_offset{0};
+    size_t m_size{0};
+    bool mf_variable{false};
+  };
+  // Литералы и имена переменных хранятся подряд в одной строке
+  std::string m_text;
+  std::vector<Segment> m_segments;
+};
+
+// Набор именованных шаблонов (параметры config.json и пользовательские
+// переменные). Значение переменной раскрывается при первом запросе: сначала
+// раскрываются зависимости (топологический порядок), результат запоминается.
+// Имена, не определенные в наборе, запрашиваются у fallback (переменные среды)
+class VarExpander {
+public:
+  using Fallback =
+      std::function<std::optional<std::string>(std::string_view)>;
+
+  VarExpander(Fallback fallback = {});
+  void set_fallback(Fallback fallback);
+  // Определяет переменную по шаблону. Сбрасывает запомненные значения
+  void define(std::string name, std::string_view raw_value);
+  // Определяет переменную с готовым значением, без разбора шаблона
+  void define_literal(std::string name, std::string value);
+  bool contains(const std::string &name) const;
+  // Раскрывает значение переменной. При циклической зависимости или
+  // неизвестном имени выбросит исключение
+  const std::string &get(const std::string &name);
+  // Раскрывает все определенные переменные
+  void resolve_all();
+  // Раскрывает произвольную строку с учетом определенных переменных
+  std::string expand(std::string_view raw);
+  std::string render(const ExpandTemplate &tmpl);
+
+private:
+  enum class State : unsigned char { pending, in_progress, resolved };
+  struct Entry {
+    ExpandTemplate m_template;
+    std::string m_value;
+    State m_state{State::pending};
+  };
+
+  void invalidate() noexcept;
+  const std::string &resolve(const std::string &name, Entry &entry);
+  std::optional<std::string_view> lookup(std::string_view name);
+
+  std::unordered_map<std::string, Entry> m_entries;
+  // Запомненные значения, полученные от fallback
+  std::unordered_map<std::string, std::optional<std::string>> m_fallback_cache;
+  // Цепочка раскрываемых переменных для сообщения о цикле
+  std::vector<std::string> m_resolve_stack;
+  Fallback m_fallback;
+};
+} // namespace winenv
@@ -0,0 +1,493 @@
+#include "file_index.hpp"
+#include "clip_history.hpp"
+#include "fs_cache.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+constexpr std::string_view file_header = "winenv-files\t2\n";
+// Массивы пишутся как есть, файл с другим порядком байт не загружается
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+// Запрос длиннее не набирают, номер символа запроса помещается в 8 бит
+constexpr size_t max_query_size = 255;
+// Символ запроса в пути директории стоит меньше символа в имени файла
+constexpr int dir_char_score = 8;
+// Маски имен считаются кусками в нескольких потоках
+constexpr size_t mask_block_size = 64 * 1024;
+// Номера файлов и смещения в пуле 32-битные
+constexpr size_t max_pool_size = UINT32_MAX / 2;
+
+// Директория для обхода, ее путь от корня для шаблонов исключения и номер
+struct DirTask {
+  std::filesystem::path m_dir;
+  std::string m_rel_path;
+  std::uint32_t m_id;
+};
+
+// Имена в UTF-8 после отбора шаблонами, отсортированные
+struct DirListing {
+  std::vector<std::string> m_subdirs;
+  std::vector<std::string> m_files;
+};
+
+DirListing list_dir(const DirTask &task, const winenv::FileFilter &filter) {
+  DirListing listing;
+  std::error_code ec;
+  std::filesystem::directory_iterator entry{task.m_dir, ec};
+  // Вызывается из потоков parallel_for: ошибка чтения директории оставляет
+  // прочитанные до нее имена и не прерывает построение индекса
+  for (; !ec && entry != std::filesystem::directory_iterator{};
+       entry.increment(ec)) {
+    std::string name;
+    try {
+      name = winenv::path_to_utf8(entry->path().filename());
+    } catch (const std::system_error &) {
+      // Имя с одиночным суррогатом не переводится в UTF-8
+      continue;
+    }
+    if (name.size() > UINT16_MAX) {
+      continue;
+    }
+    std::string rel_path =
+        task.m_rel_path.empty() ? name : task.m_rel_path + '/' + name;
+    std::error_code entry_ec;
+    if (entry->is_directory(entry_ec)) {
+      if (!entry->is_symlink(entry_ec) && !filter.is_excluded(rel_path)) {
+        listing.m_subdirs.push_back(std::move(name));
+      }
+    } else if (entry->is_regular_file(entry_ec)) {
+      if (!filter.is_excluded(rel_path) && filter.is_included(rel_path)) {
+        listing.m_files.push_back(std::move(name));
+      }
+    }
+  }
+  std::sort(listing.m_subdirs.begin(), listing.m_subdirs.end());
+  std::sort(listing.m_files.begin(), listing.m_files.end());
+  return listing;
+}
+
+template <class Ty> void append_raw(std::string &out, const Ty &value) {
+  static_assert(std::is_trivially_copyable_v<Ty>);
+  out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <class Ty>
+void append_array(std::string &out, const std::vector<Ty> &values) {
+  static_assert(std::is_trivially_copyable_v<Ty>);
+  append_raw<std::uint64_t>(out, values.size());
+  out.append(reinterpret_cast<const char *>(values.data()),
+             values.size() * sizeof(Ty));
+}
+
+void append_string(std::string &out, std::string_view value) {
+  append_raw<std::uint64_t>(out, value.size());
+  out += value;
+}
+
+// Последовательное чтение данных файла с проверкой границ
+class Reader {
+public:
+  explicit Reader(std::string_view data) : m_data{data} {}
+
+  template <class Ty> bool read_raw(Ty &value) noexcept {
+    if (m_data.size() < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, m_data.data(), sizeof(value));
+    m_data.remove_prefix(sizeof(value));
+    return true;
+  }
+
+  template <class Ty> bool read_array(std::vector<Ty> &values) {
+    std::uint64_t size;
+    if (!read_raw(size) || size > m_data.size() / sizeof(Ty)) {
+      return false;
+    }
+    values.resize(size);
+    std::memcpy(values.data(), m_data.data(), size * sizeof(Ty));
+    m_data.remove_prefix(size * sizeof(Ty));
+    return true;
+  }
+
+  bool read_string(std::string &value) {
+    std::uint64_t size;
+    if (!read_raw(size) || size > m_data.size()) {
+      return false;
+    }
+    value.assign(m_data.data(), size);
+    m_data.remove_prefix(size);
+    return true;
+  }
+
+private:
+  std::string_view m_data;
+};
+
+// Начало части запроса, которая помещается в имени: символы ищутся справа
+// налево. Чем больше символов в имени, тем меньше их искать в директориях
+size_t name_tail(const winenv::FuzzyPattern &pattern,
+                 std::string_view name) noexcept {
+  const std::string &text = pattern.text();
+  size_t first = text.size();
+  for (size_t pos = name.size(); pos-- > 0 && first > 0;) {
+    if (pattern.fold(name[pos]) == text[first - 1]) {
+      --first;
+    }
+  }
+  return first;
+}
+
+// Оценка fzf части запроса в имени и меньшие очки за символы в директориях.
+// Младшие биты отданы длине имени: при равной оценке выше короткие имена
+int score_file(const winenv::FuzzyPattern &pattern, std::string_view name,
+               size_t first) noexcept {
+  int score = pattern.score(name, first) +
+              static_cast<int>(first) * dir_char_score;
+  return score * 64 - static_cast<int>(std::min<size_t>(name.size(), 63));
+}
+} // namespace
+
+namespace winenv {
+FileIndex FileIndex::build(const std::vector<std::filesystem::path> &roots,
+                           const FileFilter &filter, size_t max_files,
+                           const std::atomic_bool *f_cancel) {
+  FileIndex index;
+  // Ключи ссылаются на строки списков директорий, которые не перемещаются
+  // до конца построения
+  std::unordered_map<std::string_view, std::uint32_t> interned;
+  auto intern = [&index, &interned](std::string_view name) {
+    auto [iter, f_new] = interned.try_emplace(
+        name, static_cast<std::uint32_t>(index.m_pool.size()));
+    if (f_new) {
+      index.m_pool += name;
+    }
+    return iter->second;
+  };
+  std::vector<std::string> root_names;
+  root_names.reserve(roots.size());
+  std::vector<DirTask> level;
+  for (const std::filesystem::path &root : roots) {
+    root_names.push_back(path_to_utf8(root.filename()));
+    if (root_names.back().empty()) { // Корень диска
+      root_names.back() = path_to_utf8(root);
+    }
+    std::string_view name = root_names.back();
+    auto id = static_cast<std::uint32_t>(index.m_dirs.size());
+    index.m_dirs.push_back({no_parent, intern(name), 0,
+                            static_cast<std::uint16_t>(name.size())});
+    index.m_roots.push_back(path_to_utf8(root));
+    level.push_back({root, {}, id});
+  }
+  std::vector<std::vector<DirListing>> levels;
+  while (!level.empty()) {
+    if ((f_cancel != nullptr && *f_cancel) ||
+        (max_files != 0 && index.m_files.size() >= max_files) ||
+        index.m_pool.size() > max_pool_size ||
+        index.m_files.size() > max_pool_size) {
+      index.mf_truncated = true;
+      break;
+    }
+    std::vector<DirListing> listings(level.size());
+    parallel_for(level.size(),
+                 [&](size_t i) { listings[i] = list_dir(level[i], filter); });
+    std::vector<DirTask> next_level;
+    for (size_t i = 0; i < level.size(); ++i) {
+      const DirTask &task = level[i];
+      index.m_dirs[task.m_id].m_first_file =
+          static_cast<std::uint32_t>(index.m_files.size());
+      for (const std::string &name : listings[i].m_files) {
+        index.m_files.push_back(
+            {intern(name), static_cast<std::uint16_t>(name.size())});
+      }
+      for (const std::string &name : listings[i].m_subdirs) {
+        auto id = static_cast<std::uint32_t>(index.m_dirs.size());
+        index.m_dirs.push_back({task.m_id, intern(name), 0,
+                                static_cast<std::uint16_t>(name.size())});
+        next_level.push_back(
+            {task.m_dir / path_from_utf8(name),
+             task.m_rel_path.empty() ? name : task.m_rel_path + '/' + name,
+             id});
+      }
+    }
+    levels.push_back(std::move(listings));
+    level = std::move(next_level);
+  }
+  // Директории, до которых обход не дошел, остаются без файлов
+  for (const DirTask &task : level) {
+    index.m_dirs[task.m_id].m_first_file =
+        static_cast<std::uint32_t>(index.m_files.size());
+  }
+  index.m_dirs.shrink_to_fit();
+  index.m_files.shrink_to_fit();
+  index.m_pool.shrink_to_fit();
+  index.compute_name_masks();
+  index.compute_path_masks();
+  return index;
+}
+
+FileIndex FileIndex::load(const std::filesystem::path &file) {
+  std::ifstream in(file, std::ios::binary);
+  std::string data;
+  std::error_code ec;
+  auto file_size = std::filesystem::file_size(file, ec);
+  if (!in.good() || ec) {
+    return {};
+  }
+  data.resize(static_cast<size_t>(file_size));
+  in.read(data.data(), static_cast<std::streamsize>(data.size()));
+  if (static_cast<size_t>(in.gcount()) != data.size() ||
+      data.size() < file_header.size() + sizeof(std::uint64_t) ||
+      data.compare(0, file_header.size(), file_header) != 0) {
+    return {};
+  }
+  // Хэш в конце файла проверяет, что файл записан целиком
+  std::string_view body{data.data() + file_header.size(),
+                        data.size() - file_header.size() -
+                            sizeof(std::uint64_t)};
+  std::uint64_t hash;
+  std::memcpy(&hash, body.data() + body.size(), sizeof(hash));
+  if (hash_text(body) != hash) {
+    return {};
+  }
+
+  FileIndex index;
+  Reader reader{body};
+  std::uint32_t order;
+  std::uint8_t f_truncated;
+  std::uint32_t n_roots;
+  if (!reader.read_raw(order) || order != byte_order_mark ||
+      !reader.read_raw(f_truncated) || !reader.read_raw(n_roots)) {
+    return {};
+  }
+  index.mf_truncated = f_truncated != 0;
+  for (std::uint32_t i = 0; i < n_roots; ++i) {
+    if (!reader.read_string(index.m_roots.emplace_back())) {
+      return {};
+    }
+  }
+  if (!reader.read_array(index.m_dirs) || !reader.read_array(index.m_files) ||
+      !reader.read_array(index.m_name_masks) ||
+      !reader.read_string(index.m_pool) ||
+      index.m_name_masks.size() != index.m_files.size()) {
+    return {};
+  }
+  // Ссылки проверяются, чтобы поиск не выходил за пределы массивов
+  auto is_in_pool = [&index](std::uint32_t offset, std::uint16_t size) {
+    return offset <= index.m_pool.size() &&
+           size <= index.m_pool.size() - offset;
+  };
+  std::uint32_t prev_first_file = 0;
+  for (size_t i = 0; i < index.m_dirs.size(); ++i) {
+    const Dir &dir = index.m_dirs[i];
+    bool is_root = i < index.m_roots.size();
+    if ((is_root ? dir.m_parent != no_parent : dir.m_parent >= i) ||
+        !is_in_pool(dir.m_name, dir.m_name_size) ||
+        dir.m_first_file < prev_first_file ||
+        dir.m_first_file > index.m_files.size()) {
+      return {};
+    }
+    prev_first_file = dir.m_first_file;
+  }
+  if (index.m_dirs.size() < index.m_roots.size() ||
+      (!index.m_files.empty() &&
+       (index.m_dirs.empty() || index.m_dirs[0].m_first_file != 0))) {
+    return {};
+  }
+  for (const File &entry : index.m_files) {
+    if (!is_in_pool(entry.m_name, entry.m_name_size)) {
+      return {};
+    }
+  }
+  index.compute_path_masks();
+  return index;
+}
+
+void FileIndex::save(const std::filesystem::path &file) const {
+  std::string data{file_header};
+  append_raw(data, byte_order_mark);
+  append_raw<std::uint8_t>(data, mf_truncated);
+  append_raw(data, static_cast<std::uint32_t>(m_roots.size()));
+  for (const std::string &root : m_roots) {
+    append_string(data, root);
+  }
+  append_array(data, m_dirs);
+  append_array(data, m_files);
+  append_array(data, m_name_masks);
+  append_string(data, m_pool);
+  append_raw(data, hash_text(std::string_view{data}.substr(
+                       file_header.size())));
+
+  std::filesystem::path temp_file = file;
+  temp_file += ".tmp";
+  {
+    std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!out.good()) {
+      throw std::runtime_error("Failed to write file index: " +
+                               path_to_utf8(temp_file));
+    }
+  }
+  std::filesystem::rename(temp_file, file);
+}
+
+size_t FileIndex::size() const noexcept { return m_files.size(); }
+
+size_t FileIndex::dir_count() const noexcept { return m_dirs.size(); }
+
+size_t FileIndex::memory_size() const noexcept {
+  return m_dirs.capacity() * sizeof(Dir) + m_files.capacity() * sizeof(File) +
+         m_pool.capacity() +
+         (m_path_masks.capacity() + m_name_masks.capacity()) *
+             sizeof(std::uint32_t);
+}
+
+bool FileIndex::is_truncated() const noexcept { return mf_truncated; }
+
+std::vector<std::filesystem::path> FileIndex::roots() const {
+  std::vector<std::filesystem::path> roots;
+  for (const std::string &root : m_roots) {
+    roots.push_back(path_from_utf8(root));
+  }
+  return roots;
+}
+
+std::string_view FileIndex::name(size_t file) const noexcept {
+  return pooled(m_files[file].m_name, m_files[file].m_name_size);
+}
+
+std::string FileIndex::relative_path(size_t file) const {
+  std::string rel_path;
+  for (size_t dir : dir_chain(dir_of(file))) {
+    rel_path += pooled(m_dirs[dir].m_name, m_dirs[dir].m_name_size);
+    rel_path += '/';
+  }
+  rel_path += name(file);
+  return rel_path;
+}
+
+std::filesystem::path FileIndex::path(size_t file) const {
+  std::vector<size_t> chain = dir_chain(dir_of(file));
+  std::filesystem::path path = path_from_utf8(m_roots[chain[0]]);
+  for (size_t i = 1; i < chain.size(); ++i) {
+    const Dir &dir = m_dirs[chain[i]];
+    path /= path_from_utf8(pooled(dir.m_name, dir.m_name_size));
+  }
+  return path / path_from_utf8(name(file));
+}
+
+std::vector<FileMatch> FileIndex::find(std::string_view query,
+                                       size_t max_results) {
+  FuzzyPattern pattern{query.substr(0, max_query_size)};
+  std::vector<FileMatch> matches;
+  if (pattern.empty()) {
+    for (size_t i = 0; i < std::min(max_results, m_files.size()); ++i) {
+      matches.push_back({static_cast<std::uint32_t>(i), 0});
+    }
+    return matches;
+  }
+
+  // Сколько символов запроса нашлось в пути директории вместе с "/" после
+  // нее. Родитель обработан раньше потомков
+  std::vector<std::uint8_t> dir_matched(m_dirs.size());
+  for (size_t i = 0; i < m_dirs.size(); ++i) {
+    const Dir &dir = m_dirs[i];
+    size_t matched = dir.m_parent == no_parent ? 0 : dir_matched[dir.m_parent];
+    matched = pattern.advance(matched, pooled(dir.m_name, dir.m_name_size));
+    dir_matched[i] = static_cast<std::uint8_t>(pattern.advance(matched, "/"));
+  }
+  // Маски концов запроса: символы, не найденные в директориях, должны быть
+  // в имени файла. Так файлы отсеиваются без чтения имен
+  std::vector<std::uint32_t> tail_masks(pattern.size() + 1);
+  for (size_t i = pattern.size(); i-- > 0;) {
+    tail_masks[i] = tail_masks[i + 1] | fuzzy_mask(pattern.text().substr(i, 1));
+  }
+  auto make_scorer = [this, &pattern, &dir_matched, &tail_masks] {
+    // Номера файлов в куске растут: директория первого ищется двоичным
+    // поиском, остальных - от предыдущей
+    return [this, &pattern, &dir_matched, &tail_masks,
+            dir = m_dirs.size()](std::uint32_t file) mutable {
+      if (dir == m_dirs.size()) {
+        dir = dir_of(file);
+      }
+      while (dir + 1 < m_dirs.size() && m_dirs[dir + 1].m_first_file <= file) {
+        ++dir;
+      }
+      std::uint32_t need = tail_masks[dir_matched[dir]];
+      if ((m_name_masks[file] & need) != need) {
+        return fuzzy_no_match;
+      }
+      std::string_view file_name = name(file);
+      size_t first = name_tail(pattern, file_name);
+      // Начало запроса ищется в директориях жадно, конец в имени - справа
+      // налево, поэтому путь подходит, только если части сходятся
+      return first <= dir_matched[dir]
+                 ? score_file(pattern, file_name, first)
+                 : fuzzy_no_match;
+    };
+  };
+  for (FuzzyMatch match :
+       m_matcher.find(pattern, m_path_masks, max_results, make_scorer)) {
+    matches.push_back({match.m_index, match.m_score});
+  }
+  return matches;
+}
+
+std::string_view FileIndex::pooled(std::uint32_t offset,
+                                   std::uint16_t size) const noexcept {
+  return {m_pool.data() + offset, size};
+}
+
+size_t FileIndex::dir_of(size_t file) const noexcept {
+  // Последняя директория, файлы которой начинаются не дальше file. Пустые
+  // директории перед ней начинаются там же
+  auto iter = std::upper_bound(
+      m_dirs.begin(), m_dirs.end(), file,
+      [](size_t file, const Dir &dir) { return file < dir.m_first_file; });
+  return static_cast<size_t>(iter - m_dirs.begin()) - 1;
+}
+
+std::vector<size_t> FileIndex::dir_chain(size_t dir) const {
+  std::vector<size_t> chain;
+  for (size_t i = dir; i != no_parent; i = m_dirs[i].m_parent) {
+    chain.push_back(i);
+  }
+  std::reverse(chain.begin(), chain.end());
+  return chain;
+}
+
+void FileIndex::compute_name_masks() {
+  m_name_masks.resize(m_files.size());
+  size_t n_blocks = (m_files.size() + mask_block_size - 1) / mask_block_size;
+  parallel_for(n_blocks, [this](size_t block) {
+    size_t end = std::min(m_files.size(), (block + 1) * mask_block_size);
+    for (size_t file = block * mask_block_size; file < end; ++file) {
+      m_name_masks[file] = fuzzy_mask(name(file));
+    }
+  });
+}
+
+void FileIndex::compute_path_masks() {
+  std::vector<std::uint32_t> dir_masks(m_dirs.size());
+  m_path_masks.resize(m_files.size());
+  for (size_t i = 0; i < m_dirs.size(); ++i) {
+    const Dir &dir = m_dirs[i];
+    std::uint32_t parent_mask =
+        dir.m_parent == no_parent ? 0 : dir_masks[dir.m_parent];
+    dir_masks[i] = parent_mask | fuzzy_mask("/") |
+                   fuzzy_mask(pooled(dir.m_name, dir.m_name_size));
+    size_t files_end =
+        i + 1 < m_dirs.size() ? m_dirs[i + 1].m_first_file : m_files.size();
+    for (size_t file = dir.m_first_file; file < files_end; ++file) {
+      m_path_masks[file] = dir_masks[i] | m_name_masks[file];
+    }
+  }
+  m_matcher.reset();
+}
+} // namespace winenv
@@ -0,0 +1,109 @@
+#pragma once
+#include "file_walker.hpp"
+#include "fuzzy_match.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+struct FileMatch {
+  std::uint32_t m_file;
+  // Больше - лучше
+  int m_score;
+};
+
+// Индекс путей файлов для выбора файла по нескольким набранным буквам.
+// Имена директорий и файлов в UTF-8 лежат в одном пуле строк, одинаковые
+// имена хранятся один раз. Директория хранит номер родителя и первого
+// своего файла, файл - только ссылку на имя: файлы директории лежат подряд
+// и отсортированы по имени, директории идут по уровням вложенности, родитель
+// раньше потомков. Кроме уникальных имен, на файл приходится 8 байт и 8 байт
+// масок символов его пути и имени для отбора при поиске, на директорию - 16.
+// Индекс сохраняется в файл и загружается без разбора путей, поэтому после
+// перезапуска поиск работает сразу, пока индекс строится заново.
+// Пример:
+// FileIndex index = FileIndex::build({root}, filter);
+// index.save("file_index.bin");
+// for (FileMatch match : index.find("rapp", 20)) {
+//   open(index.path(match.m_file));
+// }
+class FileIndex {
+public:
+  FileIndex() = default;
+
+  // Обходит директории roots уровнями, как walk_text_files, но без проверки
+  // содержимого файлов. Исключенные filter директории и файлы не попадают
+  // в индекс. Обход прекращается на уровне, где число файлов достигло
+  // max_files (0 - без предела), или когда f_cancel становится true
+  static FileIndex build(const std::vector<std::filesystem::path> &roots,
+                         const FileFilter &filter, size_t max_files = 0,
+                         const std::atomic_bool *f_cancel = nullptr);
+  // Пустой индекс, если файла нет или он испорчен
+  static FileIndex load(const std::filesystem::path &file);
+  // Записывает во временный файл и заменяет им прежний. Выбрасывает
+  // std::runtime_error, если файл не записать
+  void save(const std::filesystem::path &file) const;
+
+  // Число файлов
+  size_t size() const noexcept;
+  size_t dir_count() const noexcept;
+  // Память массивов и пула строк в байтах
+  size_t memory_size() const noexcept;
+  // Обход был остановлен до конца
+  bool is_truncated() const noexcept;
+  std::vector<std::filesystem::path> roots() const;
+
+  std::string_view name(size_t file) const noexcept;
+  // Путь от корня вместе с именем корневой директории, разделитель "/"
+  std::string relative_path(size_t file) const;
+  std::filesystem::path path(size_t file) const;
+
+  // Не больше max_results файлов, в относительном пути которых есть все
+  // символы query по порядку, лучшие первыми. Символы запроса в имени файла
+  // оцениваются как в fzf, символы в директориях дают меньше очков, при
+  // равной оценке выше короткие имена. Запрос разбирается как FuzzyPattern.
+  // Совпадения запоминаются: запрос, продолжающий прошлый, ищется только
+  // среди них
+  std::vector<FileMatch> find(std::string_view query, size_t max_results);
+
+private:
+  static constexpr std::uint32_t no_parent = UINT32_MAX;
+  struct Dir {
+    // У корней no_parent, корни идут первыми в порядке m_roots
+    std::uint32_t m_parent;
+    std::uint32_t m_name;
+    std::uint32_t m_first_file;
+    std::uint16_t m_name_size;
+    std::uint16_t m_reserved{0};
+  };
+  struct File {
+    std::uint32_t m_name;
+    std::uint16_t m_name_size;
+    std::uint16_t m_reserved{0};
+  };
+
+  std::string_view pooled(std::uint32_t offset,
+                          std::uint16_t size) const noexcept;
+  size_t dir_of(size_t file) const noexcept;
+  // Директории от корня до dir
+  std::vector<size_t> dir_chain(size_t dir) const;
+  // fuzzy_mask имени каждого файла. Маски имен сохраняются вместе с индексом
+  void compute_name_masks();
+  // Маски путей от корня из масок имен файлов и директорий
+  void compute_path_masks();
+
+  // Полные пути корней в UTF-8
+  std::vector<std::string> m_roots;
+  std::vector<Dir> m_dirs;
+  std::vector<File> m_files;
+  std::string m_pool;
+  bool mf_truncated{false};
+  std::vector<std::uint32_t> m_path_masks;
+  std::vector<std::uint32_t> m_name_masks;
+  FuzzyMatcher m_matcher;
+};
+} // namespace winenv
@@ -0,0 +1,228 @@
+#include "file_walker.hpp"
+#include "fs_cache.hpp"
+#include "parallel.hpp"
+#include "text_sniff.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <system_error>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+bool is_separator(char c) noexcept { return c == '/' || c == '\\'; }
+
+bool is_same_char(char pattern_char, char path_char) noexcept {
+  if (is_separator(pattern_char)) {
+    return is_separator(path_char);
+  }
+#ifdef _WIN32
+  return std::tolower(static_cast<unsigned char>(pattern_char)) ==
+         std::tolower(static_cast<unsigned char>(path_char));
+#else
+  return pattern_char == path_char;
+#endif
+}
+
+bool matches_any(const std::vector<std::string> &patterns,
+                 std::string_view rel_path) noexcept {
+  size_t name_pos = rel_path.find_last_of("/\\");
+  std::string_view name = name_pos == std::string_view::npos
+                              ? rel_path
+                              : rel_path.substr(name_pos + 1);
+  return std::any_of(patterns.begin(), patterns.end(),
+                     [rel_path, name](const std::string &pattern) {
+                       bool has_dir = pattern.find_first_of("/\\") !=
+                                      std::string::npos;
+                       return winenv::glob_match(pattern,
+                                                 has_dir ? rel_path : name);
+                     });
+}
+
+std::chrono::microseconds elapsed(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               start);
+}
+
+// Директория для обхода и ее путь от перетащенной директории
+struct DirTask {
+  std::filesystem::path m_dir;
+  std::string m_rel_path;
+};
+
+// Содержимое одной директории после отбора шаблонами
+struct DirListing {
+  std::vector<DirTask> m_subdirs;
+  std::vector<std::filesystem::path> m_files;
+  size_t m_n_excluded{0};
+  // Имена, не переводимые в UTF-8, и сама директория, если ее чтение
+  // прервалось ошибкой
+  size_t m_n_skipped{0};
+};
+
+DirListing list_dir(const DirTask &task, const winenv::FileFilter &filter) {
+  DirListing listing;
+  std::error_code ec;
+  std::filesystem::directory_iterator entry{task.m_dir, ec};
+  // Ошибка чтения директории не прерывает обход остальных: increment с
+  // error_code не бросает исключений, а прочитанное до ошибки остается
+  for (; !ec && entry != std::filesystem::directory_iterator{};
+       entry.increment(ec)) {
+    std::string rel_path = task.m_rel_path.empty() ? "" : task.m_rel_path + '/';
+    try {
+      rel_path += winenv::path_to_utf8(entry->path().filename());
+    } catch (const std::system_error &) {
+      // Имя с одиночным суррогатом не переводится в UTF-8
+      ++listing.m_n_skipped;
+      continue;
+    }
+    std::error_code entry_ec;
+    if (entry->is_directory(entry_ec)) {
+      if (entry->is_symlink(entry_ec)) {
+        continue;
+      }
+      if (filter.is_excluded(rel_path)) {
+        ++listing.m_n_excluded;
+      } else {
+        listing.m_subdirs.push_back({entry->path(), std::move(rel_path)});
+      }
+    } else if (entry->is_regular_file(entry_ec)) {
+      if (filter.is_excluded(rel_path) || !filter.is_included(rel_path)) {
+        ++listing.m_n_excluded;
+      } else {
+        listing.m_files.push_back(entry->path());
+      }
+    }
+  }
+  if (ec) {
+    ++listing.m_n_skipped;
+  }
+  return listing;
+}
+} // namespace
+
+namespace winenv {
+bool glob_match(std::string_view pattern, std::string_view path) noexcept {
+  while (!pattern.empty()) {
+    if (pattern.substr(0, 2) == "**") {
+      pattern.remove_prefix(2);
+      if (!pattern.empty() && is_separator(pattern[0])) {
+        // "**/" - ноль или больше директорий целиком
+        pattern.remove_prefix(1);
+        for (size_t pos = 0;; ++pos) {
+          if (glob_match(pattern, path.substr(pos))) {
+            return true;
+          }
+          pos = path.find_first_of("/\\", pos);
+          if (pos == std::string_view::npos) {
+            return false;
+          }
+        }
+      }
+      for (size_t pos = 0; pos <= path.size(); ++pos) {
+        if (glob_match(pattern, path.substr(pos))) {
+          return true;
+        }
+      }
+      return false;
+    }
+    if (pattern[0] == '*') {
+      pattern.remove_prefix(1);
+      for (size_t pos = 0; pos <= path.size(); ++pos) {
+        if (glob_match(pattern, path.substr(pos))) {
+          return true;
+        }
+        if (pos < path.size() && is_separator(path[pos])) {
+          return false;
+        }
+      }
+      return false;
+    }
+    if (path.empty()) {
+      return false;
+    }
+    if (pattern[0] == '?' ? is_separator(path[0])
+                          : !is_same_char(pattern[0], path[0])) {
+      return false;
+    }
+    pattern.remove_prefix(1);
+    path.remove_prefix(1);
+  }
+  return path.empty();
+}
+
+bool FileFilter::is_excluded(std::string_view rel_path) const noexcept {
+  return matches_any(m_exclude, rel_path);
+}
+
+bool FileFilter::is_included(std::string_view rel_path) const noexcept {
+  return m_include.empty() || matches_any(m_include, rel_path);
+}
+
+std::string WalkStats::to_string() const {
+  return "Walk: " + std::to_string(m_n_dirs) + " dirs, " +
+         std::to_string(m_n_files) + " files, " +
+         std::to_string(m_n_excluded) + " excluded, " +
+         std::to_string(m_n_binary) + " binary, " +
+         std::to_string(m_n_skipped) + " unreadable" +
+         (mf_truncated ? ", truncated" : "") + "; walk " +
+         std::to_string(m_walk_time.count()) + " us, sniff " +
+         std::to_string(m_sniff_time.count()) + " us";
+}
+
+WalkResult walk_text_files(const std::vector<std::filesystem::path> &roots,
+                           const FileFilter &filter, size_t max_files) {
+  WalkResult result;
+  WalkStats &stats = result.m_stats;
+  auto start = Clock::now();
+  std::vector<std::filesystem::path> candidates;
+  std::vector<DirTask> level;
+  for (const std::filesystem::path &root : roots) {
+    level.push_back({root, {}});
+  }
+  while (!level.empty()) {
+    if (max_files != 0 && candidates.size() >= max_files) {
+      stats.mf_truncated = true;
+      break;
+    }
+    std::vector<DirListing> listings(level.size());
+    parallel_for(level.size(),
+                 [&](size_t i) { listings[i] = list_dir(level[i], filter); });
+    stats.m_n_dirs += level.size();
+    std::vector<DirTask> next_level;
+    for (DirListing &listing : listings) {
+      stats.m_n_excluded += listing.m_n_excluded;
+      stats.m_n_skipped += listing.m_n_skipped;
+      candidates.insert(candidates.end(),
+                        std::make_move_iterator(listing.m_files.begin()),
+                        std::make_move_iterator(listing.m_files.end()));
+      next_level.insert(next_level.end(),
+                        std::make_move_iterator(listing.m_subdirs.begin()),
+                        std::make_move_iterator(listing.m_subdirs.end()));
+    }
+    level = std::move(next_level);
+  }
+  stats.m_n_files = candidates.size();
+  stats.m_walk_time = elapsed(start);
+
+  start = Clock::now();
+  std::vector<char> is_text(candidates.size(), false);
+  parallel_for(candidates.size(),
+               [&](size_t i) { is_text[i] = is_text_file(candidates[i]); });
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (is_text[i]) {
+      result.m_files.push_back(std::move(candidates[i]));
+    } else {
+      ++stats.m_n_binary;
+    }
+  }
+  stats.m_sniff_time = elapsed(start);
+
+  std::sort(result.m_files.begin(), result.m_files.end());
+  if (max_files != 0 && result.m_files.size() > max_files) {
+    result.m_files.resize(max_files);
+    stats.mf_truncated = true;
+  }
+  return result;
+}
+} // namespace winenv
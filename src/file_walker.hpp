@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+// Сопоставление пути с шаблоном: "*" - любые символы кроме разделителя,
+// "?" - один такой символ, "**" - любые символы вместе с разделителями,
+// "**/" - ноль или больше директорий. Разделителями считаются "/" и "\".
+// В Windows регистр не учитывается
+bool glob_match(std::string_view pattern, std::string_view path) noexcept;
+
+// Шаблоны отбора файлов. Шаблон без "/" сравнивается с именем файла или
+// директории, шаблон с "/" - с путем от перетащенной директории
+struct FileFilter {
+  // Пустой список - подходят все файлы
+  std::vector<std::string> m_include;
+  // Исключенные директории не обходятся
+  std::vector<std::string> m_exclude;
+
+  bool is_excluded(std::string_view rel_path) const noexcept;
+  bool is_included(std::string_view rel_path) const noexcept;
+};
+
+struct WalkStats {
+  size_t m_n_dirs{0};
+  size_t m_n_files{0};
+  size_t m_n_excluded{0};
+  // Отброшены по содержимому начала файла
+  size_t m_n_binary{0};
+  // Пропущены из-за ошибок: непрочитанные директории и имена, не
+  // переводимые в UTF-8
+  size_t m_n_skipped{0};
+  // Обход остановлен на уровне, где число файлов достигло max_files
+  bool mf_truncated{false};
+  std::chrono::microseconds m_walk_time{0};
+  std::chrono::microseconds m_sniff_time{0};
+
+  std::string to_string() const;
+};
+
+struct WalkResult {
+  // Отсортированы по пути
+  std::vector<std::filesystem::path> m_files;
+  WalkStats m_stats;
+};
+
+// Находит текстовые файлы в директориях roots. Директории одного уровня
+// вложенности читаются параллельно, затем начала найденных файлов
+// проверяются is_text_file тоже параллельно. Символические ссылки на
+// директории не обходятся. Возвращает не больше max_files файлов, 0 - без
+// предела.
+// Пример:
+// FileFilter filter{{"*.cpp", "*.hpp"}, {".git", "build*"}};
+// WalkResult result = walk_text_files({dropped_dir}, filter, 1000);
+// *g_logger << result.m_stats.to_string();
+WalkResult walk_text_files(const std::vector<std::filesystem::path> &roots,
+                           const FileFilter &filter, size_t max_files = 0);
+} // namespace winenv
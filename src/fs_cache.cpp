@@ -0,0 +1,128 @@
+#include "fs_cache.hpp"
+
+#include <fstream>
+
+namespace {
+constexpr std::string_view cache_format_version = "1";
+
+bool is_storable(const winenv::CacheRecord &record) {
+  for (const std::string &field : record) {
+    if (field.find_first_of("\t\n\r") != std::string::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+namespace winenv {
+std::string path_to_utf8(const std::filesystem::path &path) {
+  return path.u8string();
+}
+
+std::filesystem::path path_from_utf8(std::string_view utf8) {
+  return std::filesystem::u8path(utf8.begin(), utf8.end());
+}
+
+long long get_write_stamp(const std::filesystem::path &path,
+                          std::error_code &ec) noexcept {
+  auto time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return 0;
+  }
+  return static_cast<long long>(time.time_since_epoch().count());
+}
+
+std::vector<CacheRecord> read_cache_file(const std::filesystem::path &file,
+                                         std::string_view kind) {
+  std::vector<CacheRecord> records;
+  std::ifstream in(file, std::ios::binary);
+  if (!in.good()) {
+    return records;
+  }
+  std::string line;
+  std::string expected_header{kind};
+  expected_header += '\t';
+  expected_header += cache_format_version;
+  if (!std::getline(in, line) || line != expected_header) {
+    return records;
+  }
+  while (std::getline(in, line)) {
+    CacheRecord record;
+    size_t pos = 0;
+    while (true) {
+      size_t tab_pos = line.find('\t', pos);
+      if (tab_pos == std::string::npos) {
+        record.emplace_back(line, pos);
+        break;
+      }
+      record.emplace_back(line, pos, tab_pos - pos);
+      pos = tab_pos + 1;
+    }
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+void write_cache_file(const std::filesystem::path &file, std::string_view kind,
+                      const std::vector<CacheRecord> &records) {
+  std::filesystem::path temp_file = file;
+  temp_file += ".tmp";
+  {
+    std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+      throw std::runtime_error("Failed to open cache file for write: " +
+                               path_to_utf8(temp_file));
+    }
+    out << kind << '\t' << cache_format_version << '\n';
+    for (const CacheRecord &record : records) {
+      if (!is_storable(record)) {
+        continue;
+      }
+      for (size_t i = 0; i < record.size(); ++i) {
+        if (i != 0) {
+          out << '\t';
+        }
+        out << record[i];
+      }
+      out << '\n';
+    }
+    if (!out.good()) {
+      throw std::runtime_error("Failed to write cache file: " +
+                               path_to_utf8(temp_file));
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_file, file, ec);
+  if (ec) {
+    std::filesystem::remove(temp_file, ec);
+    throw std::runtime_error("Failed to replace cache file: " +
+                             path_to_utf8(file));
+  }
+}
+
+StatCache::StatCache(std::chrono::milliseconds ttl) : m_ttl{ttl} {}
+
+std::filesystem::file_type
+StatCache::status(const std::filesystem::path &path) {
+  auto now = std::chrono::steady_clock::now();
+  auto iter = m_entries.find(path.native());
+  if (iter != m_entries.end() && now - iter->second.m_time < m_ttl) {
+    return iter->second.m_type;
+  }
+  std::error_code ec;
+  std::filesystem::file_type type = std::filesystem::status(path, ec).type();
+  if (ec || type == std::filesystem::file_type::none) {
+    type = std::filesystem::file_type::not_found;
+  }
+  if (iter != m_entries.end()) {
+    iter->second = {type, now};
+  } else {
+    if (m_entries.size() >= g_max_entries) {
+      m_entries.clear();
+    }
+    m_entries.emplace(path.native(), Entry{type, now});
+  }
+  return type;
+}
+} // namespace winenv
@@ -0,0 +1,54 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace winenv {
+// Путь в кодировке UTF-8 для хранения в файлах кэша
+std::string path_to_utf8(const std::filesystem::path &path);
+std::filesystem::path path_from_utf8(std::string_view utf8);
+// Время последнего изменения файла или директории в виде числа.
+// При ошибке заполняет ec и возвращает 0
+long long get_write_stamp(const std::filesystem::path &path,
+                          std::error_code &ec) noexcept;
+
+// Запись файла кэша. В файле поля разделены табуляцией, записи - переводом
+// строки. Первая строка - заголовок с видом кэша и версией формата
+using CacheRecord = std::vector<std::string>;
+
+// Возвращает пустой список, если файла нет или заголовок не совпадает
+std::vector<CacheRecord> read_cache_file(const std::filesystem::path &file,
+                                         std::string_view kind);
+// Записывает во временный файл и заменяет им прежний, чтобы прерванная запись
+// не испортила кэш. Записи с табуляцией или переводом строки в полях
+// пропускаются. При ошибке бросает std::runtime_error, прежний файл остается
+void write_cache_file(const std::filesystem::path &file, std::string_view kind,
+                      const std::vector<CacheRecord> &records);
+
+// Типы файлов по путям, запомненные на время ttl. Повторные проверки одного
+// пути, например при каждом нажатии сочетания клавиш, не обращаются к
+// файловой системе. Не потокобезопасен
+class StatCache {
+public:
+  static constexpr std::chrono::milliseconds g_default_ttl{5'000};
+  // При переполнении кэш очищается целиком
+  static constexpr size_t g_max_entries{1024};
+
+  explicit StatCache(std::chrono::milliseconds ttl = g_default_ttl);
+  // Тип файла или file_type::not_found, если пути нет или он недоступен
+  std::filesystem::file_type status(const std::filesystem::path &path);
+
+private:
+  struct Entry {
+    std::filesystem::file_type m_type;
+    std::chrono::steady_clock::time_point m_time;
+  };
+
+  std::chrono::milliseconds m_ttl;
+  std::unordered_map<std::filesystem::path::string_type, Entry> m_entries;
+};
+} // namespace winenv
@@ -0,0 +1,422 @@
+#include "fuzzy_match.hpp"
+#include "simd.hpp"
+
+#include <array>
+
+namespace {
+// Очки и прибавки как в fzf
+constexpr int score_match = 16;
+constexpr int score_gap_start = -3;
+constexpr int score_gap_extension = -1;
+constexpr int bonus_boundary = score_match / 2;
+constexpr int bonus_non_word = score_match / 2;
+constexpr int bonus_camel123 = bonus_boundary + score_gap_extension;
+constexpr int bonus_consecutive = -(score_gap_start + score_gap_extension);
+constexpr int bonus_first_char_multiplier = 2;
+constexpr int bonus_boundary_white = bonus_boundary + 2;
+constexpr int bonus_boundary_delimiter = bonus_boundary + 1;
+
+// Порядок важен: классы после non_word начинают слово
+enum CharClass : unsigned char {
+  white,
+  non_word,
+  delimiter,
+  lower,
+  upper,
+  letter,
+  number,
+  n_char_classes
+};
+
+constexpr CharClass class_of(unsigned c) noexcept {
+  if (c >= 'a' && c <= 'z') {
+    return lower;
+  }
+  if (c >= 'A' && c <= 'Z') {
+    return upper;
+  }
+  if (c >= '0' && c <= '9') {
+    return number;
+  }
+  // Байты многобайтных символов UTF-8 считаются буквами
+  if (c >= 0x80) {
+    return letter;
+  }
+  switch (c) {
+  case ' ':
+  case '\t':
+  case '\r':
+  case '\n':
+    return white;
+  case '/':
+  case '\\':
+  case ',':
+  case ':':
+  case ';':
+  case '|':
+    return delimiter;
+  }
+  return non_word;
+}
+
+// Номер бита маски символа, заглавные и строчные буквы совпадают
+constexpr unsigned mask_bit_of(unsigned c) noexcept {
+  if (c >= 'a' && c <= 'z') {
+    return c - 'a';
+  }
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= '0' && c <= '9') {
+    return 26;
+  }
+  if (c == '/' || c == '\\') {
+    return 27;
+  }
+  if (c == '.') {
+    return 28;
+  }
+  if (c == '_' || c == '-') {
+    return 29;
+  }
+  return c >= 0x80 ? 31 : 30;
+}
+
+constexpr int bonus_for(CharClass prev, CharClass cur) noexcept {
+  if (cur > non_word) {
+    if (prev == white) {
+      return bonus_boundary_white;
+    }
+    if (prev == delimiter) {
+      return bonus_boundary_delimiter;
+    }
+    if (prev == non_word) {
+      return bonus_boundary;
+    }
+  }
+  if ((prev == lower && cur == upper) || (prev != number && cur == number)) {
+    return bonus_camel123;
+  }
+  if (cur == non_word || cur == delimiter) {
+    return bonus_non_word;
+  }
+  return cur == white ? bonus_boundary_white : 0;
+}
+
+// Таблицы по байту вместо ветвлений во внутренних циклах
+struct CharTables {
+  std::array<CharClass, 256> m_classes{};
+  std::array<std::uint32_t, 256> m_mask_bits{};
+  std::array<std::array<int, n_char_classes>, n_char_classes> m_bonuses{};
+
+  constexpr CharTables() noexcept {
+    for (unsigned c = 0; c < 256; ++c) {
+      m_classes[c] = class_of(c);
+      m_mask_bits[c] = std::uint32_t{1} << mask_bit_of(c);
+    }
+    for (unsigned prev = 0; prev < n_char_classes; ++prev) {
+      for (unsigned cur = 0; cur < n_char_classes; ++cur) {
+        m_bonuses[prev][cur] = bonus_for(static_cast<CharClass>(prev),
+                                         static_cast<CharClass>(cur));
+      }
+    }
+  }
+};
+
+constexpr CharTables tables;
+
+CharClass char_class(char c) noexcept {
+  return tables.m_classes[static_cast<unsigned char>(c)];
+}
+
+// Позиция первого wanted или alt в data, начиная с pos, или size
+size_t find_char_scalar(const char *data, size_t size, size_t pos, char wanted,
+                        char alt) noexcept {
+  while (pos < size && data[pos] != wanted && data[pos] != alt) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Без ветвлений: номер пишется всегда, счетчик растет только для подошедших
+size_t filter_masks_scalar(const std::uint32_t *masks, size_t size,
+                           std::uint32_t need, std::uint32_t first,
+                           std::uint32_t *out) noexcept {
+  size_t n_found = 0;
+  for (size_t i = 0; i < size; ++i) {
+    out[n_found] = first + static_cast<std::uint32_t>(i);
+    n_found += (masks[i] & need) == need;
+  }
+  return n_found;
+}
+
+#ifdef WINENV_SIMD_X86
+unsigned count_trailing_zeros(unsigned mask) noexcept {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+// SSE2 есть в любом процессоре x86-64
+size_t find_char(const char *data, size_t size, size_t pos, char wanted,
+                 char alt) noexcept {
+  const __m128i wanted_bytes = _mm_set1_epi8(wanted);
+  const __m128i alt_bytes = _mm_set1_epi8(alt);
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(block, wanted_bytes),
+                     _mm_cmpeq_epi8(block, alt_bytes))));
+    if (mask != 0) {
+      return pos + count_trailing_zeros(mask);
+    }
+  }
+  return find_char_scalar(data, size, pos, wanted, alt);
+}
+
+// Биты четырех масок, в которых есть все биты need_bits
+unsigned quad_mask(const std::uint32_t *quad, __m128i need_bits) noexcept {
+  __m128i equal = _mm_cmpeq_epi32(
+      _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(quad)),
+                    need_bits),
+      need_bits);
+  return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(equal)));
+}
+
+// 16 масок за шаг: подошедших обычно мало, номера выписываются по битам
+size_t filter_masks_sse2(const std::uint32_t *masks, size_t size,
+                         std::uint32_t need, std::uint32_t first,
+                         std::uint32_t *out) noexcept {
+  const __m128i need_bits = _mm_set1_epi32(static_cast<int>(need));
+  size_t n_found = 0;
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    unsigned bits = quad_mask(masks + i, need_bits) |
+                    quad_mask(masks + i + 4, need_bits) << 4 |
+                    quad_mask(masks + i + 8, need_bits) << 8 |
+                    quad_mask(masks + i + 12, need_bits) << 12;
+    for (; bits != 0; bits &= bits - 1) {
+      out[n_found++] =
+          first + static_cast<std::uint32_t>(i + count_trailing_zeros(bits));
+    }
+  }
+  return n_found + filter_masks_scalar(masks + i, size - i, need,
+                                       first + static_cast<std::uint32_t>(i),
+                                       out + n_found);
+}
+
+WINENV_TARGET("avx2")
+unsigned octo_mask(const std::uint32_t *octo, __m256i need_bits) noexcept {
+  __m256i equal = _mm256_cmpeq_epi32(
+      _mm256_and_si256(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(octo)),
+          need_bits),
+      need_bits);
+  return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(equal)));
+}
+
+WINENV_TARGET("avx2")
+size_t filter_masks_avx2(const std::uint32_t *masks, size_t size,
+                         std::uint32_t need, std::uint32_t first,
+                         std::uint32_t *out) noexcept {
+  const __m256i need_bits = _mm256_set1_epi32(static_cast<int>(need));
+  size_t n_found = 0;
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    unsigned bits = octo_mask(masks + i, need_bits) |
+                    octo_mask(masks + i + 8, need_bits) << 8 |
+                    octo_mask(masks + i + 16, need_bits) << 16 |
+                    octo_mask(masks + i + 24, need_bits) << 24;
+    for (; bits != 0; bits &= bits - 1) {
+      out[n_found++] =
+          first + static_cast<std::uint32_t>(i + count_trailing_zeros(bits));
+    }
+  }
+  return n_found + filter_masks_sse2(masks + i, size - i, need,
+                                     first + static_cast<std::uint32_t>(i),
+                                     out + n_found);
+}
+#else
+size_t find_char(const char *data, size_t size, size_t pos, char wanted,
+                 char alt) noexcept {
+  return find_char_scalar(data, size, pos, wanted, alt);
+}
+
+#endif
+
+bool is_better(const winenv::FuzzyMatch &l, const winenv::FuzzyMatch &r) {
+  return l.m_score != r.m_score ? l.m_score > r.m_score
+                                : l.m_index < r.m_index;
+}
+} // namespace
+
+namespace winenv {
+std::uint32_t fuzzy_mask(std::string_view text) noexcept {
+  std::uint32_t mask = 0;
+  for (char c : text) {
+    mask |= tables.m_mask_bits[static_cast<unsigned char>(c)];
+  }
+  return mask;
+}
+
+FuzzyPattern::FuzzyPattern(std::string_view query)
+    : mf_ignore_case{std::none_of(query.begin(), query.end(), [](char c) {
+        return c >= 'A' && c <= 'Z';
+      })} {
+  for (char c : query) {
+    if (c != ' ') {
+      m_text += fold(c);
+    }
+  }
+  m_mask = fuzzy_mask(m_text);
+}
+
+bool FuzzyPattern::narrows(const FuzzyPattern &prev) const noexcept {
+  // Совпадение с этим запросом содержит его символы, а значит, и любую их
+  // подпоследовательность. Для prev без учета регистра символы запроса
+  // сравниваются в нижнем регистре
+  size_t matched = 0;
+  for (char c : m_text) {
+    if (matched < prev.m_text.size() &&
+        prev.fold(c) == prev.m_text[matched]) {
+      ++matched;
+    }
+  }
+  return matched == prev.m_text.size();
+}
+
+size_t FuzzyPattern::advance(size_t matched,
+                             std::string_view text) const noexcept {
+  size_t pos = 0;
+  for (; matched < m_text.size(); ++matched, ++pos) {
+    char wanted = m_text[matched];
+    pos = find_char(text.data(), text.size(), pos, wanted, unfold(wanted));
+    if (pos == text.size()) {
+      break;
+    }
+  }
+  return matched;
+}
+
+int FuzzyPattern::score(std::string_view text, size_t first) const noexcept {
+  if (first >= m_text.size()) {
+    return 0;
+  }
+  // Конец окна - последний символ запроса, найденный жадным поиском
+  size_t end = 0;
+  for (size_t i = first; i < m_text.size(); ++i) {
+    char wanted = m_text[i];
+    end = find_char(text.data(), text.size(), end, wanted, unfold(wanted));
+    if (end == text.size()) {
+      return fuzzy_no_match;
+    }
+    ++end;
+  }
+  // Начало окна - первый символ запроса при поиске от конца к началу
+  size_t start = end;
+  for (size_t n_left = m_text.size() - first; n_left > 0;) {
+    if (fold(text[--start]) == m_text[first + n_left - 1]) {
+      --n_left;
+    }
+  }
+
+  int score = 0;
+  bool f_in_gap = false;
+  size_t n_consecutive = 0;
+  int first_bonus = 0;
+  CharClass prev_class = start > 0 ? char_class(text[start - 1]) : delimiter;
+  for (size_t pos = start, i = first; pos < end; ++pos) {
+    CharClass cur_class = char_class(text[pos]);
+    if (fold(text[pos]) == m_text[i]) {
+      score += score_match;
+      int bonus = tables.m_bonuses[prev_class][cur_class];
+      if (n_consecutive == 0) {
+        first_bonus = bonus;
+      } else {
+        // Прибавка за начало слова распространяется на символы подряд
+        // после него
+        if (bonus >= bonus_boundary && bonus > first_bonus) {
+          first_bonus = bonus;
+        }
+        bonus = std::max({bonus, first_bonus, bonus_consecutive});
+      }
+      score += i == first ? bonus * bonus_first_char_multiplier : bonus;
+      f_in_gap = false;
+      ++n_consecutive;
+      ++i;
+    } else {
+      score += f_in_gap ? score_gap_extension : score_gap_start;
+      f_in_gap = true;
+      n_consecutive = 0;
+      first_bonus = 0;
+    }
+    prev_class = cur_class;
+  }
+  return score;
+}
+
+char FuzzyPattern::unfold(char c) const noexcept {
+  if (c == '/') {
+    return '\\';
+  }
+  return mf_ignore_case && c >= 'a' && c <= 'z' ? static_cast<char>(c - 32)
+                                                : c;
+}
+
+FuzzyTopK::FuzzyTopK(size_t k) : m_k{k} { m_heap.reserve(k); }
+
+void FuzzyTopK::push(FuzzyMatch match) {
+  // С is_better в роли "меньше" на вершине кучи худшее совпадение
+  if (m_heap.size() < m_k) {
+    m_heap.push_back(match);
+    std::push_heap(m_heap.begin(), m_heap.end(), is_better);
+  } else if (m_k > 0 && is_better(match, m_heap.front())) {
+    std::pop_heap(m_heap.begin(), m_heap.end(), is_better);
+    m_heap.back() = match;
+    std::push_heap(m_heap.begin(), m_heap.end(), is_better);
+  }
+}
+
+const std::vector<FuzzyMatch> &FuzzyTopK::unordered() const noexcept {
+  return m_heap;
+}
+
+std::vector<FuzzyMatch> FuzzyTopK::take_sorted() {
+  std::sort_heap(m_heap.begin(), m_heap.end(), is_better);
+  return std::move(m_heap);
+}
+
+size_t fuzzy_filter_masks(const std::uint32_t *masks, size_t size,
+                          std::uint32_t need, std::uint32_t first,
+                          std::uint32_t *out) noexcept {
+#ifdef WINENV_SIMD_X86
+  static const bool use_avx2 = has_avx2();
+  return use_avx2 ? filter_masks_avx2(masks, size, need, first, out)
+                  : filter_masks_sse2(masks, size, need, first, out);
+#else
+  return filter_masks_scalar(masks, size, need, first, out);
+#endif
+}
+
+size_t fuzzy_filter_indices(const std::uint32_t *masks,
+                            const std::uint32_t *indices, size_t size,
+                            std::uint32_t need, std::uint32_t *out) noexcept {
+  // Совпадения прошлого запроса разбросаны, маски читаются по одной
+  size_t n_found = 0;
+  for (size_t i = 0; i < size; ++i) {
+    out[n_found] = indices[i];
+    n_found += (masks[indices[i]] & need) == need;
+  }
+  return n_found;
+}
+
+void FuzzyMatcher::reset() noexcept {
+  m_survivors.clear();
+  mf_narrowable = false;
+}
+} // namespace winenv
@@ -0,0 +1,193 @@
+#pragma once
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+struct FuzzyMatch {
+  std::uint32_t m_index;
+  // Больше - лучше
+  int m_score;
+};
+
+// Оценка кандидата, в котором нет символов запроса по порядку
+constexpr int fuzzy_no_match = INT_MIN;
+
+// Маска символов текста: по биту на латинскую букву без учета регистра, на
+// цифры, на "/" вместе с "\", на ".", на "_" вместе с "-", на остальные
+// символы ASCII и на байты не ASCII. Кандидат, в маске которого нет всех
+// битов маски запроса, запросу не подходит
+std::uint32_t fuzzy_mask(std::string_view text) noexcept;
+
+// Подготовленный запрос. Пробелы пропускаются, "\" совпадает с "/". Регистр
+// учитывается, только если в запросе есть заглавные буквы
+class FuzzyPattern {
+public:
+  FuzzyPattern() = default;
+  explicit FuzzyPattern(std::string_view query);
+
+  // Запрос без пробелов, в нижнем регистре, если регистр не учитывается
+  const std::string &text() const noexcept { return m_text; }
+  size_t size() const noexcept { return m_text.size(); }
+  bool empty() const noexcept { return m_text.empty(); }
+  std::uint32_t mask() const noexcept { return m_mask; }
+  // Символ текста в виде для сравнения с символами text(). Вызывается на
+  // каждый символ кандидата, поэтому в заголовке
+  char fold(char c) const noexcept {
+    if (c == '\\') {
+      return '/';
+    }
+    return mf_ignore_case && c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32)
+                                                  : c;
+  }
+  // Любой текст, подходящий этому запросу, подходит и prev: после нажатия
+  // клавиши искать можно только среди совпадений прошлого запроса
+  bool narrows(const FuzzyPattern &prev) const noexcept;
+
+  // Продолжает жадный поиск символов запроса, начиная с matched-го, в text.
+  // Возвращает число найденных символов запроса
+  size_t advance(size_t matched, std::string_view text) const noexcept;
+  // Оценка символов запроса, начиная с first, в text как в fzf: самое
+  // короткое окно с последним символом там, где его находит жадный поиск,
+  // очки за символ, прибавки за начало слова, смену регистра, цифры и
+  // символы подряд, штрафы за пропуски. fuzzy_no_match, если символов
+  // в text нет
+  int score(std::string_view text, size_t first = 0) const noexcept;
+
+private:
+  // Второй символ текста, совпадающий с символом запроса c
+  char unfold(char c) const noexcept;
+
+  std::string m_text;
+  std::uint32_t m_mask{0};
+  bool mf_ignore_case{true};
+};
+
+// Лучшие k совпадений. Худшее из отобранных лежит на вершине кучи, новое
+// совпадение сравнивается только с ним
+class FuzzyTopK {
+public:
+  explicit FuzzyTopK(size_t k);
+
+  void push(FuzzyMatch match);
+  const std::vector<FuzzyMatch> &unordered() const noexcept;
+  // Лучшие первыми, при равной оценке - меньший номер
+  std::vector<FuzzyMatch> take_sorted();
+
+private:
+  size_t m_k;
+  std::vector<FuzzyMatch> m_heap;
+};
+
+// Пишет в out номера first + i тех masks[i], i < size, в которых есть все
+// биты need, и возвращает их число. Маски сравниваются векторно
+size_t fuzzy_filter_masks(const std::uint32_t *masks, size_t size,
+                          std::uint32_t need, std::uint32_t first,
+                          std::uint32_t *out) noexcept;
+// То же для масок с номерами indices[i]
+size_t fuzzy_filter_indices(const std::uint32_t *masks,
+                            const std::uint32_t *indices, size_t size,
+                            std::uint32_t need, std::uint32_t *out) noexcept;
+
+// Выбирает лучших кандидатов по запросу, пока запрос набирается. Кандидаты
+// отбираются по маскам символов, оставшиеся оцениваются, k лучших собираются
+// в кучу. Кандидаты, подошедшие запросу, запоминаются: если следующий запрос
+// его продолжает, просматриваются только они. Большие наборы делятся на
+// куски, которые оцениваются в нескольких потоках.
+// Пример:
+// masks[i] = fuzzy_mask(texts[i]);
+// FuzzyPattern pattern{query};
+// auto matches = matcher.find(pattern, masks, 20, [&] {
+//   return [&](std::uint32_t i) { return pattern.score(texts[i]); };
+// });
+class FuzzyMatcher {
+public:
+  // Кандидаты в куске оцениваются одним потоком по возрастанию номеров
+  static constexpr size_t chunk_size = 16 * 1024;
+  // Меньшие наборы оцениваются в вызывающем потоке
+  static constexpr size_t parallel_min_size = 4 * chunk_size;
+
+  // Забывает совпадения прошлого запроса. Вызывается при смене кандидатов
+  void reset() noexcept;
+
+  // masks[i] - fuzzy_mask кандидата i. make_scorer вызывается на каждый
+  // кусок и возвращает функцию int(std::uint32_t), которая дает оценку
+  // кандидата или fuzzy_no_match. Функции разных кусков работают
+  // одновременно
+  template <class MakeScorer>
+  std::vector<FuzzyMatch> find(const FuzzyPattern &pattern,
+                               const std::vector<std::uint32_t> &masks,
+                               size_t k, MakeScorer make_scorer);
+
+private:
+  struct Chunk {
+    std::vector<std::uint32_t> m_survivors;
+    std::vector<FuzzyMatch> m_top;
+  };
+
+  FuzzyPattern m_pattern;
+  std::vector<std::uint32_t> m_survivors;
+  bool mf_narrowable{false};
+};
+
+template <class MakeScorer>
+std::vector<FuzzyMatch>
+FuzzyMatcher::find(const FuzzyPattern &pattern,
+                   const std::vector<std::uint32_t> &masks, size_t k,
+                   MakeScorer make_scorer) {
+  bool f_narrow = mf_narrowable && pattern.narrows(m_pattern);
+  size_t n = f_narrow ? m_survivors.size() : masks.size();
+  std::vector<Chunk> chunks((n + chunk_size - 1) / chunk_size);
+  auto run_chunk = [&](size_t c) {
+    size_t first = c * chunk_size;
+    size_t size = std::min(chunk_size, n - first);
+    std::vector<std::uint32_t> candidates(size);
+    size = f_narrow ? fuzzy_filter_indices(masks.data(),
+                                           m_survivors.data() + first, size,
+                                           pattern.mask(), candidates.data())
+                    : fuzzy_filter_masks(masks.data() + first, size,
+                                         pattern.mask(),
+                                         static_cast<std::uint32_t>(first),
+                                         candidates.data());
+    auto scorer = make_scorer();
+    FuzzyTopK top(k);
+    Chunk &chunk = chunks[c];
+    for (size_t i = 0; i < size; ++i) {
+      int score = scorer(candidates[i]);
+      if (score != fuzzy_no_match) {
+        chunk.m_survivors.push_back(candidates[i]);
+        top.push({candidates[i], score});
+      }
+    }
+    chunk.m_top = top.unordered();
+  };
+  if (n >= parallel_min_size) {
+    parallel_for(chunks.size(), run_chunk);
+  } else {
+    for (size_t c = 0; c < chunks.size(); ++c) {
+      run_chunk(c);
+    }
+  }
+
+  // Куски идут по возрастанию номеров, поэтому совпадения остаются
+  // отсортированными
+  m_survivors.clear();
+  FuzzyTopK top(k);
+  for (const Chunk &chunk : chunks) {
+    m_survivors.insert(m_survivors.end(), chunk.m_survivors.begin(),
+                       chunk.m_survivors.end());
+    for (FuzzyMatch match : chunk.m_top) {
+      top.push(match);
+    }
+  }
+  m_pattern = pattern;
+  // Пустому запросу подходит все, сужать нечего
+  mf_narrowable = !pattern.empty();
+  return top.take_sorted();
+}
+} // namespace winenv
@@ -1,4 +1,5 @@
 #include "log_window.hpp"
+#include "utils.hpp"
 
 namespace {
 RECT get_text_area(std::string_view text, HFONT font) {
@@ -12,8 +13,10 @@ RECT get_text_area(std::string_view text, HFONT font) {
   GetTextMetrics(hdc, &txt_metric);
   int target_width = txt_metric.tmMaxCharWidth * n_columns;
   RECT text_area{0, 0, target_width, 0};
-  int text_height =
-      DrawTextA(hdc, text.data(), text.size(), &text_area, DT_CALCRECT);
+  std::wstring wide_text = winenv::widen_string(text);
+  int text_height = DrawTextW(hdc, wide_text.data(),
+                              static_cast<int>(wide_text.size()), &text_area,
+                              DT_CALCRECT);
   if (text_height == 0) {
     text_area = {0, 0, 0, 0};
   }
@@ -133,7 +136,9 @@ LRESULT LogWindow::paint(const MSG &msg) {
   if (m_font != nullptr) {
     original_font = (HFONT)SelectObject(hdc, m_font);
   }
-  DrawTextA(hdc, m_text.c_str(), m_text.size(), &text_area, 0);
+  std::wstring wide_text = widen_string(m_text);
+  DrawTextW(hdc, wide_text.data(), static_cast<int>(wide_text.size()),
+            &text_area, 0);
   if (m_font != nullptr) {
     SelectObject(hdc, original_font);
   }
@@ -10,13 +10,17 @@
  *  Открытие вкладки браузера chromium с адресом из буфера обмена;
  * Настройка через файл config.json
  */
+#include "console_pool.hpp"
+#include "console_profile.hpp"
 #include "font.hpp"
+#include "process.hpp"
 #include "root_app.hpp"
+#include "stage_trace.hpp"
 #include "win_console.hpp"
-#include "win_proc.hpp"
 
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <sstream>
 
 std::ostream *winenv::g_logger{nullptr};
@@ -26,6 +30,7 @@ using namespace winenv;
 
 int WINAPI wWinMain(HINSTANCE hinstance, HINSTANCE hPrevInstance,
                     PWSTR raw_cmdline, int show_flag) {
+  TraceClock::time_point main_start = TraceClock::now();
   std::wstring_view cmdline{raw_cmdline};
   setlocale(LC_ALL, "Russian");
 
@@ -86,23 +91,52 @@ int WINAPI wWinMain(HINSTANCE hinstance, HINSTANCE hPrevInstance,
       RootApp root_app(hinstance);
       root_app.run();
     } else {
+      // Отметки этапов отправляются RootApp, когда из профиля станет известен
+      // его поток
+      StageReporter stage_reporter;
+      stage_reporter.mark(SpawnStage::child_main, main_start);
+      // Консоль пула настраивается скрытой и ждет передачи пользователю
+      std::optional<PoolHandoff> pool_handoff;
+      if (auto pool_ticket = PoolTicket::parse(cmdline)) {
+        pool_handoff.emplace(pool_ticket->first);
+        cmdline.remove_prefix(pool_ticket->second);
+      }
       WinConsole::allocate(start_info.lpTitle);
+      if (pool_handoff) {
+        WinConsole::get()->show(false);
+      }
       WinConsole::set_title(L"C-M-D");
+      stage_reporter.mark(SpawnStage::console_allocated);
 
-      auto [cmd_arg0, arg0_end] = cmd_arg_to<RootApp::CmdLineArg>(cmdline);
-      bool is_font_avlbl = cmd_arg0.font_name[0] != '\0';
+      auto [profile_channel, arg0_end] =
+          ConsoleProfileChannel::from_cmd_arg(cmdline);
+      const ConsoleProfile &profile = profile_channel.get();
+      stage_reporter.connect(profile.get_parent_thread_id());
+      bool is_font_avlbl = profile.m_font_name[0] != '\0';
       if (is_font_avlbl) {
-        WinConsole::get()->set_font(cmd_arg0.font_name, cmd_arg0.font_size);
+        WinConsole::get()->set_font(profile.m_font_name, profile.m_font_size);
       }
-      WinConsole::get()->set_term_color_table(cmd_arg0.term_colors);
+      stage_reporter.mark(SpawnStage::font_set);
+      WinConsole::get()->set_term_color_table(profile.m_term_colors);
+      stage_reporter.mark(SpawnStage::colors_set);
       WinConsole::get()->configure_use_startup_info(start_info);
-      WinProcess::Constructor cmd_proc_ctor;
+      stage_reporter.mark(SpawnStage::startup_info_applied);
+      if (pool_handoff) {
+        pool_handoff->signal_ready();
+        if (!pool_handoff->wait_for_hand_over()) {
+          return 0;
+        }
+        WinConsole::get()->show(true);
+        stage_reporter.mark(SpawnStage::console_shown);
+      }
+      Process::Constructor cmd_proc_ctor;
       if (arg0_end != cmdline.size()) {
         std::wstring_view launch_command = cmdline.substr(arg0_end + 1);
         cmd_proc_ctor.set_command_line_arguments({launch_command.data()});
       }
       std::wstring cmd_path_str = get_cmd_path().wstring();
       cmd_proc_ctor.create(cmd_path_str, {});
+      stage_reporter.mark(SpawnStage::cmd_launched);
     }
   } catch (WinError &err) {
     *g_logger << err.what() << '\n';
@@ -116,7 +150,8 @@ int WINAPI wWinMain(HINSTANCE hinstance, HINSTANCE hPrevInstance,
 
   std::string str{std::move(log_str).str()};
   if (!str.empty()) {
-    MessageBoxA(nullptr, str.c_str(), "Error", MB_OK | MB_ICONERROR);
+    MessageBoxW(nullptr, widen_string(str).c_str(), L"Error",
+                MB_OK | MB_ICONERROR);
   }
   return 0;
 }
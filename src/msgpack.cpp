@@ -0,0 +1,276 @@
+#include "msgpack.hpp"
+
+#include <stdexcept>
+
+namespace {
+// Размер заголовка значения и число вложенных значений
+struct ValueHead {
+  size_t m_head_size{1};
+  // Длина данных строки, двоичных данных или расширения после заголовка
+  std::uint64_t m_payload{0};
+  // Элементы массива или ключи и значения словаря
+  std::uint64_t m_n_children{0};
+};
+
+std::uint64_t read_be(std::string_view data, size_t pos, size_t n_bytes) {
+  std::uint64_t value{0};
+  for (size_t i = 0; i < n_bytes; ++i) {
+    value = value << 8 | static_cast<std::uint8_t>(data[pos + i]);
+  }
+  return value;
+}
+
+// nullopt, если заголовок обрывается
+std::optional<ValueHead> read_head(std::string_view data, size_t pos) {
+  auto tag = static_cast<std::uint8_t>(data[pos]);
+  // Значения с длиной или числом элементов в следующих n_bytes байтах
+  auto sized = [&](size_t n_bytes, size_t extra,
+                   bool f_container) -> std::optional<ValueHead> {
+    if (pos + 1 + n_bytes > data.size()) {
+      return std::nullopt;
+    }
+    std::uint64_t size = read_be(data, pos + 1, n_bytes);
+    ValueHead head{1 + n_bytes + extra};
+    (f_container ? head.m_n_children : head.m_payload) = size;
+    return head;
+  };
+  if (tag <= 0x7F || tag >= 0xE0 || tag == 0xC0 || tag == 0xC2 ||
+      tag == 0xC3) {
+    return ValueHead{};
+  }
+  if ((tag & 0xF0) == 0x80) {
+    return ValueHead{1, 0, (tag & 0x0Fu) * 2u};
+  }
+  if ((tag & 0xF0) == 0x90) {
+    return ValueHead{1, 0, tag & 0x0Fu};
+  }
+  if ((tag & 0xE0) == 0xA0) {
+    return ValueHead{1, tag & 0x1Fu};
+  }
+  switch (tag) {
+  case 0xCC: // uint8 .. uint64
+  case 0xD0: // int8 .. int64
+    return ValueHead{2};
+  case 0xCD:
+  case 0xD1:
+    return ValueHead{3};
+  case 0xCE:
+  case 0xD2:
+  case 0xCA: // float32
+    return ValueHead{5};
+  case 0xCF:
+  case 0xD3:
+  case 0xCB: // float64
+    return ValueHead{9};
+  case 0xD4: // fixext 1 .. 16: тип и данные
+    return ValueHead{2, 1};
+  case 0xD5:
+    return ValueHead{2, 2};
+  case 0xD6:
+    return ValueHead{2, 4};
+  case 0xD7:
+    return ValueHead{2, 8};
+  case 0xD8:
+    return ValueHead{2, 16};
+  case 0xD9: // str8 .. str32
+  case 0xC4: // bin8 .. bin32
+    return sized(1, 0, false);
+  case 0xDA:
+  case 0xC5:
+    return sized(2, 0, false);
+  case 0xDB:
+  case 0xC6:
+    return sized(4, 0, false);
+  case 0xC7: // ext8 .. ext32, после длины - байт типа
+    return sized(1, 1, false);
+  case 0xC8:
+    return sized(2, 1, false);
+  case 0xC9:
+    return sized(4, 1, false);
+  case 0xDC: // array16, array32
+    return sized(2, 0, true);
+  case 0xDD:
+    return sized(4, 0, true);
+  case 0xDE: { // map16, map32
+    auto head = sized(2, 0, true);
+    if (head) {
+      head->m_n_children *= 2;
+    }
+    return head;
+  }
+  case 0xDF: {
+    auto head = sized(4, 0, true);
+    if (head) {
+      head->m_n_children *= 2;
+    }
+    return head;
+  }
+  default:
+    throw std::runtime_error("Unknown msgpack tag " + std::to_string(tag));
+  }
+}
+} // namespace
+
+namespace winenv {
+void MsgpackWriter::write_nil() { m_data += '\xC0'; }
+
+void MsgpackWriter::write_bool(bool value) {
+  m_data += value ? '\xC3' : '\xC2';
+}
+
+void MsgpackWriter::write_uint(std::uint64_t value) {
+  if (value <= 0x7F) {
+    m_data += static_cast<char>(value);
+  } else if (value <= 0xFF) {
+    m_data += '\xCC';
+    write_be(value, 1);
+  } else if (value <= 0xFFFF) {
+    m_data += '\xCD';
+    write_be(value, 2);
+  } else if (value <= 0xFFFFFFFF) {
+    m_data += '\xCE';
+    write_be(value, 4);
+  } else {
+    m_data += '\xCF';
+    write_be(value, 8);
+  }
+}
+
+void MsgpackWriter::write_str(std::string_view value) {
+  size_t size = value.size();
+  if (size <= 0x1F) {
+    m_data += static_cast<char>(0xA0 | size);
+  } else if (size <= 0xFF) {
+    m_data += '\xD9';
+    write_be(size, 1);
+  } else if (size <= 0xFFFF) {
+    m_data += '\xDA';
+    write_be(size, 2);
+  } else {
+    m_data += '\xDB';
+    write_be(size, 4);
+  }
+  m_data += value;
+}
+
+void MsgpackWriter::write_array_header(size_t size) {
+  if (size <= 0x0F) {
+    m_data += static_cast<char>(0x90 | size);
+  } else if (size <= 0xFFFF) {
+    m_data += '\xDC';
+    write_be(size, 2);
+  } else {
+    m_data += '\xDD';
+    write_be(size, 4);
+  }
+}
+
+const std::string &MsgpackWriter::data() const noexcept { return m_data; }
+
+std::string MsgpackWriter::take() { return std::move(m_data); }
+
+void MsgpackWriter::write_be(std::uint64_t value, size_t n_bytes) {
+  for (size_t i = n_bytes; i-- > 0;) {
+    m_data += static_cast<char>(value >> (8 * i));
+  }
+}
+
+std::optional<size_t> msgpack_value_end(std::string_view data, size_t pos) {
+  // Число значений, которые осталось пройти, вместо рекурсии
+  std::uint64_t n_pending = 1;
+  while (n_pending != 0) {
+    if (pos >= data.size()) {
+      return std::nullopt;
+    }
+    std::optional<ValueHead> head = read_head(data, pos);
+    // Заголовок числа фиксированной длины тоже может оборваться
+    if (!head || head->m_head_size > data.size() - pos ||
+        head->m_payload > data.size() - pos - head->m_head_size) {
+      return std::nullopt;
+    }
+    pos += head->m_head_size + head->m_payload;
+    n_pending += head->m_n_children - 1;
+  }
+  return pos;
+}
+
+MsgpackReader::MsgpackReader(std::string_view data) noexcept
+    : m_data{data} {}
+
+bool MsgpackReader::read_nil() {
+  if (peek() != 0xC0) {
+    return false;
+  }
+  ++m_pos;
+  return true;
+}
+
+std::uint64_t MsgpackReader::read_uint() {
+  std::uint8_t tag = peek();
+  ++m_pos;
+  if (tag <= 0x7F) {
+    return tag;
+  }
+  if (tag >= 0xCC && tag <= 0xCF) {
+    return read_be(size_t{1} << (tag - 0xCC));
+  }
+  throw std::runtime_error("Expected msgpack unsigned integer");
+}
+
+std::string MsgpackReader::read_str() {
+  std::uint8_t tag = peek();
+  ++m_pos;
+  size_t size;
+  if ((tag & 0xE0) == 0xA0) {
+    size = tag & 0x1F;
+  } else if (tag >= 0xD9 && tag <= 0xDB) {
+    size = read_be(size_t{1} << (tag - 0xD9));
+  } else {
+    throw std::runtime_error("Expected msgpack string");
+  }
+  if (size > m_data.size() - m_pos) {
+    throw std::runtime_error("Truncated msgpack string");
+  }
+  std::string value{m_data.substr(m_pos, size)};
+  m_pos += size;
+  return value;
+}
+
+size_t MsgpackReader::read_array_header() {
+  std::uint8_t tag = peek();
+  ++m_pos;
+  if ((tag & 0xF0) == 0x90) {
+    return tag & 0x0F;
+  }
+  if (tag == 0xDC || tag == 0xDD) {
+    return read_be(tag == 0xDC ? 2 : 4);
+  }
+  throw std::runtime_error("Expected msgpack array");
+}
+
+void MsgpackReader::skip() {
+  std::optional<size_t> end = msgpack_value_end(m_data, m_pos);
+  if (!end) {
+    throw std::runtime_error("Truncated msgpack value");
+  }
+  m_pos = *end;
+}
+
+bool MsgpackReader::at_end() const noexcept { return m_pos == m_data.size(); }
+
+std::uint8_t MsgpackReader::peek() const {
+  if (m_pos >= m_data.size()) {
+    throw std::runtime_error("Unexpected end of msgpack data");
+  }
+  return static_cast<std::uint8_t>(m_data[m_pos]);
+}
+
+std::uint64_t MsgpackReader::read_be(size_t n_bytes) {
+  if (n_bytes > m_data.size() - m_pos) {
+    throw std::runtime_error("Unexpected end of msgpack data");
+  }
+  std::uint64_t value = ::read_be(m_data, m_pos, n_bytes);
+  m_pos += n_bytes;
+  return value;
+}
+} // namespace winenv
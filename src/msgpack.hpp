@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace winenv {
+// Минимальная запись msgpack: только типы, нужные запросам msgpack-RPC.
+// Пример:
+// MsgpackWriter writer;
+// writer.write_array_header(4);
+// writer.write_uint(0); // Запрос
+// writer.write_uint(msg_id);
+// writer.write_str("nvim_command");
+// writer.write_array_header(1);
+// writer.write_str("tabedit a.txt");
+class MsgpackWriter {
+public:
+  void write_nil();
+  void write_bool(bool value);
+  void write_uint(std::uint64_t value);
+  void write_str(std::string_view value);
+  void write_array_header(size_t size);
+  const std::string &data() const noexcept;
+  // Возвращает записанные данные и очищает буфер
+  std::string take();
+
+private:
+  void write_be(std::uint64_t value, size_t n_bytes);
+
+  std::string m_data;
+};
+
+// Позиция после значения, начинающегося с pos, включая вложенные значения.
+// nullopt, если данные обрываются раньше конца значения: нужно дочитать.
+// Выбрасывает std::runtime_error на неизвестном теге
+std::optional<size_t> msgpack_value_end(std::string_view data, size_t pos);
+
+// Чтение значений из полностью полученного сообщения. Методы выбрасывают
+// std::runtime_error, если значение другого типа или данные кончились
+class MsgpackReader {
+public:
+  explicit MsgpackReader(std::string_view data) noexcept;
+
+  // Потребляет nil и возвращает true, иначе ничего не потребляет
+  bool read_nil();
+  std::uint64_t read_uint();
+  std::string read_str();
+  size_t read_array_header();
+  // Пропускает значение любого типа
+  void skip();
+  bool at_end() const noexcept;
+
+private:
+  std::uint8_t peek() const;
+  std::uint64_t read_be(size_t n_bytes);
+
+  std::string_view m_data;
+  size_t m_pos{0};
+};
+} // namespace winenv
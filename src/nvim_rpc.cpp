@@ -0,0 +1,255 @@
+#include "nvim_rpc.hpp"
+#include "msgpack.hpp"
+
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+#endif
+
+namespace {
+// Символы, которые fnameescape() экранирует обратной косой чертой. В
+// Windows обратная косая черта - разделитель пути и не экранируется
+#ifdef _WIN32
+constexpr std::string_view escaped_chars = " \t\n*?[{`$%#'\"|!<";
+#else
+constexpr std::string_view escaped_chars = " \t\n*?[{`$%#'\"|!<\\";
+#endif
+
+// Защита от бесконечного ожидания при испорченном потоке
+constexpr size_t max_input_size = 16 << 20;
+
+enum class RpcType : std::uint64_t { request = 0, response = 1, notify = 2 };
+
+#ifndef _WIN32
+[[noreturn]] void throw_errno(const std::string &message) {
+  throw std::system_error(errno, std::generic_category(), message);
+}
+#endif
+} // namespace
+
+namespace winenv {
+std::string escape_file_name(std::string_view file_name) {
+  std::string escaped;
+  escaped.reserve(file_name.size() + 8);
+  // Начальный "+" и одиночный "-" имеют особый смысл у :edit
+  if (file_name == "-" || (!file_name.empty() && file_name[0] == '+')) {
+    escaped += '\\';
+  }
+  for (char c : file_name) {
+    if (escaped_chars.find(c) != std::string_view::npos) {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+NvimClient::NvimClient(EnvStringView address,
+                       std::chrono::milliseconds timeout)
+    : m_timeout{timeout} {
+#ifdef _WIN32
+  std::wstring pipe_name{address};
+  auto open_pipe = [&pipe_name] {
+    return CreateFileW(pipe_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                       nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+  };
+  m_pipe = open_pipe();
+  // Все экземпляры канала заняты другими клиентами
+  if (m_pipe == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY &&
+      WaitNamedPipeW(pipe_name.c_str(), static_cast<DWORD>(timeout.count()))) {
+    m_pipe = open_pipe();
+  }
+  if (m_pipe == INVALID_HANDLE_VALUE) {
+    throw WinError("Failed to connect to " + narrow_string(pipe_name),
+                   GetLastError());
+  }
+  m_io_event = CreateEventW(nullptr, true, false, nullptr);
+  if (m_io_event == nullptr) {
+    DWORD err = GetLastError();
+    CloseHandle(m_pipe);
+    throw WinError("Failed to create event", err);
+  }
+#else
+  sockaddr_un socket_address{};
+  socket_address.sun_family = AF_UNIX;
+  if (address.size() >= sizeof(socket_address.sun_path)) {
+    throw std::invalid_argument("Socket path is too long: " +
+                                std::string{address});
+  }
+  address.copy(socket_address.sun_path, address.size());
+  m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_socket < 0) {
+    throw_errno("Failed to create socket");
+  }
+  timeval socket_timeout{};
+  socket_timeout.tv_sec = timeout.count() / 1000;
+  socket_timeout.tv_usec = timeout.count() % 1000 * 1000;
+  setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &socket_timeout,
+             sizeof(socket_timeout));
+  setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO, &socket_timeout,
+             sizeof(socket_timeout));
+  if (connect(m_socket, reinterpret_cast<sockaddr *>(&socket_address),
+              sizeof(socket_address)) != 0) {
+    int err = errno;
+    close(m_socket);
+    throw std::system_error(err, std::generic_category(),
+                            "Failed to connect to " + std::string{address});
+  }
+#endif
+}
+
+NvimClient::~NvimClient() {
+#ifdef _WIN32
+  CloseHandle(m_io_event);
+  CloseHandle(m_pipe);
+#else
+  close(m_socket);
+#endif
+}
+
+std::vector<std::string>
+NvimClient::run_commands(const std::vector<std::string> &cmds) {
+  MsgpackWriter writer;
+  std::uint32_t first_id = m_next_id;
+  for (const std::string &cmd : cmds) {
+    writer.write_array_header(4);
+    writer.write_uint(static_cast<std::uint64_t>(RpcType::request));
+    writer.write_uint(m_next_id++);
+    writer.write_str("nvim_command");
+    writer.write_array_header(1);
+    writer.write_str(cmd);
+  }
+  write_all(writer.data());
+
+  std::vector<std::string> errors;
+  size_t n_responses = 0;
+  while (n_responses < cmds.size()) {
+    std::optional<size_t> end = msgpack_value_end(m_input, 0);
+    if (!end) {
+      read_some();
+      continue;
+    }
+    MsgpackReader reader{std::string_view{m_input}.substr(0, *end)};
+    size_t n_fields = reader.read_array_header();
+    auto type = static_cast<RpcType>(reader.read_uint());
+    // Уведомления и чужие сообщения пропускаются
+    if (type == RpcType::response && n_fields == 4) {
+      std::uint64_t id = reader.read_uint();
+      if (id - first_id < cmds.size()) {
+        ++n_responses;
+        // Ошибка Neovim - массив [тип, сообщение]
+        if (!reader.read_nil()) {
+          std::string message = "Editor error in \"" + cmds[id - first_id] +
+                                "\"";
+          size_t n_items = reader.read_array_header();
+          for (size_t i = 0; i < n_items; ++i) {
+            if (i == 1) {
+              message += ": " + reader.read_str();
+            } else {
+              reader.skip();
+            }
+          }
+          errors.push_back(std::move(message));
+        }
+      }
+    }
+    m_input.erase(0, *end);
+  }
+  return errors;
+}
+
+std::vector<std::string>
+NvimClient::open_files(const std::vector<EnvString> &files,
+                       std::string_view command) {
+  std::vector<std::string> cmds;
+  cmds.reserve(files.size());
+  for (const EnvString &file : files) {
+#ifdef _WIN32
+    std::string utf8_file = narrow_string(file);
+#else
+    const std::string &utf8_file = file;
+#endif
+    cmds.push_back(std::string{command} + ' ' + escape_file_name(utf8_file));
+  }
+  return run_commands(cmds);
+}
+
+void NvimClient::write_all(std::string_view data) {
+  while (!data.empty()) {
+#ifdef _WIN32
+    size_t n_written =
+        transfer(true, const_cast<char *>(data.data()), data.size());
+    if (n_written == 0) {
+      throw std::runtime_error("Editor closed the connection");
+    }
+#else
+    ssize_t n_written = send(m_socket, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno("Failed to send request to editor");
+    }
+#endif
+    data.remove_prefix(static_cast<size_t>(n_written));
+  }
+}
+
+void NvimClient::read_some() {
+  if (m_input.size() >= max_input_size) {
+    throw std::runtime_error("Editor response is too large");
+  }
+  char buffer[4096];
+#ifdef _WIN32
+  size_t n_read = transfer(false, buffer, sizeof(buffer));
+#else
+  ssize_t n_read;
+  do {
+    n_read = recv(m_socket, buffer, sizeof(buffer), 0);
+  } while (n_read < 0 && errno == EINTR);
+  if (n_read < 0) {
+    throw_errno("Failed to read editor response");
+  }
+#endif
+  if (n_read == 0) {
+    throw std::runtime_error("Editor closed the connection");
+  }
+  m_input.append(buffer, static_cast<size_t>(n_read));
+}
+
+#ifdef _WIN32
+size_t NvimClient::transfer(bool f_write, void *data, size_t size) {
+  OVERLAPPED overlapped{};
+  overlapped.hEvent = m_io_event;
+  auto size_arg = static_cast<DWORD>(size);
+  BOOL is_done = f_write
+                     ? WriteFile(m_pipe, data, size_arg, nullptr, &overlapped)
+                     : ReadFile(m_pipe, data, size_arg, nullptr, &overlapped);
+  if (!is_done && GetLastError() != ERROR_IO_PENDING) {
+    throw WinError("Failed to exchange data with editor", GetLastError());
+  }
+  DWORD n_transferred{0};
+  if (WaitForSingleObject(m_io_event, static_cast<DWORD>(m_timeout.count())) !=
+      WAIT_OBJECT_0) {
+    CancelIoEx(m_pipe, &overlapped);
+    GetOverlappedResult(m_pipe, &overlapped, &n_transferred, true);
+    throw WinError("Editor does not respond", ERROR_TIMEOUT);
+  }
+  if (!GetOverlappedResult(m_pipe, &overlapped, &n_transferred, false)) {
+    DWORD err = GetLastError();
+    // Сервер закрыл канал: как конец файла у сокета
+    if (err == ERROR_BROKEN_PIPE) {
+      return 0;
+    }
+    throw WinError("Failed to exchange data with editor", err);
+  }
+  return n_transferred;
+}
+#endif
+} // namespace winenv
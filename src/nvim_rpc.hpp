@@ -0,0 +1,65 @@
+#pragma once
+#include "env_snapshot.hpp"
+#ifdef _WIN32
+#include "utils.hpp"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+// Экранирует имя файла для команд Ex, как fnameescape() в Neovim
+std::string escape_file_name(std::string_view file_name);
+
+// Клиент msgpack-RPC для Neovim, запущенного с --listen <адрес>. Адрес -
+// имя именованного канала в Windows ("\\.\pipe\winenv-nvim") или путь
+// сокета unix. Запросы отправляются одним пакетом, затем читаются ответы,
+// поэтому открытие многих файлов стоит одного обмена с сервером.
+// Пример:
+// NvimClient client{L"\\\\.\\pipe\\winenv-nvim"};
+// for (const std::string &err : client.open_files(files, "tabedit")) {
+//   *g_logger << err << std::endl;
+// }
+class NvimClient {
+public:
+  // Время ожидания подключения и каждой операции чтения или записи
+  static constexpr std::chrono::milliseconds g_default_timeout{2'000};
+
+  // Выбрасывает исключение, если сервер недоступен
+  explicit NvimClient(EnvStringView address,
+                      std::chrono::milliseconds timeout = g_default_timeout);
+  ~NvimClient();
+  NvimClient(const NvimClient &other) = delete;
+  NvimClient &operator=(const NvimClient &other) = delete;
+
+  // Выполняет команды Ex через nvim_command. Возвращает сообщения об
+  // ошибках команд, выполнение остальных команд при этом продолжается.
+  // Выбрасывает исключение при обрыве связи или истечении времени
+  std::vector<std::string> run_commands(const std::vector<std::string> &cmds);
+  // Открывает файлы командой command, например "edit" или "tabedit"
+  std::vector<std::string> open_files(const std::vector<EnvString> &files,
+                                      std::string_view command);
+
+private:
+  void write_all(std::string_view data);
+  // Дописывает полученные байты в m_input
+  void read_some();
+
+#ifdef _WIN32
+  // Операция ввода-вывода с ожиданием не дольше m_timeout
+  size_t transfer(bool f_write, void *data, size_t size);
+
+  HANDLE m_pipe{INVALID_HANDLE_VALUE};
+  HANDLE m_io_event{nullptr};
+#else
+  int m_socket{-1};
+#endif
+  std::chrono::milliseconds m_timeout;
+  std::uint32_t m_next_id{0};
+  // Полученные, но еще не разобранные байты
+  std::string m_input;
+};
+} // namespace winenv
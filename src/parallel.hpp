@@ -0,0 +1,53 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace winenv {
+// Вызывает fn(i) для индексов [0, n) в нескольких потоках.
+// Индексы раздаются по одному, поэтому долгие вызовы не тормозят остальные.
+// Вызывающий поток тоже участвует в работе. После исключения из fn новые
+// индексы не раздаются; первое исключение передается вызывающему после
+// завершения всех потоков
+template <class Fn> void parallel_for(size_t n, Fn fn) {
+  size_t n_threads =
+      std::min<size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+  if (n_threads <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  std::atomic_size_t next{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  auto worker = [&next, n, &fn, &error_mutex, &error]() {
+    try {
+      for (size_t i = next++; i < n; i = next++) {
+        fn(i);
+      }
+    } catch (...) {
+      std::lock_guard lock{error_mutex};
+      if (!error) {
+        error = std::current_exception();
+      }
+      next = n;
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(n_threads - 1);
+  for (size_t t = 1; t < n_threads; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+} // namespace winenv
@@ -0,0 +1,182 @@
+#include "path_list.hpp"
+#include "fs_cache.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+constexpr std::string_view cache_kind = "path_list";
+
+using Clock = std::chrono::steady_clock;
+
+winenv::PathListReport::Duration since(Clock::time_point start) {
+  return std::chrono::duration_cast<winenv::PathListReport::Duration>(
+      Clock::now() - start);
+}
+
+// Ключ для поиска повторов. В Windows регистр в путях не учитывается
+std::string dedupe_key(std::string_view path) {
+  std::string key{path};
+  while (key.size() > 1 && (key.back() == '\\' || key.back() == '/')) {
+    key.pop_back();
+  }
+#ifdef _WIN32
+  std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  std::replace(key.begin(), key.end(), '/', '\\');
+#endif
+  return key;
+}
+} // namespace
+
+namespace winenv {
+std::string PathListReport::to_string() const {
+  return "PATH build: cache load " + std::to_string(load_cache.count()) +
+         " us, canonicalize " + std::to_string(canonicalize.count()) +
+         " us, deduplicate " + std::to_string(deduplicate.count()) +
+         " us, emit " + std::to_string(emit.count()) + " us, cache save " +
+         std::to_string(save_cache.count()) + " us; " +
+         std::to_string(n_from_cache) + " cached, " +
+         std::to_string(n_canonicalized) + " canonicalized, " +
+         std::to_string(n_missing) + " missing, " +
+         std::to_string(n_duplicates) + " duplicates" +
+         (save_error.empty() ? "" : "; cache not saved: " + save_error);
+}
+
+PathListBuilder::PathListBuilder(std::filesystem::path cache_file)
+    : m_cache_file{std::move(cache_file)} {}
+
+void PathListBuilder::add(std::filesystem::path dir) {
+  m_entries.emplace_back().m_dir = std::move(dir);
+}
+
+std::string PathListBuilder::build(std::string_view tail,
+                                   PathListReport *report) {
+  PathListReport local_report;
+  PathListReport &r = report ? *report : local_report;
+
+  // Путь -> (время изменения, канонический путь)
+  Clock::time_point start = Clock::now();
+  std::unordered_map<std::string, std::pair<long long, std::string>> cached;
+  if (!m_cache_file.empty()) {
+    for (CacheRecord &record : read_cache_file(m_cache_file, cache_kind)) {
+      if (record.size() != 3) {
+        continue;
+      }
+      try {
+        long long stamp = std::stoll(record[1]);
+        cached.insert_or_assign(std::move(record[0]),
+                                std::pair{stamp, std::move(record[2])});
+      } catch (std::logic_error &) { // Испорченная запись
+      }
+    }
+  }
+  r.load_cache = since(start);
+
+  // Для каждой директории один запрос времени изменения. Канонический путь
+  // вычисляется только при промахе кэша
+  start = Clock::now();
+  parallel_for(m_entries.size(), [this, &cached](size_t i) {
+    Entry &e = m_entries[i];
+    std::error_code ec;
+    if (!std::filesystem::is_directory(e.m_dir, ec)) {
+      return;
+    }
+    e.m_stamp = get_write_stamp(e.m_dir, ec);
+    auto iter = cached.find(path_to_utf8(e.m_dir));
+    if (iter != cached.end() && iter->second.first == e.m_stamp) {
+      e.m_canonical = path_from_utf8(iter->second.second).string();
+      e.mf_from_cache = true;
+      e.mf_exists = true;
+      return;
+    }
+    std::filesystem::path canonical = std::filesystem::canonical(e.m_dir, ec);
+    if (!ec) {
+      e.m_canonical = canonical.string();
+      e.mf_exists = true;
+    }
+  });
+  r.canonicalize = since(start);
+
+  start = Clock::now();
+  std::unordered_set<std::string> seen;
+  std::vector<std::string_view> parts;
+  parts.reserve(m_entries.size());
+  m_directories.clear();
+  for (const Entry &e : m_entries) {
+    if (!e.mf_exists) {
+      ++r.n_missing;
+      continue;
+    }
+    e.mf_from_cache ? ++r.n_from_cache : ++r.n_canonicalized;
+    if (seen.insert(dedupe_key(e.m_canonical)).second) {
+      parts.push_back(e.m_canonical);
+      m_directories.emplace_back(e.m_canonical);
+    } else {
+      ++r.n_duplicates;
+    }
+  }
+  size_t pos = 0;
+  while (pos <= tail.size() && !tail.empty()) {
+    size_t sep_pos = tail.find(g_path_list_separator, pos);
+    if (sep_pos == std::string_view::npos) {
+      sep_pos = tail.size();
+    }
+    std::string_view part = tail.substr(pos, sep_pos - pos);
+    if (!part.empty()) {
+      if (seen.insert(dedupe_key(part)).second) {
+        parts.push_back(part);
+      } else {
+        ++r.n_duplicates;
+      }
+    }
+    pos = sep_pos + 1;
+  }
+  r.deduplicate = since(start);
+
+  start = Clock::now();
+  size_t total_size = 0;
+  for (std::string_view part : parts) {
+    total_size += part.size() + 1;
+  }
+  std::string result;
+  result.reserve(total_size);
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (i != 0) {
+      result += g_path_list_separator;
+    }
+    result += parts[i];
+  }
+  r.emit = since(start);
+
+  start = Clock::now();
+  if (!m_cache_file.empty() && r.n_canonicalized != 0) {
+    std::vector<CacheRecord> records;
+    records.reserve(m_entries.size());
+    for (const Entry &e : m_entries) {
+      if (e.mf_exists) {
+        records.push_back({path_to_utf8(e.m_dir), std::to_string(e.m_stamp),
+                           path_to_utf8(e.m_canonical)});
+      }
+    }
+    // Без кэша следующий запуск лишь медленнее, поэтому ошибка не прерывает
+    // построение PATH
+    try {
+      write_cache_file(m_cache_file, cache_kind, records);
+    } catch (std::exception &err) {
+      r.save_error = err.what();
+    }
+  }
+  r.save_cache = since(start);
+  return result;
+}
+const std::vector<std::filesystem::path> &
+PathListBuilder::directories() const noexcept {
+  return m_directories;
+}
+} // namespace winenv
@@ -0,0 +1,68 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+#ifdef _WIN32
+constexpr char g_path_list_separator = ';';
+#else
+constexpr char g_path_list_separator = ':';
+#endif
+
+// Длительность этапов построения PATH и число обработанных директорий
+struct PathListReport {
+  using Duration = std::chrono::microseconds;
+  Duration load_cache{};
+  Duration canonicalize{};
+  Duration deduplicate{};
+  Duration emit{};
+  Duration save_cache{};
+  size_t n_from_cache{0};
+  size_t n_canonicalized{0};
+  size_t n_missing{0};
+  size_t n_duplicates{0};
+  // Причина, по которой не записан файл кэша, или пустая строка
+  std::string save_error;
+
+  std::string to_string() const;
+};
+
+// Строит значение переменной PATH из списка директорий.
+// Директории приводятся к каноническому виду параллельно. Результат
+// запоминается в файле кэша по пути и времени изменения директории, поэтому
+// при повторном запуске нужен только один запрос к файловой системе на
+// директорию. Несуществующие директории и повторы отбрасываются.
+// Пример:
+// PathListBuilder builder{"path_cache.txt"};
+// builder.add(apps_dir / "vcpkg");
+// std::string path = builder.build(get_env_variable("PATH"));
+class PathListBuilder {
+public:
+  // Если cache_file пустой, кэш не используется
+  explicit PathListBuilder(std::filesystem::path cache_file = {});
+  void add(std::filesystem::path dir);
+  // Возвращает директории через разделитель, за которыми следует tail.
+  // Записи tail, совпадающие с добавленными директориями, отбрасываются.
+  // Строка результата выделяется один раз
+  std::string build(std::string_view tail, PathListReport *report = nullptr);
+  // Существующие директории без повторов в порядке добавления.
+  // Заполняется методом build
+  const std::vector<std::filesystem::path> &directories() const noexcept;
+
+private:
+  struct Entry {
+    std::filesystem::path m_dir;
+    std::string m_canonical;
+    long long m_stamp{0};
+    bool mf_exists{false};
+    bool mf_from_cache{false};
+  };
+
+  std::filesystem::path m_cache_file;
+  std::vector<Entry> m_entries;
+  std::vector<std::filesystem::path> m_directories;
+};
+} // namespace winenv
@@ -0,0 +1,853 @@
+#include "process.hpp"
+#include "command_line.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <mutex>
+#include <psapi.h>
+#else
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+namespace {
+using winenv::ProcessLimits;
+using winenv::ProcessPriority;
+
+#ifdef _WIN32
+// Наследуемый конец канала существует только на время CreateProcessW.
+// Процесс, создаваемый в это время в другом потоке с наследованием
+// дескрипторов, унаследовал бы и его
+std::mutex &inherit_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+DWORD priority_class(ProcessPriority priority) noexcept {
+  switch (priority) {
+  case ProcessPriority::idle:
+    return IDLE_PRIORITY_CLASS;
+  case ProcessPriority::below_normal:
+    return BELOW_NORMAL_PRIORITY_CLASS;
+  case ProcessPriority::above_normal:
+    return ABOVE_NORMAL_PRIORITY_CLASS;
+  case ProcessPriority::high:
+    return HIGH_PRIORITY_CLASS;
+  default:
+    return NORMAL_PRIORITY_CLASS;
+  }
+}
+
+// Задание наследуется всеми потомками процесса, поэтому ограничения
+// действуют и на программы, запущенные из консоли
+HANDLE create_limited_job(const ProcessLimits &limits) {
+  HANDLE job = CreateJobObjectW(nullptr, nullptr);
+  if (job == nullptr) {
+    throw winenv::WinError("Failed to create job object", GetLastError());
+  }
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION info{};
+  JOBOBJECT_BASIC_LIMIT_INFORMATION &basic = info.BasicLimitInformation;
+  if (limits.m_priority) {
+    basic.LimitFlags |= JOB_OBJECT_LIMIT_PRIORITY_CLASS;
+    basic.PriorityClass = priority_class(*limits.m_priority);
+  }
+  if (limits.m_affinity_mask != 0) {
+    basic.LimitFlags |= JOB_OBJECT_LIMIT_AFFINITY;
+    basic.Affinity = static_cast<ULONG_PTR>(limits.m_affinity_mask);
+  }
+  if (limits.m_working_set_limit != 0) {
+    // При заданном максимуме минимум не может быть нулевым
+    constexpr size_t min_working_set = 1024 * 1024;
+    basic.LimitFlags |= JOB_OBJECT_LIMIT_WORKINGSET;
+    basic.MinimumWorkingSetSize =
+        std::min(min_working_set, limits.m_working_set_limit);
+    basic.MaximumWorkingSetSize = limits.m_working_set_limit;
+  }
+  if (limits.m_job_memory_limit != 0) {
+    basic.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+    info.JobMemoryLimit = limits.m_job_memory_limit;
+  }
+  if (!SetInformationJobObject(job, JobObjectExtendedLimitInformation, &info,
+                               sizeof(info))) {
+    DWORD err = GetLastError();
+    CloseHandle(job);
+    throw winenv::WinError("Failed to set job object limits", err);
+  }
+  return job;
+}
+#else
+int nice_value(ProcessPriority priority) noexcept {
+  switch (priority) {
+  case ProcessPriority::idle:
+    return 19;
+  case ProcessPriority::below_normal:
+    return 10;
+  case ProcessPriority::above_normal:
+    return -5;
+  case ProcessPriority::high:
+    return -10;
+  default:
+    return 0;
+  }
+}
+
+void write_control_file(const std::filesystem::path &file,
+                        const std::string &value) {
+  int fd = open(file.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0 || write(fd, value.data(), value.size()) < 0) {
+    int err = errno;
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::system_error(err, std::generic_category(),
+                            "Failed to write " + value + " to " +
+                                file.string());
+  }
+  close(fd);
+}
+
+// Группа cgroup v2 для процессов действия. Процессы могут находиться только
+// в листьях дерева, поэтому при первом вызове WinEnv переходит из своей
+// группы в лист "winenv-main", в своей группе включает контроллер memory,
+// а процессы действий помещает в соседние листья "winenv-<действие>".
+// Группа WinEnv должна быть делегирована ему вместе с контроллером memory
+// (например, systemd-run --user -p Delegate=yes) и не содержать других
+// процессов
+std::filesystem::path prepare_cgroup(const std::string &group_name) {
+  constexpr const char *main_leaf = "winenv-main";
+  static std::mutex mutex;
+  static std::filesystem::path base;
+  std::lock_guard lock{mutex};
+  if (base.empty()) {
+    // Для cgroup v2 строка имеет вид "0::/user.slice/..."
+    std::ifstream self_cgroup{"/proc/self/cgroup"};
+    std::string line, own_group;
+    while (std::getline(self_cgroup, line)) {
+      if (line.rfind("0::", 0) == 0) {
+        own_group = line.substr(3);
+        break;
+      }
+    }
+    std::filesystem::path own =
+        std::filesystem::path{"/sys/fs/cgroup"} / own_group.substr(1);
+    std::error_code ec;
+    if (own_group.empty() ||
+        !std::filesystem::exists(own / "cgroup.controllers", ec)) {
+      throw std::runtime_error("cgroup v2 hierarchy is not available");
+    }
+    // Повторный вызов после неудачного включения контроллера
+    std::filesystem::path parent = own;
+    if (own.filename() == main_leaf) {
+      parent = own.parent_path();
+    } else {
+      std::filesystem::create_directories(own / main_leaf);
+      write_control_file(own / main_leaf / "cgroup.procs", "0");
+    }
+    write_control_file(parent / "cgroup.subtree_control", "+memory");
+    base = parent;
+  }
+  std::filesystem::path group = base / ("winenv-" + group_name);
+  std::filesystem::create_directories(group);
+  return group;
+}
+
+// Ограничения, подготовленные до fork. Между fork и exec дочерний процесс
+// вызывает только системные функции и не выделяет память
+struct PreparedLimits {
+  // Пустой, если память не ограничена
+  std::string m_cgroup_procs;
+  bool mf_set_affinity{false};
+  cpu_set_t m_cpu_set{};
+  bool mf_set_priority{false};
+  int m_nice{0};
+};
+
+PreparedLimits prepare_limits(const ProcessLimits &limits) {
+  PreparedLimits prepared;
+  if (limits.m_working_set_limit != 0 || limits.m_job_memory_limit != 0) {
+    std::filesystem::path group = prepare_cgroup(limits.m_group_name);
+    auto to_value = [](size_t bytes) {
+      return bytes == 0 ? std::string{"max"} : std::to_string(bytes);
+    };
+    write_control_file(group / "memory.high",
+                       to_value(limits.m_working_set_limit));
+    write_control_file(group / "memory.max",
+                       to_value(limits.m_job_memory_limit));
+    prepared.m_cgroup_procs = (group / "cgroup.procs").string();
+  }
+  if (limits.m_affinity_mask != 0) {
+    prepared.mf_set_affinity = true;
+    CPU_ZERO(&prepared.m_cpu_set);
+    for (int cpu = 0; cpu < 64; ++cpu) {
+      if (limits.m_affinity_mask >> cpu & 1) {
+        CPU_SET(cpu, &prepared.m_cpu_set);
+      }
+    }
+  }
+  if (limits.m_priority) {
+    prepared.mf_set_priority = true;
+    prepared.m_nice = nice_value(*limits.m_priority);
+  }
+  return prepared;
+}
+
+// Шаги дочернего процесса до exec, на которых возможна ошибка
+enum class ChildStep : int {
+  redirect_stdin,
+  chdir,
+  cgroup,
+  affinity,
+  priority,
+  exec
+};
+
+const char *step_name(ChildStep step) noexcept {
+  switch (step) {
+  case ChildStep::redirect_stdin:
+    return "redirect stdin";
+  case ChildStep::chdir:
+    return "change directory";
+  case ChildStep::cgroup:
+    return "move to cgroup";
+  case ChildStep::affinity:
+    return "set affinity";
+  case ChildStep::priority:
+    return "set priority";
+  default:
+    return "exec";
+  }
+}
+
+struct ChildError {
+  ChildStep m_step;
+  int m_errno;
+};
+
+// Запуск с ограничениями через fork: дочерний процесс применяет их к себе
+// до exec, поэтому программа и все ее потомки с первой инструкции работают
+// в группе cgroup, на заданных процессорах и с заданным приоритетом.
+// Ошибка до exec передается через канал с O_CLOEXEC, успешный exec просто
+// закрывает его. Возвращает 0 или errno, как posix_spawn
+int fork_limited(pid_t *pid, const char *exe, char *const *argv,
+                 char *const *env, int stdin_fd, const char *start_dir,
+                 const PreparedLimits &limits, ChildStep *failed_step) {
+  int error_pipe[2];
+  if (pipe2(error_pipe, O_CLOEXEC) != 0) {
+    *failed_step = ChildStep::exec;
+    return errno;
+  }
+  *pid = fork();
+  if (*pid < 0) {
+    int err = errno;
+    close(error_pipe[0]);
+    close(error_pipe[1]);
+    *failed_step = ChildStep::exec;
+    return err;
+  }
+  if (*pid == 0) {
+    close(error_pipe[0]);
+    auto fail = [fd = error_pipe[1]](ChildStep step) {
+      ChildError error{step, errno};
+      ssize_t n_written = write(fd, &error, sizeof(error));
+      static_cast<void>(n_written);
+      _exit(127);
+    };
+    if (stdin_fd >= 0 && dup2(stdin_fd, STDIN_FILENO) < 0) {
+      fail(ChildStep::redirect_stdin);
+    }
+    if (*start_dir != '\0' && chdir(start_dir) != 0) {
+      fail(ChildStep::chdir);
+    }
+    if (!limits.m_cgroup_procs.empty()) {
+      // "0" переносит в группу записывающий процесс
+      int fd = open(limits.m_cgroup_procs.c_str(), O_WRONLY | O_CLOEXEC);
+      if (fd < 0 || write(fd, "0", 1) < 0) {
+        fail(ChildStep::cgroup);
+      }
+      close(fd);
+    }
+    if (limits.mf_set_affinity &&
+        sched_setaffinity(0, sizeof(limits.m_cpu_set), &limits.m_cpu_set) !=
+            0) {
+      fail(ChildStep::affinity);
+    }
+    if (limits.mf_set_priority &&
+        setpriority(PRIO_PROCESS, 0, limits.m_nice) != 0) {
+      fail(ChildStep::priority);
+    }
+    *exe == '\0' ? execvpe(argv[0], argv, env) : execve(exe, argv, env);
+    fail(ChildStep::exec);
+  }
+  close(error_pipe[1]);
+  ChildError error{};
+  ssize_t n_read;
+  do {
+    n_read = read(error_pipe[0], &error, sizeof(error));
+  } while (n_read < 0 && errno == EINTR);
+  close(error_pipe[0]);
+  if (n_read != sizeof(error)) {
+    return 0;
+  }
+  while (waitpid(*pid, nullptr, 0) < 0 && errno == EINTR) {
+  }
+  *pid = 0;
+  *failed_step = error.m_step;
+  return error.m_errno;
+}
+#endif
+} // namespace
+
+namespace winenv {
+using Constructor = Process::Constructor;
+
+#ifdef _WIN32
+void run_as_admin(const std::wstring &file_path, const std::wstring &cmd_args) {
+  HINSTANCE res = ShellExecuteW(nullptr, L"runas", file_path.c_str(),
+                                cmd_args.c_str(), nullptr, SW_SHOWNORMAL);
+  INT_PTR ret_code = reinterpret_cast<INT_PTR>(res);
+  if (ret_code <= 32) {
+    throw WinError("Failed to run as admin", ret_code);
+  }
+}
+
+Constructor::Constructor() {
+  ZeroMemory(&m, sizeof(m));
+  m.cb = sizeof(m); // Обязательно заполнить !
+}
+
+Process Constructor::create(ProcStringView exe_path,
+                            ProcString console_title) {
+  auto start = std::chrono::steady_clock::now();
+  Process process{};
+  m.lpTitle = console_title.data();
+  DWORD flags = m_startup_flags ? m_startup_flags : NORMAL_PRIORITY_CLASS;
+  // Процесс включается в задание до того, как начнет выполняться
+  bool use_job = !m_limits.empty();
+  if (use_job) {
+    flags |= CREATE_SUSPENDED;
+  }
+  void *env_block{nullptr};
+  if (m_env_block != nullptr) {
+    // Блок только читается функцией CreateProcessW
+    env_block = const_cast<wchar_t *>(m_env_block->c_str());
+    flags |= CREATE_UNICODE_ENVIRONMENT;
+  }
+  // exe_path и m_start_dir должны заканчиваться нулевым символом
+  ProcString exe{exe_path};
+  ProcString start_dir{m_start_dir};
+  std::unique_lock<std::mutex> inherit_lock;
+  HANDLE stdin_read{nullptr};
+  if (mf_redirect_stdin) {
+    inherit_lock = std::unique_lock<std::mutex>{inherit_mutex()};
+    SECURITY_ATTRIBUTES attributes{sizeof(attributes), nullptr, true};
+    HANDLE stdin_write{nullptr};
+    if (!CreatePipe(&stdin_read, &stdin_write, &attributes,
+                    PipeWriter::g_pipe_chunk_size)) {
+      throw WinError("Failed to create stdin pipe", GetLastError());
+    }
+    process.m_stdin = PipeWriter{stdin_write};
+    // Наследуется только конец для чтения
+    SetHandleInformation(stdin_write, HANDLE_FLAG_INHERIT, 0);
+    m.hStdInput = stdin_read;
+    m.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    m.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    m.dwFlags |= STARTF_USESTDHANDLES;
+  }
+  BOOL rs = CreateProcessW(
+      exe.empty() ? nullptr : exe.c_str(),
+      m_cmd_args.empty() ? nullptr : m_cmd_args.data(), nullptr, nullptr,
+      mf_redirect_stdin, // Наследуется только канал стандартного ввода
+      flags, env_block, start_dir.empty() ? nullptr : start_dir.c_str(), &m,
+      &process.m_info);
+  m.lpTitle = nullptr;
+  if (stdin_read != nullptr) {
+    CloseHandle(stdin_read);
+    m.hStdInput = nullptr;
+    inherit_lock.unlock();
+  }
+  if (rs == 0) {
+    // Чтобы вывести заголовок процесса в сообщение ошибки, нужно преобразовать
+    // широкую строку в однобайтную строку.
+    std::string narrow_title = narrow_string(console_title);
+    throw WinError("Failed to create Process with title: " + narrow_title,
+                   GetLastError());
+  }
+  if (use_job) {
+    try {
+      process.m_job = create_limited_job(m_limits);
+      if (!AssignProcessToJobObject(process.m_job, process.m_info.hProcess)) {
+        throw WinError("Failed to assign Process to job object",
+                       GetLastError());
+      }
+    } catch (...) {
+      TerminateProcess(process.m_info.hProcess, 1);
+      throw;
+    }
+    if (!(m_startup_flags & CREATE_SUSPENDED)) {
+      ResumeThread(process.m_info.hThread);
+    }
+  }
+  process.m_spawn_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  return process;
+}
+
+Constructor &Constructor::add_startup_flags(int flags) noexcept {
+  m_startup_flags |= flags;
+  return *this;
+}
+
+Constructor &Constructor::set_window_position(DWORD x, DWORD y) noexcept {
+  m.dwX = x;
+  m.dwY = y;
+  m.dwFlags |= STARTF_USEPOSITION;
+  return *this;
+}
+
+Constructor &Constructor::set_window_size_pxl(DWORD width,
+                                              DWORD height) noexcept {
+  m.dwXSize = width;
+  m.dwYSize = height;
+  m.dwFlags |= STARTF_USESIZE;
+  return *this;
+}
+
+Constructor &Constructor::set_console_size_chr(DWORD width,
+                                               DWORD height) noexcept {
+  m.dwXCountChars = width;
+  m.dwYCountChars = height;
+  m.dwFlags |= STARTF_USECOUNTCHARS;
+  return *this;
+}
+
+Constructor &Constructor::set_console_color(ConsoleColor foreground,
+                                            ConsoleColor background) noexcept {
+  m.dwFillAttribute = console_text_attribute(foreground, background);
+  m.dwFlags |= STARTF_USEFILLATTRIBUTE;
+  return *this;
+}
+
+Constructor &
+Constructor::set_window_show_parameter(int show_parameter) noexcept {
+  m.wShowWindow = show_parameter;
+  m.dwFlags |= STARTF_USESHOWWINDOW;
+  return *this;
+}
+#else
+Constructor::Constructor() = default;
+
+Process Constructor::create(ProcStringView exe_path,
+                            ProcString console_title) {
+  auto start = std::chrono::steady_clock::now();
+  std::string exe{exe_path};
+  std::vector<std::string> args = parse_command_line(m_cmd_args);
+  // Как и CreateProcessW без командной строки: единственный аргумент - путь
+  if (args.empty()) {
+    if (exe.empty()) {
+      throw std::invalid_argument("No program to create Process");
+    }
+    args.push_back(exe);
+  }
+  std::vector<char *> argv;
+  argv.reserve(args.size() + 1);
+  for (std::string &arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+  // Указатели на записи готового блока, сам блок не копируется
+  std::vector<char *> envp;
+  if (m_env_block != nullptr) {
+    for (const char *entry = m_env_block->c_str(); *entry != '\0';
+         entry += std::char_traits<char>::length(entry) + 1) {
+      envp.push_back(const_cast<char *>(entry));
+    }
+    envp.push_back(nullptr);
+  }
+
+  // Группа cgroup настраивается до запуска, чтобы ошибка не оставила
+  // лишнего процесса
+  std::optional<PreparedLimits> limits;
+  if (!m_limits.empty()) {
+    limits = prepare_limits(m_limits);
+  }
+
+  // O_CLOEXEC: другие дочерние процессы не наследуют канал
+  int stdin_pipe[2]{-1, -1};
+  if (mf_redirect_stdin && pipe2(stdin_pipe, O_CLOEXEC) != 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Failed to create stdin pipe");
+  }
+  PipeWriter stdin_writer{stdin_pipe[1]};
+  std::string start_dir{m_start_dir};
+  Process process{};
+  char *const *env = envp.empty() ? environ : envp.data();
+  int rs{0};
+  ChildStep failed_step{ChildStep::exec};
+  if (limits) {
+    rs = fork_limited(&process.m_pid, exe.c_str(), argv.data(), env,
+                      stdin_pipe[0], start_dir.c_str(), *limits,
+                      &failed_step);
+  } else {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (mf_redirect_stdin) {
+      posix_spawn_file_actions_adddup2(&actions, stdin_pipe[0], STDIN_FILENO);
+    }
+    if (!start_dir.empty()) {
+      posix_spawn_file_actions_addchdir_np(&actions, start_dir.c_str());
+    }
+    // glibc создает процесс через clone(CLONE_VM | CLONE_VFORK), без
+    // копирования адресного пространства
+    rs = exe.empty() ? posix_spawnp(&process.m_pid, argv[0], &actions,
+                                    nullptr, argv.data(), env)
+                     : posix_spawn(&process.m_pid, exe.c_str(), &actions,
+                                   nullptr, argv.data(), env);
+    posix_spawn_file_actions_destroy(&actions);
+  }
+  if (stdin_pipe[0] >= 0) {
+    close(stdin_pipe[0]);
+  }
+  process.m_stdin = std::move(stdin_writer);
+  if (rs != 0) {
+    process.m_pid = 0;
+    std::string program = exe.empty() ? args[0] : exe;
+    throw std::system_error(
+        rs, std::generic_category(),
+        failed_step == ChildStep::exec
+            ? "Failed to create Process " + program +
+                  " with title: " + console_title
+            : std::string{"Failed to "} + step_name(failed_step) +
+                  " for Process " + program);
+  }
+#ifdef SYS_pidfd_open
+  process.m_pidfd =
+      static_cast<int>(syscall(SYS_pidfd_open, process.m_pid, 0));
+#endif
+  process.m_spawn_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  return process;
+}
+#endif
+
+Constructor &Constructor::set_command_line_arguments(ProcString cmd_args) {
+  m_cmd_args = std::move(cmd_args);
+  return *this;
+}
+
+Constructor &Constructor::set_environment_variables(SharedEnvBlock env) {
+  m_env_block = std::move(env);
+  return *this;
+}
+
+Constructor &Constructor::set_startup_directory(ProcStringView dir) {
+  m_start_dir = dir;
+  return *this;
+}
+
+Constructor &Constructor::set_limits(ProcessLimits limits) {
+  m_limits = std::move(limits);
+  return *this;
+}
+
+Constructor &Constructor::redirect_stdin() noexcept {
+  mf_redirect_stdin = true;
+  return *this;
+}
+
+#ifdef _WIN32
+PipeWriter::PipeWriter(HANDLE handle) noexcept : m_handle{handle} {}
+#else
+PipeWriter::PipeWriter(int fd) noexcept : m_fd{fd} {}
+#endif
+
+PipeWriter::~PipeWriter() { close(); }
+
+PipeWriter::PipeWriter(PipeWriter &&other) noexcept {
+  *this = std::move(other);
+}
+
+PipeWriter &PipeWriter::operator=(PipeWriter &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  close();
+#ifdef _WIN32
+  m_handle = std::exchange(other.m_handle, nullptr);
+#else
+  m_fd = std::exchange(other.m_fd, -1);
+#endif
+  return *this;
+}
+
+#ifdef _WIN32
+void PipeWriter::write(std::string_view data) {
+  while (!data.empty()) {
+    DWORD n_written{0};
+    auto chunk = static_cast<DWORD>(std::min(data.size(), g_pipe_chunk_size));
+    if (!WriteFile(m_handle, data.data(), chunk, &n_written, nullptr)) {
+      throw WinError("Failed to write to Process stdin", GetLastError());
+    }
+    data.remove_prefix(n_written);
+  }
+}
+
+void PipeWriter::close() noexcept {
+  if (m_handle != nullptr) {
+    CloseHandle(m_handle);
+    m_handle = nullptr;
+  }
+}
+
+bool PipeWriter::is_open() const noexcept { return m_handle != nullptr; }
+#else
+void PipeWriter::write(std::string_view data) {
+  // Запись в канал без читателя посылает SIGPIPE, который завершил бы
+  // WinEnv. Сигнал блокируется только в вызывающем потоке
+  sigset_t sigpipe_set;
+  sigset_t old_mask;
+  sigemptyset(&sigpipe_set);
+  sigaddset(&sigpipe_set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe_set, &old_mask);
+  int err{0};
+  while (!data.empty()) {
+    ssize_t n_written = ::write(m_fd, data.data(),
+                                std::min(data.size(), g_pipe_chunk_size));
+    if (n_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      err = errno;
+      break;
+    }
+    data.remove_prefix(static_cast<size_t>(n_written));
+  }
+  if (err == EPIPE) {
+    // Сбрасывает ожидающий сигнал до снятия блокировки
+    timespec no_wait{};
+    sigtimedwait(&sigpipe_set, nullptr, &no_wait);
+  }
+  pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+  if (err != 0) {
+    throw std::system_error(err, std::generic_category(),
+                            "Failed to write to Process stdin");
+  }
+}
+
+void PipeWriter::close() noexcept {
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+bool PipeWriter::is_open() const noexcept { return m_fd >= 0; }
+#endif
+
+bool ProcessLimits::empty() const noexcept {
+  return !m_priority && m_affinity_mask == 0 && m_working_set_limit == 0 &&
+         m_job_memory_limit == 0;
+}
+
+Process::~Process() { release(); }
+
+Process::Process() = default;
+
+Process::Process(Process &&other) { *this = std::move(other); }
+
+Process &Process::operator=(Process &&other) {
+  if (this == &other) {
+    return *this;
+  }
+  release();
+#ifdef _WIN32
+  m_info = std::exchange(other.m_info, {});
+  m_job = std::exchange(other.m_job, nullptr);
+#else
+  m_pid = std::exchange(other.m_pid, 0);
+  m_pidfd = std::exchange(other.m_pidfd, -1);
+  mf_reaped = std::exchange(other.mf_reaped, false);
+  m_wait_status = std::exchange(other.m_wait_status, 0);
+  m_usage = other.m_usage;
+#endif
+  m_spawn_time = other.m_spawn_time;
+  m_stdin = std::move(other.m_stdin);
+  return *this;
+}
+
+PipeWriter Process::take_stdin() noexcept { return std::move(m_stdin); }
+
+std::chrono::microseconds Process::get_spawn_time() const noexcept {
+  return m_spawn_time;
+}
+
+#ifdef _WIN32
+bool Process::wait_for(std::uint32_t milliseconds) {
+  if (!m_info.hProcess) {
+    throw std::runtime_error("Uninitialized Process instance");
+  }
+  DWORD result = WaitForSingleObject(m_info.hProcess, milliseconds);
+  if (result == WAIT_OBJECT_0) {
+    return true;
+  }
+  if (result == WAIT_TIMEOUT) {
+    return false;
+  };
+  throw WinError("Failed while waiting Process", GetLastError());
+}
+
+Process::NativeId Process::get_id() const noexcept {
+  return m_info.dwProcessId;
+}
+
+Process::Usage Process::get_usage() {
+  Usage usage{};
+  DWORD exit_code{0};
+  if (!GetExitCodeProcess(m_info.hProcess, &exit_code)) {
+    throw WinError("Failed to get Process exit code", GetLastError());
+  }
+  usage.m_exit_code = static_cast<int>(exit_code);
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (GetProcessTimes(m_info.hProcess, &creation_time, &exit_time,
+                      &kernel_time, &user_time)) {
+    // Интервалы по 100 нс
+    auto to_ticks = [](FILETIME t) {
+      return static_cast<unsigned long long>(t.dwHighDateTime) << 32 |
+             t.dwLowDateTime;
+    };
+    usage.m_cpu_time = std::chrono::microseconds(
+        (to_ticks(kernel_time) + to_ticks(user_time)) / 10);
+  }
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (GetProcessMemoryInfo(m_info.hProcess, &counters, sizeof(counters))) {
+    usage.m_peak_memory = counters.PeakWorkingSetSize;
+  }
+  return usage;
+}
+
+HANDLE Process::get_handle() noexcept { return m_info.hProcess; }
+
+HANDLE Process::get_thread_handle() noexcept { return m_info.hThread; }
+
+DWORD Process::get_thread_id() const noexcept { return m_info.dwThreadId; }
+
+void Process::release() noexcept {
+  if (m_info.hProcess != nullptr) {
+    CloseHandle(m_info.hProcess);
+    CloseHandle(m_info.hThread);
+    m_info = {};
+  }
+  // Закрытие задания не завершает процессы, ограничения продолжают действовать
+  if (m_job != nullptr) {
+    CloseHandle(m_job);
+    m_job = nullptr;
+  }
+}
+#else
+bool Process::wait_for(std::uint32_t milliseconds) {
+  if (m_pid == 0) {
+    throw std::runtime_error("Uninitialized Process instance");
+  }
+  if (mf_reaped) {
+    return true;
+  }
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(milliseconds);
+  bool is_finite = milliseconds != 0 && milliseconds != g_wait_infinite;
+  bool use_pidfd = is_finite && m_pidfd >= 0;
+  if (use_pidfd) {
+    // pidfd становится читаемым, когда процесс завершается
+    pollfd pfd{m_pidfd, POLLIN, 0};
+    int rs = poll(&pfd, 1, static_cast<int>(milliseconds));
+    if (rs < 0 && errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(),
+                              "Failed while waiting Process");
+    }
+    if (rs <= 0) {
+      return false;
+    }
+  }
+  int options = milliseconds == g_wait_infinite ? 0 : WNOHANG;
+  while (true) {
+    rusage child_usage{};
+    pid_t rs = wait4(m_pid, &m_wait_status, options, &child_usage);
+    if (rs == m_pid) {
+      mf_reaped = true;
+      if (WIFEXITED(m_wait_status)) {
+        m_usage.m_exit_code = WEXITSTATUS(m_wait_status);
+      } else if (WIFSIGNALED(m_wait_status)) {
+        m_usage.m_exit_code = 128 + WTERMSIG(m_wait_status);
+      }
+      auto to_us = [](timeval t) {
+        return std::chrono::seconds(t.tv_sec) +
+               std::chrono::microseconds(t.tv_usec);
+      };
+      m_usage.m_cpu_time =
+          to_us(child_usage.ru_utime) + to_us(child_usage.ru_stime);
+      // ru_maxrss в килобайтах
+      m_usage.m_peak_memory = static_cast<size_t>(child_usage.ru_maxrss) * 1024;
+      return true;
+    }
+    if (rs < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "Failed while waiting Process");
+    }
+    // Процесс еще работает. Без pidfd опрашиваем до истечения времени
+    if (use_pidfd || !is_finite ||
+        std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+Process::NativeId Process::get_id() const noexcept { return m_pid; }
+
+Process::Usage Process::get_usage() {
+  if (!mf_reaped) {
+    throw std::runtime_error("Process is still running");
+  }
+  return m_usage;
+}
+
+int Process::get_pidfd() const noexcept { return m_pidfd; }
+
+int Process::get_wait_status() const noexcept { return m_wait_status; }
+
+void Process::release() noexcept {
+  if (m_pidfd >= 0) {
+    close(m_pidfd);
+    m_pidfd = -1;
+  }
+  // Уже завершившийся процесс не должен оставаться зомби. Работающий
+  // процесс продолжает работу
+  if (m_pid != 0 && !mf_reaped) {
+    waitpid(m_pid, &m_wait_status, WNOHANG);
+  }
+  m_pid = 0;
+  mf_reaped = false;
+}
+#endif
+} // namespace winenv
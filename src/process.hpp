@@ -0,0 +1,212 @@
+#pragma once
+#include "env_block.hpp"
+#ifdef _WIN32
+#include "color.hpp"
+#else
+#include <sys/types.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace winenv {
+#ifdef _WIN32
+void run_as_admin(const std::wstring &file_path, const std::wstring &cmd_args);
+#endif
+
+// Строки аргументов в кодировке системы: широкие в Windows
+using ProcString = EnvString;
+using ProcStringView = EnvStringView;
+// Ожидание без ограничения времени, совпадает с INFINITE
+constexpr std::uint32_t g_wait_infinite = 0xFFFFFFFF;
+
+// Классы приоритета Windows. В остальных системах переводятся в nice
+enum class ProcessPriority { idle, below_normal, normal, above_normal, high };
+
+// Ограничения ресурсов дочернего процесса и всех его потомков. Действуют
+// до запуска программы: в Windows процесс создается приостановленным и
+// включается в Job Object, в Linux дочерний процесс до exec входит в группу
+// cgroup v2 (память) и вызывает sched_setaffinity/setpriority
+struct ProcessLimits {
+  std::optional<ProcessPriority> m_priority;
+  // Маска допустимых процессоров, 0 - без ограничений
+  std::uint64_t m_affinity_mask{0};
+  // Рабочий набор процесса (Windows) или memory.high группы (Linux), байты.
+  // 0 - без ограничений
+  size_t m_working_set_limit{0};
+  // Память всех процессов задания (Windows) или memory.max группы (Linux)
+  size_t m_job_memory_limit{0};
+  // Имя группы cgroup, обычно название действия
+  std::string m_group_name;
+
+  bool empty() const noexcept;
+};
+
+// Конец анонимного канала для записи в стандартный ввод дочернего процесса.
+// Данные пишутся блоками не больше g_pipe_chunk_size без промежуточных
+// копий. Запись блокируется, пока процесс не прочитает предыдущие блоки,
+// поэтому большие объемы лучше писать из отдельного потока.
+// Пример:
+// Process proc = Process::Constructor().redirect_stdin().create(exe, {});
+// PipeWriter input = proc.take_stdin();
+// input.write(text);
+// input.close(); // Процесс получает конец файла
+class PipeWriter {
+public:
+  static constexpr size_t g_pipe_chunk_size = 64 * 1024;
+
+  PipeWriter() = default;
+#ifdef _WIN32
+  explicit PipeWriter(HANDLE handle) noexcept;
+#else
+  explicit PipeWriter(int fd) noexcept;
+#endif
+  ~PipeWriter();
+  PipeWriter(const PipeWriter &other) = delete;
+  PipeWriter(PipeWriter &&other) noexcept;
+  PipeWriter &operator=(const PipeWriter &other) = delete;
+  PipeWriter &operator=(PipeWriter &&other) noexcept;
+
+  // Выбрасывает исключение, если процесс закрыл свой конец канала
+  void write(std::string_view data);
+  void close() noexcept;
+  bool is_open() const noexcept;
+
+private:
+#ifdef _WIN32
+  HANDLE m_handle{nullptr};
+#else
+  int m_fd{-1};
+#endif
+};
+
+// Обёртка дочернего процесса. Позволяет создать процесс с необходимыми
+// параметрами, дождаться завершения процесса. В Windows процесс создается
+// CreateProcessW, в остальных системах - posix_spawn.
+// Пример. Создание процесса командной строки:
+// Process proc = Process::Constructor()
+//                  .set_command_line_arguments(L"_ echo hello world")
+//                  .create(L"C:\\WINDOWS\\system32\\cmd.exe", L"hello world");
+class Process {
+public:
+#ifdef _WIN32
+  using NativeId = DWORD;
+#else
+  using NativeId = pid_t;
+#endif
+
+  // Инкапсулирующая фабрика
+  class Constructor {
+  public:
+    Constructor();
+    // Информация требуемая для создания процесса.
+    // Если exe_path пустая строка, нужно определить аргументы
+    // командной строки set_command_line_arguments(...).
+    // Второй аргумент не влияет на вид пользовательских окон и
+    // используется только в Windows
+    Process create(ProcStringView exe_path, ProcString console_title);
+    // Аргументы отделены пробелами. Первый аргумент - название программы,
+    // аргумент не записывается в строку LPSTR szCmdLine функции WinMain.
+    // Если exe_path == {}, тогда первый аргумент используется как путь к
+    // исполняемому файлу и ищется в PATH
+    Constructor &set_command_line_arguments(ProcString cmd_args);
+    // Если не вызывать, то наследует от родительского процесса.
+    // Блок не копируется, один блок может использоваться многими запусками
+    Constructor &set_environment_variables(SharedEnvBlock env);
+    // Если не вызывать, то наследует от родительского процесса
+    Constructor &set_startup_directory(ProcStringView dir);
+    // Если ограничения не удалось применить, процесс завершается, а create
+    // выбрасывает исключение
+    Constructor &set_limits(ProcessLimits limits);
+    // Стандартный ввод процесса - канал, конец для записи забирается
+    // методом take_stdin созданного процесса
+    Constructor &redirect_stdin() noexcept;
+#ifdef _WIN32
+    // Допустимые флаги:
+    // https://learn.microsoft.com/en-us/windows/win32/procthread/process-creation-flags
+    Constructor &add_startup_flags(int flags) noexcept;
+    Constructor &set_window_position(DWORD x, DWORD y) noexcept;
+    // Применяется при первом вызове CreateWindow()
+    Constructor &set_window_size_pxl(DWORD width, DWORD height) noexcept;
+    // Не применяют оконные программы
+    Constructor &set_console_size_chr(DWORD width, DWORD height) noexcept;
+    Constructor &set_console_color(ConsoleColor foreground,
+                                   ConsoleColor background) noexcept;
+    Constructor &set_window_show_parameter(int show_parameter) noexcept;
+#endif
+
+  private:
+#ifdef _WIN32
+    STARTUPINFOW m;
+    int m_startup_flags{};
+#endif
+    // Опционально. Нужны неконстантные указатели. Храним копии
+    ProcString m_cmd_args;
+    SharedEnvBlock m_env_block;
+    // Опционально. Подойдет константный указаетель
+    ProcStringView m_start_dir;
+    ProcessLimits m_limits;
+    bool mf_redirect_stdin{false};
+  };
+  // Итоги работы завершившегося процесса
+  struct Usage {
+    int m_exit_code{0};
+    // Время пользователя и ядра
+    std::chrono::microseconds m_cpu_time{0};
+    // Пиковый размер рабочего набора (Windows) или резидентной памяти
+    size_t m_peak_memory{0};
+  };
+  // Не завершает процесс, только освобождает дескрипторы
+  ~Process();
+  // Не создает новой процесс, используется как "пустой" объект
+  Process();
+  Process(const Process &other) = delete;
+  Process(Process &&other);
+  Process &operator=(const Process &other) = delete;
+  Process &operator=(Process &&other);
+  // Ждем завершение процесса заданное время.
+  // Если процесс завершился, возвращаем true иначе - false.
+  // Допустимы особые значения времени 0 и g_wait_infinite
+  bool wait_for(std::uint32_t milliseconds);
+  NativeId get_id() const noexcept;
+  // Время, затраченное на создание процесса
+  std::chrono::microseconds get_spawn_time() const noexcept;
+  // Вызывается после того, как wait_for вернул true. В POSIX код
+  // завершения по сигналу равен 128 + номер сигнала, как в оболочке
+  Usage get_usage();
+  // Канал стандартного ввода, если при создании вызван redirect_stdin.
+  // Повторный вызов возвращает закрытый канал
+  PipeWriter take_stdin() noexcept;
+#ifdef _WIN32
+  HANDLE get_handle() noexcept;
+  HANDLE get_thread_handle() noexcept;
+  DWORD get_thread_id() const noexcept;
+#else
+  // Дескриптор pidfd или -1, если ядро его не поддерживает
+  int get_pidfd() const noexcept;
+  // Статус waitpid завершившегося процесса
+  int get_wait_status() const noexcept;
+#endif
+
+private:
+  void release() noexcept;
+
+#ifdef _WIN32
+  PROCESS_INFORMATION m_info{};
+  // Задание с ограничениями, если они заданы
+  HANDLE m_job{nullptr};
+#else
+  pid_t m_pid{0};
+  int m_pidfd{-1};
+  bool mf_reaped{false};
+  int m_wait_status{0};
+  Usage m_usage{};
+#endif
+  std::chrono::microseconds m_spawn_time{0};
+  PipeWriter m_stdin;
+};
+} // namespace winenv
@@ -1,14 +1,155 @@
 ﻿#include "root_app.hpp"
+#include "command_line.hpp"
+#include "file_walker.hpp"
 #include "font.hpp"
-#include "win_proc.hpp"
+#include "nvim_rpc.hpp"
+#include "parallel.hpp"
+#include "path_list.hpp"
+#include "process.hpp"
+#include "shims.hpp"
 
 #include "log_window.hpp"
 
+#include <algorithm>
+#include <cwchar>
+#include <memory>
+#include <thread>
+
 namespace {
+// Названия действий в ACTIONS и в сводке ProcessSupervisor
+const std::string spawn_cmd_action{"spawn_cmd"};
+const std::string browser_action{"browser"};
+const std::string editor_action{"editor"};
+
+// Предел длины аргумента из буфера обмена. Больший текст передается только
+// через стандартный ввод
+constexpr size_t max_clipboard_arg = 2048;
+
+// Пишет данные в стандартный ввод процесса в отдельном потоке, чтобы не
+// останавливать обработку сообщений. Поток завершается, когда данные
+// записаны или процесс закрыл ввод
+void stream_to_stdin(winenv::PipeWriter input,
+                     std::shared_ptr<const std::string> data) {
+  std::thread{[input = std::move(input), data = std::move(data)]() mutable {
+    try {
+      input.write(*data);
+    } catch (std::exception &) { // Процесс завершился, не дочитав ввод
+    }
+  }}.detach();
+}
+
+// Нажатие HK_CLIP_HISTORY позже этого после предыдущего начинает перебор
+// истории заново
+constexpr std::chrono::milliseconds clip_recall_pause{3'000};
+// Предел длины записи истории в окне журнала
+constexpr size_t clip_preview_size = 300;
+
+// Индекс файлов старше строится заново при нажатии HK_FILE_PICK
+constexpr std::chrono::minutes file_index_max_age{5};
+// Число найденных файлов в окне выбора
+constexpr size_t file_pick_results = 20;
+
+bool is_inside(const winenv::Path &path, const winenv::Path &dir) {
+  auto [dir_end, path_end] =
+      std::mismatch(dir.begin(), dir.end(), path.begin(), path.end());
+  return dir_end == dir.end();
+}
+
+// Передает fn текст буфера обмена, читая его прямо из блока буфера. Длина
+// ограничена размером блока на случай строки без завершающего нуля.
+// Возвращает false, если буфер обмена не удалось открыть
+template <class Fn> bool with_clipboard_text(HWND owner, Fn &&fn) {
+  if (!OpenClipboard(owner)) {
+    return false;
+  }
+  HGLOBAL hglb = GetClipboardData(CF_UNICODETEXT);
+  auto clipboard_text =
+      hglb == nullptr ? nullptr : static_cast<LPCWSTR>(GlobalLock(hglb));
+  if (clipboard_text != nullptr) {
+    fn(std::wstring_view{
+        clipboard_text,
+        wcsnlen(clipboard_text, GlobalSize(hglb) / sizeof(wchar_t))});
+    GlobalUnlock(hglb);
+  }
+  CloseClipboard();
+  return true;
+}
+
+// false, если владелец буфера обмена просит не запоминать его содержимое:
+// менеджеры паролей ставят формат ExcludeClipboardContentFromMonitorProcessing
+// или CanIncludeInClipboardHistory со значением 0. Вызывается при открытом
+// буфере обмена
+bool is_clip_history_allowed() {
+  static const UINT exclude_format =
+      RegisterClipboardFormatW(L"ExcludeClipboardContentFromMonitorProcessing");
+  static const UINT include_format =
+      RegisterClipboardFormatW(L"CanIncludeInClipboardHistory");
+  if (exclude_format != 0 && IsClipboardFormatAvailable(exclude_format)) {
+    return false;
+  }
+  if (include_format == 0 || !IsClipboardFormatAvailable(include_format)) {
+    return true;
+  }
+  // Значение формата - DWORD. Непрочитанное значение считается запретом
+  HGLOBAL hglb = GetClipboardData(include_format);
+  if (hglb == nullptr || GlobalSize(hglb) < sizeof(DWORD)) {
+    return false;
+  }
+  auto value = static_cast<const DWORD *>(GlobalLock(hglb));
+  if (value == nullptr) {
+    return false;
+  }
+  bool is_allowed = *value != 0;
+  GlobalUnlock(hglb);
+  return is_allowed;
+}
+
+// Помещает текст в буфер обмена. Владельцем буфера становится owner
+bool set_clipboard_text(HWND owner, std::wstring_view text) {
+  HGLOBAL hglb =
+      GlobalAlloc(GMEM_MOVEABLE, (text.size() + 1) * sizeof(wchar_t));
+  if (hglb == nullptr) {
+    return false;
+  }
+  auto buffer = static_cast<wchar_t *>(GlobalLock(hglb));
+  text.copy(buffer, text.size());
+  buffer[text.size()] = L'\0';
+  GlobalUnlock(hglb);
+  if (!OpenClipboard(owner)) {
+    GlobalFree(hglb);
+    return false;
+  }
+  EmptyClipboard();
+  // После успешного вызова блоком владеет система
+  bool is_set = SetClipboardData(CF_UNICODETEXT, hglb) != nullptr;
+  if (!is_set) {
+    GlobalFree(hglb);
+  }
+  CloseClipboard();
+  return is_set;
+}
+
 bool add_font(std::string_view font_name) {
   return winenv::manage_font_resouces<winenv::FontAction::add>(
              std::filesystem::current_path() / "fonts") > 0;
 }
+
+winenv::ConsoleProfile make_console_profile(const winenv::AppConfig &config) {
+  winenv::ConsoleProfile profile;
+  std::copy_n(config.term_color_table.begin(),
+              std::min(config.term_color_table.size(),
+                       std::size(profile.m_term_colors)),
+              profile.m_term_colors);
+  // Последний символ остается нулевым
+  std::copy_n(config.font_name.begin(),
+              std::min(config.font_name.size(),
+                       std::size(profile.m_font_name) - 1),
+              profile.m_font_name);
+  profile.m_font_size = config.font_size;
+  // Профиль создается в потоке RootApp
+  profile.m_parent_thread_id = GetCurrentThreadId();
+  return profile;
+}
 } // namespace
 
 namespace winenv {
@@ -27,7 +168,16 @@ RootApp::RootApp(HINSTANCE app_hinstance)
                         method_handle(&RootApp::log_wnd_2clk_handler))
                     .add_message_handling(
                         WM_NCLBUTTONDBLCLK,
-                        method_handle(&RootApp::log_wnd_2clk_handler)),
+                        method_handle(&RootApp::log_wnd_2clk_handler))
+                    .add_message_handling(
+                        WM_CHAR,
+                        method_handle(&RootApp::file_pick_char_handler))
+                    .add_message_handling(
+                        WM_KEYDOWN,
+                        method_handle(&RootApp::file_pick_key_handler))
+                    .add_message_handling(
+                        WM_ACTIVATE,
+                        method_handle(&RootApp::file_pick_activate_handler)),
                 "",
                 mf_found_fonts || mf_added_fonts ? m_config.font_name : "",
                 m_config.font_size * 15 / 10},
@@ -39,14 +189,63 @@ RootApp::RootApp(HINSTANCE app_hinstance)
               .add_message_handling(
                   WM_DROPFILES, method_handle(&RootApp::file_drop_msg_handler))
               .add_message_handling(WM_PAINT,
-                                    method_handle(&RootApp::paint_file_wnd))},
-      m_programm_path{get_programm_path()} {
+                                    method_handle(&RootApp::paint_file_wnd))
+              .add_message_handling(
+                  WM_CLIPBOARDUPDATE,
+                  method_handle(&RootApp::clipboard_update_msg_handler))},
+      m_programm_path{get_programm_path()},
+      m_console_profile{make_console_profile(m_config)},
+      m_supervisor{[thread_id = GetCurrentThreadId()] {
+        PostThreadMessageW(thread_id, g_wm_child_exit, 0, 0);
+      }} {
   EventDriven::reasign_owner(this);
   configure_env();
+  if (m_config.console_pool_size > 0) {
+    m_pool_cancel = CreateEventW(nullptr, true, false, nullptr);
+    if (m_pool_cancel == nullptr) {
+      throw WinError("Failed to create console pool cancel event",
+                     GetLastError());
+    }
+    m_console_pool = std::make_unique<WarmPool<PooledConsole>>(
+        m_config.console_pool_size, [this] { return create_pooled_console(); },
+        [](PooledConsole &console) { return console.is_alive(); });
+  }
+  m_dispatcher.add_message_handling(
+      g_wm_child_exit, method_handle(&RootApp::child_exit_msg_handler));
+  m_dispatcher.add_message_handling(
+      g_wm_spawn_stage, method_handle(&RootApp::spawn_stage_msg_handler));
+  m_dispatcher.add_message_handling(
+      g_wm_file_index, method_handle(&RootApp::file_index_msg_handler));
+  // Сохраненный индекс нужен только для тех же директорий
+  auto load_start = std::chrono::steady_clock::now();
+  FileIndex saved_index = FileIndex::load(m_file_index_file);
+  if (saved_index.roots() == m_file_pick_roots) {
+    m_file_index = std::move(saved_index);
+    auto load_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - load_start);
+    *g_logger << "File index: " << m_file_index.size()
+              << " files loaded in " << load_time.count() << " us"
+              << std::endl;
+  }
   std::string warning_str;
 
   warning_str += configure_hotkeys();
   add_con_font_to_registry(m_config.font_name);
+  if (m_config.clip_history_size > 0) {
+    try {
+      m_clip_history.emplace(m_config.clip_history_size,
+                             m_config.clip_history_kb * 1024);
+      m_clip_history->open_file(m_clip_history_file);
+      *g_logger << "Clipboard history: " << m_clip_history->size()
+                << " entries, " << m_clip_history->bytes_used() << " bytes"
+                << std::endl;
+    } catch (std::exception &ex) { // История работает и без файла
+      warning_str += std::string(ex.what()) + '\n';
+    }
+    if (!AddClipboardFormatListener(m_file_wnd.get_hwnd())) {
+      warning_str += "Failed to listen for clipboard updates\n";
+    }
+  }
 
   if (!warning_str.empty()) {
     warning_str = log_text_top + warning_str + log_text_bottom;
@@ -56,10 +255,17 @@ RootApp::RootApp(HINSTANCE app_hinstance)
     m_log_wnd.print("Hello!");
     m_log_wnd.show_for(1'000);
   }
+  // Последним: при исключении выше поток еще не запущен, и деструктор
+  // std::thread не вызывает std::terminate
+  start_file_index();
 }
 
 RootApp::~RootApp() {
   *g_logger << "Root app is being destructed" << std::endl;
+  mf_cancel_file_index = true;
+  if (m_file_index_thread.joinable()) {
+    m_file_index_thread.join();
+  }
   if (mf_added_fonts) {
     manage_font_resouces<FontAction::remove>(std::filesystem::current_path() /
                                              "fonts");
@@ -67,6 +273,16 @@ RootApp::~RootApp() {
   *g_logger << "Root app was destructed" << std::endl;
 }
 
+RootApp::ConsolePoolStopper::~ConsolePoolStopper() {
+  // Поток пула может ждать готовности консоли до 10 секунд
+  if (m_app.m_pool_cancel != nullptr) {
+    SetEvent(m_app.m_pool_cancel);
+    m_app.m_console_pool.reset();
+    CloseHandle(m_app.m_pool_cancel);
+    m_app.m_pool_cancel = nullptr;
+  }
+}
+
 void RootApp::run() {
   try {
     while (!m_file_wnd.is_quit()) {
@@ -92,27 +308,103 @@ void RootApp::run() {
 
 void RootApp::configure_env() {
   using std::filesystem::canonical;
-  Path abs_root_path = canonical(m_programm_path / m_config.root_offset);
-  std::string str_root_path = abs_root_path.string();
-  set_env_variable("flash_root", str_root_path);
+  using std::filesystem::u8path;
+  VarExpander &vars = m_config.variables;
+  // Снимок среды делается один раз, дальше меняется только копия
+  auto snapshot = std::make_shared<const EnvSnapshot>(EnvSnapshot::capture());
+  // Ссылки %NAME% и неизвестные ${name} берутся из снимка среды
+  vars.set_fallback(
+      [snapshot](std::string_view name) -> std::optional<std::string> {
+        std::optional<EnvStringView> value =
+            snapshot->find(widen_string(name));
+        if (!value) {
+          return std::nullopt;
+        }
+        return narrow_string(*value);
+      });
+  EnvBlock env{*snapshot};
+  Path abs_root_path =
+      canonical(m_programm_path / u8path(vars.get("ROOT_OFFSET")));
+  env.set(L"flash_root", abs_root_path.wstring());
+  vars.define_literal("flash_root", abs_root_path.u8string());
   m_cmd_launch_dir = abs_root_path; // Запускаем cmd в корне
-  Path abs_apps_dir = canonical(abs_root_path / m_config.apps_dir);
-  Path abs_apps_data = canonical(abs_root_path / m_config.apps_data);
-  Path abs_xdg_home = canonical(abs_root_path / m_config.xdg_home);
+  m_file_pick_roots = {abs_root_path};
+  for (auto &pick_dir : m_config.file_pick_dirs) {
+    std::error_code ec;
+    Path dir = canonical(abs_root_path / u8path(vars.expand(pick_dir)), ec);
+    if (ec) {
+      *g_logger << "File pick directory not found: " << pick_dir << std::endl;
+      continue;
+    }
+    // Вложенная директория уже обходится вместе с корнем
+    auto contains_dir = [&dir](const Path &root) {
+      return is_inside(dir, root);
+    };
+    if (std::none_of(m_file_pick_roots.begin(), m_file_pick_roots.end(),
+                     contains_dir)) {
+      m_file_pick_roots.push_back(std::move(dir));
+    }
+  }
+  Path abs_apps_dir = canonical(abs_root_path / u8path(vars.get("APPS_DIR")));
+  Path abs_apps_data =
+      canonical(abs_root_path / u8path(vars.get("APPS_DATA")));
+  Path abs_xdg_home = canonical(abs_root_path / u8path(vars.get("XDGHOME")));
   // Переменные, используемые linux приложениями как директории хранения данных
-  std::string str_xdg_home = abs_xdg_home.string();
-  set_env_variable("XDG_CONFIG_HOME", str_xdg_home);
-  set_env_variable("XDG_DATA_HOME", str_xdg_home);
-  set_env_variable("XDG_RUNTIME_HOME", str_xdg_home);
-  set_env_variable("XDG_STATE_HOME", str_xdg_home);
+  std::wstring str_xdg_home = abs_xdg_home.wstring();
+  env.set(L"XDG_CONFIG_HOME", str_xdg_home);
+  env.set(L"XDG_DATA_HOME", str_xdg_home);
+  env.set(L"XDG_RUNTIME_HOME", str_xdg_home);
+  env.set(L"XDG_STATE_HOME", str_xdg_home);
+
+  // Кэши не зависят от текущей директории, из которой запущен WinEnv
+  m_path_cache_file = abs_apps_data / "path_cache.txt";
+  m_exe_index = ExecutableIndex{abs_apps_data / "exe_index.txt"};
+  m_clip_history_file = abs_apps_data / "clip_history.bin";
+  m_file_index_file = abs_apps_data / "file_index.bin";
 
   // Объединяем пути к приложениям
-  std::string new_path{};
+  PathListBuilder path_builder{m_path_cache_file};
   for (auto &bin_path : m_config.apps_bin_paths) {
-    new_path += canonical(abs_apps_dir / bin_path).string() + ';';
+    path_builder.add(abs_apps_dir / u8path(vars.expand(bin_path)));
+  }
+  PathListReport path_report;
+  std::string old_path = narrow_string(snapshot->find(L"PATH").value_or(L""));
+  std::string new_path = path_builder.build(old_path, &path_report);
+  *g_logger << path_report.to_string() << std::endl;
+
+  auto index_start = std::chrono::steady_clock::now();
+  size_t n_rescanned = m_exe_index.refresh(path_builder.directories());
+  auto index_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - index_start);
+  *g_logger << "Executable index: " << m_exe_index.size() << " names, "
+            << n_rescanned << " directories rescanned, " << index_time.count()
+            << " us" << std::endl;
+  if (!m_exe_index.save_error().empty()) {
+    *g_logger << "Executable index cache not saved: "
+              << m_exe_index.save_error() << std::endl;
+  }
+
+  if (m_config.use_shims) {
+    // Консоли находят команду в первой же директории PATH. Директории
+    // APPS_BIN_PATHS остаются за ней: по ним CreateProcess ищет программы
+    // с расширением, а загрузчик - DLL
+    try {
+      ShimDirectory shims{abs_apps_data / "shims"};
+      ShimPlan plan = shims.sync(shims_from_commands(m_exe_index.commands()));
+      *g_logger << "Shims: " << plan.m_create.size() << " created, "
+                << plan.m_remove.size() << " removed, " << plan.m_n_unchanged
+                << " unchanged" << std::endl;
+      new_path = narrow_string(shims.get_path().wstring()) +
+                 g_path_list_separator + new_path;
+    } catch (std::exception &err) {
+      *g_logger << "Shims are not used: " << err.what() << std::endl;
+    }
+  }
+  env.set(L"PATH", widen_string(new_path));
+  for (auto &[name, value_template] : m_config.environment) {
+    env.set(widen_string(name), widen_string(vars.render(value_template)));
   }
-  new_path += get_env_variable("PATH");
-  set_env_variable("PATH", new_path);
+  m_env = SharedEnv{env.build()};
 }
 
 std::string RootApp::configure_hotkeys() {
@@ -143,10 +435,20 @@ std::string RootApp::configure_hotkeys() {
                                method_handle(&RootApp::exit_khandler));
   add_key_handling_with_backup(m_config.spawn_cmd_hk,
                                method_handle(&RootApp::spawn_cmd_khandler));
-  add_key_handling_with_backup(
-      m_config.file_pick_hk, method_handle(&RootApp::show_file_drop_khandler));
+  add_key_handling_with_backup(m_config.file_pick_hk,
+                               method_handle(&RootApp::file_pick_khandler));
   add_key_handling_with_backup(m_config.launch_browser_hk,
                                method_handle(&RootApp::browser_khandler));
+  if (m_config.show_processes_hk) {
+    add_key_handling_with_backup(
+        *m_config.show_processes_hk,
+        method_handle(&RootApp::show_processes_khandler));
+  }
+  if (m_config.clip_history_hk) {
+    add_key_handling_with_backup(
+        *m_config.clip_history_hk,
+        method_handle(&RootApp::clip_history_khandler));
+  }
   return log_msg;
 }
 
@@ -195,46 +497,464 @@ void RootApp::add_con_font_to_registry(std::string font_name) {
   }
 }
 
-void RootApp::create_child_console(std::wstring_view launch_command) {
+void RootApp::create_child_console(std::wstring_view launch_command,
+                                   SpawnTrace trace) {
+  trace.mark(SpawnStage::spawn_entered);
+  Process proc = spawn_console_process(L"", launch_command, false);
+  trace.mark(SpawnStage::process_created);
+  *g_logger << "Console spawned in " << proc.get_spawn_time().count() << " us"
+            << std::endl;
+  m_spawn_tracer.begin(proc.get_id(), trace);
+  m_supervisor.watch(std::move(proc), spawn_cmd_action);
+}
+
+Process RootApp::spawn_console_process(std::wstring_view prefix,
+                                       std::wstring_view launch_command,
+                                       bool f_hidden) const {
   char title_narrow[g_max_file_path];
   // Уникальный заголовок, чтобы предотвратить ошибки при поиске окна консоли
   get_unique_window_title(title_narrow, g_max_file_path);
   std::wstring title_wide = widen_string(title_narrow);
 
-  CmdLineArg console_app_args;
-  std::copy(m_config.term_color_table.begin(), m_config.term_color_table.end(),
-            console_app_args.term_colors);
-  std::copy(m_config.font_name.begin(), m_config.font_name.end(),
-            console_app_args.font_name);
-  console_app_args.font_size = m_config.font_size;
   // В командной строку WinMain входит последовательность символов после первого
   // пробела
-  std::wstring cmd_args = L"_ " + cmd_arg_from(console_app_args);
+  std::wstring cmd_args = L"_ ";
+  cmd_args += prefix;
+  cmd_args += m_console_profile.to_cmd_arg();
   if (!launch_command.empty()) {
     cmd_args += L' ';
-    cmd_args += launch_command.data();
+    cmd_args += launch_command;
   }
   std::wstring program_path_str{m_programm_path.wstring()};
   std::wstring launch_directory{m_cmd_launch_dir.wstring()};
-  WinProcess proc =
-      WinProcess::Constructor()
-          .set_command_line_arguments(cmd_args.c_str())
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments(cmd_args.c_str())
+      .set_startup_directory(launch_directory)
+      .set_environment_variables(m_env.block())
+      .set_limits(m_config.get_action(spawn_cmd_action).limits)
+      .set_console_color(m_config.foreground, m_config.background)
+      .set_window_position(0, 0)
+      .set_console_size_chr(m_config.columns, m_config.rows)
+      .add_startup_flags(
+          CREATE_NEW_CONSOLE); // По флагу отличаем дочерний процесс
+  if (f_hidden) {
+    ctor.set_window_show_parameter(SW_HIDE);
+  }
+  return ctor.create(program_path_str, title_wide);
+}
+
+PooledConsole RootApp::create_pooled_console() {
+  PoolTicket ticket{GetCurrentProcessId(), m_n_pooled_consoles++};
+  PooledConsole console{ticket};
+  console.set_process(
+      spawn_console_process(ticket.to_cmd_prefix(), L"", true));
+  console.wait_ready(10'000, m_pool_cancel);
+  return console;
+}
+
+std::optional<Path> RootApp::resolve_program(const std::string &program) {
+  auto iter = m_resolved_programs.find(program);
+  if (iter != m_resolved_programs.end()) {
+    return iter->second;
+  }
+  Path program_path{widen_string(program)};
+  std::optional<Path> resolved;
+  if (program_path.has_parent_path()) {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(program_path, ec)) {
+      resolved = program_path;
+    }
+  } else {
+    resolved = m_exe_index.find(program);
+  }
+  if (!resolved && !program_path.has_parent_path()) {
+    // PATH дочерних процессов, а не WinEnv
+    std::wstring path_var{m_env.snapshot().find(L"PATH").value_or(L"")};
+    std::wstring found(g_max_file_path, L'\0');
+    DWORD length =
+        SearchPathW(path_var.c_str(), program_path.c_str(), L".exe",
+                    static_cast<DWORD>(found.size()), found.data(), nullptr);
+    if (length > 0 && length < found.size()) {
+      found.resize(length);
+      resolved = Path{found};
+    }
+  }
+  if (resolved) {
+    m_resolved_programs.insert({program, *resolved});
+  }
+  return resolved;
+}
+
+void RootApp::launch_action(const std::string &action,
+                            std::string_view default_program,
+                            const std::vector<std::wstring> &args,
+                            std::wstring_view title,
+                            std::shared_ptr<const std::string> stdin_data) {
+  const ActionConfig &action_config = m_config.get_action(action);
+  std::string program = action_config.executable.empty()
+                            ? std::string{default_program}
+                            : action_config.executable;
+  std::optional<Path> program_path = resolve_program(program);
+  std::wstring exe_path;
+  std::vector<std::wstring> cmd_args;
+  // Через cmd.exe метасимволы в аргументах, например & в адресе, иначе
+  // делят команду
+  ArgQuoting quoting{ArgQuoting::argv};
+  if (action_config.use_shell) {
+    exe_path = get_cmd_path().wstring();
+    quoting = ArgQuoting::shell;
+    // Первый аргумент команды start в кавычках - заголовок окна
+    cmd_args = {L"/C", L"start", L"", L"/B",
+                program_path ? program_path->wstring() : widen_string(program)};
+  } else if (program_path) {
+    exe_path = program_path->wstring();
+  } else {
+    m_log_wnd.print(log_text_top + program +
+                    " is not found in APPS_BIN_PATHS and PATH" +
+                    log_text_bottom);
+    m_log_wnd.show_for(3'000);
+    return;
+  }
+  ArgBatchPlan plan;
+  size_t base_size{0};
+  try {
+    base_size = build_command_line(exe_path, cmd_args, quoting).size();
+    plan = plan_arg_batches(base_size, args, action_config.max_batch_args,
+                            action_config.use_shell ? g_max_shell_command_line
+                                                    : g_max_command_line,
+                            quoting);
+  } catch (std::length_error &err) {
+    m_log_wnd.print(std::string(log_text_top) + err.what() + log_text_bottom);
+    m_log_wnd.show_for(3'000);
+    return;
+  }
+  // Без аргументов программа запускается один раз
+  if (args.empty()) {
+    plan.m_batches.push_back({0, 0, base_size});
+  }
+
+  size_t n_batches = plan.m_batches.size();
+  std::vector<std::optional<Process>> processes(n_batches);
+  std::vector<std::chrono::microseconds> durations(n_batches);
+  std::vector<std::string> errors(n_batches);
+  std::wstring launch_directory{m_cmd_launch_dir.wstring()};
+  auto launch_batch = [&](size_t i) {
+    auto start = std::chrono::steady_clock::now();
+    const ArgBatch &batch = plan.m_batches[i];
+    std::vector<std::wstring> batch_args{cmd_args};
+    auto first = args.begin() + batch.m_first;
+    batch_args.insert(batch_args.end(), first, first + batch.m_count);
+    try {
+      Process::Constructor constructor;
+      constructor
+          .set_command_line_arguments(
+              build_command_line(exe_path, batch_args, quoting))
           .set_startup_directory(launch_directory)
-          .set_console_color(m_config.foreground, m_config.background)
-          .set_window_position(0, 0)
-          .set_console_size_chr(m_config.columns, m_config.rows)
-          .add_startup_flags(
-              CREATE_NEW_CONSOLE) // По флагу отличаем дочерний процесс
-          .create(program_path_str, title_wide);
+          .set_environment_variables(m_env.block())
+          .set_limits(action_config.limits);
+      if (stdin_data) {
+        constructor.redirect_stdin();
+      }
+      processes[i] = constructor.create(exe_path, std::wstring{title});
+    } catch (std::exception &ex) {
+      errors[i] = ex.what();
+    }
+    durations[i] = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+  };
+  auto start = std::chrono::steady_clock::now();
+  if (action_config.parallel_batches) {
+    parallel_for(n_batches, launch_batch);
+  } else {
+    for (size_t i = 0; i < n_batches; ++i) {
+      launch_batch(i);
+    }
+  }
+  auto total = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  std::string failed;
+  for (size_t i = 0; i < n_batches; ++i) {
+    const ArgBatch &batch = plan.m_batches[i];
+    *g_logger << action << " batch " << i + 1 << "/" << n_batches << ": "
+              << batch.m_count << " args, " << batch.m_size << " chars, "
+              << durations[i].count() << " us";
+    if (processes[i]) {
+      *g_logger << ", pid " << processes[i]->get_id() << std::endl;
+      if (stdin_data) {
+        stream_to_stdin(processes[i]->take_stdin(), stdin_data);
+      }
+      m_supervisor.watch(std::move(*processes[i]), action);
+    } else {
+      *g_logger << ", failed: " << errors[i] << std::endl;
+      failed += errors[i] + '\n';
+    }
+  }
+  if (n_batches > 1) {
+    *g_logger << action << ": " << args.size() << " args in " << n_batches
+              << " batches, " << total.count() << " us" << std::endl;
+  }
+  for (size_t i : plan.m_oversized) {
+    failed += narrow_string(args[i]) + " is too long for a command line\n";
+  }
+  if (!failed.empty()) {
+    m_log_wnd.print(log_text_top + failed + log_text_bottom);
+    m_log_wnd.show_for(3'000);
+  }
+}
+
+void RootApp::open_in_editor(const std::vector<std::wstring> &files,
+                             size_t line, size_t column) {
+  // Команда Ex после "+" выполняется после открытия файла. В аргументе
+  // :edit пробел экранируется
+  std::string position;
+  if (column != 0) {
+    position = "call cursor(" + std::to_string(line) + ", " +
+               std::to_string(column) + ")";
+  } else if (line != 0) {
+    position = std::to_string(line);
+  }
+  if (m_config.editor_server.empty()) {
+    std::vector<std::wstring> launch_args;
+    if (!position.empty()) {
+      launch_args = {L"--", L"+" + widen_string(position)};
+    }
+    launch_args.insert(launch_args.end(), files.begin(), files.end());
+    launch_action(editor_action, "nvim-qt.exe", launch_args, L"NVIM");
+    return;
+  }
+  std::string open_command = m_config.editor_open_command;
+  if (!position.empty()) {
+    open_command += " +" + escape_file_name(position);
+  }
+  if (open_in_editor_server(files, open_command)) {
+    return;
+  }
+  // Новый редактор слушает тот же адрес, и следующие файлы откроются в нем.
+  // Аргументы после "--" nvim-qt передает nvim
+  std::vector<std::wstring> launch_args{L"--", L"--listen",
+                                        widen_string(m_config.editor_server)};
+  if (!position.empty()) {
+    launch_args.push_back(L"+" + widen_string(position));
+  }
+  launch_args.insert(launch_args.end(), files.begin(), files.end());
+  launch_action(editor_action, "nvim-qt.exe", launch_args, L"NVIM");
+}
+
+bool RootApp::open_in_editor_server(const std::vector<std::wstring> &files,
+                                    const std::string &open_command) {
+  auto start = std::chrono::steady_clock::now();
+  std::optional<NvimClient> client;
+  try {
+    client.emplace(widen_string(m_config.editor_server));
+  } catch (std::exception &ex) {
+    *g_logger << "Editor server is not reachable: " << ex.what() << std::endl;
+    return false;
+  }
+  // Часть файлов могла открыться, поэтому новый редактор не запускается
+  std::string failed;
+  try {
+    for (const std::string &err :
+         client->open_files(files, open_command)) {
+      failed += err + '\n';
+    }
+  } catch (std::exception &ex) {
+    failed += ex.what();
+  }
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  *g_logger << files.size() << " files sent to editor server in "
+            << duration.count() << " us" << std::endl;
+  if (!failed.empty()) {
+    m_log_wnd.print(log_text_top + failed + log_text_bottom);
+    m_log_wnd.show_for(3'000);
+  }
+  return true;
 }
 
 LRESULT RootApp::spawn_cmd_khandler(const MSG &msg) {
-  create_child_console(L"");
+  SpawnTrace trace;
+  trace.mark(SpawnStage::hotkey);
+  if (m_console_pool) {
+    if (std::optional<PooledConsole> console = m_console_pool->acquire()) {
+      Process proc = console->hand_over();
+      m_spawn_tracer.begin(proc.get_id(), trace);
+      m_supervisor.watch(std::move(proc), spawn_cmd_action);
+      return 0;
+    }
+    // Ошибки фабрики пула записываются из основного потока, когда из-за них
+    // консоль приходится создавать без пула
+    WarmPoolStats pool = m_console_pool->get_stats();
+    if (pool.m_n_failures != m_n_logged_pool_failures) {
+      *g_logger << "Console pool: "
+                << pool.m_n_failures - m_n_logged_pool_failures
+                << " failures, last: " << pool.m_last_error << std::endl;
+      m_n_logged_pool_failures = pool.m_n_failures;
+    }
+  }
+  create_child_console(L"", trace);
   return 0;
 }
 
-LRESULT RootApp::show_file_drop_khandler(const MSG &msg) {
+void RootApp::start_file_index() {
+  if (m_file_index_thread.joinable()) {
+    return;
+  }
+  m_file_index_time = std::chrono::steady_clock::now();
+  // Корни и фильтр не меняются после configure_env, результат забирается
+  // только после завершения потока
+  m_file_index_thread = std::thread{[this, thread_id = GetCurrentThreadId()] {
+    try {
+      m_built_file_index = FileIndex::build(
+          m_file_pick_roots, m_config.file_pick_filter,
+          m_config.file_pick_max_files, &mf_cancel_file_index);
+      if (!mf_cancel_file_index) {
+        m_built_file_index->save(m_file_index_file);
+      }
+    } catch (std::exception &ex) {
+      m_file_index_error = ex.what();
+    }
+    PostThreadMessageW(thread_id, g_wm_file_index, 0, 0);
+  }};
+}
+
+void RootApp::show_file_pick(bool f_search) {
+  if (f_search) {
+    auto start = std::chrono::steady_clock::now();
+    m_file_pick_matches =
+        m_file_index.find(m_file_pick_query, file_pick_results);
+    m_file_pick_search_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    m_file_pick_selected = 0;
+  }
+  std::string text = "Find file: " + m_file_pick_query + "_\n\n";
+  for (size_t i = 0; i < m_file_pick_matches.size(); ++i) {
+    text += i == m_file_pick_selected ? "> " : "  ";
+    text += m_file_index.relative_path(m_file_pick_matches[i].m_file);
+    text += '\n';
+  }
+  if (m_file_pick_matches.empty()) {
+    text += "  No files found\n";
+  }
+  text += '\n' + std::to_string(m_file_index.size()) + " files";
+  if (m_file_index_thread.joinable()) {
+    text += ", indexing...";
+  }
+  text += ", search " + std::to_string(m_file_pick_search_time.count()) +
+          " us\nUp/Down - select, Enter - open in editor, Esc - close";
+  m_log_wnd.print(text);
+  m_log_wnd.show(true);
+}
+
+void RootApp::finish_file_pick() {
+  mf_picking_file = false;
+  m_file_pick_matches.clear();
+  m_log_wnd.show(false);
+}
+
+LRESULT RootApp::file_pick_khandler(const MSG &msg) {
   m_file_wnd.show_for(10'000);
+  if (std::chrono::steady_clock::now() - m_file_index_time >
+      file_index_max_age) {
+    start_file_index();
+  }
+  mf_picking_file = true;
+  m_file_pick_query.clear();
+  show_file_pick(true);
+  SetForegroundWindow(m_log_wnd.get_hwnd());
+  return 0;
+}
+
+LRESULT RootApp::file_pick_char_handler(const MSG &msg) {
+  if (!mf_picking_file) {
+    return 0;
+  }
+  // Окно журнала создано как ANSI, символ приходит в кодовой странице
+  // системы
+  auto ansi_char = static_cast<char>(msg.wParam);
+  if (ansi_char == '\b') {
+    // Последний символ UTF-8 удаляется вместе с байтами продолжения
+    while (!m_file_pick_query.empty() &&
+           (m_file_pick_query.back() & 0xC0) == 0x80) {
+      m_file_pick_query.pop_back();
+    }
+    if (!m_file_pick_query.empty()) {
+      m_file_pick_query.pop_back();
+    }
+  } else if (static_cast<unsigned char>(ansi_char) >= 0x20) {
+    wchar_t wide_char;
+    if (MultiByteToWideChar(CP_ACP, 0, &ansi_char, 1, &wide_char, 1) != 1) {
+      return 0;
+    }
+    m_file_pick_query += narrow_string({&wide_char, 1});
+  } else { // Enter и Esc обрабатываются по WM_KEYDOWN
+    return 0;
+  }
+  show_file_pick(true);
+  return 0;
+}
+
+LRESULT RootApp::file_pick_key_handler(const MSG &msg) {
+  if (!mf_picking_file) {
+    return 0;
+  }
+  switch (msg.wParam) {
+  case VK_UP:
+    if (m_file_pick_selected > 0) {
+      --m_file_pick_selected;
+    }
+    break;
+  case VK_DOWN:
+    if (m_file_pick_selected + 1 < m_file_pick_matches.size()) {
+      ++m_file_pick_selected;
+    }
+    break;
+  case VK_RETURN:
+    if (!m_file_pick_matches.empty()) {
+      Path file =
+          m_file_index.path(m_file_pick_matches[m_file_pick_selected].m_file);
+      finish_file_pick();
+      open_in_editor({file.wstring()});
+    }
+    return 0;
+  case VK_ESCAPE:
+    finish_file_pick();
+    return 0;
+  default:
+    return 0;
+  }
+  show_file_pick(false);
+  return 0;
+}
+
+LRESULT RootApp::file_pick_activate_handler(const MSG &msg) {
+  if (mf_picking_file && LOWORD(msg.wParam) == WA_INACTIVE) {
+    finish_file_pick();
+  }
+  return 0;
+}
+
+LRESULT RootApp::file_index_msg_handler(const MSG &msg) {
+  m_file_index_thread.join();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - m_file_index_time);
+  if (!m_file_index_error.empty()) {
+    *g_logger << "File index: " << m_file_index_error << std::endl;
+    m_file_index_error.clear();
+  }
+  if (m_built_file_index) {
+    m_file_index = std::move(*m_built_file_index);
+    m_built_file_index.reset();
+    *g_logger << "File index: " << m_file_index.size() << " files, "
+              << m_file_index.dir_count() << " dirs, "
+              << m_file_index.memory_size() / 1024 << " KiB"
+              << (m_file_index.is_truncated() ? ", truncated" : "")
+              << ", built in " << duration.count() << " ms" << std::endl;
+    if (mf_picking_file) {
+      show_file_pick(true);
+    }
+  }
   return 0;
 }
 
@@ -249,63 +969,96 @@ LRESULT RootApp::browser_khandler(const MSG &msg) {
     m_log_wnd.show_for(1'000);
     return 0;
   }
-  if (!OpenClipboard(nullptr)) {
+  std::vector<std::wstring> args;
+  std::shared_ptr<const std::string> stdin_data;
+  ClipboardClass clip;
+  bool f_to_editor{false};
+  bool is_opened = with_clipboard_text(nullptr, [&](std::wstring_view text) {
+    auto start = std::chrono::steady_clock::now();
+    clip = classify_clipboard(text, m_cmd_launch_dir, m_stat_cache);
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    *g_logger << "Clipboard: " << clipboard_kind_name(clip.m_kind) << ", "
+              << text.size() << " chars, " << duration.count() << " us"
+              << std::endl;
+    // Для редактора путь уже скопирован в clip.m_path
+    f_to_editor = m_config.clipboard_routes[static_cast<size_t>(
+                      clip.m_kind)] == editor_action;
+    if (f_to_editor) {
+      return;
+    }
+    std::wstring_view arg = clip.m_text.substr(0, max_clipboard_arg);
+    if (m_config.get_action(browser_action).clipboard_stdin) {
+      stdin_data = std::make_shared<const std::string>(narrow_string(text));
+    } else if (clip.m_kind == ClipboardKind::url) {
+      args.push_back(widen_string(percent_encode(arg, PercentMode::uri)));
+    } else if (std::string url = m_config.search_engines.make_url(arg);
+               !url.empty()) {
+      args.push_back(widen_string(url));
+    }
+  });
+  if (!is_opened) {
     m_log_wnd.print("Failed to open the clipboard");
     m_log_wnd.show_for(1'000);
     return 0;
   }
-  std::wstring launch_command = L"/C start /B chrome.exe";
-  LPWSTR clipboard_text{nullptr};
-  HGLOBAL hglb = GetClipboardData(CF_UNICODETEXT);
-  if (hglb != nullptr) {
-    clipboard_text = reinterpret_cast<LPWSTR>(GlobalLock(hglb));
-    if (clipboard_text != nullptr) {
-      std::wstring clipboard_copy {clipboard_text};
-      GlobalUnlock(hglb);
-      launch_command += L' ';
-      // Необходимо сформировать правильный адресс
-      if (clipboard_copy.substr(0,4) != L"http") {
-        launch_command += L"https://www.google.com/search?q=";
-        // Пробелы - недопустимы
-        std::replace(clipboard_copy.begin(), clipboard_copy.end(), L' ', L'+');
-      }
-      launch_command += clipboard_copy;
-    }
-  }
-  CloseClipboard();
 
-  std::wstring program_path_str = get_cmd_path().wstring();
-  std::wstring launch_directory{m_cmd_launch_dir.wstring()};
-  WinProcess proc = WinProcess::Constructor()
-                        .set_command_line_arguments(launch_command.c_str())
-                        .set_startup_directory(launch_directory)
-                        .create(program_path_str, L"CHROMIUM");
+  if (f_to_editor) {
+    open_in_editor({clip.m_path.wstring()}, clip.m_line, clip.m_column);
+    return 0;
+  }
+  launch_action(browser_action, "chrome.exe", args, L"CHROMIUM",
+                std::move(stdin_data));
   return 0;
 }
 
 LRESULT RootApp::file_drop_msg_handler(const MSG &msg) {
   m_file_wnd.show(false);
 
-  std::wstring file_name;
-  file_name.resize(g_max_file_path);
-  std::wstring launch_command{L"/C start /B nvim-qt.exe"};
+  std::vector<std::wstring> args;
+  std::vector<Path> dirs;
   HDROP hdrop = (HDROP)msg.wParam;
   // Получаем число переданных файлов через специальное значение параметра
-  UINT n_files =
-      DragQueryFileW(hdrop, 0xFFFFFFFF, file_name.data(), g_max_file_path);
+  UINT n_files = DragQueryFileW(hdrop, 0xFFFFFFFF, nullptr, 0);
+  args.reserve(n_files);
   for (UINT i = 0; i < n_files; ++i) {
-    DragQueryFileW(hdrop, i, file_name.data(), g_max_file_path);
-    launch_command += L' ';
-    launch_command += file_name.c_str();
+    // Без буфера возвращается длина имени, имена бывают длиннее MAX_PATH
+    UINT length = DragQueryFileW(hdrop, i, nullptr, 0);
+    std::wstring file_name(length, L'\0');
+    DragQueryFileW(hdrop, i, file_name.data(), length + 1);
+    std::error_code ec;
+    if (std::filesystem::is_directory(file_name, ec)) {
+      dirs.emplace_back(std::move(file_name));
+    } else {
+      args.push_back(std::move(file_name));
+    }
   }
   DragFinish(hdrop);
 
-  std::wstring program_path_str = get_cmd_path().wstring();
-  std::wstring launch_directory{m_cmd_launch_dir.wstring()};
-  WinProcess proc = WinProcess::Constructor()
-                        .set_command_line_arguments(launch_command.c_str())
-                        .set_startup_directory(launch_directory)
-                        .create(program_path_str, L"NVIM");
+  // Вместо директорий открываются текстовые файлы в них
+  if (!dirs.empty()) {
+    WalkResult walk = walk_text_files(dirs, m_config.drop_filter,
+                                      m_config.drop_max_files);
+    *g_logger << walk.m_stats.to_string() << std::endl;
+    for (const Path &file : walk.m_files) {
+      args.push_back(file.wstring());
+    }
+    std::string warning;
+    if (walk.m_stats.mf_truncated) {
+      warning = "Only " + std::to_string(walk.m_files.size()) +
+                " files of dropped directories are opened, see DROP_MAX_FILES";
+    } else if (args.empty()) {
+      warning = "No text files found in dropped directories";
+    }
+    if (!warning.empty()) {
+      m_log_wnd.print(log_text_top + warning + log_text_bottom);
+      m_log_wnd.show_for(3'000);
+    }
+    if (args.empty()) {
+      return 0;
+    }
+  }
+  open_in_editor(args);
   return 0;
 }
 
@@ -314,6 +1067,111 @@ LRESULT RootApp::log_wnd_2clk_handler(const MSG &msg) {
   return 0;
 }
 
+LRESULT RootApp::child_exit_msg_handler(const MSG &msg) {
+  std::string failed;
+  for (const ExitRecord &record : m_supervisor.take_exited()) {
+    *g_logger << record.to_string() << std::endl;
+    if (record.m_usage.m_exit_code != 0) {
+      failed += record.to_string() + '\n';
+    }
+  }
+  if (!failed.empty()) {
+    m_log_wnd.print(log_text_top + failed + log_text_bottom);
+    m_log_wnd.show_for(5'000);
+  }
+  return 0;
+}
+
+LRESULT RootApp::spawn_stage_msg_handler(const MSG &msg) {
+  auto [stage, time] = unpack_stage_stamp(static_cast<uint32_t>(msg.lParam));
+  m_spawn_tracer.mark(static_cast<uint32_t>(msg.wParam), stage, time);
+  return 0;
+}
+
+LRESULT RootApp::show_processes_khandler(const MSG &msg) {
+  std::string text = log_text_top;
+  for (auto &[action, stats] : m_supervisor.get_stats()) {
+    text += action + ": " + stats.to_string() + '\n';
+  }
+  text += "total: " + m_supervisor.get_total_stats().to_string();
+  if (m_console_pool) {
+    WarmPoolStats pool = m_console_pool->get_stats();
+    text += "\nconsole pool: " + std::to_string(pool.m_n_ready) + " ready, " +
+            std::to_string(pool.m_n_hits) + " hits, " +
+            std::to_string(pool.m_n_misses) + " misses, " +
+            std::to_string(pool.m_n_failures) + " failures";
+    if (!pool.m_last_error.empty()) {
+      text += " (last: " + pool.m_last_error + ')';
+    }
+  }
+  std::string spawn_stages = m_spawn_tracer.to_string();
+  *g_logger << spawn_stages << std::flush;
+  text += '\n' + spawn_stages;
+  text += log_text_bottom;
+  m_log_wnd.print(text);
+  m_log_wnd.show(true);
+  return 0;
+}
+
+LRESULT RootApp::clipboard_update_msg_handler(const MSG &msg) {
+  // Записи, помещенные в буфер обмена из истории, в нее не добавляются
+  if (!m_clip_history || GetClipboardOwner() == m_file_wnd.get_hwnd() ||
+      !IsClipboardFormatAvailable(CF_UNICODETEXT)) {
+    return 0;
+  }
+  std::string text;
+  size_t max_size = m_config.clip_history_kb * 1024;
+  // Текст длиннее арены в UTF-8 не короче, чем в UTF-16
+  with_clipboard_text(m_file_wnd.get_hwnd(), [&](std::wstring_view wtext) {
+    if (wtext.size() <= max_size && is_clip_history_allowed()) {
+      text = narrow_string(wtext);
+    }
+  });
+  try {
+    m_clip_history->add(text);
+  } catch (std::exception &ex) {
+    *g_logger << ex.what() << std::endl;
+  }
+  return 0;
+}
+
+LRESULT RootApp::clip_history_khandler(const MSG &msg) {
+  size_t n_entries = m_clip_history ? m_clip_history->size() : 0;
+  if (n_entries < 2) {
+    m_log_wnd.print("Clipboard history is empty");
+    m_log_wnd.show_for(1'000);
+    return 0;
+  }
+  auto now = std::chrono::steady_clock::now();
+  // Перебор начинается с предыдущей записи, 0 - текущий текст
+  if (now - m_clip_recall_time > clip_recall_pause) {
+    m_clip_recall_index = 0;
+  }
+  m_clip_recall_time = now;
+  m_clip_recall_index = (m_clip_recall_index + 1) % n_entries;
+  std::string_view entry = m_clip_history->get(m_clip_recall_index);
+  if (!set_clipboard_text(m_file_wnd.get_hwnd(), widen_string(entry))) {
+    m_log_wnd.print("Failed to set the clipboard");
+    m_log_wnd.show_for(1'000);
+    return 0;
+  }
+  // Обрезка не разрывает последовательность UTF-8
+  size_t preview_size = std::min(entry.size(), clip_preview_size);
+  while (preview_size < entry.size() && preview_size > 0 &&
+         (static_cast<unsigned char>(entry[preview_size]) & 0xC0) == 0x80) {
+    --preview_size;
+  }
+  std::string text = "Clipboard " + std::to_string(m_clip_recall_index + 1) +
+                     "/" + std::to_string(n_entries) + "\n\n";
+  text += entry.substr(0, preview_size);
+  if (preview_size < entry.size()) {
+    text += "...";
+  }
+  m_log_wnd.print(text);
+  m_log_wnd.show_for(static_cast<UINT>(clip_recall_pause.count()));
+  return 0;
+}
+
 LRESULT RootApp::paint_file_wnd(const MSG &msg) {
   PAINTSTRUCT ps;
   HDC hdc = BeginPaint(m_file_wnd.get_hwnd(), &ps);
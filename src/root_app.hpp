@@ -1,7 +1,25 @@
 #pragma once
+#include "clip_history.hpp"
 #include "color.hpp"
 #include "config.hpp"
+#include "console_pool.hpp"
+#include "console_profile.hpp"
+#include "env_block.hpp"
+#include "exe_index.hpp"
+#include "file_index.hpp"
 #include "log_window.hpp"
+#include "stage_trace.hpp"
+#include "supervisor.hpp"
+#include "warm_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace winenv {
 // Основной класс. Должен быть создан в одном экземпляре
@@ -17,13 +35,6 @@ class RootApp : public HasEventDispatcher, public EventDriven {
   };
 
 public:
-  // Данные, которые передаются дочернему процессу через аргумент командной
-  // строки
-  struct CmdLineArg {
-    RgbColor term_colors[16]{};
-    char font_name[32]{};
-    size_t font_size{};
-  };
   // Подготовка к основному циклу программы.
   // Создает окно. Считывает параметры из .json файла.
   // Добавляет обработчики клавиш и сообщений. Регистрирует шрифты
@@ -37,22 +48,92 @@ public:
   void run();
 
 private:
-  // По параметрам из .json файла обновляет переменную среды PATH.
-  // Устанавливает переменные среды XDG_HOME
+  // По параметрам из .json файла строит блок переменных среды дочерних
+  // процессов: расширяет PATH, устанавливает flash_root и XDG_*.
+  // Среда самого процесса WinEnv не меняется
   void configure_env();
   // Добавляет обработку сочетаний клавиш
   std::string configure_hotkeys();
   void add_con_font_to_registry(std::string font_name);
   // Создает дочерний процесс с настроенной консолью, в которой запускается
-  // указанная команда
-  void create_child_console(std::wstring_view launch_command);
+  // указанная команда. Дальнейшие отметки этапов запуска придут от дочернего
+  // процесса
+  void create_child_console(std::wstring_view launch_command,
+                            SpawnTrace trace);
+  // Запускает процесс консоли. prefix передается дочернему процессу перед
+  // закодированными настройками консоли
+  Process spawn_console_process(std::wstring_view prefix,
+                                std::wstring_view launch_command,
+                                bool f_hidden) const;
+  // Запускает скрытую консоль и ждет ее готовности. Вызывается из потока
+  // пула консолей
+  PooledConsole create_pooled_console();
+  // Путь к программе: поиск в APPS_BIN_PATHS, затем в PATH дочерних
+  // процессов. Найденный путь запоминается. Путь с директорией
+  // проверяется на существование
+  std::optional<Path> resolve_program(const std::string &program);
+  // Запускает программу действия с аргументами в кавычках. Аргументы, не
+  // помещающиеся в одну командную строку или сверх MAX_BATCH_ARGS,
+  // передаются нескольким процессам, с PARALLEL_BATCHES - параллельно.
+  // С USE_SHELL в ACTIONS запускает через "cmd /C start". Если задан
+  // stdin_data, он пишется в стандартный ввод каждого процесса из
+  // отдельного потока
+  void launch_action(const std::string &action,
+                     std::string_view default_program,
+                     const std::vector<std::wstring> &args,
+                     std::wstring_view title,
+                     std::shared_ptr<const std::string> stdin_data = {});
+  // Открывает файлы в редакторе, слушающем EDITOR_SERVER, или в новом.
+  // С line курсор ставится на строку line и столбец column (с единицы)
+  void open_in_editor(const std::vector<std::wstring> &files, size_t line = 0,
+                      size_t column = 0);
+  // Открывает файлы в редакторе, слушающем EDITOR_SERVER, командой
+  // open_command. Возвращает false, если к редактору не удалось подключиться
+  bool open_in_editor_server(const std::vector<std::wstring> &files,
+                             const std::string &open_command);
+  // Строит индекс файлов в фоновом потоке, если он еще не строится.
+  // Готовый индекс сохраняется в m_file_index_file и приходит с
+  // g_wm_file_index
+  void start_file_index();
+  // Показывает набранный запрос и найденные файлы в окне журнала. С
+  // f_search файлы сначала ищутся заново
+  void show_file_pick(bool f_search);
+  void finish_file_pick();
   LRESULT spawn_cmd_khandler(const MSG &msg);
-  LRESULT show_file_drop_khandler(const MSG &msg);
+  // Показывает окно для перетаскивания файлов и начинает выбор файла по
+  // набранным буквам. Устаревший индекс строится заново
+  LRESULT file_pick_khandler(const MSG &msg);
+  // Ввод запроса выбора файла в окне журнала
+  LRESULT file_pick_char_handler(const MSG &msg);
+  // Стрелки выбирают файл, Enter открывает его в редакторе, Esc отменяет
+  LRESULT file_pick_key_handler(const MSG &msg);
+  // Выбор отменяется, когда окно журнала теряет фокус
+  LRESULT file_pick_activate_handler(const MSG &msg);
+  // Забирает у фонового потока новый индекс файлов
+  LRESULT file_index_msg_handler(const MSG &msg);
   // Вызывает завершение работы программы
   LRESULT exit_khandler(const MSG &msg);
+  // Открывает текст из буфера обмена действием из CLIPBOARD_ROUTES для
+  // его вида: адрес или поиск в браузере, файл в редакторе. С
+  // CLIPBOARD_STDIN браузеру весь текст передается в стандартный ввод
   LRESULT browser_khandler(const MSG &msg);
+  // Открывает перетащенные файлы в запущенном редакторе или в новом.
+  // Директории заменяются текстовыми файлами в них, отобранными
+  // DROP_INCLUDE и DROP_EXCLUDE
   LRESULT file_drop_msg_handler(const MSG &msg);
   LRESULT log_wnd_2clk_handler(const MSG &msg);
+  // Записывает в журнал завершившиеся дочерние процессы
+  LRESULT child_exit_msg_handler(const MSG &msg);
+  // Принимает отметку этапа запуска от дочерней консоли
+  LRESULT spawn_stage_msg_handler(const MSG &msg);
+  // Показывает сводку по дочерним процессам
+  LRESULT show_processes_khandler(const MSG &msg);
+  // Запоминает новый текст буфера обмена в истории, если владелец буфера
+  // не исключил его из истории
+  LRESULT clipboard_update_msg_handler(const MSG &msg);
+  // Помещает в буфер обмена предыдущую запись истории. Нажатия подряд
+  // листают историю дальше
+  LRESULT clip_history_khandler(const MSG &msg);
   LRESULT paint_file_wnd(const MSG &msg);
 
   AppConfig m_config{};
@@ -63,6 +144,62 @@ private:
   FileDropWnd m_file_wnd;
   Path m_programm_path;
   Path m_cmd_launch_dir;
+  // Канонические пути APPS_BIN_PATHS, сохраненные между запусками. Файлы
+  // кэша лежат в APPS_DATA и задаются в configure_env
+  Path m_path_cache_file;
+  ExecutableIndex m_exe_index;
+  // Найденные пути программ действий
+  std::unordered_map<std::string, Path> m_resolved_programs;
+  // Пути, проверенные при разборе буфера обмена
+  StatCache m_stat_cache;
+  // Последние тексты буфера обмена, если задан CLIP_HISTORY_SIZE. Файл
+  // истории лежит в APPS_DATA и задается в configure_env
+  std::optional<ClipHistory> m_clip_history;
+  Path m_clip_history_file;
+  // Номер записи, выбранной последним нажатием HK_CLIP_HISTORY, и время
+  // нажатия
+  size_t m_clip_recall_index{0};
+  std::chrono::steady_clock::time_point m_clip_recall_time;
+  // Файлы flash_root и FILE_PICK_DIRS для HK_FILE_PICK. Загружается из
+  // m_file_index_file в APPS_DATA, пока строится новый
+  FileIndex m_file_index;
+  Path m_file_index_file;
+  std::vector<Path> m_file_pick_roots;
+  std::thread m_file_index_thread;
+  std::atomic_bool mf_cancel_file_index{false};
+  // Результат фонового потока, забирается после g_wm_file_index
+  std::optional<FileIndex> m_built_file_index;
+  std::string m_file_index_error;
+  std::chrono::steady_clock::time_point m_file_index_time;
+  // Набранный запрос, лучшие найденные файлы и выбранный из них
+  bool mf_picking_file{false};
+  std::string m_file_pick_query;
+  std::vector<FileMatch> m_file_pick_matches;
+  size_t m_file_pick_selected{0};
+  std::chrono::microseconds m_file_pick_search_time{0};
+  // Общий для всех запусков блок переменных среды
+  SharedEnv m_env;
+  // Шрифт и цвета дочерних консолей в общей памяти
+  ConsoleProfileChannel m_console_profile;
+  // Запущенные консоли, браузеры и редакторы
+  ProcessSupervisor m_supervisor;
+  // Время этапов от нажатия HK_SPAWN_CMD до запуска cmd.exe
+  SpawnTracer m_spawn_tracer;
+  std::atomic<size_t> m_n_pooled_consoles{0};
+  // Ошибки пула, уже записанные в журнал
+  size_t m_n_logged_pool_failures{0};
+  // Прерывает ожидание готовности консоли пула при завершении
+  HANDLE m_pool_cancel{nullptr};
+  // Скрытые консоли, готовые к показу по HK_SPAWN_CMD. Объявлен после
+  // остальных членов: поток пула использует их и останавливается первым
+  std::unique_ptr<WarmPool<PooledConsole>> m_console_pool;
+  // Прерывает ожидание консоли, останавливает пул и закрывает
+  // m_pool_cancel. Уничтожается раньше пула, в том числе при исключении
+  // в конструкторе RootApp
+  struct ConsolePoolStopper {
+    RootApp &m_app;
+    ~ConsolePoolStopper();
+  } m_console_pool_stopper{*this};
 
   static constexpr const char *log_text_top =
       "Info\n\n";
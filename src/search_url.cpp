@@ -0,0 +1,230 @@
+#include "search_url.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+using winenv::PercentMode;
+
+constexpr char hex_digits[] = "0123456789ABCDEF";
+constexpr char32_t replacement_char = 0xFFFD;
+// Один символ дает до 4 байт UTF-8, каждый байт - 3 символа "%XX"
+constexpr size_t max_encoded_per_char = 12;
+
+bool is_unreserved(char32_t c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+         c == '~';
+}
+
+bool is_kept(char32_t c, PercentMode mode) noexcept {
+  return mode == PercentMode::uri ? c > 0x20 && c < 0x7F : is_unreserved(c);
+}
+
+bool is_blank(char32_t c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+char *write_escaped_byte(std::uint8_t byte, char *out) noexcept {
+  out[0] = '%';
+  out[1] = hex_digits[byte >> 4];
+  out[2] = hex_digits[byte & 0x0F];
+  return out + 3;
+}
+
+char *write_escaped_utf8(char32_t c, char *out) noexcept {
+  if (c < 0x80) {
+    return write_escaped_byte(static_cast<std::uint8_t>(c), out);
+  }
+  if (c < 0x800) {
+    out = write_escaped_byte(static_cast<std::uint8_t>(0xC0 | c >> 6), out);
+  } else {
+    if (c < 0x10000) {
+      out = write_escaped_byte(static_cast<std::uint8_t>(0xE0 | c >> 12), out);
+    } else {
+      out = write_escaped_byte(static_cast<std::uint8_t>(0xF0 | c >> 18), out);
+      out = write_escaped_byte(
+          static_cast<std::uint8_t>(0x80 | (c >> 12 & 0x3F)), out);
+    }
+    out = write_escaped_byte(static_cast<std::uint8_t>(0x80 | (c >> 6 & 0x3F)),
+                             out);
+  }
+  return write_escaped_byte(static_cast<std::uint8_t>(0x80 | (c & 0x3F)), out);
+}
+
+// Символ, начинающийся с pos. Сдвигает pos за символ
+template <class Char>
+char32_t next_char(const Char *text, size_t size, size_t &pos) noexcept {
+  char32_t c = static_cast<char32_t>(text[pos++]);
+  bool is_surrogate = c >= 0xD800 && c <= 0xDFFF;
+  if constexpr (sizeof(Char) == 2) {
+    if (c <= 0xDBFF && is_surrogate && pos < size) {
+      char32_t low = static_cast<char32_t>(text[pos]);
+      if (low >= 0xDC00 && low <= 0xDFFF) {
+        ++pos;
+        return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+      }
+    }
+  }
+  return is_surrogate || c > 0x10FFFF ? replacement_char : c;
+}
+
+#ifdef WINENV_SIMD_X86
+// 8 кодовых единиц в 16-битных полях. Значения больше 0x7FFF насыщаются
+// и не проходят проверок ниже
+template <class Char> __m128i load_units(const Char *in) noexcept {
+  if constexpr (sizeof(Char) == 2) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+  } else {
+    return _mm_packs_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 4)));
+  }
+}
+
+__m128i in_range(__m128i units, short low, short high) noexcept {
+  return _mm_and_si128(_mm_cmpgt_epi16(units, _mm_set1_epi16(low - 1)),
+                       _mm_cmplt_epi16(units, _mm_set1_epi16(high + 1)));
+}
+
+__m128i equals(__m128i units, char c) noexcept {
+  return _mm_cmpeq_epi16(units, _mm_set1_epi16(c));
+}
+
+// Маска movemask: по 2 бита на единицу, не требующую кодирования
+unsigned kept_mask(__m128i units, PercentMode mode) noexcept {
+  __m128i kept;
+  if (mode == PercentMode::uri) {
+    kept = in_range(units, 0x21, 0x7E);
+  } else {
+    __m128i letters = _mm_or_si128(in_range(units, 'a', 'z'),
+                                   in_range(units, 'A', 'Z'));
+    __m128i marks =
+        _mm_or_si128(_mm_or_si128(equals(units, '-'), equals(units, '.')),
+                     _mm_or_si128(equals(units, '_'), equals(units, '~')));
+    kept = _mm_or_si128(_mm_or_si128(letters, in_range(units, '0', '9')),
+                        marks);
+  }
+  return static_cast<unsigned>(_mm_movemask_epi8(kept));
+}
+
+unsigned count_trailing_zeros(unsigned mask) noexcept {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+template <class Char>
+std::string encode(const Char *text, size_t size, PercentMode mode) {
+  std::string encoded(size * max_encoded_per_char, '\0');
+  char *out = encoded.data();
+  size_t pos = 0;
+  while (pos < size) {
+#ifdef WINENV_SIMD_X86
+    // SSE2 есть в любом процессоре x86-64
+    if (pos + 8 <= size) {
+      __m128i units = load_units(text + pos);
+      unsigned mask = kept_mask(units, mode);
+      if (mask == 0xFFFF) {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out),
+                         _mm_packus_epi16(units, units));
+        out += 8;
+        pos += 8;
+        continue;
+      }
+      // Копирует единицы до первой, требующей кодирования
+      size_t n_kept = count_trailing_zeros(~mask) / 2;
+      for (size_t i = 0; i < n_kept; ++i) {
+        *out++ = static_cast<char>(text[pos++]);
+      }
+    }
+#endif
+    char32_t c = next_char(text, size, pos);
+    if (is_kept(c, mode)) {
+      *out++ = static_cast<char>(c);
+    } else {
+      out = write_escaped_utf8(c, out);
+    }
+  }
+  encoded.resize(out - encoded.data());
+  return encoded;
+}
+
+template <class Char>
+bool starts_with_ascii(std::basic_string_view<Char> text,
+                       std::string_view prefix) noexcept {
+  return text.size() >= prefix.size() &&
+         std::equal(prefix.begin(), prefix.end(), text.begin(),
+                    [](char left, Char right) {
+                      return static_cast<Char>(left) == right;
+                    });
+}
+} // namespace
+
+namespace winenv {
+std::string percent_encode(std::u16string_view text, PercentMode mode) {
+  return encode(text.data(), text.size(), mode);
+}
+
+std::string percent_encode(std::wstring_view text, PercentMode mode) {
+  return encode(text.data(), text.size(), mode);
+}
+
+void SearchEngines::add(std::string prefix, std::string_view url_template) {
+  ExpandTemplate compiled{url_template};
+  for (std::string_view name : compiled.dependencies()) {
+    if (name != "query") {
+      throw ExpansionError("Search template \"" + std::string{url_template} +
+                           "\" may only reference ${query}");
+    }
+  }
+  m_templates.insert_or_assign(std::move(prefix), std::move(compiled));
+}
+
+bool SearchEngines::empty() const noexcept { return m_templates.empty(); }
+
+std::string SearchEngines::make_url(std::wstring_view text) const {
+  while (!text.empty() && is_blank(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && is_blank(text.back())) {
+    text.remove_suffix(1);
+  }
+  if (starts_with_ascii(text, "http://") ||
+      starts_with_ascii(text, "https://")) {
+    return percent_encode(text, PercentMode::uri);
+  }
+  // Префикс - короткое слово из латинских букв перед двоеточием
+  auto iter = m_templates.end();
+  size_t colon_pos = text.substr(0, 16).find(L':');
+  if (colon_pos != std::wstring_view::npos && colon_pos != 0 &&
+      std::all_of(text.begin(), text.begin() + colon_pos, [](wchar_t c) {
+        return (c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z');
+      })) {
+    std::string prefix(text.begin(), text.begin() + colon_pos);
+    iter = m_templates.find(prefix);
+  }
+  if (iter != m_templates.end()) {
+    text.remove_prefix(colon_pos + 1);
+    while (!text.empty() && is_blank(text.front())) {
+      text.remove_prefix(1);
+    }
+  } else {
+    iter = m_templates.find("");
+    if (iter == m_templates.end()) {
+      return {};
+    }
+  }
+  std::string query = percent_encode(text);
+  return iter->second.render(
+      [&query](std::string_view) -> std::optional<std::string_view> {
+        return query;
+      });
+}
+} // namespace winenv
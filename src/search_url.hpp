@@ -0,0 +1,52 @@
+#pragma once
+#include "expand.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace winenv {
+enum class PercentMode {
+  // Часть адреса, например запрос: кодируется все, кроме незарезервированных
+  // символов RFC 3986 (буквы, цифры, "-._~")
+  component,
+  // Адрес целиком: кодируются только пробелы, управляющие символы и не ASCII,
+  // уже закодированные последовательности сохраняются
+  uri
+};
+
+// Процентное кодирование текста в UTF-16 (char16_t, wchar_t в Windows) или
+// UTF-32 (wchar_t в Linux). Символы вне ASCII переводятся в UTF-8 по ходу
+// кодирования, непарные суррогаты заменяются на U+FFFD. Подряд идущие
+// символы, не требующие кодирования, проверяются и копируются векторно по 8.
+// Пример:
+// percent_encode(L"a&b c") == "a%26b%20c"
+std::string percent_encode(std::u16string_view text,
+                           PercentMode mode = PercentMode::component);
+std::string percent_encode(std::wstring_view text,
+                           PercentMode mode = PercentMode::component);
+
+// Шаблоны адресов поиска. Шаблон ссылается только на ${query}, куда
+// подставляется закодированный запрос. Префикс выбирает шаблон: текст
+// "gh: async fn" ищется шаблоном "gh", текст без известного префикса -
+// шаблоном с пустым префиксом.
+// Пример:
+// SearchEngines engines;
+// engines.add("", "https://www.google.com/search?q=${query}");
+// engines.add("gh", "https://github.com/search?q=${query}");
+// std::string url = engines.make_url(L"gh: a&b"); // ...?q=a%26b
+class SearchEngines {
+public:
+  // Шаблон разбирается один раз. Выбрасывает ExpansionError, если шаблон
+  // ссылается на другие переменные
+  void add(std::string prefix, std::string_view url_template);
+  bool empty() const noexcept;
+  // Адрес для текста. Текст, начинающийся с "http://" или "https://",
+  // считается адресом и только дополняется кодированием в режиме uri.
+  // Пустая строка, если подходящего шаблона нет
+  std::string make_url(std::wstring_view text) const;
+
+private:
+  std::unordered_map<std::string, ExpandTemplate> m_templates;
+};
+} // namespace winenv
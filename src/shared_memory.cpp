@@ -0,0 +1,196 @@
+#include "shared_memory.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+constexpr std::wstring_view name_prefix = L"Local\\WinEnvShm.";
+
+// Метка - это "<pid>.<номер>" без префикса пространства имен
+std::wstring mapping_name(std::wstring_view handle) {
+  return std::wstring{name_prefix} + std::wstring{handle};
+}
+#else
+[[noreturn]] void throw_errno(const std::string &message) {
+  throw std::system_error(errno, std::generic_category(), message);
+}
+
+// Метка - это "<pid>.<дескриптор>": блок открывается через /proc создателя
+std::string handle_path(std::string_view handle) {
+  size_t dot_pos = handle.find('.');
+  if (dot_pos == std::string_view::npos || dot_pos == 0 ||
+      dot_pos + 1 == handle.size() ||
+      handle.find_first_not_of("0123456789.") != std::string_view::npos ||
+      handle.find('.', dot_pos + 1) != std::string_view::npos) {
+    throw std::runtime_error("Malformed shared memory handle " +
+                             std::string{handle});
+  }
+  return "/proc/" + std::string{handle.substr(0, dot_pos)} + "/fd/" +
+         std::string{handle.substr(dot_pos + 1)};
+}
+#endif
+} // namespace
+
+namespace winenv {
+SharedMemory::~SharedMemory() { release(); }
+
+SharedMemory::SharedMemory(SharedMemory &&other) noexcept {
+  *this = std::move(other);
+}
+
+SharedMemory &SharedMemory::operator=(SharedMemory &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  release();
+#ifdef _WIN32
+  m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+  m_fd = std::exchange(other.m_fd, -1);
+#endif
+  mp_view = std::exchange(other.mp_view, nullptr);
+  m_size = std::exchange(other.m_size, 0);
+  m_handle = std::move(other.m_handle);
+  return *this;
+}
+
+SharedMemory SharedMemory::create(size_t size) {
+  SharedMemory memory;
+  memory.m_size = size;
+#ifdef _WIN32
+  static std::atomic<unsigned> counter{0};
+  memory.m_handle = std::to_wstring(GetCurrentProcessId()) + L'.' +
+                    std::to_wstring(++counter);
+  std::wstring name = mapping_name(memory.m_handle);
+  memory.m_mapping = CreateFileMappingW(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32),
+      static_cast<DWORD>(size), name.c_str());
+  if (memory.m_mapping == nullptr) {
+    throw WinError("Failed to create shared memory", GetLastError());
+  }
+  // Блок с таким именем остался от завершившегося процесса с тем же pid
+  if (GetLastError() == ERROR_ALREADY_EXISTS) {
+    throw WinError("Shared memory already exists", ERROR_ALREADY_EXISTS);
+  }
+  memory.mp_view = MapViewOfFile(memory.m_mapping, FILE_MAP_WRITE, 0, 0, size);
+  if (memory.mp_view == nullptr) {
+    throw WinError("Failed to map shared memory", GetLastError());
+  }
+#else
+  memory.m_fd = memfd_create("winenv-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memory.m_fd < 0) {
+    throw_errno("Failed to create shared memory");
+  }
+  if (ftruncate(memory.m_fd, size) != 0) {
+    throw_errno("Failed to resize shared memory");
+  }
+  void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    memory.m_fd, 0);
+  if (view == MAP_FAILED) {
+    throw_errno("Failed to map shared memory");
+  }
+  memory.mp_view = view;
+  memory.m_handle =
+      std::to_string(getpid()) + '.' + std::to_string(memory.m_fd);
+#endif
+  return memory;
+}
+
+SharedMemory SharedMemory::open(EnvStringView handle) {
+  SharedMemory memory;
+  memory.m_handle = EnvString{handle};
+#ifdef _WIN32
+  std::wstring name = mapping_name(handle);
+  memory.m_mapping = OpenFileMappingW(FILE_MAP_READ, false, name.c_str());
+  if (memory.m_mapping == nullptr) {
+    throw WinError("Failed to open shared memory " + narrow_string(name),
+                   GetLastError());
+  }
+  memory.mp_view = MapViewOfFile(memory.m_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (memory.mp_view == nullptr) {
+    throw WinError("Failed to map shared memory", GetLastError());
+  }
+  MEMORY_BASIC_INFORMATION info;
+  if (VirtualQuery(memory.mp_view, &info, sizeof(info)) == 0) {
+    throw WinError("Failed to query shared memory size", GetLastError());
+  }
+  memory.m_size = info.RegionSize;
+#else
+  std::string path = handle_path(handle);
+  memory.m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (memory.m_fd < 0) {
+    throw_errno("Failed to open shared memory " + path);
+  }
+  struct stat info;
+  if (fstat(memory.m_fd, &info) != 0) {
+    throw_errno("Failed to query shared memory size");
+  }
+  memory.m_size = info.st_size;
+  void *view =
+      mmap(nullptr, memory.m_size, PROT_READ, MAP_SHARED, memory.m_fd, 0);
+  if (view == MAP_FAILED) {
+    throw_errno("Failed to map shared memory");
+  }
+  memory.mp_view = view;
+#endif
+  return memory;
+}
+
+void SharedMemory::seal() {
+#ifdef _WIN32
+  DWORD old_protection{0};
+  if (!VirtualProtect(mp_view, m_size, PAGE_READONLY, &old_protection)) {
+    throw WinError("Failed to seal shared memory", GetLastError());
+  }
+#else
+  // Печать записи недопустима, пока есть отображение для записи
+  munmap(mp_view, m_size);
+  mp_view = nullptr;
+  if (fcntl(m_fd, F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+    throw_errno("Failed to seal shared memory");
+  }
+  void *view = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (view == MAP_FAILED) {
+    throw_errno("Failed to map shared memory");
+  }
+  mp_view = view;
+#endif
+}
+
+void SharedMemory::release() noexcept {
+#ifdef _WIN32
+  if (mp_view != nullptr) {
+    UnmapViewOfFile(mp_view);
+  }
+  if (m_mapping != nullptr) {
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+  }
+#else
+  if (mp_view != nullptr) {
+    munmap(mp_view, m_size);
+  }
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+#endif
+  mp_view = nullptr;
+  m_size = 0;
+  m_handle.clear();
+}
+} // namespace winenv
@@ -0,0 +1,56 @@
+#pragma once
+#include "env_snapshot.hpp"
+#ifdef _WIN32
+#include "utils.hpp"
+#endif
+
+#include <cstddef>
+
+namespace winenv {
+// Блок общей памяти, который процесс заполняет один раз, а дочерние
+// процессы отображают только для чтения. В Windows это именованное
+// отображение файла подкачки, в Linux - memfd, который после заполнения
+// запечатывается. Дочернему процессу передается короткая метка блока без
+// пробелов, пригодная для командной строки.
+// Пример:
+// SharedMemory memory = SharedMemory::create(sizeof(Data));
+// new (memory.data()) Data{...};
+// memory.seal();
+// EnvString handle = memory.get_handle(); // Передается дочернему процессу
+// SharedMemory view = SharedMemory::open(handle); // В дочернем процессе
+class SharedMemory {
+public:
+  SharedMemory() = default;
+  ~SharedMemory();
+  SharedMemory(const SharedMemory &other) = delete;
+  SharedMemory(SharedMemory &&other) noexcept;
+  SharedMemory &operator=(const SharedMemory &other) = delete;
+  SharedMemory &operator=(SharedMemory &&other) noexcept;
+
+  // Создает заполненный нулями блок, доступный для записи до вызова seal
+  static SharedMemory create(size_t size);
+  // Отображает только для чтения блок, созданный другим процессом.
+  // Блок существует, пока его не освободит создавший процесс
+  static SharedMemory open(EnvStringView handle);
+
+  // Запрещает дальнейшую запись в блок
+  void seal();
+  EnvString get_handle() const { return m_handle; }
+  void *data() noexcept { return mp_view; }
+  const void *data() const noexcept { return mp_view; }
+  // Размер отображения. У открытого блока может быть округлен до страницы
+  size_t size() const noexcept { return m_size; }
+
+private:
+  void release() noexcept;
+
+#ifdef _WIN32
+  HANDLE m_mapping{nullptr};
+#else
+  int m_fd{-1};
+#endif
+  void *mp_view{nullptr};
+  size_t m_size{0};
+  EnvString m_handle;
+};
+} // namespace winenv
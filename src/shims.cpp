@@ -0,0 +1,188 @@
+#include "shims.hpp"
+#include "fs_cache.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include "utils.hpp"
+#endif
+
+namespace {
+constexpr std::string_view manifest_kind = "shims";
+constexpr const char *manifest_name = ".winenv_shims";
+
+#ifdef _WIN32
+// Сценарии запускаются через call, иначе управление не вернется в прокладку
+bool is_batch_file(const std::filesystem::path &target) {
+  std::string ext = winenv::path_to_utf8(target.extension());
+  for (char &c : ext) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return ext == ".bat" || ext == ".cmd";
+}
+
+// Текст в OEM кодовой странице, в которой запускаются консоли и в которой
+// cmd.exe читает .cmd файлы. Пустая строка, если в ней нет всех символов
+std::string to_oem(const std::wstring &wide) {
+  UINT code_page = GetOEMCP();
+  if (code_page == CP_UTF8) {
+    return winenv::narrow_string(wide);
+  }
+  BOOL f_lossy = FALSE;
+  int size = WideCharToMultiByte(code_page, WC_NO_BEST_FIT_CHARS, wide.data(),
+                                 static_cast<int>(wide.size()), nullptr, 0,
+                                 nullptr, &f_lossy);
+  if (size == 0 || f_lossy) {
+    return {};
+  }
+  std::string text(size, '\0');
+  WideCharToMultiByte(code_page, WC_NO_BEST_FIT_CHARS, wide.data(),
+                      static_cast<int>(wide.size()), text.data(), size,
+                      nullptr, nullptr);
+  return text;
+}
+
+// Путь программы для строки .cmd файла. Путь с символами вне OEM кодовой
+// страницы заменяется коротким путем 8.3. "%" удваивается, иначе cmd.exe
+// подставит вместо него переменную
+std::string to_batch_path(const std::filesystem::path &target) {
+  std::string text = to_oem(target.native());
+  if (text.empty()) {
+    DWORD size = GetShortPathNameW(target.c_str(), nullptr, 0);
+    std::wstring short_path(size, L'\0');
+    size = GetShortPathNameW(target.c_str(), short_path.data(), size);
+    if (size != 0 && size < short_path.size()) {
+      short_path.resize(size);
+      text = to_oem(short_path);
+    }
+  }
+  if (text.empty()) {
+    throw std::runtime_error(
+        "Shim target is not representable in the console code page: " +
+        winenv::path_to_utf8(target));
+  }
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (char c : text) {
+    escaped += c;
+    if (c == '%') {
+      escaped += '%';
+    }
+  }
+  return escaped;
+}
+#endif
+} // namespace
+
+namespace winenv {
+bool ShimPlan::empty() const noexcept {
+  return m_remove.empty() && m_create.empty();
+}
+
+ShimPlan diff_shims(const ShimMap &current, const ShimMap &desired) {
+  // Оба словаря упорядочены: один совместный проход
+  ShimPlan plan;
+  auto cur = current.begin();
+  auto des = desired.begin();
+  while (cur != current.end() || des != desired.end()) {
+    if (des == desired.end() ||
+        (cur != current.end() && cur->first < des->first)) {
+      plan.m_remove.push_back(cur->first);
+      ++cur;
+    } else if (cur == current.end() || des->first < cur->first) {
+      plan.m_create.push_back(*des);
+      ++des;
+    } else {
+      if (cur->second == des->second) {
+        ++plan.m_n_unchanged;
+      } else {
+        plan.m_create.push_back(*des);
+      }
+      ++cur;
+      ++des;
+    }
+  }
+  return plan;
+}
+
+ShimMap shims_from_commands(
+    const std::unordered_map<std::string, std::filesystem::path> &commands) {
+  return {commands.begin(), commands.end()};
+}
+
+ShimDirectory::ShimDirectory(std::filesystem::path dir)
+    : m_dir{std::move(dir)}, m_manifest{m_dir / manifest_name} {}
+
+ShimPlan ShimDirectory::sync(const ShimMap &desired) {
+  std::filesystem::create_directories(m_dir);
+  ShimPlan plan = diff_shims(read_current(), desired);
+  if (plan.empty()) {
+    return plan;
+  }
+  for (const std::string &command : plan.m_remove) {
+    std::error_code ec;
+    std::filesystem::remove(m_dir / shim_file_name(command), ec);
+  }
+  for (const auto &[command, target] : plan.m_create) {
+    write_shim(command, target);
+  }
+  std::vector<CacheRecord> records;
+  records.reserve(desired.size());
+  for (const auto &[command, target] : desired) {
+    records.push_back({command, path_to_utf8(target)});
+  }
+  write_cache_file(m_manifest, manifest_kind, records);
+  return plan;
+}
+
+const std::filesystem::path &ShimDirectory::get_path() const noexcept {
+  return m_dir;
+}
+
+std::filesystem::path
+ShimDirectory::shim_file_name(const std::string &command) {
+#ifdef _WIN32
+  return path_from_utf8(command + ".cmd");
+#else
+  return path_from_utf8(command);
+#endif
+}
+
+ShimMap ShimDirectory::read_current() const {
+  ShimMap current;
+  for (CacheRecord &record : read_cache_file(m_manifest, manifest_kind)) {
+    if (record.size() != 2) {
+      continue;
+    }
+    std::error_code ec;
+    // Удаленная вручную прокладка будет создана заново
+    if (!std::filesystem::is_symlink(m_dir / shim_file_name(record[0]), ec) &&
+        !std::filesystem::exists(m_dir / shim_file_name(record[0]), ec)) {
+      continue;
+    }
+    current.insert({std::move(record[0]), path_from_utf8(record[1])});
+  }
+  return current;
+}
+
+void ShimDirectory::write_shim(const std::string &command,
+                               const std::filesystem::path &target) const {
+  std::filesystem::path shim_path = m_dir / shim_file_name(command);
+  std::error_code ec;
+  std::filesystem::remove(shim_path, ec);
+#ifdef _WIN32
+  std::string batch_path = to_batch_path(target);
+  std::ofstream out(shim_path, std::ios::binary | std::ios::trunc);
+  if (!out.good()) {
+    throw std::runtime_error("Failed to create shim: " +
+                             path_to_utf8(shim_path));
+  }
+  out << "@" << (is_batch_file(target) ? "call " : "") << '"' << batch_path
+      << "\" %*\r\n";
+#else
+  std::filesystem::create_symlink(target, shim_path);
+#endif
+}
+} // namespace winenv
@@ -0,0 +1,59 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace winenv {
+// Прокладки: имя команды без расширения -> путь к программе
+using ShimMap = std::map<std::string, std::filesystem::path>;
+
+// Изменения, приводящие директорию прокладок к желаемому виду
+struct ShimPlan {
+  std::vector<std::string> m_remove;
+  // Новые прокладки и прокладки, цель которых изменилась
+  std::vector<std::pair<std::string, std::filesystem::path>> m_create;
+  size_t m_n_unchanged{0};
+
+  bool empty() const noexcept;
+};
+
+// Сравнивает текущие и желаемые прокладки
+ShimPlan diff_shims(const ShimMap &current, const ShimMap &desired);
+
+// Управляемая директория прокладок. Вместо десятков директорий
+// APPS_BIN_PATHS в PATH добавляется одна, и cmd.exe ищет команду один раз.
+// В Windows прокладка - файл "<имя>.cmd", запускающий программу по полному
+// пути: жесткая ссылка на .exe нарушила бы поиск DLL рядом с программой.
+// Такая команда запускается как пакетный файл: cmd.exe повторно разбирает
+// "^" в аргументах и по Ctrl+C спрашивает, прервать ли пакетный файл.
+// В остальных системах прокладка - символическая ссылка.
+// Список созданных прокладок хранится в файле внутри директории, поэтому
+// повторная синхронизация затрагивает только изменившиеся команды, а
+// посторонние файлы не удаляются
+class ShimDirectory {
+public:
+  explicit ShimDirectory(std::filesystem::path dir);
+  // Создает директорию при необходимости и применяет разницу
+  ShimPlan sync(const ShimMap &desired);
+  const std::filesystem::path &get_path() const noexcept;
+  // Имя файла прокладки для команды
+  static std::filesystem::path shim_file_name(const std::string &command);
+
+private:
+  // Прокладки из списка, файлы которых существуют
+  ShimMap read_current() const;
+  void write_shim(const std::string &command,
+                  const std::filesystem::path &target) const;
+
+  std::filesystem::path m_dir;
+  std::filesystem::path m_manifest;
+};
+
+// Преобразует индекс команд в желаемое содержимое директории прокладок
+ShimMap
+shims_from_commands(const std::unordered_map<std::string, std::filesystem::path>
+                        &commands);
+} // namespace winenv
@@ -0,0 +1,62 @@
+#pragma once
+// Векторные ветки собираются только для x86-64 и выбираются во время работы
+// по возможностям процессора, поэтому программа запускается и на процессорах
+// без SSSE3/AVX2. Функции с векторными инструкциями помечаются
+// WINENV_TARGET("ssse3"), чтобы GCC и Clang собирали их без -mssse3.
+// MSVC разрешает встроенные функции любых наборов без флагов
+#if defined(__x86_64__) || defined(_M_X64)
+#define WINENV_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define WINENV_TARGET(features)
+#else
+#define WINENV_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+namespace winenv {
+#ifdef WINENV_SIMD_X86
+namespace detail {
+struct CpuFeatures {
+  bool m_ssse3{false};
+  bool m_avx2{false};
+};
+
+inline CpuFeatures detect_cpu_features() noexcept {
+  CpuFeatures features;
+#ifdef _MSC_VER
+  int info[4]{};
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+  __cpuid(info, 1);
+  features.m_ssse3 = (info[2] & (1 << 9)) != 0;
+  bool has_osxsave = (info[2] & (1 << 27)) != 0;
+  bool has_avx = (info[2] & (1 << 28)) != 0;
+  // Регистры AVX должны сохраняться системой при переключении потоков
+  bool is_ymm_saved = has_osxsave && (_xgetbv(0) & 0x6) == 0x6;
+  if (max_leaf >= 7 && has_avx && is_ymm_saved) {
+    __cpuidex(info, 7, 0);
+    features.m_avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  features.m_ssse3 = __builtin_cpu_supports("ssse3");
+  features.m_avx2 = __builtin_cpu_supports("avx2");
+#endif
+  return features;
+}
+
+inline const CpuFeatures &cpu_features() noexcept {
+  static const CpuFeatures features = detect_cpu_features();
+  return features;
+}
+} // namespace detail
+
+inline bool has_ssse3() noexcept { return detail::cpu_features().m_ssse3; }
+inline bool has_avx2() noexcept { return detail::cpu_features().m_avx2; }
+#else
+inline bool has_ssse3() noexcept { return false; }
+inline bool has_avx2() noexcept { return false; }
+#endif
+} // namespace winenv
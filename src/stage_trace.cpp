@@ -0,0 +1,168 @@
+#include "stage_trace.hpp"
+
+#include <algorithm>
+
+namespace {
+using winenv::TraceClock;
+
+constexpr unsigned stamp_bits = 28;
+constexpr std::uint32_t stamp_mask = (1u << stamp_bits) - 1;
+
+std::uint64_t to_microseconds(TraceClock::time_point time) noexcept {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+// Значение выборки с долей rank от 0 до 1
+std::chrono::microseconds
+percentile(std::vector<std::chrono::microseconds> &samples, double rank) {
+  size_t pos = std::min(samples.size() - 1,
+                        static_cast<size_t>(rank * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + pos, samples.end());
+  return samples[pos];
+}
+
+std::string us_to_string(std::chrono::microseconds us) {
+  return std::to_string(us.count()) + " us";
+}
+} // namespace
+
+namespace winenv {
+const char *stage_name(SpawnStage stage) noexcept {
+  switch (stage) {
+  case SpawnStage::hotkey:
+    return "hotkey";
+  case SpawnStage::spawn_entered:
+    return "spawn_entered";
+  case SpawnStage::process_created:
+    return "process_created";
+  case SpawnStage::child_main:
+    return "child_main";
+  case SpawnStage::console_allocated:
+    return "console_allocated";
+  case SpawnStage::font_set:
+    return "font_set";
+  case SpawnStage::colors_set:
+    return "colors_set";
+  case SpawnStage::startup_info_applied:
+    return "startup_info_applied";
+  case SpawnStage::console_shown:
+    return "console_shown";
+  case SpawnStage::cmd_launched:
+    return "cmd_launched";
+  default:
+    return "unknown";
+  }
+}
+
+std::uint32_t pack_stage_stamp(SpawnStage stage, TraceClock::time_point time) {
+  return static_cast<std::uint32_t>(stage) << stamp_bits |
+         static_cast<std::uint32_t>(to_microseconds(time) & stamp_mask);
+}
+
+std::pair<SpawnStage, TraceClock::time_point>
+unpack_stage_stamp(std::uint32_t packed, TraceClock::time_point now) {
+  auto stage = static_cast<SpawnStage>(packed >> stamp_bits);
+  std::uint32_t age =
+      (static_cast<std::uint32_t>(to_microseconds(now)) - packed) & stamp_mask;
+  return {stage, now - std::chrono::microseconds{age}};
+}
+
+void SpawnTrace::mark(SpawnStage stage, TraceClock::time_point time) {
+  m_stamps[static_cast<size_t>(stage)] = time;
+}
+
+void SpawnTracer::begin(std::uint32_t id, const SpawnTrace &trace) {
+  // Дочерний процесс мог завершиться, не дойдя до запуска cmd.exe
+  TraceClock::time_point now = TraceClock::now();
+  for (auto iter = m_pending.begin(); iter != m_pending.end();) {
+    const auto &hotkey = iter->second.m_stamps[0];
+    if (!hotkey || now - *hotkey > max_trace_age) {
+      iter = m_pending.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  m_pending[id] = trace;
+}
+
+void SpawnTracer::mark(std::uint32_t id, SpawnStage stage,
+                       TraceClock::time_point time) {
+  auto iter = m_pending.find(id);
+  if (iter == m_pending.end() || stage >= SpawnStage::count) {
+    return;
+  }
+  iter->second.mark(stage, time);
+  if (stage == SpawnStage::cmd_launched) {
+    finish(iter->second);
+    m_pending.erase(iter);
+  }
+}
+
+void SpawnTracer::finish(const SpawnTrace &trace) {
+  const auto &hotkey = trace.m_stamps[0];
+  if (!hotkey) {
+    return;
+  }
+  for (size_t i = 0; i < g_n_spawn_stages; ++i) {
+    if (!trace.m_stamps[i]) {
+      continue;
+    }
+    std::deque<std::chrono::microseconds> &samples = m_samples[i];
+    if (samples.size() == max_samples) {
+      samples.pop_front();
+    }
+    samples.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+        *trace.m_stamps[i] - *hotkey));
+  }
+  ++m_n_finished;
+}
+
+std::string SpawnTracer::to_string() const {
+  std::string text =
+      "spawn stages after hotkey (" + std::to_string(m_n_finished) + "):\n";
+  for (size_t i = 1; i < g_n_spawn_stages; ++i) {
+    if (m_samples[i].empty()) {
+      continue;
+    }
+    std::vector<std::chrono::microseconds> samples{m_samples[i].begin(),
+                                                   m_samples[i].end()};
+    text += stage_name(static_cast<SpawnStage>(i));
+    text += ": p50 " + us_to_string(percentile(samples, 0.5));
+    text += ", p90 " + us_to_string(percentile(samples, 0.9));
+    text += ", p99 " + us_to_string(percentile(samples, 0.99));
+    text += ", max " +
+            us_to_string(*std::max_element(samples.begin(), samples.end()));
+    text += '\n';
+  }
+  return text;
+}
+
+#ifdef _WIN32
+void StageReporter::mark(SpawnStage stage, TraceClock::time_point time) {
+  std::uint32_t packed = pack_stage_stamp(stage, time);
+  if (mf_connected) {
+    post(packed);
+  } else {
+    m_pending.push_back(packed);
+  }
+}
+
+void StageReporter::connect(DWORD parent_thread_id) {
+  m_parent_thread_id = parent_thread_id;
+  mf_connected = true;
+  for (std::uint32_t packed : m_pending) {
+    post(packed);
+  }
+  m_pending.clear();
+}
+
+void StageReporter::post(std::uint32_t packed) const noexcept {
+  if (m_parent_thread_id != 0) {
+    PostThreadMessageW(m_parent_thread_id, g_wm_spawn_stage,
+                       GetCurrentProcessId(), packed);
+  }
+}
+#endif
+} // namespace winenv
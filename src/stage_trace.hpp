@@ -0,0 +1,109 @@
+#pragma once
+#ifdef _WIN32
+#include "common.hpp"
+#endif
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace winenv {
+// Этапы от нажатия HK_SPAWN_CMD до запуска cmd.exe в готовой консоли.
+// Первые три отмечает родительский процесс, остальные - дочерний
+enum class SpawnStage : std::uint8_t {
+  hotkey,
+  spawn_entered,
+  process_created,
+  child_main,
+  console_allocated,
+  font_set,
+  colors_set,
+  startup_info_applied,
+  // Только для консоли из пула: окно показано после передачи
+  console_shown,
+  cmd_launched,
+  count
+};
+constexpr size_t g_n_spawn_stages = static_cast<size_t>(SpawnStage::count);
+
+const char *stage_name(SpawnStage stage) noexcept;
+
+// Отметки времени steady_clock сравнимы между процессами: в Windows это
+// QueryPerformanceCounter, в Linux - CLOCK_MONOTONIC. Отметка вместе с
+// этапом упаковывается в 32 бита сообщения: 4 бита этапа и младшие 28 бит
+// микросекунд. Получатель восстанавливает время по своему текущему, если
+// сообщение дошло быстрее 268 секунд
+using TraceClock = std::chrono::steady_clock;
+std::uint32_t pack_stage_stamp(SpawnStage stage, TraceClock::time_point time);
+std::pair<SpawnStage, TraceClock::time_point>
+unpack_stage_stamp(std::uint32_t packed,
+                   TraceClock::time_point now = TraceClock::now());
+
+// Отметки одного запуска консоли
+struct SpawnTrace {
+  std::array<std::optional<TraceClock::time_point>, g_n_spawn_stages>
+      m_stamps;
+
+  void mark(SpawnStage stage, TraceClock::time_point time = TraceClock::now());
+};
+
+// Собирает отметки запусков и считает по каждому этапу процентили времени
+// от нажатия клавиши. Запуск учитывается, когда приходит отметка
+// cmd_launched. Используется из одного потока.
+// Пример:
+// SpawnTrace trace;
+// trace.mark(SpawnStage::hotkey);
+// ... // Запуск процесса
+// tracer.begin(proc.get_id(), trace);
+// tracer.mark(child_id, stage, time); // По сообщению дочернего процесса
+// *g_logger << tracer.to_string();
+class SpawnTracer {
+public:
+  // Ожидает отметки дочернего процесса id
+  void begin(std::uint32_t id, const SpawnTrace &trace);
+  // Отметки неизвестных процессов отбрасываются: например, отметки
+  // консоли пула, подготовленной до нажатия клавиши
+  void mark(std::uint32_t id, SpawnStage stage, TraceClock::time_point time);
+  // Процентили по этапам, по одной строке на этап
+  std::string to_string() const;
+
+private:
+  static constexpr size_t max_samples = 1024;
+  // Запуск, не дошедший до cmd_launched за это время, отбрасывается
+  static constexpr std::chrono::seconds max_trace_age{60};
+
+  void finish(const SpawnTrace &trace);
+
+  std::unordered_map<std::uint32_t, SpawnTrace> m_pending;
+  // Последние max_samples длительностей от нажатия клавиши по этапам
+  std::array<std::deque<std::chrono::microseconds>, g_n_spawn_stages>
+      m_samples;
+  size_t m_n_finished{0};
+};
+
+#ifdef _WIN32
+// Сторона дочернего процесса. Отметки копятся, пока не известен поток
+// родительского процесса, затем отправляются ему сообщением
+// g_wm_spawn_stage: WPARAM - Id дочернего процесса, LPARAM - упакованная
+// отметка
+class StageReporter {
+public:
+  void mark(SpawnStage stage, TraceClock::time_point time = TraceClock::now());
+  // Отправляет накопленные отметки. 0 - родитель не принимает отметки
+  void connect(DWORD parent_thread_id);
+
+private:
+  void post(std::uint32_t packed) const noexcept;
+
+  DWORD m_parent_thread_id{0};
+  bool mf_connected{false};
+  std::vector<std::uint32_t> m_pending;
+};
+#endif
+} // namespace winenv
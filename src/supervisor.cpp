@@ -0,0 +1,276 @@
+#include "supervisor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifndef _WIN32
+// Период опроса процессов, для которых ядро не выдало pidfd
+constexpr int poll_period_ms = 100;
+#endif
+
+std::string memory_to_string(size_t bytes) {
+  return std::to_string(bytes / (1024 * 1024)) + " MiB";
+}
+} // namespace
+
+namespace winenv {
+std::string ExitRecord::to_string() const {
+  if (!mf_usage_known) {
+    return m_action + " (" + std::to_string(m_id) + ") exited after " +
+           std::to_string(m_lifetime.count() / 1000) + " ms, usage unknown";
+  }
+  return m_action + " (" + std::to_string(m_id) + ") exited with code " +
+         std::to_string(m_usage.m_exit_code) + " after " +
+         std::to_string(m_lifetime.count() / 1000) + " ms, cpu " +
+         std::to_string(m_usage.m_cpu_time.count() / 1000) + " ms, peak " +
+         memory_to_string(m_usage.m_peak_memory);
+}
+
+void SupervisorStats::add(const SupervisorStats &other) noexcept {
+  m_n_running += other.m_n_running;
+  m_n_exited += other.m_n_exited;
+  m_n_failed += other.m_n_failed;
+  m_total_lifetime += other.m_total_lifetime;
+  m_total_cpu_time += other.m_total_cpu_time;
+  m_max_peak_memory = std::max(m_max_peak_memory, other.m_max_peak_memory);
+}
+
+std::string SupervisorStats::to_string() const {
+  return std::to_string(m_n_running) + " running, " +
+         std::to_string(m_n_exited) + " exited (" +
+         std::to_string(m_n_failed) + " failed), lifetime " +
+         std::to_string(m_total_lifetime.count() / 1000) + " ms, cpu " +
+         std::to_string(m_total_cpu_time.count() / 1000) + " ms, max peak " +
+         memory_to_string(m_max_peak_memory);
+}
+
+ProcessSupervisor::ProcessSupervisor(ExitCallback on_exit)
+    : m_on_exit{std::move(on_exit)} {
+#ifndef _WIN32
+  m_epoll = epoll_create1(EPOLL_CLOEXEC);
+  m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (m_epoll < 0 || m_wake_fd < 0) {
+    int err = errno;
+    close(m_epoll);
+    close(m_wake_fd);
+    throw std::system_error(err, std::generic_category(),
+                            "Failed to create ProcessSupervisor");
+  }
+  // Нулевой pid не бывает у дочерних процессов: им помечаем пробуждение
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = 0;
+  epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake_fd, &event);
+  m_wait_thread = std::thread{&ProcessSupervisor::wait_loop, this};
+#endif
+}
+
+ProcessSupervisor::~ProcessSupervisor() {
+#ifdef _WIN32
+  // Обратные вызовы берут m_mutex, поэтому ждем их завершения без блокировки.
+  // Вызов, пришедший после переноса, не найдет процесс в m_running
+  std::unordered_map<Process::NativeId, std::unique_ptr<Watched>> running;
+  {
+    std::lock_guard lock{m_mutex};
+    running.swap(m_running);
+  }
+  for (auto &[id, watched] : running) {
+    UnregisterWaitEx(watched->m_wait, INVALID_HANDLE_VALUE);
+  }
+#else
+  {
+    std::lock_guard lock{m_mutex};
+    mf_stopping = true;
+  }
+  uint64_t one = 1;
+  write(m_wake_fd, &one, sizeof(one));
+  m_wait_thread.join();
+  m_running.clear();
+  close(m_wake_fd);
+  close(m_epoll);
+#endif
+}
+
+void ProcessSupervisor::watch(Process process, std::string action) {
+  auto watched = std::make_unique<Watched>();
+  watched->m_process = std::move(process);
+  watched->m_action = std::move(action);
+  watched->m_start = std::chrono::steady_clock::now();
+  Process::NativeId id = watched->m_process.get_id();
+
+  std::lock_guard lock{m_mutex};
+#ifdef _WIN32
+  watched->mp_owner = this;
+  // Обратный вызов заблокируется на m_mutex до конца добавления
+  if (!RegisterWaitForSingleObject(&watched->m_wait,
+                                   watched->m_process.get_handle(),
+                                   &ProcessSupervisor::wait_callback,
+                                   watched.get(), INFINITE,
+                                   WT_EXECUTEONLYONCE)) {
+    throw WinError("Failed to watch Process " + watched->m_action,
+                   GetLastError());
+  }
+#else
+  int pidfd = watched->m_process.get_pidfd();
+  if (pidfd >= 0) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(id);
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, pidfd, &event) != 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "Failed to watch Process " + watched->m_action);
+    }
+  } else if (m_n_without_pidfd++ == 0) {
+    // Поток ожидания должен перейти на опрос по таймеру
+    uint64_t one = 1;
+    write(m_wake_fd, &one, sizeof(one));
+  }
+#endif
+  ++m_stats[watched->m_action].m_n_running;
+  m_running.insert({id, std::move(watched)});
+}
+
+std::vector<ExitRecord> ProcessSupervisor::take_exited() {
+  std::lock_guard lock{m_mutex};
+  return std::exchange(m_exited, {});
+}
+
+std::map<std::string, SupervisorStats> ProcessSupervisor::get_stats() const {
+  std::lock_guard lock{m_mutex};
+  return m_stats;
+}
+
+SupervisorStats ProcessSupervisor::get_total_stats() const {
+  std::lock_guard lock{m_mutex};
+  SupervisorStats total;
+  for (auto &[action, stats] : m_stats) {
+    total.add(stats);
+  }
+  return total;
+}
+
+bool ProcessSupervisor::finish(Process::NativeId id) {
+  auto iter = m_running.find(id);
+  if (iter == m_running.end()) {
+    return false;
+  }
+  Watched &watched = *iter->second;
+#ifdef _WIN32
+  // Внутри обратного вызова допустима только неблокирующая отмена
+  UnregisterWait(watched.m_wait);
+#else
+  if (!watched.m_process.wait_for(0)) {
+    return false;
+  }
+  if (watched.m_process.get_pidfd() < 0) {
+    --m_n_without_pidfd;
+  }
+#endif
+  ExitRecord record;
+  record.m_action = watched.m_action;
+  record.m_id = id;
+  record.m_lifetime = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - watched.m_start);
+  // Исключение из обратного вызова пула ожидания завершило бы программу,
+  // а процесс остался бы среди работающих
+  try {
+    record.m_usage = watched.m_process.get_usage();
+  } catch (std::exception &) {
+    record.mf_usage_known = false;
+  }
+
+  SupervisorStats &stats = m_stats[record.m_action];
+  --stats.m_n_running;
+  ++stats.m_n_exited;
+  if (!record.mf_usage_known || record.m_usage.m_exit_code != 0) {
+    ++stats.m_n_failed;
+  }
+  stats.m_total_lifetime += record.m_lifetime;
+  stats.m_total_cpu_time += record.m_usage.m_cpu_time;
+  stats.m_max_peak_memory =
+      std::max(stats.m_max_peak_memory, record.m_usage.m_peak_memory);
+  m_exited.push_back(std::move(record));
+  // pidfd закрывается вместе с процессом и сам удаляется из epoll
+  m_running.erase(iter);
+  return true;
+}
+
+#ifdef _WIN32
+void CALLBACK ProcessSupervisor::wait_callback(void *context,
+                                               BOOLEAN timed_out) {
+  auto *watched = static_cast<Watched *>(context);
+  ProcessSupervisor *owner = watched->mp_owner;
+  Process::NativeId id = watched->m_process.get_id();
+  bool is_finished{false};
+  {
+    std::lock_guard lock{owner->m_mutex};
+    // После finish запись watched уже удалена
+    is_finished = owner->finish(id);
+  }
+  if (is_finished && owner->m_on_exit) {
+    owner->m_on_exit();
+  }
+}
+#else
+void ProcessSupervisor::wait_loop() {
+  constexpr int max_events = 16;
+  epoll_event events[max_events];
+  while (true) {
+    int timeout{-1};
+    {
+      std::lock_guard lock{m_mutex};
+      if (mf_stopping) {
+        return;
+      }
+      timeout = m_n_without_pidfd > 0 ? poll_period_ms : -1;
+    }
+    int n_events = epoll_wait(m_epoll, events, max_events, timeout);
+    if (n_events < 0 && errno != EINTR) {
+      return;
+    }
+    bool is_finished{false};
+    {
+      std::lock_guard lock{m_mutex};
+      for (int i = 0; i < n_events; ++i) {
+        if (events[i].data.u64 == 0) {
+          uint64_t value{0};
+          read(m_wake_fd, &value, sizeof(value));
+          continue;
+        }
+        is_finished |= finish(static_cast<pid_t>(events[i].data.u64));
+      }
+      if (m_n_without_pidfd > 0) {
+        is_finished |= poll_without_pidfd();
+      }
+    }
+    if (is_finished && m_on_exit) {
+      m_on_exit();
+    }
+  }
+}
+
+bool ProcessSupervisor::poll_without_pidfd() {
+  std::vector<Process::NativeId> ids;
+  for (auto &[id, watched] : m_running) {
+    if (watched->m_process.get_pidfd() < 0) {
+      ids.push_back(id);
+    }
+  }
+  bool is_finished{false};
+  for (Process::NativeId id : ids) {
+    is_finished |= finish(id);
+  }
+  return is_finished;
+}
+#endif
+} // namespace winenv
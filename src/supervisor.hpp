@@ -0,0 +1,108 @@
+#pragma once
+#include "process.hpp"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <thread>
+#endif
+
+namespace winenv {
+// Итоги работы одного дочернего процесса
+struct ExitRecord {
+  std::string m_action;
+  Process::NativeId m_id{0};
+  // С момента передачи процесса наблюдателю до завершения
+  std::chrono::microseconds m_lifetime{0};
+  Process::Usage m_usage{};
+  // false, если итоги не удалось получить: m_usage пустой, а процесс
+  // считается завершившимся с ошибкой
+  bool mf_usage_known{true};
+
+  std::string to_string() const;
+};
+
+// Сводка по действию: сколько процессов работает, сколько завершилось
+// и сколько ресурсов потрачено завершившимися
+struct SupervisorStats {
+  size_t m_n_running{0};
+  size_t m_n_exited{0};
+  // Завершились с ненулевым кодом
+  size_t m_n_failed{0};
+  std::chrono::microseconds m_total_lifetime{0};
+  std::chrono::microseconds m_total_cpu_time{0};
+  size_t m_max_peak_memory{0};
+
+  void add(const SupervisorStats &other) noexcept;
+  std::string to_string() const;
+};
+
+// Наблюдатель за дочерними процессами. Хранит запущенные процессы и
+// асинхронно ждет их завершения: в Windows через пул ожидания
+// RegisterWaitForSingleObject, в остальных системах - один поток с epoll по
+// дескрипторам pidfd. Обратный вызов on_exit выполняется в потоке ожидания,
+// поэтому он только уведомляет поток-владелец, который забирает записи
+// методом take_exited.
+// Пример:
+// ProcessSupervisor supervisor{[id = GetCurrentThreadId()] {
+//   PostThreadMessageW(id, g_wm_child_exit, 0, 0);
+// }};
+// supervisor.watch(std::move(proc), "spawn_cmd");
+class ProcessSupervisor {
+public:
+  using ExitCallback = std::function<void()>;
+
+  explicit ProcessSupervisor(ExitCallback on_exit = {});
+  // Перестает ждать. Работающие процессы не завершаются
+  ~ProcessSupervisor();
+  ProcessSupervisor(const ProcessSupervisor &other) = delete;
+  ProcessSupervisor &operator=(const ProcessSupervisor &other) = delete;
+
+  void watch(Process process, std::string action);
+  // Записи завершившихся процессов, накопленные с прошлого вызова
+  std::vector<ExitRecord> take_exited();
+  // Сводки по каждому действию
+  std::map<std::string, SupervisorStats> get_stats() const;
+  // Сводка по всем действиям
+  SupervisorStats get_total_stats() const;
+
+private:
+  struct Watched {
+    Process m_process;
+    std::string m_action;
+    std::chrono::steady_clock::time_point m_start;
+#ifdef _WIN32
+    ProcessSupervisor *mp_owner{nullptr};
+    HANDLE m_wait{nullptr};
+#endif
+  };
+  // Переносит завершившийся процесс в m_exited. Вызывается под m_mutex.
+  // Возвращает false, если процесс не найден или еще работает
+  bool finish(Process::NativeId id);
+#ifdef _WIN32
+  static void CALLBACK wait_callback(void *context, BOOLEAN timed_out);
+#else
+  void wait_loop();
+  // Процессы без pidfd опрашиваются по таймеру. Вызывается под m_mutex
+  bool poll_without_pidfd();
+
+  int m_epoll{-1};
+  int m_wake_fd{-1};
+  size_t m_n_without_pidfd{0};
+  bool mf_stopping{false};
+  std::thread m_wait_thread;
+#endif
+
+  ExitCallback m_on_exit;
+  mutable std::mutex m_mutex;
+  std::unordered_map<Process::NativeId, std::unique_ptr<Watched>> m_running;
+  std::vector<ExitRecord> m_exited;
+  std::map<std::string, SupervisorStats> m_stats;
+};
+} // namespace winenv
@@ -0,0 +1,145 @@
+#include "text_sniff.hpp"
+#include "simd.hpp"
+
+#include <fstream>
+
+namespace {
+bool is_plain_ascii(unsigned char c) noexcept { return c != 0 && c < 0x80; }
+
+// Позиция первого байта, не являющегося ASCII без нуля, начиная с pos
+size_t skip_ascii_scalar(const unsigned char *data, size_t size,
+                         size_t pos) noexcept {
+  while (pos < size && is_plain_ascii(data[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+#ifdef WINENV_SIMD_X86
+unsigned count_trailing_zeros(unsigned mask) noexcept {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+// SSE2 есть в любом процессоре x86-64
+size_t skip_ascii_sse2(const unsigned char *data, size_t size,
+                       size_t pos) noexcept {
+  const __m128i zero = _mm_setzero_si128();
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    // Старший бит - не ASCII, совпадение с нулем - нулевой байт
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(block)) |
+                    static_cast<unsigned>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)));
+    if (mask != 0) {
+      return pos + count_trailing_zeros(mask);
+    }
+  }
+  return skip_ascii_scalar(data, size, pos);
+}
+
+WINENV_TARGET("avx2")
+size_t skip_ascii_avx2(const unsigned char *data, size_t size,
+                       size_t pos) noexcept {
+  const __m256i zero = _mm256_setzero_si256();
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(block)) |
+                    static_cast<unsigned>(_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(block, zero)));
+    if (mask != 0) {
+      return pos + count_trailing_zeros(mask);
+    }
+  }
+  return skip_ascii_sse2(data, size, pos);
+}
+#endif
+
+size_t skip_ascii(const unsigned char *data, size_t size, size_t pos) noexcept {
+#ifdef WINENV_SIMD_X86
+  static const bool use_avx2 = winenv::has_avx2();
+  return use_avx2 ? skip_ascii_avx2(data, size, pos)
+                  : skip_ascii_sse2(data, size, pos);
+#else
+  return skip_ascii_scalar(data, size, pos);
+#endif
+}
+
+bool is_continuation(unsigned char c) noexcept { return (c & 0xC0) == 0x80; }
+
+// Длина корректной многобайтной последовательности в начале data или 0.
+// Если последовательность обрезана концом блока, возвращает size
+size_t utf8_sequence_size(const unsigned char *data, size_t size) noexcept {
+  unsigned char lead = data[0];
+  size_t length;
+  // Допустимый диапазон второго байта исключает сокращенные формы,
+  // суррогаты D800..DFFF и значения больше U+10FFFF
+  unsigned char second_min = 0x80;
+  unsigned char second_max = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    if (lead == 0xE0) {
+      second_min = 0xA0;
+    } else if (lead == 0xED) {
+      second_max = 0x9F;
+    }
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    if (lead == 0xF0) {
+      second_min = 0x90;
+    } else if (lead == 0xF4) {
+      second_max = 0x8F;
+    }
+  } else {
+    return 0;
+  }
+  for (size_t i = 1; i < length; ++i) {
+    if (i == size) {
+      return size;
+    }
+    if (i == 1 ? data[1] < second_min || data[1] > second_max
+               : !is_continuation(data[i])) {
+      return 0;
+    }
+  }
+  return length;
+}
+} // namespace
+
+namespace winenv {
+bool is_text_block(const unsigned char *data, size_t size) noexcept {
+  size_t pos = skip_ascii(data, size, 0);
+  while (pos < size) {
+    size_t length = utf8_sequence_size(data + pos, size - pos);
+    if (length == 0) {
+      return false;
+    }
+    pos = skip_ascii(data, size, pos + length);
+  }
+  return true;
+}
+
+bool is_text_file(const std::filesystem::path &file) {
+  std::ifstream in{file, std::ios::binary};
+  if (!in) {
+    return false;
+  }
+  unsigned char block[g_sniff_block_size];
+  in.read(reinterpret_cast<char *>(block), sizeof(block));
+  size_t size = static_cast<size_t>(in.gcount());
+  if (size >= 2 && ((block[0] == 0xFF && block[1] == 0xFE) ||
+                    (block[0] == 0xFE && block[1] == 0xFF))) {
+    return true;
+  }
+  return is_text_block(block, size);
+}
+} // namespace winenv
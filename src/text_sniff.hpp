@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+
+namespace winenv {
+// Размер начала файла, по которому определяется, текстовый ли он
+constexpr size_t g_sniff_block_size = 4096;
+
+// true, если в блоке нет нулевых байт и он корректен в UTF-8: без
+// сокращенных форм, суррогатов и значений больше U+10FFFF.
+// Последовательность, обрезанная концом блока, считается корректной.
+// ASCII проверяется векторно по 32 (AVX2) или 16 байт, многобайтные
+// последовательности - по одной
+bool is_text_block(const unsigned char *data, size_t size) noexcept;
+// Проверяет первые g_sniff_block_size байт файла. Файлы с меткой порядка
+// байт UTF-16 считаются текстовыми. false, если файл не удалось прочитать
+bool is_text_file(const std::filesystem::path &file);
+} // namespace winenv
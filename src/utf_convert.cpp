@@ -0,0 +1,408 @@
+#include "utf_convert.hpp"
+#include "simd.hpp"
+
+#include <cstdint>
+
+namespace {
+constexpr char32_t replacement_char = 0xFFFD;
+
+bool is_continuation(unsigned char c) noexcept { return (c & 0xC0) == 0x80; }
+
+struct Decoded {
+  char32_t m_code;
+  // Прочитанные байты: вся последовательность или ее неверное начало
+  size_t m_size;
+};
+
+// Последовательность в начале data. data[0] не ASCII
+Decoded decode_utf8(const unsigned char *data, size_t size) noexcept {
+  unsigned char lead = data[0];
+  size_t length;
+  char32_t code;
+  // Допустимый диапазон второго байта исключает сокращенные формы,
+  // суррогаты D800..DFFF и значения больше U+10FFFF
+  unsigned char second_min = 0x80;
+  unsigned char second_max = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+    code = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    code = lead & 0x0F;
+    if (lead == 0xE0) {
+      second_min = 0xA0;
+    } else if (lead == 0xED) {
+      second_max = 0x9F;
+    }
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    code = lead & 0x07;
+    if (lead == 0xF0) {
+      second_min = 0x90;
+    } else if (lead == 0xF4) {
+      second_max = 0x8F;
+    }
+  } else {
+    return {replacement_char, 1};
+  }
+  for (size_t i = 1; i < length; ++i) {
+    if (i == size || (i == 1 ? data[1] < second_min || data[1] > second_max
+                             : !is_continuation(data[i]))) {
+      return {replacement_char, i};
+    }
+    code = code << 6 | (data[i] & 0x3F);
+  }
+  return {code, length};
+}
+
+// Символ UTF-16, начинающийся с pos. Сдвигает pos за символ
+template <class Char16>
+char32_t next_char(const Char16 *text, size_t size, size_t &pos) noexcept {
+  char32_t c = static_cast<char32_t>(text[pos++]);
+  if (c < 0xD800 || c > 0xDFFF) {
+    return c;
+  }
+  if (c <= 0xDBFF && pos < size) {
+    char32_t low = static_cast<char32_t>(text[pos]);
+    if (low >= 0xDC00 && low <= 0xDFFF) {
+      ++pos;
+      return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+    }
+  }
+  return replacement_char;
+}
+
+template <class Char16> Char16 *write_utf16(char32_t c, Char16 *out) noexcept {
+  if (c < 0x10000) {
+    *out++ = static_cast<Char16>(c);
+  } else {
+    c -= 0x10000;
+    *out++ = static_cast<Char16>(0xD800 + (c >> 10));
+    *out++ = static_cast<Char16>(0xDC00 + (c & 0x3FF));
+  }
+  return out;
+}
+
+char *write_utf8(char32_t c, char *out) noexcept {
+  if (c < 0x80) {
+    *out++ = static_cast<char>(c);
+  } else if (c < 0x800) {
+    *out++ = static_cast<char>(0xC0 | c >> 6);
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    *out++ = static_cast<char>(0xE0 | c >> 12);
+    *out++ = static_cast<char>(0x80 | (c >> 6 & 0x3F));
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xF0 | c >> 18);
+    *out++ = static_cast<char>(0x80 | (c >> 12 & 0x3F));
+    *out++ = static_cast<char>(0x80 | (c >> 6 & 0x3F));
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+  }
+  return out;
+}
+
+size_t utf8_char_size(char32_t c) noexcept {
+  return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+}
+
+size_t skip_ascii_scalar(const unsigned char *data, size_t size,
+                         size_t pos) noexcept {
+  while (pos < size && data[pos] < 0x80) {
+    ++pos;
+  }
+  return pos;
+}
+
+#ifdef WINENV_SIMD_X86
+unsigned count_trailing_zeros(unsigned mask) noexcept {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+// Без инструкции POPCNT, которой может не быть у процессора
+unsigned count_bits(unsigned mask) noexcept {
+  mask = mask - ((mask >> 1) & 0x55555555);
+  mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+  return (((mask + (mask >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+// Позиция первого байта не ASCII, начиная с pos. SSE2 есть в любом
+// процессоре x86-64
+size_t skip_ascii_sse2(const unsigned char *data, size_t size,
+                       size_t pos) noexcept {
+  for (; pos + 16 <= size; pos += 16) {
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos))));
+    if (mask != 0) {
+      return pos + count_trailing_zeros(mask);
+    }
+  }
+  return skip_ascii_scalar(data, size, pos);
+}
+
+WINENV_TARGET("avx2")
+size_t skip_ascii_avx2(const unsigned char *data, size_t size,
+                       size_t pos) noexcept {
+  for (; pos + 32 <= size; pos += 32) {
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos))));
+    if (mask != 0) {
+      return pos + count_trailing_zeros(mask);
+    }
+  }
+  return skip_ascii_sse2(data, size, pos);
+}
+
+// Начало блока из 16 байт, состоящее только из ASCII и верных двухбайтных
+// последовательностей (кириллица, латиница с диакритикой). data указывает
+// на начало символа. Возвращает длину начала до конца последнего целого
+// символа, n_chars - число символов в нем
+size_t check_short_prefix(const unsigned char *data,
+                          unsigned &n_chars) noexcept {
+  __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+  // Байты со знаком: 80..BF - от -128 до -65, C2..DF - от -62 до -33
+  unsigned ascii = ~static_cast<unsigned>(_mm_movemask_epi8(block)) & 0xFFFF;
+  unsigned continuations = static_cast<unsigned>(
+      _mm_movemask_epi8(_mm_cmplt_epi8(block, _mm_set1_epi8(-64))));
+  unsigned leads = static_cast<unsigned>(_mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(-63)),
+                    _mm_cmplt_epi8(block, _mm_set1_epi8(-32)))));
+  // Чужие байты, продолжения без начала пары и начала без продолжения
+  unsigned errors = (~(ascii | continuations | leads) |
+                     (continuations ^ leads << 1)) & 0xFFFF;
+  unsigned n_bytes = count_trailing_zeros(errors | 0x10000);
+  // Последовательность, начатая последним байтом, остается следующему блоку
+  if (n_bytes != 0 && (leads >> (n_bytes - 1) & 1)) {
+    --n_bytes;
+  }
+  n_chars = count_bits((ascii | leads) & ((1u << n_bytes) - 1));
+  return n_bytes;
+}
+
+// 8 кодовых единиц UTF-16
+template <class Char16> __m128i load_units(const Char16 *in) noexcept {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+}
+
+// Маска movemask: по 2 бита на единицу, все биты которой попали под bits
+unsigned units_without(__m128i units, short bits) noexcept {
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(
+      _mm_and_si128(units, _mm_set1_epi16(bits)), _mm_setzero_si128())));
+}
+#endif
+
+size_t skip_ascii(const unsigned char *data, size_t size, size_t pos) noexcept {
+#ifdef WINENV_SIMD_X86
+  static const bool use_avx2 = winenv::has_avx2();
+  return use_avx2 ? skip_ascii_avx2(data, size, pos)
+                  : skip_ascii_sse2(data, size, pos);
+#else
+  return skip_ascii_scalar(data, size, pos);
+#endif
+}
+
+template <class Char16>
+void decode(const unsigned char *data, size_t size, Char16 *out) noexcept {
+  static_assert(sizeof(Char16) == 2);
+  size_t pos = 0;
+  while (pos < size) {
+#ifdef WINENV_SIMD_X86
+    // Блоки проверяются векторно только с байта ASCII или начала двухбайтной
+    // последовательности: текст на других алфавитах их не содержит
+    if (pos + 16 <= size && data[pos] < 0xE0) {
+      __m128i block =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      if (_mm_movemask_epi8(block) == 0) {
+        // Байты ASCII расширяются нулями до 16 бит
+        __m128i zero = _mm_setzero_si128();
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                         _mm_unpacklo_epi8(block, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8),
+                         _mm_unpackhi_epi8(block, zero));
+        out += 16;
+        pos += 16;
+        continue;
+      }
+      unsigned n_chars;
+      if (size_t n_bytes = check_short_prefix(data + pos, n_chars)) {
+        // Значение пары считается на месте первого байта, затем единицы
+        // пишутся подряд без ветвлений
+        __m128i zero = _mm_setzero_si128();
+        __m128i next = _mm_srli_si128(block, 1);
+        __m128i units[2] = {_mm_unpacklo_epi8(block, zero),
+                            _mm_unpackhi_epi8(block, zero)};
+        __m128i next_units[2] = {_mm_unpacklo_epi8(next, zero),
+                                 _mm_unpackhi_epi8(next, zero)};
+        alignas(16) std::uint16_t values[16];
+        for (size_t half = 0; half < 2; ++half) {
+          __m128i pair = _mm_or_si128(
+              _mm_slli_epi16(_mm_and_si128(units[half], _mm_set1_epi16(0x1F)),
+                             6),
+              _mm_and_si128(next_units[half], _mm_set1_epi16(0x3F)));
+          __m128i is_ascii = _mm_cmplt_epi16(units[half], _mm_set1_epi16(0x80));
+          _mm_store_si128(reinterpret_cast<__m128i *>(values) + half,
+                          _mm_or_si128(_mm_and_si128(is_ascii, units[half]),
+                                       _mm_andnot_si128(is_ascii, pair)));
+        }
+        unsigned continuations = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmplt_epi8(block, _mm_set1_epi8(-64))));
+        // На месте второго байта пишется единица, которую затрет следующий
+        // символ. За последним байтом символа может не быть, поэтому он
+        // пишется только после проверки
+        size_t last = n_bytes - 1;
+        for (size_t i = 0; i < last; ++i) {
+          *out = static_cast<Char16>(values[i]);
+          out += ~continuations >> i & 1;
+        }
+        if (!(continuations >> last & 1)) {
+          *out++ = static_cast<Char16>(values[last]);
+        }
+        pos += n_bytes;
+        continue;
+      }
+    }
+#endif
+    if (data[pos] < 0x80) {
+      *out++ = static_cast<Char16>(data[pos++]);
+      continue;
+    }
+    Decoded decoded = decode_utf8(data + pos, size - pos);
+    out = write_utf16(decoded.m_code, out);
+    pos += decoded.m_size;
+  }
+}
+
+template <class Char16>
+size_t encoded_size(const Char16 *text, size_t size) noexcept {
+  static_assert(sizeof(Char16) == 2);
+  size_t n_bytes = 0;
+  size_t pos = 0;
+  while (pos < size) {
+#ifdef WINENV_SIMD_X86
+    if (pos + 8 <= size) {
+      __m128i units = load_units(text + pos);
+      if (units_without(units, static_cast<short>(0xFF80)) == 0xFFFF) {
+        n_bytes += 8;
+        pos += 8;
+        continue;
+      }
+      // Суррогаты D800..DFFF разбираются по одному
+      __m128i surrogates = _mm_cmpeq_epi16(
+          _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))),
+          _mm_set1_epi16(static_cast<short>(0xD800)));
+      if (_mm_movemask_epi8(surrogates) == 0) {
+        // 3 байта, минус по байту для единиц меньше 0x800 и меньше 0x80
+        unsigned n_short =
+            count_bits(units_without(units, static_cast<short>(0xF800))) / 2;
+        unsigned n_ascii =
+            count_bits(units_without(units, static_cast<short>(0xFF80))) / 2;
+        n_bytes += 24 - n_short - n_ascii;
+        pos += 8;
+        continue;
+      }
+    }
+#endif
+    n_bytes += utf8_char_size(next_char(text, size, pos));
+  }
+  return n_bytes;
+}
+
+template <class Char16>
+void encode(const Char16 *text, size_t size, char *out) noexcept {
+  static_assert(sizeof(Char16) == 2);
+  size_t pos = 0;
+  while (pos < size) {
+    if (text[pos] >= 0x80) {
+      out = write_utf8(next_char(text, size, pos), out);
+      continue;
+    }
+#ifdef WINENV_SIMD_X86
+    if (pos + 8 <= size) {
+      __m128i units = load_units(text + pos);
+      unsigned mask = units_without(units, static_cast<short>(0xFF80));
+      if (mask == 0xFFFF) {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out),
+                         _mm_packus_epi16(units, units));
+        out += 8;
+        pos += 8;
+        continue;
+      }
+      for (size_t end = pos + count_trailing_zeros(~mask) / 2; pos < end;) {
+        *out++ = static_cast<char>(text[pos++]);
+      }
+      continue;
+    }
+#endif
+    *out++ = static_cast<char>(text[pos++]);
+  }
+}
+} // namespace
+
+namespace winenv {
+size_t utf16_size(std::string_view utf8) noexcept {
+  auto data = reinterpret_cast<const unsigned char *>(utf8.data());
+  size_t size = utf8.size();
+  size_t n_units = 0;
+  size_t pos = 0;
+  while (pos < size) {
+#ifdef WINENV_SIMD_X86
+    if (pos + 16 <= size && data[pos] < 0xE0) {
+      unsigned n_chars;
+      if (size_t n_bytes = check_short_prefix(data + pos, n_chars)) {
+        n_units += n_chars;
+        pos += n_bytes;
+        if (n_chars == 16) { // Блок ASCII: вероятно, дальше тоже ASCII
+          size_t ascii_end = skip_ascii(data, size, pos);
+          n_units += ascii_end - pos;
+          pos = ascii_end;
+        }
+        continue;
+      }
+    }
+#endif
+    if (data[pos] < 0x80) {
+      ++n_units;
+      ++pos;
+      continue;
+    }
+    Decoded decoded = decode_utf8(data + pos, size - pos);
+    n_units += decoded.m_code >= 0x10000 ? 2 : 1;
+    pos += decoded.m_size;
+  }
+  return n_units;
+}
+
+void utf8_to_utf16(std::string_view utf8, char16_t *out) noexcept {
+  decode(reinterpret_cast<const unsigned char *>(utf8.data()), utf8.size(),
+         out);
+}
+
+size_t utf8_size(std::u16string_view utf16) noexcept {
+  return encoded_size(utf16.data(), utf16.size());
+}
+
+void utf16_to_utf8(std::u16string_view utf16, char *out) noexcept {
+  encode(utf16.data(), utf16.size(), out);
+}
+
+#ifdef _WIN32
+void utf8_to_utf16(std::string_view utf8, wchar_t *out) noexcept {
+  decode(reinterpret_cast<const unsigned char *>(utf8.data()), utf8.size(),
+         out);
+}
+
+size_t utf8_size(std::wstring_view utf16) noexcept {
+  return encoded_size(utf16.data(), utf16.size());
+}
+
+void utf16_to_utf8(std::wstring_view utf16, char *out) noexcept {
+  encode(utf16.data(), utf16.size(), out);
+}
+#endif
+} // namespace winenv
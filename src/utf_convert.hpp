@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace winenv {
+// Перекодирование UTF-8 <-> UTF-16 без зависимости от локали процесса. Длина
+// результата считается первым проходом, вторым проходом текст пишется в
+// память точного размера. Подряд идущие символы ASCII проверяются и
+// переписываются векторно. Неверные последовательности UTF-8 и непарные
+// суррогаты UTF-16 заменяются на U+FFFD: каждый неверный байт или
+// максимальная часть обрезанной последовательности - одной заменой.
+// Пример:
+// std::u16string wide(utf16_size(text), u'\0');
+// utf8_to_utf16(text, wide.data());
+
+// Длина текста UTF-8 в кодовых единицах UTF-16
+size_t utf16_size(std::string_view utf8) noexcept;
+// Пишет utf16_size(utf8) единиц в out
+void utf8_to_utf16(std::string_view utf8, char16_t *out) noexcept;
+// Длина текста UTF-16 в байтах UTF-8
+size_t utf8_size(std::u16string_view utf16) noexcept;
+// Пишет utf8_size(utf16) байт в out
+void utf16_to_utf8(std::u16string_view utf16, char *out) noexcept;
+
+#ifdef _WIN32
+// wchar_t в Windows - кодовая единица UTF-16
+void utf8_to_utf16(std::string_view utf8, wchar_t *out) noexcept;
+size_t utf8_size(std::wstring_view utf16) noexcept;
+void utf16_to_utf8(std::wstring_view utf16, char *out) noexcept;
+#endif
+} // namespace winenv
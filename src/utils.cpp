@@ -1,11 +1,32 @@
 #include "utils.hpp"
+#include "utf_convert.hpp"
 
+#include <atomic>
 #include <charconv>
 #include <system_error>
 
 namespace winenv {
 std::string WinError::get_as_string(long long int win_err_code) {
-  return {std::system_category().message(win_err_code)};
+  // Текст запрашивается в UTF-16, чтобы не зависеть от кодовой страницы
+  wchar_t *buffer{nullptr};
+  DWORD size = FormatMessageW(
+      FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
+          FORMAT_MESSAGE_IGNORE_INSERTS,
+      nullptr, static_cast<DWORD>(win_err_code), 0,
+      reinterpret_cast<wchar_t *>(&buffer), 0, nullptr);
+  if (size == 0) {
+    return "Unknown error";
+  }
+  std::wstring_view message{buffer, size};
+  // Системные сообщения заканчиваются переводом строки
+  while (!message.empty() &&
+         (message.back() == L'\n' || message.back() == L'\r' ||
+          message.back() == L' ')) {
+    message.remove_suffix(1);
+  }
+  std::string result = narrow_string(message);
+  LocalFree(buffer);
+  return result;
 }
 
 WinError::WinError(const std::string &str)
@@ -23,22 +44,14 @@ WrongLiteralFormat::WrongLiteralFormat(const std::string &str)
     : std::runtime_error(str) {}
 
 std::wstring widen_string(std::string_view narrow) {
-  size_t n_converted;
-  std::wstring wide;
-  wide.resize(narrow.size() + 1); // Место для конца строки
-  mbstowcs_s(&n_converted, wide.data(), wide.size(), narrow.data(),
-             narrow.size());
-  wide.resize(n_converted);
+  std::wstring wide(utf16_size(narrow), L'\0');
+  utf8_to_utf16(narrow, wide.data());
   return wide;
 }
 
 std::string narrow_string(std::wstring_view wide) {
-  size_t n_converted;
-  std::string narrow;
-  narrow.resize((wide.size() + 1) * sizeof(wchar_t));
-  wcstombs_s(&n_converted, narrow.data(), narrow.size(), wide.data(),
-             wide.size());
-  narrow.resize(n_converted);
+  std::string narrow(utf8_size(wide), '\0');
+  utf16_to_utf8(wide, narrow.data());
   return narrow;
 }
 
@@ -54,7 +67,14 @@ void get_unique_window_title(char *str, size_t size) {
   if (error_code2 != std::errc{}) {
     throw std::runtime_error("Failed to_chars(...) call");
   }
-  *last2 = '\0';
+  // Консоли пула создаются из другого потока и могут запуститься в тот же тик
+  static std::atomic<unsigned> counter{0};
+  *last2 = '_';
+  auto [last3, error_code3] = std::to_chars(last2 + 1, str + size, ++counter);
+  if (error_code3 != std::errc{}) {
+    throw std::runtime_error("Failed to_chars(...) call");
+  }
+  *last3 = '\0';
 }
 
 Path get_programm_path() {
@@ -68,31 +88,23 @@ Path get_programm_path() {
 Path get_cmd_path() { return {get_env_variable("COMSPEC")}; }
 
 std::string get_env_variable(std::string_view env_name) {
-  constexpr size_t supposed_variable_size{4096};
+  std::string name{env_name};
   std::string env_variable{};
-  env_variable.resize(supposed_variable_size);
-
-  // Возвращает 0 в случае ошибки или размер, необходимый для того, чтобы
-  // вместить строку. Если входной буфер достаточного размера, записывает строку
-  DWORD real_size = GetEnvironmentVariableA(
-      env_name.data(), env_variable.data(), supposed_variable_size);
-  if (real_size == 0) {
-    throw WinError(std::string{"Failed to get \""} + env_name.data() +
-                       "\" env variable",
-                   GetLastError());
-  } else if (supposed_variable_size < real_size) {
-    env_variable.resize(real_size);
-    DWORD written = GetEnvironmentVariableA(env_name.data(),
-                                            env_variable.data(), real_size);
-    if (written == 0) {
-      throw WinError(std::string{"Failed to get \""} + env_name.data() +
-                         "\" env variable",
-                     GetLastError());
+  // Без буфера возвращает размер вместе с завершающим нулем. Переменная может
+  // измениться между вызовами, поэтому повторяем, пока значение не поместится
+  DWORD required_size = GetEnvironmentVariableA(name.c_str(), nullptr, 0);
+  while (required_size != 0) {
+    env_variable.resize(required_size);
+    DWORD written = GetEnvironmentVariableA(name.c_str(), env_variable.data(),
+                                            required_size);
+    if (written < required_size) {
+      env_variable.resize(written);
+      return env_variable;
     }
-  } else {
-    env_variable.resize(real_size);
+    required_size = written;
   }
-  return env_variable;
+  throw WinError("Failed to get \"" + name + "\" env variable",
+                 GetLastError());
 }
 
 void set_env_variable(std::string_view name, std::string_view value) {
@@ -104,7 +116,8 @@ void set_env_variable(std::string_view name, std::string_view value) {
 }
 
 void invoke_message_box(std::string_view message) {
-  MessageBoxA(nullptr, message.data(), nullptr, MB_OK | MB_ICONINFORMATION);
+  MessageBoxW(nullptr, widen_string(message).c_str(), nullptr,
+              MB_OK | MB_ICONINFORMATION);
 }
 
 } // namespace winenv
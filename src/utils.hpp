@@ -80,56 +80,9 @@ bind_instance(ClassTy *instance, ReturnTy (ClassTy::*method)(Args...)) {
 std::wstring widen_string(std::string_view narrow);
 std::string narrow_string(std::wstring_view wide);
 
-// Создает широкую строку, которую можно передать как параметр командной строки
-// Размер преобразуемого типа данных должен быть кратным двум
-template <class Ty>
-typename std::enable_if<sizeof(Ty) % 2 != 1, std::wstring>::type
-cmd_arg_from(const Ty &data) {
-  // Диапазон символов [0, 32], не используемых в аргументах командной строки
-  // 32 - символ пробела - первый печатный символ - разделяет аргументы
-  // командной строки
-  static constexpr wchar_t not_used_beg = L'\0';
-  static constexpr wchar_t not_used_end = L'!'; // Символ следующий за пробелом
-  auto sy_data = reinterpret_cast<const wchar_t *>(&data);
-  std::wstring arg_str;
-  // Объем данных может увеличится до 2-х раз
-  arg_str.resize(sizeof(Ty) * 2);
-  size_t j = 0;
-  for (size_t i = 0; i < sizeof(Ty) / sizeof(wchar_t); ++i, ++j) {
-    if (not_used_beg <= sy_data[i] && sy_data[i] <= not_used_end) {
-      arg_str[j++] = not_used_end; // Отмечаем символ требующий раскодирования
-      arg_str[j] = sy_data[i] + not_used_end; // Закодированный символ допустим
-    } else {
-      arg_str[j] = sy_data[i];
-    }
-  }
-  arg_str.resize(j);
-  return arg_str;
-}
-
-// Создает объект из аргумента командой строки, полученного методом
-// cmd_arg_from. Вторым элементом возвращает позицию символа, на котором
-// завершилось преобразование
-template <class Ty>
-std::pair<Ty, size_t> cmd_arg_to(std::wstring_view arg_str) {
-  static constexpr wchar_t special_sy = L'!';
-  Ty data;
-  auto sy_data = reinterpret_cast<wchar_t *>(&data);
-  size_t j = 0;
-  for (size_t i = 0; arg_str[j] != L'\0' && arg_str[j] != L' ' &&
-                     i < sizeof(Ty) / sizeof(wchar_t);
-       ++i, ++j) {
-    if (arg_str[j] == special_sy) {
-      sy_data[i] = arg_str[++j] - special_sy;
-    } else {
-      sy_data[i] = arg_str[j];
-    }
-  }
-  return {data, j};
-}
-
 // Записывает в си-строку Id процесса и через разделитель '_' число тактов
-// процессора прошедших со старта системы. Ставит '\0' в конце
+// процессора прошедших со старта системы, затем номер вызова. Ставит '\0'
+// в конце
 void get_unique_window_title(char *str, size_t size);
 
 // Возвращает путь к текущему исполняемому файлу
@@ -0,0 +1,21 @@
+#include "versioned_header.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace winenv {
+void check_versioned_header(const VersionedHeader &header,
+                            std::uint32_t magic, size_t min_size,
+                            size_t available, const char *name) {
+  if (available < min_size || header.m_magic != magic) {
+    throw std::runtime_error(std::string{name} + " is corrupted");
+  }
+  // Более новые версии только дописывают поля в конец
+  if (header.m_version < 1 || header.m_size < min_size ||
+      header.m_size > available) {
+    throw std::runtime_error(std::string{name} + " version " +
+                             std::to_string(header.m_version) +
+                             " is not supported");
+  }
+}
+} // namespace winenv
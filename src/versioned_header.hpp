@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace winenv {
+// Начало структуры, которую без разбора читают процессы других версий:
+// из общей памяти или из командной строки. Новые поля дописываются только
+// в конец с увеличением версии, поэтому старый читатель берет известные ему
+// поля, а новый проверяет по m_size, записаны ли добавленные
+struct VersionedHeader {
+  std::uint32_t m_magic{0};
+  std::uint32_t m_version{0};
+  // sizeof структуры у записавшего процесса
+  std::uint32_t m_size{0};
+
+  // Записано ли поле, заканчивающееся на смещении field_end
+  bool has_field(size_t field_end) const noexcept {
+    return m_size >= field_end;
+  }
+};
+
+// Проверяет заголовок структуры name, от которой доступно available байт.
+// min_size - размер первой версии. Выбрасывает std::runtime_error, если
+// структура повреждена или записана несовместимой версией
+void check_versioned_header(const VersionedHeader &header,
+                            std::uint32_t magic, size_t min_size,
+                            size_t available, const char *name);
+} // namespace winenv
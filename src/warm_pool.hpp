@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace winenv {
+// Счетчики пула заранее подготовленных экземпляров
+struct WarmPoolStats {
+  size_t m_n_ready{0};
+  // Выдано из пула без ожидания
+  size_t m_n_hits{0};
+  // Пул был пуст, вызывающий создает экземпляр сам
+  size_t m_n_misses{0};
+  size_t m_n_created{0};
+  // Экземпляры, переставшие работать в пуле
+  size_t m_n_discarded{0};
+  size_t m_n_failures{0};
+  // Текст последней ошибки фабрики
+  std::string m_last_error;
+};
+
+// Пул заранее подготовленных экземпляров, например, скрытых дочерних
+// консолей. Фоновый поток создает экземпляры фабрикой, пока в пуле меньше
+// target_size готовых. acquire() не ждет: отдает готовый экземпляр или
+// std::nullopt. После ошибок фабрики повторные попытки откладываются, а
+// текст ошибки сохраняется в статистике. Member должен быть перемещаемым.
+// Пример:
+// WarmPool<PooledConsole> pool{2, [this] { return create_pooled_console(); },
+//                              [](PooledConsole &c) { return c.is_alive(); }};
+// if (std::optional<PooledConsole> console = pool.acquire()) { ... }
+template <class Member> class WarmPool {
+public:
+  using Factory = std::function<Member()>;
+  using IsAlive = std::function<bool(Member &)>;
+
+  WarmPool(size_t target_size, Factory factory, IsAlive is_alive = {})
+      : m_target_size{target_size}, m_factory{std::move(factory)},
+        m_is_alive{std::move(is_alive)} {
+    m_thread = std::thread{&WarmPool::refill_loop, this};
+  }
+  // Ждет завершения создаваемого экземпляра, поэтому долгую фабрику
+  // владелец прерывает до уничтожения пула. Готовые экземпляры
+  // уничтожаются вместе с пулом
+  ~WarmPool() {
+    {
+      std::lock_guard lock{m_mutex};
+      mf_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+  }
+  WarmPool(const WarmPool &other) = delete;
+  WarmPool &operator=(const WarmPool &other) = delete;
+
+  std::optional<Member> acquire() {
+    std::optional<Member> member;
+    {
+      std::lock_guard lock{m_mutex};
+      while (!m_ready.empty()) {
+        Member candidate = std::move(m_ready.front());
+        m_ready.pop_front();
+        if (!m_is_alive || m_is_alive(candidate)) {
+          member = std::move(candidate);
+          break;
+        }
+        ++m_stats.m_n_discarded;
+      }
+      ++(member ? m_stats.m_n_hits : m_stats.m_n_misses);
+    }
+    m_wake.notify_all();
+    return member;
+  }
+
+  WarmPoolStats get_stats() const {
+    std::lock_guard lock{m_mutex};
+    WarmPoolStats stats = m_stats;
+    stats.m_n_ready = m_ready.size();
+    return stats;
+  }
+
+private:
+  static constexpr std::chrono::milliseconds min_backoff{500};
+  static constexpr std::chrono::milliseconds max_backoff{30'000};
+
+  void refill_loop() {
+    std::chrono::milliseconds backoff{0};
+    std::unique_lock lock{m_mutex};
+    while (true) {
+      m_wake.wait(lock, [this] {
+        return mf_stopping || m_ready.size() < m_target_size;
+      });
+      if (mf_stopping) {
+        return;
+      }
+      // Фабрика может работать долго, пул в это время доступен
+      lock.unlock();
+      std::optional<Member> member;
+      std::string error;
+      try {
+        member = m_factory();
+      } catch (std::exception &err) {
+        error = err.what();
+      } catch (...) {
+        error = "Unknown error";
+      }
+      lock.lock();
+      if (member) {
+        m_ready.push_back(std::move(*member));
+        ++m_stats.m_n_created;
+        backoff = std::chrono::milliseconds{0};
+        continue;
+      }
+      ++m_stats.m_n_failures;
+      m_stats.m_last_error = std::move(error);
+      backoff = std::clamp(backoff * 2, min_backoff, max_backoff);
+      m_wake.wait_for(lock, backoff, [this] { return mf_stopping; });
+    }
+  }
+
+  const size_t m_target_size;
+  Factory m_factory;
+  IsAlive m_is_alive;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<Member> m_ready;
+  WarmPoolStats m_stats;
+  bool mf_stopping{false};
+  std::thread m_thread;
+};
+} // namespace winenv
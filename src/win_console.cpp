@@ -166,6 +166,13 @@ void WinConsole::set_position(int left, int top) {
   }
 }
 
+void WinConsole::show(bool f_show) {
+  ShowWindow(m_hwnd, f_show ? SW_SHOWNORMAL : SW_HIDE);
+  if (f_show) {
+    SetForegroundWindow(m_hwnd);
+  }
+}
+
 void WinConsole::set_color(ConsoleColor foreground, ConsoleColor background) {
   if (!SetConsoleTextAttribute(
           m_console_out_handle,
@@ -36,6 +36,8 @@ public:
                    short buf_height = 0);
   void resize_pxls(int width, int height);
   void set_position(int left, int top);
+  // Показывает окно на переднем плане или скрывает его
+  void show(bool f_show);
   void set_color(ConsoleColor foreground, ConsoleColor background);
   void set_term_color_table(const RgbColor new_table[n_term_colors]);
   void set_font(std::string_view font_name, short font_height);
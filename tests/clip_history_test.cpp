@@ -0,0 +1,147 @@
+#include "clip_history.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+
+std::vector<std::string> entries(const ClipHistory &history) {
+  std::vector<std::string> texts;
+  for (size_t i = 0; i < history.size(); ++i) {
+    texts.emplace_back(history.get(i));
+  }
+  return texts;
+}
+
+TEST(ClipHistory, KeepsNewestEntriesFirst) {
+  ClipHistory history{3, 1024};
+  EXPECT_TRUE(history.add("a"));
+  EXPECT_TRUE(history.add("bb"));
+  EXPECT_FALSE(history.add("bb"));
+  EXPECT_FALSE(history.add(""));
+  EXPECT_TRUE(history.add("ccc"));
+  EXPECT_TRUE(history.add("dddd"));
+  EXPECT_EQ(entries(history), (std::vector<std::string>{"dddd", "ccc", "bb"}));
+  EXPECT_EQ(history.bytes_used(), 9u);
+  EXPECT_EQ(history.get(3), "");
+  // Повтор старой записи переносит ее в начало
+  EXPECT_TRUE(history.add("bb"));
+  EXPECT_EQ(entries(history), (std::vector<std::string>{"bb", "dddd", "ccc"}));
+}
+
+// Новая запись вытесняет перекрытые ею и пропущенные в конце арены
+TEST(ClipHistory, RingEvictsOverlappedEntries) {
+  ClipHistory history{10, 10};
+  history.add("aaaa");
+  history.add("bbbb");
+  EXPECT_TRUE(history.add("ccc"));
+  EXPECT_EQ(entries(history), (std::vector<std::string>{"ccc", "bbbb"}));
+  // "dd" ложится за "ccc" и задевает "bbbb"
+  EXPECT_TRUE(history.add("dd"));
+  EXPECT_EQ(entries(history), (std::vector<std::string>{"dd", "ccc"}));
+  EXPECT_TRUE(history.add("f"));
+  EXPECT_EQ(entries(history), (std::vector<std::string>{"f", "dd", "ccc"}));
+  EXPECT_EQ(history.bytes_used(), 6u);
+  EXPECT_TRUE(history.add("eeeeeeeeee"));
+  EXPECT_EQ(entries(history), std::vector<std::string>{"eeeeeeeeee"});
+  EXPECT_FALSE(history.add("fffffffffff"));
+}
+
+// Записи после любых вытеснений совпадают с простой моделью истории
+TEST(ClipHistory, MatchesModelOnRandomTexts) {
+  std::mt19937 random{47};
+  ClipHistory history{8, 64};
+  std::vector<std::string> model;
+  for (int iter = 0; iter < 20'000; ++iter) {
+    std::string text(1 + random() % 20, static_cast<char>('a' + random() % 4));
+    bool f_added = history.add(text);
+    ASSERT_EQ(f_added, model.empty() || model.front() != text);
+    if (!f_added) {
+      continue;
+    }
+    model.erase(std::remove(model.begin(), model.end(), text), model.end());
+    model.insert(model.begin(), text);
+    std::vector<std::string> actual = entries(history);
+    ASSERT_LE(actual.size(), 8u);
+    // В истории - новейшие записи модели подряд
+    ASSERT_TRUE(std::equal(actual.begin(), actual.end(), model.begin()));
+    size_t bytes = 0;
+    for (const std::string &entry : actual) {
+      bytes += entry.size();
+    }
+    ASSERT_EQ(history.bytes_used(), bytes);
+    model.resize(actual.size());
+  }
+}
+
+TEST(ClipHistory, RestoresEntriesFromFile) {
+  TempDir dir;
+  {
+    ClipHistory history{5, 1024};
+    history.open_file(dir / "clip_history.bin");
+    EXPECT_EQ(history.size(), 0u);
+    for (std::string text : {"one", "two", "three", "two"}) {
+      history.add(text);
+    }
+  }
+  ClipHistory history{5, 1024};
+  history.open_file(dir / "clip_history.bin");
+  EXPECT_EQ(entries(history),
+            (std::vector<std::string>{"two", "three", "one"}));
+  // Меньшая история берет новейшие записи
+  ClipHistory small{2, 1024};
+  small.open_file(dir / "clip_history.bin");
+  EXPECT_EQ(entries(small), (std::vector<std::string>{"two", "three"}));
+}
+
+// Оборванная запись в конце файла отбрасывается вместе с остатком
+TEST(ClipHistory, DropsTruncatedTail) {
+  TempDir dir;
+  auto file = dir / "clip_history.bin";
+  {
+    ClipHistory history{5, 1024};
+    history.open_file(file);
+    history.add("first");
+    history.add("second");
+  }
+  std::string data = test::read_file(file);
+  test::write_file(file, data.substr(0, data.size() - 2));
+  ClipHistory history{5, 1024};
+  history.open_file(file);
+  EXPECT_EQ(entries(history), std::vector<std::string>{"first"});
+  history.add("third");
+
+  ClipHistory reopened{5, 1024};
+  reopened.open_file(file);
+  EXPECT_EQ(entries(reopened), (std::vector<std::string>{"third", "first"}));
+}
+
+TEST(ClipHistory, IgnoresForeignFile) {
+  TempDir dir;
+  test::write_file(dir / "clip_history.bin", "not a history file");
+  ClipHistory history{5, 1024};
+  history.open_file(dir / "clip_history.bin");
+  EXPECT_EQ(history.size(), 0u);
+}
+
+// Файл переписывается с одними действующими записями и не растет
+TEST(ClipHistory, CompactsGrowingFile) {
+  TempDir dir;
+  auto file = dir / "clip_history.bin";
+  ClipHistory history{4, 100};
+  history.open_file(file);
+  for (int i = 0; i < 1000; ++i) {
+    history.add("entry " + std::to_string(i));
+  }
+  EXPECT_LT(std::filesystem::file_size(file), 1000u);
+  ClipHistory reopened{4, 100};
+  reopened.open_file(file);
+  EXPECT_EQ(entries(reopened), entries(history));
+}
+} // namespace
+} // namespace winenv
@@ -0,0 +1,30 @@
+#include "clipboard_class.hpp"
+#include "test_utils.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace winenv {
+namespace {
+// Типичное содержимое буфера обмена. Путь проверяется через StatCache,
+// поэтому после первого раза файловая система не трогается
+void BM_ClassifyClipboard(benchmark::State &state) {
+  test::TempDir dir;
+  test::write_file(dir / "src/main.cpp", "int main() {}\n");
+  std::string paragraph;
+  while (paragraph.size() < 4000) {
+    paragraph += "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+  }
+  const std::string texts[] = {"https://example.org/search?q=winenv",
+                               "0123456789abcdef0123456789abcdef01234567",
+                               "src/main.cpp:120:7", paragraph,
+                               paragraph + "\n" + paragraph};
+  const std::string &text = texts[state.range(0)];
+  StatCache stats;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(classify_clipboard(text, dir.path(), stats));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ClassifyClipboard)->DenseRange(0, 4);
+} // namespace
+} // namespace winenv
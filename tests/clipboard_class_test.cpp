@@ -0,0 +1,92 @@
+#include "clipboard_class.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+using test::write_file;
+
+class ClassifyClipboard : public testing::Test {
+protected:
+  void SetUp() override {
+    write_file(m_dir / "src/main.cpp", "int main() {}\n");
+    write_file(m_dir / "my file.txt", "text\n");
+  }
+
+  ClipboardClass classify(EnvStringView text) {
+    return classify_clipboard(text, m_dir.path(), m_stats);
+  }
+  ClipboardKind kind(EnvStringView text) { return classify(text).m_kind; }
+
+  TempDir m_dir;
+  StatCache m_stats;
+};
+
+TEST_F(ClassifyClipboard, Urls) {
+  EXPECT_EQ(kind("https://example.org/a?b=c"), ClipboardKind::url);
+  EXPECT_EQ(kind("  ftp://host/file \n"), ClipboardKind::url);
+  EXPECT_EQ(kind("git+ssh://host/repo"), ClipboardKind::url);
+  EXPECT_EQ(kind("WWW.example.org"), ClipboardKind::url);
+  // Однобуквенная схема - диск Windows, пробел в адресе недопустим
+  EXPECT_EQ(kind("c://dir"), ClipboardKind::text);
+  EXPECT_EQ(kind("https://a b"), ClipboardKind::text);
+}
+
+TEST_F(ClassifyClipboard, Hashes) {
+  EXPECT_EQ(kind("3f2a9c1"), ClipboardKind::hash);
+  EXPECT_EQ(kind("0123456789abcdef0123456789abcdef01234567"),
+            ClipboardKind::hash);
+  EXPECT_EQ(kind("{123e4567-e89b-12d3-a456-426614174000}"),
+            ClipboardKind::hash);
+  // Только буквы или только цифры - скорее слово или число
+  EXPECT_EQ(kind("deadbeef"), ClipboardKind::text);
+  EXPECT_EQ(kind("12345678"), ClipboardKind::text);
+  EXPECT_EQ(kind("3f2a9c"), ClipboardKind::text);
+  EXPECT_EQ(kind(std::string(130, 'a') + "1"), ClipboardKind::text);
+}
+
+TEST_F(ClassifyClipboard, PathsAndLocations) {
+  ClipboardClass cls = classify("src/main.cpp");
+  EXPECT_EQ(cls.m_kind, ClipboardKind::path);
+  EXPECT_EQ(cls.m_path, m_dir / "src/main.cpp");
+  EXPECT_EQ(kind("\"  my file.txt \""), ClipboardKind::path);
+  EXPECT_EQ(kind((m_dir / "src").string()), ClipboardKind::path);
+  EXPECT_EQ(kind("src/missing.cpp"), ClipboardKind::text);
+
+  cls = classify("src/main.cpp:12");
+  EXPECT_EQ(cls.m_kind, ClipboardKind::location);
+  EXPECT_EQ(cls.m_path, m_dir / "src/main.cpp");
+  EXPECT_EQ(cls.m_line, 12u);
+  EXPECT_EQ(cls.m_column, 0u);
+  cls = classify("src/main.cpp:12:5:");
+  EXPECT_EQ(cls.m_line, 12u);
+  EXPECT_EQ(cls.m_column, 5u);
+  cls = classify("src/main.cpp(7,3)");
+  EXPECT_EQ(cls.m_kind, ClipboardKind::location);
+  EXPECT_EQ(cls.m_line, 7u);
+  EXPECT_EQ(cls.m_column, 3u);
+  // Номер строки не бывает нулевым и длиннее 9 цифр
+  EXPECT_EQ(kind("src/main.cpp:0"), ClipboardKind::text);
+  EXPECT_EQ(kind("src/main.cpp:1234567890"), ClipboardKind::text);
+}
+
+TEST_F(ClassifyClipboard, Text) {
+  EXPECT_EQ(kind(""), ClipboardKind::text);
+  EXPECT_EQ(kind("hello world"), ClipboardKind::text);
+  ClipboardClass cls = classify(" src/main.cpp\nsecond line");
+  EXPECT_EQ(cls.m_kind, ClipboardKind::text);
+  EXPECT_EQ(cls.m_text, "src/main.cpp\nsecond line");
+  EXPECT_EQ(kind("a|b.txt"), ClipboardKind::text);
+}
+
+TEST(ClipboardKindName, RoundTrip) {
+  for (size_t i = 0; i < g_n_clipboard_kinds; ++i) {
+    auto kind = static_cast<ClipboardKind>(i);
+    EXPECT_EQ(parse_clipboard_kind(clipboard_kind_name(kind)), kind);
+  }
+  EXPECT_EQ(parse_clipboard_kind("file"), std::nullopt);
+}
+} // namespace
+} // namespace winenv
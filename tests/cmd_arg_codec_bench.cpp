@@ -0,0 +1,37 @@
+#include "cmd_arg_codec.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+namespace winenv {
+namespace {
+std::vector<unsigned char> random_bytes(size_t size) {
+  std::mt19937 random{37};
+  std::vector<unsigned char> bytes(size);
+  for (unsigned char &byte : bytes) {
+    byte = static_cast<unsigned char>(random());
+  }
+  return bytes;
+}
+
+void BM_EncodeCmdArg(benchmark::State &state) {
+  std::vector<unsigned char> bytes = random_bytes(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(encode_cmd_arg(bytes.data(), bytes.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeCmdArg)->Arg(64)->Arg(4 << 10)->Arg(1 << 20);
+
+void BM_DecodeCmdArg(benchmark::State &state) {
+  std::vector<unsigned char> bytes = random_bytes(state.range(0));
+  std::wstring arg = encode_cmd_arg(bytes.data(), bytes.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_cmd_arg(arg));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeCmdArg)->Arg(64)->Arg(4 << 10)->Arg(1 << 20);
+} // namespace
+} // namespace winenv
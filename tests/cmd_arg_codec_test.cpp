@@ -0,0 +1,119 @@
+#include "cmd_arg_codec.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace winenv {
+namespace {
+constexpr wchar_t first_char = 0x4E00;
+constexpr wchar_t last_char = 0x5DFF;
+
+std::vector<unsigned char> random_bytes(std::mt19937 &random, size_t size) {
+  std::vector<unsigned char> bytes(size);
+  for (unsigned char &byte : bytes) {
+    byte = static_cast<unsigned char>(random());
+  }
+  return bytes;
+}
+
+// Размеры вокруг блоков SSSE3 по 12 байт и 8 символов
+TEST(CmdArgCodec, RoundTripsEverySmallSize) {
+  std::mt19937 random{37};
+  for (size_t size = 0; size < 200; ++size) {
+    std::vector<unsigned char> bytes = random_bytes(random, size);
+    std::wstring arg = encode_cmd_arg(bytes.data(), bytes.size());
+    for (wchar_t c : arg) {
+      ASSERT_GE(c, first_char);
+      ASSERT_LE(c, last_char);
+    }
+    auto [decoded, arg_end] = decode_cmd_arg(arg + L" tail");
+    EXPECT_EQ(decoded, bytes) << "size " << size;
+    EXPECT_EQ(arg_end, arg.size());
+  }
+}
+
+TEST(CmdArgCodec, RoundTripsLargeData) {
+  std::mt19937 random{1};
+  std::vector<unsigned char> bytes = random_bytes(random, 1 << 20);
+  std::wstring arg = encode_cmd_arg(bytes.data(), bytes.size());
+  EXPECT_EQ(decode_cmd_arg(arg).first, bytes);
+}
+
+TEST(CmdArgCodec, RejectsOtherVersion) {
+  std::wstring arg = encode_cmd_arg("abc", 3);
+  // Младшие 8 бит первого символа - номер версии
+  arg[0] += 1;
+  try {
+    decode_cmd_arg(arg);
+    FAIL() << "Version " << g_cmd_arg_version + 1 << " accepted";
+  } catch (std::runtime_error &err) {
+    EXPECT_NE(std::string{err.what()}.find("version"), std::string::npos);
+  }
+}
+
+// Любое изменение аргумента обнаруживается: раскодирование либо
+// выбрасывает исключение, либо возвращает исходные данные
+TEST(CmdArgCodec, FuzzMutationsAreDetected) {
+  std::mt19937 random{2024};
+  for (int iter = 0; iter < 20'000; ++iter) {
+    std::vector<unsigned char> bytes = random_bytes(random, random() % 100);
+    std::wstring arg = encode_cmd_arg(bytes.data(), bytes.size());
+    switch (random() % 4) {
+    case 0: // Другой символ из диапазона
+      arg[random() % arg.size()] =
+          static_cast<wchar_t>(first_char + random() % 0x1000);
+      break;
+    case 1: // Символ вне диапазона
+      arg[random() % arg.size()] = static_cast<wchar_t>(random() % 0x10000);
+      break;
+    case 2: // Обрезанный аргумент
+      arg.resize(random() % arg.size());
+      break;
+    default: // Лишние символы
+      arg += static_cast<wchar_t>(first_char + random() % 0x1000);
+      arg += static_cast<wchar_t>(first_char + random() % 0x1000);
+      break;
+    }
+    try {
+      EXPECT_EQ(decode_cmd_arg(arg).first, bytes) << "iteration " << iter;
+    } catch (std::runtime_error &) {
+    }
+  }
+}
+
+TEST(CmdArgCodec, FuzzRandomTextNeverCrashes) {
+  std::mt19937 random{7};
+  for (int iter = 0; iter < 20'000; ++iter) {
+    std::wstring arg(random() % 64, L'\0');
+    for (wchar_t &c : arg) {
+      c = random() % 2 ? static_cast<wchar_t>(first_char + random() % 0x1000)
+                       : static_cast<wchar_t>(random() % 0x10000);
+    }
+    try {
+      decode_cmd_arg(arg);
+    } catch (std::runtime_error &) {
+    }
+  }
+}
+
+struct Settings {
+  int m_width;
+  int m_height;
+};
+
+struct SettingsV2 {
+  Settings m_v1;
+  double m_scale;
+};
+
+TEST(CmdArgCodec, StructsAcceptLongerData) {
+  SettingsV2 newer{{80, 25}, 1.5};
+  auto [settings, arg_end] = cmd_arg_to<Settings>(cmd_arg_from(newer));
+  EXPECT_EQ(settings.m_width, 80);
+  EXPECT_EQ(settings.m_height, 25);
+  EXPECT_THROW(cmd_arg_to<SettingsV2>(cmd_arg_from(newer.m_v1)),
+               std::runtime_error);
+}
+} // namespace
+} // namespace winenv
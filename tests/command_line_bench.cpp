@@ -0,0 +1,41 @@
+#include "command_line.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace winenv {
+namespace {
+// Пути перетащенных файлов: половина с пробелами
+std::vector<ProcString> file_args(size_t n) {
+  std::vector<ProcString> args;
+  args.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    args.push_back((i % 2 ? "/home/user/my project/src/file_"
+                          : "/home/user/project/src/file_") +
+                   std::to_string(i) + ".cpp");
+  }
+  return args;
+}
+
+void BM_BuildCommandLine(benchmark::State &state) {
+  std::vector<ProcString> args = file_args(state.range(0));
+  size_t size = 0;
+  for (auto _ : state) {
+    ProcString cmd_line = build_command_line("/usr/bin/nvim", args);
+    size = cmd_line.size();
+    benchmark::DoNotOptimize(cmd_line);
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_BuildCommandLine)->Arg(10)->Arg(200);
+
+void BM_ParseCommandLine(benchmark::State &state) {
+  ProcString cmd_line =
+      build_command_line("/usr/bin/nvim", file_args(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(parse_command_line(cmd_line));
+  }
+  state.SetBytesProcessed(state.iterations() * cmd_line.size());
+}
+BENCHMARK(BM_ParseCommandLine)->Arg(10)->Arg(200);
+} // namespace
+} // namespace winenv
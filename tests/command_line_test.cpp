@@ -0,0 +1,238 @@
+#include "command_line.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+
+namespace winenv {
+namespace {
+using Args = std::vector<ProcString>;
+
+// Примеры разбора аргументов из документации Microsoft Visual C++
+// "Parsing C++ command-line arguments", совпадающие с CommandLineToArgvW
+TEST(ParseCommandLine, KnownCommandLineToArgvVectors) {
+  EXPECT_EQ(parse_command_line(R"(prog "a b c" d e)"),
+            (Args{"prog", "a b c", "d", "e"}));
+  EXPECT_EQ(parse_command_line(R"(prog "ab\"c" "\\" d)"),
+            (Args{"prog", R"(ab"c)", R"(\)", "d"}));
+  EXPECT_EQ(parse_command_line(R"(prog a\\\b d"e f"g h)"),
+            (Args{"prog", R"(a\\\b)", "de fg", "h"}));
+  EXPECT_EQ(parse_command_line(R"(prog a\\\"b c d)"),
+            (Args{"prog", R"(a\"b)", "c", "d"}));
+  EXPECT_EQ(parse_command_line(R"(prog a\\\\"b c" d e)"),
+            (Args{"prog", R"(a\\b c)", "d", "e"}));
+}
+
+TEST(ParseCommandLine, ProgramNameRules) {
+  EXPECT_EQ(parse_command_line(""), Args{});
+  // Обратная косая черта в имени программы не экранирует кавычку
+  EXPECT_EQ(parse_command_line(R"("C:\Program Files\x.exe" a)"),
+            (Args{R"(C:\Program Files\x.exe)", "a"}));
+  EXPECT_EQ(parse_command_line(R"(C:\dir\x.exe\ "a b")"),
+            (Args{R"(C:\dir\x.exe\)", "a b"}));
+  EXPECT_EQ(parse_command_line("prog \t a\t\tb  "), (Args{"prog", "a", "b"}));
+}
+
+TEST(BuildCommandLine, QuotesOnlyWhenNeeded) {
+  EXPECT_EQ(build_command_line("C:\\Program Files\\x.exe",
+                               {"a.txt", "my file", "", R"(dir\)"}),
+            R"("C:\Program Files\x.exe" a.txt "my file" "" dir\)");
+  EXPECT_EQ(build_command_line("x", {R"(say "hi")", R"(end\ )"}),
+            R"(x "say \"hi\"" "end\ ")");
+  EXPECT_EQ(build_command_line("x", {"tail\\ x\\"}), R"(x "tail\ x\\")");
+  EXPECT_THROW(build_command_line("a\"b", {}), std::invalid_argument);
+  EXPECT_THROW(build_command_line("x", {ProcString(g_max_command_line, 'a')}),
+               std::length_error);
+}
+
+TEST(BuildCommandLine, QuotedArgSizeMatchesBuiltLength) {
+  for (ProcString arg : {"", "a", "a b", R"(a"b)", R"(a\\"b)", R"(a\ )"}) {
+    EXPECT_EQ(build_command_line("x", {arg}).size(),
+              2 + quoted_arg_size(arg))
+        << arg;
+  }
+}
+
+// Как cmd.exe убирает ^ из строки, в которой все метасимволы экранированы.
+// Возвращает nullopt, если метасимвол остался без ^
+std::optional<ProcString> unescape_shell(const ProcString &cmd_line) {
+  const ProcString meta = "()%!^\"<>&|";
+  ProcString unescaped;
+  for (size_t i = 0; i < cmd_line.size(); ++i) {
+    if (cmd_line[i] == '^' && i + 1 < cmd_line.size()) {
+      unescaped += cmd_line[++i];
+    } else if (meta.find(cmd_line[i]) != ProcString::npos) {
+      return std::nullopt;
+    } else {
+      unescaped += cmd_line[i];
+    }
+  }
+  return unescaped;
+}
+
+TEST(BuildCommandLine, ShellQuotingEscapesCmdMetacharacters) {
+  EXPECT_EQ(build_command_line("cmd.exe",
+                               {"https://x.org/?q=a&type=code", "%PATH%"},
+                               ArgQuoting::shell),
+            "cmd.exe https://x.org/?q=a^&type=code ^%PATH^%");
+  EXPECT_EQ(build_command_line("cmd.exe", {"", "a b", R"(say "hi")"},
+                               ArgQuoting::shell),
+            R"(cmd.exe ^"^" ^"a b^" ^"say \^"hi\^"^")");
+
+  // После cmd.exe программа получает ту же строку, что и без оболочки
+  Args args{"a|b", "x > y", "(1)", "^", "!v!", R"(q\"<)", "tail\\ x\\"};
+  ProcString shell_line =
+      build_command_line("cmd.exe", args, ArgQuoting::shell);
+  std::optional<ProcString> unescaped = unescape_shell(shell_line);
+  ASSERT_TRUE(unescaped) << shell_line;
+  EXPECT_EQ(*unescaped, build_command_line("cmd.exe", args));
+  EXPECT_EQ(parse_command_line(*unescaped).size(), args.size() + 1);
+  for (const ProcString &arg : args) {
+    EXPECT_EQ(build_command_line("x", {arg}, ArgQuoting::shell).size(),
+              2 + quoted_arg_size(arg, ArgQuoting::shell))
+        << arg;
+  }
+}
+
+TEST(PlanArgBatches, ShellQuotingCountsCarets) {
+  // Каждый аргумент - 1 + 2 символа, с ^ - 1 + 4
+  Args args(4, "&&");
+  ArgBatchPlan plan = plan_arg_batches(0, args, 0, 13, ArgQuoting::shell);
+  ASSERT_EQ(plan.m_batches.size(), 2u);
+  EXPECT_EQ(plan.m_batches[0].m_count, 2u);
+  EXPECT_EQ(plan.m_batches[0].m_size, 10u);
+  EXPECT_EQ(plan_arg_batches(0, args, 0, 13).m_batches.size(), 1u);
+}
+
+// Случайные аргументы из символов, на которых ошибаются правила
+// экранирования, собираются и разбираются обратно без изменений
+TEST(CommandLineFuzz, BuildParseRoundTrip) {
+  const std::string alphabet = "ab \t\"\\\xC3\xA9";
+  const std::string program_alphabet = "ab \\.:";
+  std::mt19937 random{40};
+  auto random_string = [&](const std::string &chars, size_t max_size) {
+    ProcString text(random() % (max_size + 1), '\0');
+    for (char &c : text) {
+      c = chars[random() % chars.size()];
+    }
+    return text;
+  };
+  for (int iter = 0; iter < 50'000; ++iter) {
+    ProcString program = random_string(program_alphabet, 6);
+    if (program.empty()) {
+      program = "p";
+    }
+    Args args(random() % 6);
+    for (ProcString &arg : args) {
+      arg = random_string(alphabet, 8);
+    }
+    ProcString cmd_line = build_command_line(program, args);
+    Args expected{program};
+    expected.insert(expected.end(), args.begin(), args.end());
+    ASSERT_EQ(parse_command_line(cmd_line), expected) << cmd_line;
+  }
+}
+
+// Проверяет инварианты раскладки: пакеты непрерывны, идут по порядку и
+// вместе с пропущенными покрывают все аргументы, длина пакета совпадает с
+// длиной собранной строки, пакеты жадные
+void check_plan(const ProcString &program, const Args &args, size_t max_args,
+                size_t max_size) {
+  size_t base_size = build_command_line(program, {}).size();
+  ArgBatchPlan plan = plan_arg_batches(base_size, args, max_args, max_size);
+  std::vector<size_t> oversized;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (base_size + 1 + quoted_arg_size(args[i]) >= max_size) {
+      oversized.push_back(i);
+    }
+  }
+  ASSERT_EQ(plan.m_oversized, oversized);
+
+  size_t next = 0;
+  size_t next_oversized = 0;
+  for (size_t b = 0; b < plan.m_batches.size(); ++b) {
+    const ArgBatch &batch = plan.m_batches[b];
+    while (next_oversized < oversized.size() &&
+           oversized[next_oversized] == next) {
+      ++next;
+      ++next_oversized;
+    }
+    ASSERT_EQ(batch.m_first, next);
+    ASSERT_NE(batch.m_count, 0u);
+    ASSERT_TRUE(max_args == 0 || batch.m_count <= max_args);
+    Args slice(args.begin() + batch.m_first,
+               args.begin() + batch.m_first + batch.m_count);
+    ASSERT_EQ(batch.m_size, build_command_line(program, slice).size());
+    ASSERT_LT(batch.m_size, max_size);
+    next = batch.m_first + batch.m_count;
+    // Следующий аргумент не поместился в пакет, иначе пакет не жадный
+    if (next < args.size() && !std::binary_search(oversized.begin(),
+                                                  oversized.end(), next)) {
+      ASSERT_TRUE(
+          (max_args != 0 && batch.m_count == max_args) ||
+          batch.m_size + 1 + quoted_arg_size(args[next]) >= max_size)
+          << "batch " << b;
+    }
+  }
+  while (next_oversized < oversized.size() &&
+         oversized[next_oversized] == next) {
+    ++next;
+    ++next_oversized;
+  }
+  ASSERT_EQ(next, args.size());
+  ASSERT_EQ(next_oversized, oversized.size());
+}
+
+TEST(PlanArgBatches, EmptyArgs) {
+  ArgBatchPlan plan = plan_arg_batches(10, {});
+  EXPECT_TRUE(plan.m_batches.empty());
+  EXPECT_TRUE(plan.m_oversized.empty());
+}
+
+TEST(PlanArgBatches, SplitsAtSizeAndCountLimits) {
+  // "x aaaa aaaa aaaa" длиной 16 уже не короче max_size
+  Args args(5, "aaaa");
+  check_plan("x", args, 0, 16);
+  ArgBatchPlan plan = plan_arg_batches(1, args, 0, 16);
+  ASSERT_EQ(plan.m_batches.size(), 3u);
+  EXPECT_EQ(plan.m_batches[0].m_count, 2u);
+  EXPECT_EQ(plan.m_batches[0].m_size, 11u);
+  EXPECT_EQ(plan.m_batches[2].m_first, 4u);
+
+  plan = plan_arg_batches(1, args, 2);
+  ASSERT_EQ(plan.m_batches.size(), 3u);
+  EXPECT_EQ(plan.m_batches[2].m_count, 1u);
+}
+
+TEST(PlanArgBatches, OversizedArgEndsBatch) {
+  Args args{"a", "b", ProcString(20, 'c'), "d"};
+  check_plan("x", args, 0, 16);
+  ArgBatchPlan plan = plan_arg_batches(1, args, 0, 16);
+  EXPECT_EQ(plan.m_oversized, std::vector<size_t>{2});
+  ASSERT_EQ(plan.m_batches.size(), 2u);
+  EXPECT_EQ(plan.m_batches[0].m_count, 2u);
+  EXPECT_EQ(plan.m_batches[1].m_first, 3u);
+}
+
+TEST(PlanArgBatches, RandomPlansKeepInvariants) {
+  const std::string alphabet = "ab \"\\";
+  std::mt19937 random{41};
+  for (int iter = 0; iter < 5'000; ++iter) {
+    ProcString program(1 + random() % 8, 'p');
+    Args args(random() % 40);
+    for (ProcString &arg : args) {
+      arg.resize(random() % 30);
+      for (char &c : arg) {
+        c = alphabet[random() % alphabet.size()];
+      }
+    }
+    size_t max_args = random() % 6;
+    size_t max_size = program.size() + 1 + random() % 120;
+    ASSERT_NO_FATAL_FAILURE(check_plan(program, args, max_args, max_size))
+        << "iteration " << iter;
+  }
+}
+} // namespace
+} // namespace winenv
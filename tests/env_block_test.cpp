@@ -0,0 +1,47 @@
+#include "env_block.hpp"
+
+#include <gtest/gtest.h>
+
+namespace winenv {
+namespace {
+using namespace std::string_literals;
+
+EnvString block_of(const EnvString &entries) { return entries + '\0'; }
+
+TEST(EnvBlock, BuildMergesOverridesInNameOrder) {
+  EnvBlock env{EnvSnapshot{block_of("B=2\0D=4\0A=1\0"s)}};
+  env.set("C", "3");
+  env.set("D", "40");
+  env.unset("A");
+  EXPECT_EQ(*env.build(), "B=2\0C=3\0D=40\0"s);
+}
+
+TEST(SharedEnv, EmptyDeltaSharesBlock) {
+  SharedEnv env{std::make_shared<const EnvString>("A=1\0"s)};
+  EXPECT_EQ(env.with_delta({}), env.block());
+  EXPECT_EQ(env.snapshot().find("A"), EnvStringView{"1"});
+}
+
+TEST(SharedEnv, DeltaMatchesFreshBuild) {
+  EnvString base = "A=1\0C=3\0E=5\0"s;
+  EnvBlock::Delta delta{{"D", "4"}, {"A", ""}, {"E", "x"}, {"D", "44"}};
+  SharedEnv env{std::make_shared<const EnvString>(base)};
+
+  EnvBlock fresh{EnvSnapshot{block_of(base)}};
+  for (const auto &[name, value] : delta) {
+    fresh.set(name, value);
+  }
+  EXPECT_EQ(*env.with_delta(delta), *fresh.build());
+  EXPECT_EQ(*env.with_delta(delta), "C=3\0D=44\0E=x\0"s);
+  // Разбор базы не меняется переопределениями
+  EXPECT_EQ(env.snapshot().find("A"), EnvStringView{"1"});
+}
+
+TEST(SharedEnv, RemovingEverythingLeavesTerminatedBlock) {
+  SharedEnv env{std::make_shared<const EnvString>("A=1\0"s)};
+  SharedEnvBlock block = env.with_delta({{"A", ""}});
+  EXPECT_EQ(*block, EnvString(1, '\0'));
+  EXPECT_EQ(block->c_str()[1], '\0');
+}
+} // namespace
+} // namespace winenv
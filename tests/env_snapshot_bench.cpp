@@ -0,0 +1,77 @@
+#include "env_snapshot.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <string>
+
+namespace winenv {
+namespace {
+// Блок из n переменных с именами и значениями типичной длины
+EnvString make_block(size_t n) {
+  EnvString block;
+  for (size_t i = 0; i < n; ++i) {
+    block += "WINENV_BENCH_VAR_" + std::to_string(i * 7919 % n) +
+             "=C:\\Program Files\\app\\bin;C:\\Users\\user\\AppData\\" +
+             std::to_string(i) + '\0';
+  }
+  return block + '\0';
+}
+
+std::vector<EnvString> make_names(size_t n) {
+  std::vector<EnvString> names;
+  for (size_t i = 0; i < n; ++i) {
+    names.push_back("WINENV_BENCH_VAR_" + std::to_string(i));
+  }
+  return names;
+}
+
+void BM_SnapshotFromBlock(benchmark::State &state) {
+  EnvString block = make_block(state.range(0));
+  for (auto _ : state) {
+    EnvSnapshot env{block};
+    benchmark::DoNotOptimize(env.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SnapshotFromBlock)->Arg(50)->Arg(500);
+
+void BM_SnapshotCapture(benchmark::State &state) {
+  for (auto _ : state) {
+    EnvSnapshot env = EnvSnapshot::capture();
+    benchmark::DoNotOptimize(env.size());
+  }
+}
+BENCHMARK(BM_SnapshotCapture);
+
+void BM_SnapshotFind(benchmark::State &state) {
+  size_t n = state.range(0);
+  EnvSnapshot env{make_block(n)};
+  std::vector<EnvString> names = make_names(n);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(env.find(names[i]));
+    i = i + 1 == n ? 0 : i + 1;
+  }
+}
+BENCHMARK(BM_SnapshotFind)->Arg(50)->Arg(500);
+
+// getenv просматривает environ линейно
+void BM_Getenv(benchmark::State &state) {
+  size_t n = state.range(0);
+  std::vector<EnvString> names = make_names(n);
+  for (const EnvString &name : names) {
+    setenv(name.c_str(), "C:\\Program Files\\app\\bin", 1);
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::getenv(names[i].c_str()));
+    i = i + 1 == n ? 0 : i + 1;
+  }
+  for (const EnvString &name : names) {
+    unsetenv(name.c_str());
+  }
+}
+BENCHMARK(BM_Getenv)->Arg(50)->Arg(500);
+} // namespace
+} // namespace winenv
@@ -0,0 +1,91 @@
+#include "env_snapshot.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+namespace winenv {
+namespace {
+using namespace std::string_literals;
+
+EnvString block_of(const EnvString &entries) { return entries + '\0'; }
+
+std::vector<EnvString>
+names_of(const std::vector<EnvSnapshot::Variable> &vars) {
+  std::vector<EnvString> names;
+  for (const EnvSnapshot::Variable &var : vars) {
+    names.emplace_back(var.m_name);
+  }
+  return names;
+}
+
+TEST(EnvSnapshot, ParsesBlockInNameOrder) {
+  EnvSnapshot env{block_of("C=3\0A=1\0=C:=C:\\\0B=\0"s)};
+  ASSERT_EQ(env.size(), 4u);
+  std::vector<EnvString> entries;
+  for (EnvSnapshot::Variable var : env) {
+    entries.emplace_back(var.m_entry);
+  }
+  EXPECT_EQ(entries,
+            (std::vector<EnvString>{"=C:=C:\\", "A=1", "B=", "C=3"}));
+}
+
+TEST(EnvSnapshot, FindsByName) {
+  EnvSnapshot env{block_of("PATH=/bin\0HOME=/root\0EMPTY=\0=C:=C:\\\0"s)};
+  EXPECT_EQ(env.find("PATH"), EnvStringView{"/bin"});
+  EXPECT_EQ(env.find("HOME"), EnvStringView{"/root"});
+  EXPECT_EQ(env.find("EMPTY"), EnvStringView{});
+  EXPECT_EQ(env.find("=C:"), EnvStringView{"C:\\"});
+  EXPECT_EQ(env.find("PAT"), std::nullopt);
+  EXPECT_EQ(env.find("PATHS"), std::nullopt);
+  EXPECT_EQ(env.find(""), std::nullopt);
+  EXPECT_EQ(EnvSnapshot{}.find("PATH"), std::nullopt);
+}
+
+// При повторе имени остается последнее определение
+TEST(EnvSnapshot, LastDefinitionWins) {
+  EnvSnapshot env{block_of("A=1\0B=2\0A=3\0"s)};
+  EXPECT_EQ(env.size(), 2u);
+  EXPECT_EQ(env.find("A"), EnvStringView{"3"});
+}
+
+TEST(EnvSnapshot, CaptureMatchesGetenv) {
+  EnvSnapshot env = EnvSnapshot::capture();
+  ASSERT_NE(env.size(), 0u);
+  for (EnvSnapshot::Variable var : env) {
+    const char *value = std::getenv(EnvString{var.m_name}.c_str());
+    ASSERT_NE(value, nullptr) << EnvString{var.m_name};
+    EXPECT_EQ(var.m_value, EnvStringView{value});
+  }
+}
+
+TEST(EnvSnapshotDiff, AddedRemovedAndChanged) {
+  EnvSnapshot older{block_of("A=1\0B=2\0C=3\0E=5\0"s)};
+  EnvSnapshot newer{block_of("B=2\0C=30\0D=4\0E=\0F=6\0"s)};
+  EnvSnapshot::Difference difference = older.diff(newer);
+  EXPECT_EQ(names_of(difference.m_added), (std::vector<EnvString>{"D", "F"}));
+  EXPECT_EQ(difference.m_added[0].m_value, "4");
+  EXPECT_EQ(names_of(difference.m_removed), std::vector<EnvString>{"A"});
+  EXPECT_EQ(difference.m_removed[0].m_entry, "A=1");
+  ASSERT_EQ(difference.m_changed.size(), 2u);
+  EXPECT_EQ(difference.m_changed[0].first.m_entry, "C=3");
+  EXPECT_EQ(difference.m_changed[0].second.m_entry, "C=30");
+  // Пустое значение - изменение, а не удаление
+  EXPECT_EQ(difference.m_changed[1].first.m_entry, "E=5");
+  EXPECT_EQ(difference.m_changed[1].second.m_entry, "E=");
+}
+
+TEST(EnvSnapshotDiff, EqualAndEmptySnapshots) {
+  EnvSnapshot env{block_of("A=1\0B=2\0"s)};
+  EnvSnapshot::Difference same = env.diff(EnvSnapshot{block_of("B=2\0A=1\0"s)});
+  EXPECT_TRUE(same.m_added.empty());
+  EXPECT_TRUE(same.m_removed.empty());
+  EXPECT_TRUE(same.m_changed.empty());
+
+  EXPECT_EQ(names_of(EnvSnapshot{}.diff(env).m_added),
+            (std::vector<EnvString>{"A", "B"}));
+  EXPECT_EQ(names_of(env.diff(EnvSnapshot{}).m_removed),
+            (std::vector<EnvString>{"A", "B"}));
+}
+} // namespace
+} // namespace winenv
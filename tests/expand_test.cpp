@@ -0,0 +1,142 @@
+#include "expand.hpp"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+namespace winenv {
+namespace {
+using Names = std::vector<std::string_view>;
+
+// Значения из словаря, остальные имена неизвестны
+ExpandTemplate::Lookup lookup_in(const std::map<std::string, std::string,
+                                                std::less<>> &values) {
+  return [&values](std::string_view name) -> std::optional<std::string_view> {
+    auto iter = values.find(name);
+    if (iter == values.end()) {
+      return std::nullopt;
+    }
+    return std::string_view{iter->second};
+  };
+}
+
+TEST(ExpandTemplate, ParsesEverySegmentForm) {
+  ExpandTemplate tmpl{"${root}/%NAME%: 100%% of 5% $x ${a}${b}"};
+  EXPECT_EQ(tmpl.dependencies(), (Names{"root", "NAME", "a", "b"}));
+  EXPECT_FALSE(tmpl.is_literal());
+  std::map<std::string, std::string, std::less<>> values{
+      {"root", "/opt"}, {"NAME", "nvim"}, {"a", "A"}, {"b", "B"}};
+  EXPECT_EQ(tmpl.render(lookup_in(values)), "/opt/nvim: 100% of 5% $x AB");
+}
+
+TEST(ExpandTemplate, LiteralsOnly) {
+  for (std::string_view raw : {"", "plain", "%%", "50%", "$", "$name", "%"}) {
+    ExpandTemplate tmpl{raw};
+    EXPECT_TRUE(tmpl.is_literal()) << raw;
+    EXPECT_TRUE(tmpl.dependencies().empty()) << raw;
+  }
+  std::map<std::string, std::string, std::less<>> none;
+  EXPECT_EQ(ExpandTemplate{"%%"}.render(lookup_in(none)), "%");
+  // Одиночный '%', как и в cmd.exe, остается литералом
+  EXPECT_EQ(ExpandTemplate{"a % b"}.render(lookup_in(none)), "a % b");
+  EXPECT_EQ(ExpandTemplate{"a$b"}.render(lookup_in(none)), "a$b");
+}
+
+TEST(ExpandTemplate, MalformedBracesThrow) {
+  EXPECT_THROW(ExpandTemplate{"${root"}, ExpansionError);
+  EXPECT_THROW(ExpandTemplate{"a${}b"}, ExpansionError);
+}
+
+TEST(ExpandTemplate, MissingVariableThrows) {
+  std::map<std::string, std::string, std::less<>> values{{"known", "1"}};
+  ExpandTemplate tmpl{"${known}%unknown%"};
+  try {
+    tmpl.render(lookup_in(values));
+    FAIL() << "Unknown variable is rendered";
+  } catch (ExpansionError &err) {
+    EXPECT_STREQ(err.what(), "[Expansion error] Unknown variable \"unknown\"");
+  }
+}
+
+// Зависимости раскрываются раньше зависящих от них переменных независимо
+// от порядка определения
+TEST(VarExpander, ResolvesInTopologicalOrder) {
+  VarExpander vars;
+  vars.define("bin", "${apps}/bin");
+  vars.define("apps", "${root}/apps");
+  vars.define("nvim", "${bin}/nvim.exe ${apps}");
+  vars.define_literal("root", "C:/flash");
+  EXPECT_EQ(vars.get("nvim"), "C:/flash/apps/bin/nvim.exe C:/flash/apps");
+  EXPECT_EQ(vars.get("bin"), "C:/flash/apps/bin");
+  EXPECT_EQ(vars.expand("%root%%%"), "C:/flash%");
+
+  // Переопределение сбрасывает запомненные значения
+  vars.define_literal("root", "D:");
+  EXPECT_EQ(vars.get("nvim"), "D:/apps/bin/nvim.exe D:/apps");
+}
+
+TEST(VarExpander, TwoNodeCycleThrows) {
+  VarExpander vars;
+  vars.define("a", "${b}/x");
+  vars.define("b", "%a%/y");
+  try {
+    vars.get("a");
+    FAIL() << "Cycle is not detected";
+  } catch (ExpansionError &err) {
+    EXPECT_STREQ(err.what(),
+                 "[Expansion error] Cyclic variable dependency: a -> b -> a");
+  }
+  EXPECT_THROW(vars.resolve_all(), ExpansionError);
+  // После разрыва цикла значения раскрываются
+  vars.define("b", "y");
+  EXPECT_EQ(vars.get("a"), "y/x");
+}
+
+TEST(VarExpander, SelfReferenceThrows) {
+  VarExpander vars;
+  vars.define("path", "${path};C:/bin");
+  try {
+    vars.get("path");
+    FAIL() << "Self reference is not detected";
+  } catch (ExpansionError &err) {
+    EXPECT_STREQ(err.what(),
+                 "[Expansion error] Cyclic variable dependency: path -> path");
+  }
+}
+
+// fallback вызывается один раз на имя, в том числе для неизвестных имен
+TEST(VarExpander, FallbackIsMemoized) {
+  std::map<std::string, int> n_calls;
+  VarExpander vars{[&n_calls](std::string_view name)
+                       -> std::optional<std::string> {
+    ++n_calls[std::string{name}];
+    if (name == "HOME") {
+      return "/home/user";
+    }
+    return std::nullopt;
+  }};
+  vars.define("cfg", "%HOME%/.config");
+  vars.define("cache", "${HOME}/.cache");
+  EXPECT_EQ(vars.get("cfg"), "/home/user/.config");
+  EXPECT_EQ(vars.get("cache"), "/home/user/.cache");
+  EXPECT_EQ(vars.expand("%HOME%"), "/home/user");
+  EXPECT_THROW(vars.expand("%MISSING%"), ExpansionError);
+  EXPECT_THROW(vars.expand("%MISSING%"), ExpansionError);
+  EXPECT_EQ(n_calls, (std::map<std::string, int>{{"HOME", 1}, {"MISSING", 1}}));
+
+  // Определенная переменная закрывает одноименную из fallback
+  vars.define_literal("HOME", "/root");
+  EXPECT_EQ(vars.get("cfg"), "/root/.config");
+  EXPECT_EQ(n_calls["HOME"], 1);
+}
+
+TEST(VarExpander, MissingVariableThrows) {
+  VarExpander vars;
+  vars.define("a", "${nowhere}");
+  EXPECT_THROW(vars.get("a"), ExpansionError);
+  EXPECT_THROW(vars.get("undefined"), ExpansionError);
+  EXPECT_FALSE(vars.contains("undefined"));
+  EXPECT_TRUE(vars.contains("a"));
+}
+} // namespace
+} // namespace winenv
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Stand-in for `nvim --listen <socket>` in NvimClient tests.
+
+Serves one connection on a unix socket with msgpack-RPC. Every
+nvim_command request is appended to the log file, one command per line.
+Commands starting with "bad" fail the way Neovim reports an unknown Ex
+command. Modes:
+  normal - a notification first, then responses in reverse order,
+           sent a few bytes at a time
+  silent - read requests and never answer
+  close  - close the connection after the first read
+Only the msgpack types used by the client are supported, so the script
+needs nothing beyond the standard library.
+"""
+
+import os
+import socket
+import struct
+import sys
+
+
+def encode(value):
+    if value is None:
+        return b"\xc0"
+    if isinstance(value, bool):
+        return b"\xc3" if value else b"\xc2"
+    if isinstance(value, int):
+        if value < 0x80:
+            return bytes([value])
+        for tag, fmt, limit in ((0xCC, ">B", 1 << 8), (0xCD, ">H", 1 << 16),
+                                (0xCE, ">I", 1 << 32)):
+            if value < limit:
+                return bytes([tag]) + struct.pack(fmt, value)
+        return b"\xcf" + struct.pack(">Q", value)
+    if isinstance(value, str):
+        data = value.encode()
+        if len(data) < 32:
+            return bytes([0xA0 | len(data)]) + data
+        if len(data) < 1 << 8:
+            return b"\xd9" + struct.pack(">B", len(data)) + data
+        return b"\xda" + struct.pack(">H", len(data)) + data
+    if isinstance(value, list):
+        if len(value) < 16:
+            head = bytes([0x90 | len(value)])
+        else:
+            head = b"\xdc" + struct.pack(">H", len(value))
+        return head + b"".join(encode(item) for item in value)
+    raise TypeError(type(value))
+
+
+class Incomplete(Exception):
+    pass
+
+
+def decode(data, pos):
+    """Returns (value, position after the value)."""
+
+    def take(size):
+        if pos + 1 + size > len(data):
+            raise Incomplete
+        return data[pos + 1:pos + 1 + size]
+
+    if pos >= len(data):
+        raise Incomplete
+    tag = data[pos]
+    if tag < 0x80:
+        return tag, pos + 1
+    if tag == 0xC0:
+        return None, pos + 1
+    if tag in (0xC2, 0xC3):
+        return tag == 0xC3, pos + 1
+    uints = {0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q"}
+    if tag in uints:
+        size = struct.calcsize(uints[tag])
+        return struct.unpack(uints[tag], take(size))[0], pos + 1 + size
+    if 0xA0 <= tag <= 0xBF or tag in (0xD9, 0xDA, 0xDB):
+        if tag <= 0xBF:
+            length, start = tag & 0x1F, pos + 1
+        else:
+            fmt = {0xD9: ">B", 0xDA: ">H", 0xDB: ">I"}[tag]
+            size = struct.calcsize(fmt)
+            length, start = struct.unpack(fmt, take(size))[0], pos + 1 + size
+        if start + length > len(data):
+            raise Incomplete
+        return data[start:start + length].decode(), start + length
+    if 0x90 <= tag <= 0x9F or tag in (0xDC, 0xDD):
+        if tag <= 0x9F:
+            length, pos = tag & 0x0F, pos + 1
+        else:
+            fmt = ">H" if tag == 0xDC else ">I"
+            size = struct.calcsize(fmt)
+            length, pos = struct.unpack(fmt, take(size))[0], pos + 1 + size
+        items = []
+        for _ in range(length):
+            item, pos = decode(data, pos)
+            items.append(item)
+        return items, pos
+    raise ValueError("unsupported msgpack tag 0x%02x" % tag)
+
+
+def respond(request):
+    _, msg_id, method, params = request
+    command = params[0] if method == "nvim_command" and params else ""
+    if command.startswith("bad"):
+        error = [0, "Vim:E492: Not an editor command: " + command]
+        return [1, msg_id, error, None]
+    return [1, msg_id, None, None]
+
+
+def serve(conn, log_file, mode):
+    data = b""
+    requests = []
+    while True:
+        chunk = conn.recv(4096)
+        if not chunk or mode == "close":
+            return
+        data += chunk
+        pos = 0
+        try:
+            while True:
+                request, pos = decode(data, pos)
+                requests.append(request)
+                data = data[pos:]
+                pos = 0
+        except Incomplete:
+            pass
+        with open(log_file, "a", encoding="utf-8") as log:
+            for request in requests:
+                log.write(request[3][0] + "\n")
+        if mode == "silent":
+            continue
+        reply = encode([2, "nvim_buf_changedtick_event", []])
+        for request in reversed(requests):
+            reply += encode(respond(request))
+        requests.clear()
+        for start in range(0, len(reply), 7):
+            conn.sendall(reply[start:start + 7])
+
+
+def main():
+    socket_path, log_file, mode = sys.argv[1:4]
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    # The test waits for the socket file, so it appears only after listen
+    server.bind(socket_path + ".tmp")
+    server.listen(1)
+    os.rename(socket_path + ".tmp", socket_path)
+    conn, _ = server.accept()
+    with conn:
+        serve(conn, log_file, mode)
+
+
+if __name__ == "__main__":
+    main()
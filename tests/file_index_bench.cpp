@@ -0,0 +1,86 @@
+#include "file_index.hpp"
+#include "test_utils.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+
+namespace winenv {
+namespace {
+// Дерево из n_files пустых файлов: по 1000 в директории, по 100
+// директорий в каждой верхней. Строится один раз на размер: миллион
+// файлов создается несколько секунд
+const test::TempDir &file_tree(size_t n_files) {
+  static std::map<size_t, std::unique_ptr<test::TempDir>> trees;
+  std::unique_ptr<test::TempDir> &tree = trees[n_files];
+  if (tree) {
+    return *tree;
+  }
+  tree = std::make_unique<test::TempDir>();
+  const char *extensions[] = {".cpp", ".hpp", ".py", ".md"};
+  for (size_t dir = 0; dir * 1000 < n_files; ++dir) {
+    auto leaf = *tree / ("module_" + std::to_string(dir / 100)) /
+                ("component_" + std::to_string(dir % 100));
+    std::filesystem::create_directories(leaf);
+    for (size_t file = 0; file < 1000 && dir * 1000 + file < n_files;
+         ++file) {
+      std::ofstream{leaf / ("source_file_" + std::to_string(file) +
+                            extensions[file % 4])};
+    }
+  }
+  return *tree;
+}
+
+void BM_FileIndexBuild(benchmark::State &state) {
+  const test::TempDir &tree = file_tree(state.range(0));
+  size_t memory = 0;
+  for (auto _ : state) {
+    FileIndex index = FileIndex::build({tree.path()}, FileFilter{});
+    memory = index.memory_size();
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["bytes_per_file"] =
+      static_cast<double>(memory) / static_cast<double>(state.range(0));
+}
+BENCHMARK(BM_FileIndexBuild)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_FileIndexLoad(benchmark::State &state) {
+  const test::TempDir &tree = file_tree(state.range(0));
+  test::TempDir dir;
+  FileIndex::build({tree.path()}, FileFilter{}).save(dir / "file_index.bin");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(FileIndex::load(dir / "file_index.bin"));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FileIndexLoad)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Набор запроса по букве: каждый следующий запрос ищется среди совпадений
+// прошлого. Время - на весь набор
+void BM_FileIndexTypeQuery(benchmark::State &state) {
+  const test::TempDir &tree = file_tree(state.range(0));
+  FileIndex index = FileIndex::build({tree.path()}, FileFilter{});
+  const std::string query = "comp7src42hpp";
+  for (auto _ : state) {
+    for (size_t size = 1; size <= query.size(); ++size) {
+      benchmark::DoNotOptimize(index.find(query.substr(0, size), 20));
+    }
+    // Несвязанный запрос сбрасывает запомненные совпадения
+    benchmark::DoNotOptimize(index.find("zz", 20));
+  }
+}
+BENCHMARK(BM_FileIndexTypeQuery)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+} // namespace
+} // namespace winenv
@@ -0,0 +1,57 @@
+#include "file_index.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+using test::write_file;
+
+TEST(FileIndex, BuildsFindsAndReloads) {
+  TempDir dir;
+  write_file(dir / "src/root_app.cpp");
+  write_file(dir / "src/root_app.hpp");
+  write_file(dir / "src/process.cpp");
+  write_file(dir / "build/root_app.o");
+  write_file(dir / "readme.md");
+  FileFilter filter{{}, {"build"}};
+  FileIndex index = FileIndex::build({dir.path()}, filter);
+  EXPECT_EQ(index.size(), 4u);
+  EXPECT_FALSE(index.is_truncated());
+
+  std::vector<FileMatch> matches = index.find("rapp", 10);
+  ASSERT_EQ(matches.size(), 2u);
+  EXPECT_EQ(index.path(matches[0].m_file).parent_path(), dir / "src");
+  EXPECT_EQ(index.name(matches[0].m_file).substr(0, 8), "root_app");
+
+  index.save(dir / "file_index.bin");
+  FileIndex loaded = FileIndex::load(dir / "file_index.bin");
+  EXPECT_EQ(loaded.size(), index.size());
+  EXPECT_EQ(loaded.roots(), index.roots());
+  std::vector<FileMatch> loaded_matches = loaded.find("rapp", 10);
+  ASSERT_EQ(loaded_matches.size(), matches.size());
+  for (size_t i = 0; i < matches.size(); ++i) {
+    EXPECT_EQ(loaded.relative_path(loaded_matches[i].m_file),
+              index.relative_path(matches[i].m_file));
+  }
+}
+
+// Ошибка чтения директории в потоке обхода не завершает программу, а
+// оставляет корень без файлов
+TEST(FileIndex, UnreadableRootIsEmpty) {
+  TempDir dir;
+  write_file(dir / "a.txt");
+  FileIndex index = FileIndex::build({dir / "missing", dir.path()}, {});
+  EXPECT_EQ(index.size(), 1u);
+  EXPECT_EQ(index.path(0), dir / "a.txt");
+}
+
+TEST(FileIndex, LoadsCorruptFileAsEmpty) {
+  TempDir dir;
+  EXPECT_EQ(FileIndex::load(dir / "none.bin").size(), 0u);
+  write_file(dir / "bad.bin", "winenv-files\t2\ngarbage");
+  EXPECT_EQ(FileIndex::load(dir / "bad.bin").size(), 0u);
+}
+} // namespace
+} // namespace winenv
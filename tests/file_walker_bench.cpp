@@ -0,0 +1,63 @@
+#include "file_walker.hpp"
+#include "test_utils.hpp"
+#include "text_sniff.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace winenv {
+namespace {
+// Дерево исходников: 20 директорий по 10 поддиректорий, в каждой 20
+// текстовых файлов и 5 двоичных, плюс исключаемая директория build
+const test::TempDir &source_tree() {
+  static test::TempDir dir;
+  static bool f_created = false;
+  if (!f_created) {
+    std::string text(2000, 'x');
+    std::string binary(2000, '\0');
+    for (int top = 0; top < 20; ++top) {
+      for (int sub = 0; sub < 10; ++sub) {
+        auto leaf = dir / ("m" + std::to_string(top)) /
+                    ("d" + std::to_string(sub));
+        for (int f = 0; f < 20; ++f) {
+          test::write_file(leaf / ("f" + std::to_string(f) + ".cpp"), text);
+        }
+        for (int f = 0; f < 5; ++f) {
+          test::write_file(leaf / ("o" + std::to_string(f) + ".cpp"), binary);
+        }
+        test::write_file(leaf / "build" / "gen.cpp", text);
+      }
+    }
+    f_created = true;
+  }
+  return dir;
+}
+
+void BM_WalkTextFiles(benchmark::State &state) {
+  const test::TempDir &dir = source_tree();
+  FileFilter filter{{"*.cpp"}, {"build"}};
+  size_t n_files = 0;
+  for (auto _ : state) {
+    WalkResult result = walk_text_files({dir.path()}, filter);
+    n_files = result.m_stats.m_n_files;
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * n_files);
+}
+BENCHMARK(BM_WalkTextFiles)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Блок ASCII проверяется векторно, блок с кириллицей - по символам
+void BM_IsTextBlock(benchmark::State &state) {
+  std::string block;
+  while (block.size() < g_sniff_block_size) {
+    block += state.range(0) ? "// \xD0\xBA\xD0\xBE\xD0\xB4\n" : "int x;\n";
+  }
+  block.resize(g_sniff_block_size);
+  auto data = reinterpret_cast<const unsigned char *>(block.data());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(is_text_block(data, block.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * block.size());
+}
+BENCHMARK(BM_IsTextBlock)->Arg(0)->Arg(1);
+} // namespace
+} // namespace winenv
@@ -0,0 +1,47 @@
+#include "file_walker.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+using test::write_file;
+
+TEST(WalkTextFiles, FiltersAndSniffsFiles) {
+  TempDir dir;
+  write_file(dir / "a.cpp", "int main() {}\n");
+  write_file(dir / "src/b.hpp", "#pragma once\n");
+  write_file(dir / "src/blob.cpp", std::string_view{"\0\1\2", 3});
+  write_file(dir / "build/c.cpp", "int c;\n");
+  write_file(dir / "notes.txt", "text\n");
+  FileFilter filter{{"*.cpp", "*.hpp"}, {"build"}};
+  WalkResult result = walk_text_files({dir.path()}, filter);
+  EXPECT_EQ(result.m_files, (std::vector<std::filesystem::path>{
+                                dir / "a.cpp", dir / "src/b.hpp"}));
+  EXPECT_EQ(result.m_stats.m_n_binary, 1u);
+  EXPECT_EQ(result.m_stats.m_n_excluded, 2u);
+  EXPECT_EQ(result.m_stats.m_n_skipped, 0u);
+}
+
+// Ошибка чтения директории учитывается в статистике, а не прерывает обход
+TEST(WalkTextFiles, UnreadableDirIsSkipped) {
+  TempDir dir;
+  write_file(dir / "a.txt", "a\n");
+  WalkResult result =
+      walk_text_files({dir / "missing", dir.path()}, FileFilter{});
+  EXPECT_EQ(result.m_files, std::vector<std::filesystem::path>{dir / "a.txt"});
+  EXPECT_EQ(result.m_stats.m_n_skipped, 1u);
+}
+
+TEST(WalkTextFiles, StopsAtMaxFiles) {
+  TempDir dir;
+  for (int i = 0; i < 10; ++i) {
+    write_file(dir / ("f" + std::to_string(i) + ".txt"), "x\n");
+  }
+  WalkResult result = walk_text_files({dir.path()}, FileFilter{}, 4);
+  EXPECT_EQ(result.m_files.size(), 4u);
+  EXPECT_TRUE(result.m_stats.mf_truncated);
+}
+} // namespace
+} // namespace winenv
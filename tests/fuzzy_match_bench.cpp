@@ -0,0 +1,92 @@
+#include "fuzzy_match.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+namespace winenv {
+namespace {
+// Миллион путей вида "module_12/component_7/source_file_42.cpp"
+struct Candidates {
+  std::vector<std::string> m_texts;
+  std::vector<std::uint32_t> m_masks;
+};
+
+const Candidates &candidates() {
+  static const Candidates result = [] {
+    const char *extensions[] = {".cpp", ".hpp", ".py", ".md"};
+    std::mt19937 random{50};
+    Candidates c;
+    c.m_texts.resize(1'000'000);
+    for (std::string &text : c.m_texts) {
+      text = "module_" + std::to_string(random() % 100) + "/component_" +
+             std::to_string(random() % 100) + "/source_file_" +
+             std::to_string(random() % 1000) + extensions[random() % 4];
+      c.m_masks.push_back(fuzzy_mask(text));
+    }
+    return c;
+  }();
+  return result;
+}
+
+std::vector<FuzzyMatch> find(FuzzyMatcher &matcher, std::string_view query) {
+  const Candidates &c = candidates();
+  FuzzyPattern pattern{query};
+  return matcher.find(pattern, c.m_masks, 20, [&] {
+    return [&](std::uint32_t i) { return pattern.score(c.m_texts[i]); };
+  });
+}
+
+const std::string typed_query = "comp7src42hpp";
+
+// Набор запроса по букве: каждый запрос ищется среди совпадений прошлого
+void BM_FuzzyTypeNarrowing(benchmark::State &state) {
+  candidates();
+  for (auto _ : state) {
+    FuzzyMatcher matcher;
+    for (size_t size = 1; size <= typed_query.size(); ++size) {
+      benchmark::DoNotOptimize(find(matcher, typed_query.substr(0, size)));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * typed_query.size());
+}
+BENCHMARK(BM_FuzzyTypeNarrowing)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Тот же набор, но каждый запрос ищется среди всех кандидатов
+void BM_FuzzyTypeFresh(benchmark::State &state) {
+  candidates();
+  for (auto _ : state) {
+    for (size_t size = 1; size <= typed_query.size(); ++size) {
+      FuzzyMatcher matcher;
+      benchmark::DoNotOptimize(find(matcher, typed_query.substr(0, size)));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * typed_query.size());
+}
+BENCHMARK(BM_FuzzyTypeFresh)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_FuzzyFilterMasks(benchmark::State &state) {
+  const std::vector<std::uint32_t> &masks = candidates().m_masks;
+  std::vector<std::uint32_t> out(masks.size());
+  std::uint32_t need = fuzzy_mask("hpp7");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        fuzzy_filter_masks(masks.data(), masks.size(), need, 0, out.data()));
+  }
+  state.SetItemsProcessed(state.iterations() * masks.size());
+}
+BENCHMARK(BM_FuzzyFilterMasks);
+
+void BM_FuzzyScore(benchmark::State &state) {
+  const std::vector<std::string> &texts = candidates().m_texts;
+  FuzzyPattern pattern{"src42hpp"};
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pattern.score(texts[i]));
+    i = (i + 1) % texts.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FuzzyScore);
+} // namespace
+} // namespace winenv
@@ -0,0 +1,97 @@
+#include "fuzzy_match.hpp"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <random>
+
+namespace winenv {
+namespace {
+// Случайные пути из частей с общими буквами, чтобы запросы находили многое
+std::vector<std::string> make_texts(size_t n, unsigned seed) {
+  const char *parts[] = {"src",  "Root", "app",   "_",     "-",   "/",
+                         "\\",   ".cpp", ".HPP",  "index", "fuzzy", "x9",
+                         "Main", "test", "é",     "a b"};
+  std::mt19937 random{seed};
+  std::vector<std::string> texts(n);
+  for (std::string &text : texts) {
+    size_t n_parts = 1 + random() % 8;
+    for (size_t i = 0; i < n_parts; ++i) {
+      text += parts[random() % std::size(parts)];
+    }
+  }
+  return texts;
+}
+
+std::vector<FuzzyMatch> find(FuzzyMatcher &matcher, std::string_view query,
+                             const std::vector<std::string> &texts,
+                             const std::vector<std::uint32_t> &masks,
+                             size_t k) {
+  FuzzyPattern pattern{query};
+  return matcher.find(pattern, masks, k, [&] {
+    return [&](std::uint32_t i) { return pattern.score(texts[i]); };
+  });
+}
+
+void expect_same(const std::vector<FuzzyMatch> &narrowed,
+                 const std::vector<FuzzyMatch> &fresh,
+                 std::string_view query) {
+  ASSERT_EQ(narrowed.size(), fresh.size()) << query;
+  for (size_t i = 0; i < fresh.size(); ++i) {
+    ASSERT_EQ(narrowed[i].m_index, fresh[i].m_index) << query << ' ' << i;
+    ASSERT_EQ(narrowed[i].m_score, fresh[i].m_score) << query << ' ' << i;
+  }
+}
+
+// Результаты поиска среди совпадений прошлого запроса не отличаются от
+// поиска по всем кандидатам, в том числе на наборах, которые делятся на
+// куски и оцениваются в нескольких потоках
+TEST(FuzzyMatcher, NarrowedResultsEqualFreshSearch) {
+  const std::vector<std::vector<std::string>> sessions{
+      {"", "s", "sr", "src", "src ", "src a", "src ap", "src app"},
+      {"r", "ro", "roo", "Roo", "RootA", "RootAp"},
+      {"/", "/\\", "/\\x", "/\\x9", "/\\x", "/\\x9."},
+      {"i", "in", "ind", "in", "i", "im", "ima"},
+      {"é", "éa", "éap", "éapp"}};
+  for (size_t n : {size_t{1'000}, 3 * FuzzyMatcher::parallel_min_size / 2}) {
+    std::vector<std::string> texts = make_texts(n, 50);
+    std::vector<std::uint32_t> masks;
+    for (const std::string &text : texts) {
+      masks.push_back(fuzzy_mask(text));
+    }
+    for (const auto &session : sessions) {
+      FuzzyMatcher narrowing;
+      for (const std::string &query : session) {
+        std::vector<FuzzyMatch> narrowed =
+            find(narrowing, query, texts, masks, 50);
+        FuzzyMatcher fresh;
+        ASSERT_NO_FATAL_FAILURE(expect_same(
+            narrowed, find(fresh, query, texts, masks, 50), query));
+      }
+    }
+  }
+}
+
+TEST(FuzzyPattern, NarrowsOnlyExtendedQueries) {
+  EXPECT_TRUE(FuzzyPattern{"ab"}.narrows(FuzzyPattern{"a"}));
+  EXPECT_TRUE(FuzzyPattern{"a b"}.narrows(FuzzyPattern{"ab"}));
+  EXPECT_TRUE(FuzzyPattern{"aB"}.narrows(FuzzyPattern{"a"}));
+  // Прошлый запрос - подпоследовательность нового
+  EXPECT_TRUE(FuzzyPattern{"xaybz"}.narrows(FuzzyPattern{"ab"}));
+  EXPECT_FALSE(FuzzyPattern{"a"}.narrows(FuzzyPattern{"ab"}));
+  EXPECT_FALSE(FuzzyPattern{"ba"}.narrows(FuzzyPattern{"ab"}));
+  // Запрос с учетом регистра не сужается запросом с другим регистром
+  EXPECT_FALSE(FuzzyPattern{"Ab"}.narrows(FuzzyPattern{"aB"}));
+}
+
+TEST(FuzzyPattern, ScoresAndRejects) {
+  FuzzyPattern pattern{"rapp"};
+  EXPECT_EQ(pattern.score("process.cpp"), fuzzy_no_match);
+  EXPECT_NE(pattern.score("root_app.cpp"), fuzzy_no_match);
+  // Начало слова и символы подряд дают больше очков
+  EXPECT_GT(pattern.score("root_app.cpp"), pattern.score("rxaxpxp"));
+  EXPECT_EQ(FuzzyPattern{"a\\b"}.text(), "a/b");
+  EXPECT_EQ(FuzzyPattern{"R"}.score("root"), fuzzy_no_match);
+}
+} // namespace
+} // namespace winenv
@@ -0,0 +1,123 @@
+#include "msgpack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+namespace winenv {
+namespace {
+// Ответ msgpack-RPC [1, id, nil, result] со значениями всех видов заголовков
+std::string make_response(std::uint64_t id) {
+  MsgpackWriter writer;
+  writer.write_array_header(4);
+  writer.write_uint(1);
+  writer.write_uint(id);
+  writer.write_nil();
+  writer.write_array_header(6);
+  writer.write_bool(true);
+  writer.write_uint(0xFFFFFFFFFFFF);
+  writer.write_str("short");
+  writer.write_str(std::string(300, 's'));
+  writer.write_array_header(20);
+  for (int i = 0; i < 20; ++i) {
+    writer.write_uint(static_cast<std::uint64_t>(i) * 1000);
+  }
+  writer.write_uint(200);
+  return writer.take();
+}
+
+TEST(Msgpack, WriterChoosesShortestForms) {
+  MsgpackWriter writer;
+  writer.write_uint(0x7F);
+  writer.write_uint(0x80);
+  writer.write_uint(0x100);
+  writer.write_uint(0x10000);
+  writer.write_uint(0x100000000);
+  EXPECT_EQ(writer.take(), std::string("\x7F\xCC\x80\xCD\x01\x00"
+                                       "\xCE\x00\x01\x00\x00"
+                                       "\xCF\x00\x00\x00\x01\x00\x00\x00\x00",
+                                       20));
+  writer.write_str(std::string(31, 'a'));
+  writer.write_str(std::string(32, 'a'));
+  writer.write_array_header(15);
+  writer.write_array_header(16);
+  std::string data = writer.take();
+  EXPECT_EQ(data[0], '\xBF');
+  EXPECT_EQ(data.substr(32, 2), "\xD9\x20");
+  EXPECT_EQ(data.substr(66), std::string("\x9F\xDC\x00\x10", 4));
+}
+
+TEST(Msgpack, ReaderRoundTrip) {
+  std::string data = make_response(70000);
+  ASSERT_EQ(msgpack_value_end(data, 0), data.size());
+  MsgpackReader reader{data};
+  EXPECT_EQ(reader.read_array_header(), 4u);
+  EXPECT_EQ(reader.read_uint(), 1u);
+  EXPECT_EQ(reader.read_uint(), 70000u);
+  EXPECT_TRUE(reader.read_nil());
+  EXPECT_FALSE(reader.read_nil());
+  EXPECT_EQ(reader.read_array_header(), 6u);
+  reader.skip();
+  EXPECT_EQ(reader.read_uint(), 0xFFFFFFFFFFFFu);
+  EXPECT_EQ(reader.read_str(), "short");
+  EXPECT_EQ(reader.read_str(), std::string(300, 's'));
+  reader.skip();
+  EXPECT_FALSE(reader.at_end());
+  EXPECT_THROW(reader.read_str(), std::runtime_error);
+}
+
+// Значения, которые есть не во writer: float, int, fixext, map, bin
+TEST(Msgpack, ValueEndOfOtherTypes) {
+  const std::string values[] = {
+      std::string("\xCA\x00\x00\x00\x00", 5),
+      std::string("\xCB\x00\x00\x00\x00\x00\x00\x00\x00", 9),
+      std::string("\xD0\xFF", 2), std::string("\xD3\x00\x00\x00\x00\x00\x00"
+                                              "\x00\x01", 9),
+      std::string("\xD4\x01\x02", 3), std::string("\xD8\x01", 2) +
+                                          std::string(16, 'x'),
+      std::string("\x82\x01\xA1x\x02\xC0", 6),
+      std::string("\xC4\x03xyz", 5), std::string("\xC7\x02\x05xy", 5),
+      "\xE0"};
+  for (const std::string &value : values) {
+    EXPECT_EQ(msgpack_value_end(value + "tail", 0), value.size())
+        << testing::PrintToString(value);
+  }
+  EXPECT_THROW(msgpack_value_end("\xC1", 0), std::runtime_error);
+}
+
+// Значение, оборванное на любом байте, требует дочитать данные: конец не
+// выходит за полученные байты, а чтение не начинается
+TEST(Msgpack, TruncatedAtEveryOffset) {
+  std::string scalars[] = {std::string("\xCE\x00\x01\x00\x00", 5),
+                           std::string("\xCF\x00\x00\x00\x01\x00\x00\x00"
+                                       "\x00", 9),
+                           std::string("\xCB\x00\x00\x00\x00\x00\x00\x00"
+                                       "\x00", 9),
+                           std::string("\xD2\x00\x00\x00\x00", 5),
+                           std::string("\xD7\x01", 2) + std::string(8, 'x'),
+                           "\xDA" + std::string("\x00\x03", 2) + "abc"};
+  std::vector<std::string> messages{make_response(5), make_response(1 << 20)};
+  for (const std::string &scalar : scalars) {
+    messages.push_back("\x94\x01\x05\xC0" + scalar);
+  }
+  for (const std::string &message : messages) {
+    ASSERT_EQ(msgpack_value_end(message, 0), message.size());
+    for (size_t size = 0; size < message.size(); ++size) {
+      std::string_view part{message.data(), size};
+      ASSERT_EQ(msgpack_value_end(part, 0), std::nullopt)
+          << testing::PrintToString(message) << " cut at " << size;
+    }
+  }
+}
+
+TEST(Msgpack, ReaderThrowsOnTruncatedData) {
+  EXPECT_THROW(MsgpackReader{""}.read_uint(), std::runtime_error);
+  EXPECT_THROW(MsgpackReader{"\xCE\x00"}.read_uint(), std::runtime_error);
+  EXPECT_THROW(MsgpackReader{"\xA3xy"}.read_str(), std::runtime_error);
+  EXPECT_THROW(MsgpackReader{"\xDC\x00"}.read_array_header(),
+               std::runtime_error);
+  EXPECT_THROW(MsgpackReader{"\x92\x01"}.skip(), std::runtime_error);
+  EXPECT_THROW(MsgpackReader{"\xA1x"}.read_uint(), std::runtime_error);
+}
+} // namespace
+} // namespace winenv
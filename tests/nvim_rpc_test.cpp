@@ -0,0 +1,94 @@
+#include "nvim_rpc.hpp"
+#include "process.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <system_error>
+#include <thread>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+
+// Заменитель Neovim на msgpack-RPC из fake_nvim.py. Обслуживает одно
+// подключение и записывает полученные команды в журнал по строке на команду
+class FakeNvim {
+public:
+  explicit FakeNvim(const std::string &mode) {
+    Process::Constructor ctor;
+    ctor.set_command_line_arguments(std::string{"python3 "} +
+                                    WINENV_TESTS_DIR "/fake_nvim.py " +
+                                    socket().string() + ' ' +
+                                    log().string() + ' ' + mode);
+    m_proc = ctor.create(WINENV_PYTHON, {});
+    for (int i = 0; i < 500 && !std::filesystem::exists(socket()); ++i) {
+      if (m_proc.wait_for(10)) {
+        break;
+      }
+    }
+  }
+  ~FakeNvim() { m_proc.wait_for(10'000); }
+
+  std::filesystem::path socket() const { return m_dir / "nvim.sock"; }
+  std::filesystem::path log() const { return m_dir / "commands.log"; }
+  // Ждет завершения сервера и возвращает его код
+  int exit_code() {
+    EXPECT_TRUE(m_proc.wait_for(10'000));
+    return m_proc.get_usage().m_exit_code;
+  }
+
+private:
+  TempDir m_dir;
+  Process m_proc;
+};
+
+TEST(NvimClient, OpensFilesWithEscapedNames) {
+  FakeNvim server{"normal"};
+  {
+    NvimClient client{server.socket().string()};
+    EXPECT_TRUE(
+        client.open_files({"a b.txt", "+x", "dir/c%d.txt"}, "tabedit").empty());
+  }
+  EXPECT_EQ(server.exit_code(), 0);
+  EXPECT_EQ(test::read_file(server.log()),
+            "tabedit a\\ b.txt\ntabedit \\+x\ntabedit dir/c\\%d.txt\n");
+}
+
+// Ответы приходят в обратном порядке после уведомления и кусками по
+// нескольку байт; ошибка одной команды не мешает остальным
+TEST(NvimClient, MatchesResponsesAndReportsErrors) {
+  FakeNvim server{"normal"};
+  {
+    NvimClient client{server.socket().string()};
+    std::vector<std::string> cmds{"edit a", "bad command", "edit b"};
+    EXPECT_EQ(client.run_commands(cmds),
+              std::vector<std::string>{
+                  "Editor error in \"bad command\": "
+                  "Vim:E492: Not an editor command: bad command"});
+    // Номера запросов продолжаются в том же подключении
+    std::string long_cmd = "edit " + std::string(300, 'x');
+    EXPECT_TRUE(client.run_commands({long_cmd}).empty());
+  }
+  EXPECT_EQ(server.exit_code(), 0);
+}
+
+TEST(NvimClient, ThrowsOnTimeout) {
+  FakeNvim server{"silent"};
+  NvimClient client{server.socket().string(),
+                    std::chrono::milliseconds{200}};
+  EXPECT_THROW(client.run_commands({"edit a"}), std::system_error);
+}
+
+TEST(NvimClient, ThrowsWhenServerCloses) {
+  FakeNvim server{"close"};
+  NvimClient client{server.socket().string()};
+  EXPECT_THROW(client.run_commands({"edit a"}), std::runtime_error);
+}
+
+TEST(NvimClient, ThrowsWithoutServer) {
+  TempDir dir;
+  EXPECT_THROW(NvimClient{(dir / "none.sock").string()}, std::system_error);
+}
+} // namespace
+} // namespace winenv
@@ -0,0 +1,33 @@
+#include "parallel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+namespace winenv {
+namespace {
+TEST(ParallelFor, CallsEveryIndexOnce) {
+  std::vector<std::atomic_int> calls(10'000);
+  parallel_for(calls.size(), [&](size_t i) { ++calls[i]; });
+  for (size_t i = 0; i < calls.size(); ++i) {
+    ASSERT_EQ(calls[i], 1) << i;
+  }
+}
+
+// Исключение из рабочего потока не завершает программу, а передается
+// вызывающему
+TEST(ParallelFor, RethrowsWorkerException) {
+  std::atomic_size_t n_calls{0};
+  EXPECT_THROW(parallel_for(100'000,
+                            [&](size_t i) {
+                              ++n_calls;
+                              if (i == 5) {
+                                throw std::runtime_error("task failed");
+                              }
+                            }),
+               std::runtime_error);
+  // Раздача индексов останавливается после ошибки
+  EXPECT_LT(n_calls, 100'000u);
+}
+} // namespace
+} // namespace winenv
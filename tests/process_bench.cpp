@@ -0,0 +1,59 @@
+#include "env_block.hpp"
+#include "process.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace winenv {
+namespace {
+// Запуск и ожидание /bin/true: число запусков в секунду и время самого
+// запуска (posix_spawn) отдельно от ожидания завершения
+void run_spawns(benchmark::State &state, Process::Constructor ctor) {
+  double spawn_us = 0;
+  for (auto _ : state) {
+    Process proc = ctor.create("/bin/true", {});
+    spawn_us += static_cast<double>(proc.get_spawn_time().count());
+    proc.wait_for(g_wait_infinite);
+    benchmark::DoNotOptimize(proc.get_usage());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["spawn_us"] = benchmark::Counter(
+      spawn_us, benchmark::Counter::kAvgIterations);
+}
+
+void BM_Spawn(benchmark::State &state) {
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("true");
+  run_spawns(state, std::move(ctor));
+}
+BENCHMARK(BM_Spawn)->UseRealTime();
+
+void BM_SpawnSharedEnv(benchmark::State &state) {
+  EnvBlock env = EnvBlock::capture();
+  env.set("WINENV_BENCH", "1");
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("true").set_environment_variables(
+      env.build());
+  run_spawns(state, std::move(ctor));
+}
+BENCHMARK(BM_SpawnSharedEnv)->UseRealTime();
+
+void BM_SpawnStdin(benchmark::State &state) {
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("true").redirect_stdin();
+  run_spawns(state, std::move(ctor));
+}
+BENCHMARK(BM_SpawnStdin)->UseRealTime();
+
+// Порождение с ограничениями: приоритет и маска процессоров применяются
+// до запуска программы
+void BM_SpawnLimited(benchmark::State &state) {
+  ProcessLimits limits;
+  limits.m_priority = ProcessPriority::below_normal;
+  limits.m_affinity_mask = 1;
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("true").set_limits(limits);
+  run_spawns(state, std::move(ctor));
+}
+BENCHMARK(BM_SpawnLimited)->UseRealTime();
+} // namespace
+} // namespace winenv
@@ -0,0 +1,87 @@
+#include "process.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/resource.h>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+using test::write_file;
+
+// Код завершения sh script с ограничениями limits
+int run_script(const TempDir &temp, const std::string &script,
+               const ProcessLimits &limits) {
+  write_file(temp / "script.sh", script);
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("sh " + (temp / "script.sh").string())
+      .set_limits(limits);
+  Process proc = ctor.create({}, {});
+  EXPECT_TRUE(proc.wait_for(10'000));
+  return proc.get_usage().m_exit_code;
+}
+
+// Приоритет задан до exec: его видит уже потомок, запущенный программой
+// первой же командой
+TEST(ProcessLimits, PriorityAppliesToDescendants) {
+  errno = 0;
+  if (getpriority(PRIO_PROCESS, 0) > 10) {
+    GTEST_SKIP() << "Test process niceness is above 10";
+  }
+  TempDir temp;
+  ProcessLimits limits;
+  limits.m_priority = ProcessPriority::below_normal;
+  EXPECT_EQ(run_script(temp, "sh -c 'exit $(nice)'\n", limits), 10);
+}
+
+TEST(ProcessLimits, AffinityAppliesToDescendants) {
+  TempDir temp;
+  ProcessLimits limits;
+  limits.m_affinity_mask = 1;
+  EXPECT_EQ(run_script(temp,
+                       "sh -c 'grep -q \"^Cpus_allowed_list:.0$\" "
+                       "/proc/self/status'\n",
+                       limits),
+            0);
+}
+
+// Памяти нужна делегированная группа cgroup v2, иначе запуск отказывает
+TEST(ProcessLimits, MemoryLimitPlacesProcessInActionGroup) {
+  TempDir temp;
+  ProcessLimits limits;
+  limits.m_job_memory_limit = 256 * 1024 * 1024;
+  limits.m_group_name = "test";
+  try {
+    EXPECT_EQ(run_script(temp,
+                         "grep -q '^0::.*/winenv-test$' /proc/self/cgroup\n",
+                         limits),
+              0);
+  } catch (std::exception &err) {
+    GTEST_SKIP() << "cgroup v2 delegation is not available: " << err.what();
+  }
+}
+
+TEST(ProcessLimits, FailureBeforeExecIsReported) {
+  ProcessLimits limits;
+  limits.m_priority = ProcessPriority::normal;
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("true")
+      .set_startup_directory("/nonexistent/winenv")
+      .set_limits(limits);
+  try {
+    ctor.create({}, {});
+    FAIL() << "Process started in a missing directory";
+  } catch (std::system_error &err) {
+    EXPECT_EQ(err.code().value(), ENOENT);
+    EXPECT_NE(std::string{err.what()}.find("change directory"),
+              std::string::npos);
+  }
+
+  Process::Constructor missing;
+  missing.set_command_line_arguments("winenv-no-such-program")
+      .set_limits(limits);
+  EXPECT_THROW(missing.create({}, {}), std::system_error);
+}
+} // namespace
+} // namespace winenv
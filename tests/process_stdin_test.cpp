@@ -0,0 +1,83 @@
+#include "process.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <csignal>
+#include <system_error>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+using test::write_file;
+
+// sh script с каналом стандартного ввода
+Process start_script(const TempDir &temp, const std::string &script) {
+  write_file(temp / "script.sh", script);
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments("sh " + (temp / "script.sh").string())
+      .redirect_stdin();
+  return ctor.create({}, {});
+}
+
+// Данные больше буфера канала и размера куска записи
+std::string make_input() {
+  std::string input(3 * PipeWriter::g_pipe_chunk_size + 123, '\0');
+  for (size_t i = 0; i < input.size(); ++i) {
+    input[i] = static_cast<char>('a' + i % 26);
+  }
+  return input;
+}
+
+bool is_sigpipe_pending() {
+  sigset_t pending;
+  sigpending(&pending);
+  return sigismember(&pending, SIGPIPE) == 1;
+}
+
+TEST(ProcessStdin, ChildReadsAllInput) {
+  TempDir temp;
+  Process proc = start_script(temp, "cat > \"$(dirname \"$0\")/out\"\n");
+  PipeWriter input = proc.take_stdin();
+  ASSERT_TRUE(input.is_open());
+  EXPECT_FALSE(proc.take_stdin().is_open());
+  std::string data = make_input();
+  input.write(std::string_view{data}.substr(0, 1000));
+  input.write(std::string_view{data}.substr(1000));
+  // Конец файла приходит процессу только после закрытия
+  input.close();
+  ASSERT_TRUE(proc.wait_for(10'000));
+  EXPECT_EQ(proc.get_usage().m_exit_code, 0);
+  EXPECT_EQ(test::read_file(temp / "out"), data);
+}
+
+// Процесс, закрывший ввод, не завершает WinEnv сигналом SIGPIPE: запись
+// выбрасывает исключение с EPIPE, а сигнал не остается ожидающим
+TEST(ProcessStdin, ChildExitingEarlyGivesEpipe) {
+  TempDir temp;
+  Process proc =
+      start_script(temp, "head -c 10 > \"$(dirname \"$0\")/out\"\nexit 3\n");
+  PipeWriter input = proc.take_stdin();
+  std::string data = make_input();
+  try {
+    input.write(data);
+    ADD_FAILURE() << "Write to exited process succeeded";
+  } catch (const std::system_error &err) {
+    EXPECT_EQ(err.code(), std::errc::broken_pipe);
+  }
+  EXPECT_FALSE(is_sigpipe_pending());
+  ASSERT_TRUE(proc.wait_for(10'000));
+  EXPECT_EQ(proc.get_usage().m_exit_code, 3);
+  EXPECT_EQ(test::read_file(temp / "out"), data.substr(0, 10));
+}
+
+TEST(ProcessStdin, WriteAfterChildExitGivesEpipe) {
+  TempDir temp;
+  Process proc = start_script(temp, "exit 0\n");
+  PipeWriter input = proc.take_stdin();
+  ASSERT_TRUE(proc.wait_for(10'000));
+  EXPECT_THROW(input.write("late"), std::system_error);
+  EXPECT_FALSE(is_sigpipe_pending());
+}
+} // namespace
+} // namespace winenv
@@ -0,0 +1,34 @@
+#include "search_url.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace winenv {
+namespace {
+// Запрос из 1000 символов: латиница с редкими пробелами или кириллица
+std::wstring make_query(bool f_cyrillic) {
+  std::wstring query;
+  while (query.size() < 1000) {
+    query += f_cyrillic ? L"поиск " : L"parse_args ";
+  }
+  return query;
+}
+
+void BM_PercentEncode(benchmark::State &state) {
+  std::wstring query = make_query(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(percent_encode(query));
+  }
+  state.SetItemsProcessed(state.iterations() * query.size());
+}
+BENCHMARK(BM_PercentEncode)->Arg(0)->Arg(1);
+
+void BM_PercentEncodeUri(benchmark::State &state) {
+  std::wstring url = L"https://example.org/docs/" + make_query(false);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(percent_encode(url, PercentMode::uri));
+  }
+  state.SetItemsProcessed(state.iterations() * url.size());
+}
+BENCHMARK(BM_PercentEncodeUri);
+} // namespace
+} // namespace winenv
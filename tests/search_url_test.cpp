@@ -0,0 +1,126 @@
+#include "search_url.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <random>
+
+namespace winenv {
+namespace {
+// Посимвольное кодирование без векторного пути для сравнения
+template <class Char>
+std::string reference_encode(std::basic_string_view<Char> text,
+                             PercentMode mode) {
+  std::u32string chars;
+  for (size_t i = 0; i < text.size(); ++i) {
+    char32_t c = static_cast<char32_t>(text[i]);
+    if (sizeof(Char) == 2 && c >= 0xD800 && c <= 0xDBFF &&
+        i + 1 < text.size() && text[i + 1] >= 0xDC00 &&
+        text[i + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (text[++i] - 0xDC00);
+    } else if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+      c = 0xFFFD;
+    }
+    chars += c;
+  }
+  std::string encoded;
+  for (char32_t c : chars) {
+    bool is_unreserved =
+        (c < 0x80 && std::isalnum(static_cast<int>(c))) ||
+        std::u32string_view{U"-._~"}.find(c) != std::u32string_view::npos;
+    bool is_kept =
+        mode == PercentMode::uri ? c > 0x20 && c < 0x7F : is_unreserved;
+    if (is_kept) {
+      encoded += static_cast<char>(c);
+      continue;
+    }
+    std::string utf8;
+    if (c < 0x80) {
+      utf8 += static_cast<char>(c);
+    } else if (c < 0x800) {
+      utf8 += static_cast<char>(0xC0 | c >> 6);
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      utf8 += static_cast<char>(0xE0 | c >> 12);
+      utf8 += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+      utf8 += static_cast<char>(0xF0 | c >> 18);
+      utf8 += static_cast<char>(0x80 | (c >> 12 & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    for (unsigned char byte : utf8) {
+      encoded += '%';
+      encoded += "0123456789ABCDEF"[byte >> 4];
+      encoded += "0123456789ABCDEF"[byte & 0x0F];
+    }
+  }
+  return encoded;
+}
+
+TEST(PercentEncode, Component) {
+  EXPECT_EQ(percent_encode(L"a&b c"), "a%26b%20c");
+  EXPECT_EQ(percent_encode(L"AZaz09-._~"), "AZaz09-._~");
+  EXPECT_EQ(percent_encode(L"/?#%+"), "%2F%3F%23%25%2B");
+  EXPECT_EQ(percent_encode(L"éк"), "%C3%A9%D0%BA");
+  EXPECT_EQ(percent_encode(std::wstring_view{L"\U0001F600"}),
+            "%F0%9F%98%80");
+  EXPECT_EQ(percent_encode(u"\xD83D\xDE00"), "%F0%9F%98%80");
+}
+
+// Непарные суррогаты заменяются на U+FFFD, пара по краям куска из 8
+// единиц склеивается
+TEST(PercentEncode, LoneSurrogatesAndChunkBorders) {
+  EXPECT_EQ(percent_encode(u"\xD800x"), "%EF%BF%BDx");
+  EXPECT_EQ(percent_encode(u"x\xDC00"), "x%EF%BF%BD");
+  EXPECT_EQ(percent_encode(u"abcdefg\xD83D\xDE00h"), "abcdefg%F0%9F%98%80h");
+  EXPECT_EQ(percent_encode(u"abcdefgh\xD83D"), "abcdefgh%EF%BF%BD");
+}
+
+TEST(PercentEncode, UriKeepsReservedAndEscapes) {
+  EXPECT_EQ(percent_encode(L"https://x.org/a b?q=%41&r=é#f",
+                           PercentMode::uri),
+            "https://x.org/a%20b?q=%41&r=%C3%A9#f");
+  EXPECT_EQ(percent_encode(L"a\tb\x7F", PercentMode::uri), "a%09b%7F");
+}
+
+// Векторный путь совпадает с посимвольным на случайных строках из
+// символов на границах классов
+TEST(PercentEncode, MatchesReferenceOnRandomText) {
+  const std::u16string units = u"aZ09-~ %/\x7F\x80\x7FF\x800\xD7FF\xD83D"
+                               u"\xDE00\xDC00\xE000\xFFFF";
+  std::mt19937 random{45};
+  for (int iter = 0; iter < 20'000; ++iter) {
+    std::u16string text16(random() % 40, u'\0');
+    for (char16_t &c : text16) {
+      c = units[random() % units.size()];
+    }
+    std::wstring wide(text16.begin(), text16.end());
+    if (iter % 2) {
+      wide += static_cast<wchar_t>(0x10000 + random() % 0x100000);
+    }
+    for (PercentMode mode : {PercentMode::component, PercentMode::uri}) {
+      ASSERT_EQ(percent_encode(text16, mode),
+                reference_encode(std::u16string_view{text16}, mode));
+      ASSERT_EQ(percent_encode(wide, mode),
+                reference_encode(std::wstring_view{wide}, mode));
+    }
+  }
+}
+
+TEST(SearchEngines, ChoosesTemplateByPrefix) {
+  SearchEngines engines;
+  EXPECT_TRUE(engines.empty());
+  EXPECT_EQ(engines.make_url(L"query"), "");
+  engines.add("", "https://www.google.com/search?q=${query}");
+  engines.add("gh", "https://github.com/search?q=${query}");
+  EXPECT_EQ(engines.make_url(L"  gh:  a&b \n"),
+            "https://github.com/search?q=a%26b");
+  EXPECT_EQ(engines.make_url(L"std::vector"),
+            "https://www.google.com/search?q=std%3A%3Avector");
+  EXPECT_EQ(engines.make_url(L"https://x.org/a b"), "https://x.org/a%20b");
+  EXPECT_THROW(engines.add("x", "https://x.org/${other}"), ExpansionError);
+}
+} // namespace
+} // namespace winenv
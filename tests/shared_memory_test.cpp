@@ -0,0 +1,94 @@
+#include "shared_memory.hpp"
+#include "versioned_header.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace winenv {
+namespace {
+struct Profile {
+  static constexpr std::uint32_t g_magic = 0x50434557;
+
+  VersionedHeader m_header{g_magic, 1, sizeof(Profile)};
+  char m_font_name[32]{};
+  std::uint32_t m_font_size{0};
+};
+
+SharedMemory publish(const Profile &profile) {
+  SharedMemory memory = SharedMemory::create(sizeof(Profile));
+  new (memory.data()) Profile{profile};
+  memory.seal();
+  return memory;
+}
+
+TEST(SharedMemory, OpenedByHandleReadsPublishedData) {
+  Profile profile;
+  profile.m_font_size = 14;
+  std::copy_n("Consolas", 8, profile.m_font_name);
+  SharedMemory memory = publish(profile);
+
+  SharedMemory view = SharedMemory::open(memory.get_handle());
+  ASSERT_GE(view.size(), sizeof(Profile));
+  const auto &received = *static_cast<const Profile *>(view.data());
+  EXPECT_NO_THROW(check_versioned_header(received.m_header, Profile::g_magic,
+                                         sizeof(Profile), view.size(),
+                                         "Profile"));
+  EXPECT_STREQ(received.m_font_name, "Consolas");
+  EXPECT_EQ(received.m_font_size, 14u);
+}
+
+// Запечатанный блок нельзя изменить ни через отображение, ни через файл
+TEST(SharedMemory, SealedBlockRejectsWritesAndGrowth) {
+  SharedMemory memory = publish(Profile{});
+  SharedMemory view = SharedMemory::open(memory.get_handle());
+  long page = sysconf(_SC_PAGESIZE);
+  EXPECT_NE(mprotect(view.data(), page, PROT_READ | PROT_WRITE), 0);
+  EXPECT_NE(mprotect(memory.data(), page, PROT_READ | PROT_WRITE), 0);
+
+  std::string handle = memory.get_handle();
+  std::string path = "/proc/" + handle.substr(0, handle.find('.')) + "/fd/" +
+                     handle.substr(handle.find('.') + 1);
+  int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  ASSERT_GE(fd, 0) << path;
+  char byte = 'x';
+  EXPECT_EQ(pwrite(fd, &byte, 1, 0), -1);
+  EXPECT_EQ(errno, EPERM);
+  EXPECT_NE(ftruncate(fd, sizeof(Profile) * 2), 0);
+  EXPECT_NE(ftruncate(fd, 0), 0);
+  EXPECT_EQ(mmap(nullptr, sizeof(Profile), PROT_READ | PROT_WRITE, MAP_SHARED,
+                 fd, 0),
+            MAP_FAILED);
+  EXPECT_NE(fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE), 0);
+  close(fd);
+
+  const auto &received = *static_cast<const Profile *>(view.data());
+  EXPECT_EQ(received.m_header.m_magic, Profile::g_magic);
+}
+
+// Профиль неизвестной версии отклоняется, а не читается как известный
+TEST(SharedMemory, UnknownVersionIsNotMisread) {
+  Profile profile;
+  profile.m_header.m_version = 0;
+  SharedMemory memory = publish(profile);
+  SharedMemory view = SharedMemory::open(memory.get_handle());
+  const auto &received = *static_cast<const Profile *>(view.data());
+  EXPECT_THROW(check_versioned_header(received.m_header, Profile::g_magic,
+                                      sizeof(Profile), view.size(), "Profile"),
+               std::runtime_error);
+}
+
+TEST(SharedMemory, MalformedHandleIsRejected) {
+  for (const char *handle : {"", "12", ".3", "12.", "1.2.3", "a.1"}) {
+    EXPECT_THROW(SharedMemory::open(handle), std::runtime_error) << handle;
+  }
+}
+} // namespace
+} // namespace winenv
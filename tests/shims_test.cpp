@@ -0,0 +1,102 @@
+#include "shims.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+namespace winenv {
+namespace {
+using test::TempDir;
+using test::write_file;
+
+TEST(DiffShims, SplitsCommandsIntoRemoveCreateAndUnchanged) {
+  ShimMap current{{"a", "/bin/a"}, {"b", "/bin/b"}, {"c", "/bin/c"}};
+  ShimMap desired{{"b", "/bin/b"}, {"c", "/opt/c"}, {"d", "/bin/d"}};
+  ShimPlan plan = diff_shims(current, desired);
+  EXPECT_EQ(plan.m_remove, std::vector<std::string>{"a"});
+  ASSERT_EQ(plan.m_create.size(), 2u);
+  EXPECT_EQ(plan.m_create[0].first, "c");
+  EXPECT_EQ(plan.m_create[0].second, "/opt/c");
+  EXPECT_EQ(plan.m_create[1].first, "d");
+  EXPECT_EQ(plan.m_n_unchanged, 1u);
+}
+
+TEST(DiffShims, EmptySides) {
+  ShimMap shims{{"a", "/bin/a"}, {"b", "/bin/b"}};
+  EXPECT_TRUE(diff_shims({}, {}).empty());
+  EXPECT_EQ(diff_shims({}, shims).m_create.size(), 2u);
+  EXPECT_EQ(diff_shims(shims, {}).m_remove.size(), 2u);
+  ShimPlan same = diff_shims(shims, shims);
+  EXPECT_TRUE(same.empty());
+  EXPECT_EQ(same.m_n_unchanged, 2u);
+}
+
+class ShimDirectoryTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    write_file(m_temp / "bin/a", "a");
+    write_file(m_temp / "bin/b", "b");
+    write_file(m_temp / "opt/b", "b2");
+  }
+  std::filesystem::path shim(const std::string &command) const {
+    return m_temp / "shims" / ShimDirectory::shim_file_name(command);
+  }
+
+  TempDir m_temp;
+};
+
+TEST_F(ShimDirectoryTest, CreatesSymlinksToTargets) {
+  ShimDirectory shims{m_temp / "shims"};
+  ShimPlan plan =
+      shims.sync({{"a", m_temp / "bin/a"}, {"b", m_temp / "bin/b"}});
+  EXPECT_EQ(plan.m_create.size(), 2u);
+  ASSERT_TRUE(std::filesystem::is_symlink(shim("a")));
+  EXPECT_EQ(std::filesystem::read_symlink(shim("a")), m_temp / "bin/a");
+  EXPECT_EQ(test::read_file(shim("b")), "b");
+}
+
+TEST_F(ShimDirectoryTest, SecondSyncChangesOnlyDifferences) {
+  ShimMap desired{{"a", m_temp / "bin/a"}, {"b", m_temp / "bin/b"}};
+  ShimDirectory{m_temp / "shims"}.sync(desired);
+
+  ShimDirectory shims{m_temp / "shims"};
+  ShimPlan same = shims.sync(desired);
+  EXPECT_TRUE(same.empty());
+  EXPECT_EQ(same.m_n_unchanged, 2u);
+
+  ShimPlan plan = shims.sync({{"b", m_temp / "opt/b"}});
+  EXPECT_EQ(plan.m_remove, std::vector<std::string>{"a"});
+  ASSERT_EQ(plan.m_create.size(), 1u);
+  EXPECT_FALSE(std::filesystem::is_symlink(shim("a")));
+  EXPECT_EQ(std::filesystem::read_symlink(shim("b")), m_temp / "opt/b");
+}
+
+TEST_F(ShimDirectoryTest, RecreatesDeletedShimAndKeepsForeignFiles) {
+  ShimMap desired{{"a", m_temp / "bin/a"}};
+  ShimDirectory shims{m_temp / "shims"};
+  shims.sync(desired);
+  write_file(m_temp / "shims/foreign", "user file");
+  std::filesystem::remove(shim("a"));
+
+  ShimPlan plan = shims.sync(desired);
+  ASSERT_EQ(plan.m_create.size(), 1u);
+  EXPECT_TRUE(std::filesystem::is_symlink(shim("a")));
+
+  shims.sync({});
+  EXPECT_FALSE(std::filesystem::is_symlink(shim("a")));
+  EXPECT_EQ(test::read_file(m_temp / "shims/foreign"), "user file");
+}
+
+TEST_F(ShimDirectoryTest, DanglingShimCountsAsExisting) {
+  ShimDirectory shims{m_temp / "shims"};
+  shims.sync({{"a", m_temp / "bin/a"}});
+  std::filesystem::remove(m_temp / "bin/a");
+  EXPECT_TRUE(shims.sync({{"a", m_temp / "bin/a"}}).empty());
+}
+
+TEST(ShimsFromCommands, OrdersCommands) {
+  ShimMap shims = shims_from_commands({{"b", "/bin/b"}, {"a", "/bin/a"}});
+  ASSERT_EQ(shims.size(), 2u);
+  EXPECT_EQ(shims.begin()->first, "a");
+}
+} // namespace
+} // namespace winenv
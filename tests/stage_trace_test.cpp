@@ -0,0 +1,94 @@
+#include "stage_trace.hpp"
+
+#include <gtest/gtest.h>
+
+namespace winenv {
+namespace {
+using std::chrono::microseconds;
+
+constexpr std::uint64_t stamp_period = std::uint64_t{1} << 28;
+
+TraceClock::time_point at_us(std::uint64_t us) {
+  return TraceClock::time_point{microseconds{us}};
+}
+
+TEST(StageStamp, RoundTripWithinPeriod) {
+  TraceClock::time_point time = at_us(5 * stamp_period + 1234);
+  for (microseconds delay : {microseconds{0}, microseconds{1},
+                             microseconds{stamp_period - 1}}) {
+    auto [stage, unpacked] = unpack_stage_stamp(
+        pack_stage_stamp(SpawnStage::font_set, time), time + delay);
+    EXPECT_EQ(stage, SpawnStage::font_set);
+    EXPECT_EQ(unpacked, time) << delay.count();
+  }
+}
+
+// Младшие 28 бит микросекунд переполняются между отправкой и приемом
+TEST(StageStamp, RoundTripAcrossWrap) {
+  for (std::uint64_t before : {1u, 5u, 1000u}) {
+    TraceClock::time_point time = at_us(7 * stamp_period - before);
+    for (std::uint64_t after : {0u, 1u, 10u, 1000u}) {
+      auto [stage, unpacked] =
+          unpack_stage_stamp(pack_stage_stamp(SpawnStage::cmd_launched, time),
+                             at_us(7 * stamp_period + after));
+      EXPECT_EQ(stage, SpawnStage::cmd_launched);
+      EXPECT_EQ(unpacked, time) << before << ' ' << after;
+    }
+  }
+}
+
+// Задержка в полный период неотличима от нулевой
+TEST(StageStamp, DelayOfFullPeriodIsLost) {
+  TraceClock::time_point time = at_us(3 * stamp_period + 42);
+  auto [stage, unpacked] =
+      unpack_stage_stamp(pack_stage_stamp(SpawnStage::hotkey, time),
+                         time + microseconds{stamp_period});
+  EXPECT_EQ(stage, SpawnStage::hotkey);
+  EXPECT_EQ(unpacked, time + microseconds{stamp_period});
+}
+
+// Старшие 4 бита могут прийти от чужого сообщения
+TEST(StageStamp, InvalidStageIsIgnored) {
+  std::uint32_t packed = 0xF000'0010u;
+  auto [stage, unpacked] = unpack_stage_stamp(packed, at_us(stamp_period));
+  EXPECT_GE(stage, SpawnStage::count);
+  EXPECT_STREQ(stage_name(stage), "unknown");
+
+  SpawnTracer tracer;
+  SpawnTrace trace;
+  trace.mark(SpawnStage::hotkey);
+  tracer.begin(1, trace);
+  tracer.mark(1, stage, unpacked);
+  EXPECT_EQ(tracer.to_string(), "spawn stages after hotkey (0):\n");
+}
+
+TEST(SpawnTracer, PercentilesFromHotkey) {
+  SpawnTracer tracer;
+  TraceClock::time_point start = TraceClock::now();
+  for (std::uint32_t id = 1; id <= 100; ++id) {
+    SpawnTrace trace;
+    trace.mark(SpawnStage::hotkey, start);
+    trace.mark(SpawnStage::process_created, start + microseconds{7});
+    tracer.begin(id, trace);
+    // Отметки других процессов отбрасываются
+    tracer.mark(id + 1000, SpawnStage::cmd_launched, start);
+    tracer.mark(id, SpawnStage::cmd_launched, start + microseconds{id});
+  }
+  // Запуск уже учтен, повторная отметка ничего не меняет
+  tracer.mark(100, SpawnStage::cmd_launched, start);
+  EXPECT_EQ(tracer.to_string(),
+            "spawn stages after hotkey (100):\n"
+            "process_created: p50 7 us, p90 7 us, p99 7 us, max 7 us\n"
+            "cmd_launched: p50 51 us, p90 91 us, p99 100 us, max 100 us\n");
+}
+
+TEST(SpawnTracer, UnfinishedTraceIsNotCounted) {
+  SpawnTracer tracer;
+  SpawnTrace trace;
+  trace.mark(SpawnStage::hotkey);
+  tracer.begin(1, trace);
+  tracer.mark(1, SpawnStage::child_main, TraceClock::now());
+  EXPECT_EQ(tracer.to_string(), "spawn stages after hotkey (0):\n");
+}
+} // namespace
+} // namespace winenv
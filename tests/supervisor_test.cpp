@@ -0,0 +1,61 @@
+#include "supervisor.hpp"
+
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace winenv {
+namespace {
+Process spawn(const char *program) {
+  Process::Constructor ctor;
+  ctor.set_command_line_arguments(program);
+  return ctor.create({}, {});
+}
+
+TEST(ProcessSupervisor, RecordsExitsPerAction) {
+  std::mutex mutex;
+  std::condition_variable exited;
+  bool f_notified{false};
+  // Несколько процессов, завершившихся вместе, дают одно уведомление
+  ProcessSupervisor supervisor{[&] {
+    std::lock_guard lock{mutex};
+    f_notified = true;
+    exited.notify_one();
+  }};
+  supervisor.watch(spawn("true"), "ok");
+  supervisor.watch(spawn("false"), "fail");
+  std::vector<ExitRecord> records;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while (records.size() < 2) {
+    std::unique_lock lock{mutex};
+    ASSERT_TRUE(exited.wait_until(lock, deadline, [&] { return f_notified; }));
+    f_notified = false;
+    lock.unlock();
+    for (ExitRecord &record : supervisor.take_exited()) {
+      records.push_back(std::move(record));
+    }
+  }
+  ASSERT_EQ(records.size(), 2u);
+  for (const ExitRecord &record : records) {
+    EXPECT_TRUE(record.mf_usage_known);
+    EXPECT_EQ(record.m_usage.m_exit_code, record.m_action == "ok" ? 0 : 1);
+  }
+  EXPECT_TRUE(supervisor.take_exited().empty());
+
+  std::map<std::string, SupervisorStats> stats = supervisor.get_stats();
+  EXPECT_EQ(stats["ok"].m_n_failed, 0u);
+  EXPECT_EQ(stats["fail"].m_n_failed, 1u);
+  SupervisorStats total = supervisor.get_total_stats();
+  EXPECT_EQ(total.m_n_exited, 2u);
+  EXPECT_EQ(total.m_n_running, 0u);
+}
+
+TEST(ExitRecord, UnknownUsageIsReported) {
+  ExitRecord record;
+  record.m_action = "editor";
+  record.mf_usage_known = false;
+  EXPECT_NE(record.to_string().find("usage unknown"), std::string::npos);
+}
+} // namespace
+} // namespace winenv
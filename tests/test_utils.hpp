@@ -0,0 +1,46 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace winenv::test {
+// Временная директория, удаляемая вместе с содержимым
+class TempDir {
+public:
+  TempDir() {
+    std::random_device random;
+    m_path = std::filesystem::temp_directory_path() /
+             ("winenv_test_" + std::to_string(random()));
+    std::filesystem::create_directories(m_path);
+  }
+  ~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(m_path, ec);
+  }
+  TempDir(const TempDir &other) = delete;
+  TempDir &operator=(const TempDir &other) = delete;
+
+  const std::filesystem::path &path() const noexcept { return m_path; }
+  std::filesystem::path operator/(std::string_view name) const {
+    return m_path / name;
+  }
+
+private:
+  std::filesystem::path m_path;
+};
+
+// Создает файл вместе с недостающими директориями
+inline void write_file(const std::filesystem::path &file,
+                       std::string_view content = {}) {
+  std::filesystem::create_directories(file.parent_path());
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  out << content;
+}
+
+inline std::string read_file(const std::filesystem::path &file) {
+  std::ifstream in(file, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+} // namespace winenv::test
@@ -0,0 +1,116 @@
+#include "utf_convert.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <clocale>
+#include <cstdlib>
+
+namespace winenv {
+namespace {
+// Текст около 1 МБ: ASCII, кириллица или смесь с эмодзи
+std::string make_text(int kind) {
+  const char *piece = kind == 0   ? "plain ASCII text "
+                      : kind == 1 ? "\xD1\x82\xD0\xB5\xD0\xBA\xD1\x81\xD1\x82 "
+                                  : "mixed \xD1\x82\xD0\xB5\xD0\xBA\xD1\x81\xD1"
+                                    "\x82 \xF0\x9F\x98\x80 ";
+  std::string text;
+  while (text.size() < (1 << 20)) {
+    text += piece;
+  }
+  return text;
+}
+
+std::u16string make_utf16(int kind) {
+  std::string utf8 = make_text(kind);
+  std::u16string utf16(utf16_size(utf8), u'\0');
+  utf8_to_utf16(utf8, utf16.data());
+  return utf16;
+}
+
+// Прежняя реализация widen_string и narrow_string - mbstowcs и wcstombs
+// CRT. В Linux в локали C.UTF-8 они перекодируют в UTF-32
+bool set_utf8_locale() {
+  return std::setlocale(LC_ALL, "C.UTF-8") != nullptr;
+}
+
+void BM_Utf8ToUtf16(benchmark::State &state) {
+  std::string text = make_text(state.range(0));
+  for (auto _ : state) {
+    std::u16string wide(utf16_size(text), u'\0');
+    utf8_to_utf16(text, wide.data());
+    benchmark::DoNotOptimize(wide);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Utf8ToUtf16)->DenseRange(0, 2);
+
+void BM_Mbstowcs(benchmark::State &state) {
+  if (!set_utf8_locale()) {
+    state.SkipWithError("No C.UTF-8 locale");
+    return;
+  }
+  std::string text = make_text(state.range(0));
+  for (auto _ : state) {
+    std::wstring wide(std::mbstowcs(nullptr, text.c_str(), 0), L'\0');
+    std::mbstowcs(wide.data(), text.c_str(), wide.size());
+    benchmark::DoNotOptimize(wide);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Mbstowcs)->DenseRange(0, 2);
+
+void BM_Utf16ToUtf8(benchmark::State &state) {
+  std::u16string wide = make_utf16(state.range(0));
+  size_t size = utf8_size(wide);
+  for (auto _ : state) {
+    std::string text(utf8_size(wide), '\0');
+    utf16_to_utf8(wide, text.data());
+    benchmark::DoNotOptimize(text);
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_Utf16ToUtf8)->DenseRange(0, 2);
+
+void BM_Wcstombs(benchmark::State &state) {
+  if (!set_utf8_locale()) {
+    state.SkipWithError("No C.UTF-8 locale");
+    return;
+  }
+  std::string utf8 = make_text(state.range(0));
+  std::wstring wide(std::mbstowcs(nullptr, utf8.c_str(), 0), L'\0');
+  std::mbstowcs(wide.data(), utf8.c_str(), wide.size());
+  for (auto _ : state) {
+    std::string text(std::wcstombs(nullptr, wide.c_str(), 0), '\0');
+    std::wcstombs(text.data(), wide.c_str(), text.size());
+    benchmark::DoNotOptimize(text);
+  }
+  state.SetBytesProcessed(state.iterations() * utf8.size());
+}
+BENCHMARK(BM_Wcstombs)->DenseRange(0, 2);
+
+// Короткие строки вроде имен переменных среды: важна цена вызова
+void BM_Utf8ToUtf16Short(benchmark::State &state) {
+  std::string text = "XDG_HOME";
+  for (auto _ : state) {
+    std::u16string wide(utf16_size(text), u'\0');
+    utf8_to_utf16(text, wide.data());
+    benchmark::DoNotOptimize(wide);
+  }
+}
+BENCHMARK(BM_Utf8ToUtf16Short);
+
+void BM_MbstowcsShort(benchmark::State &state) {
+  if (!set_utf8_locale()) {
+    state.SkipWithError("No C.UTF-8 locale");
+    return;
+  }
+  std::string text = "XDG_HOME";
+  for (auto _ : state) {
+    std::wstring wide(std::mbstowcs(nullptr, text.c_str(), 0), L'\0');
+    std::mbstowcs(wide.data(), text.c_str(), wide.size());
+    benchmark::DoNotOptimize(wide);
+  }
+}
+BENCHMARK(BM_MbstowcsShort);
+} // namespace
+} // namespace winenv
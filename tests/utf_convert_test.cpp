@@ -0,0 +1,186 @@
+#include "utf_convert.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+namespace winenv {
+namespace {
+std::u16string to_utf16(std::string_view utf8) {
+  std::u16string utf16(utf16_size(utf8), u'\0');
+  utf8_to_utf16(utf8, utf16.data());
+  return utf16;
+}
+
+std::string to_utf8(std::u16string_view utf16) {
+  std::string utf8(utf8_size(utf16), '\0');
+  utf16_to_utf8(utf16, utf8.data());
+  return utf8;
+}
+
+// Посимвольный декодер по алгоритму "U+FFFD Substitution of Maximal
+// Subparts" стандарта Unicode для сравнения с векторными проходами
+std::u16string reference_to_utf16(std::string_view utf8) {
+  std::u16string utf16;
+  size_t i = 0;
+  while (i < utf8.size()) {
+    auto byte = static_cast<unsigned char>(utf8[i]);
+    if (byte < 0x80) {
+      utf16 += static_cast<char16_t>(byte);
+      ++i;
+      continue;
+    }
+    // Длина последовательности и допустимые значения второго байта
+    size_t size = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (byte >= 0xC2 && byte <= 0xDF) {
+      size = 2;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+      size = 3;
+      low = byte == 0xE0 ? 0xA0 : 0x80;
+      high = byte == 0xED ? 0x9F : 0xBF;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+      size = 4;
+      low = byte == 0xF0 ? 0x90 : 0x80;
+      high = byte == 0xF4 ? 0x8F : 0xBF;
+    }
+    char32_t c = size == 2 ? byte & 0x1F : size == 3 ? byte & 0x0F : byte & 7;
+    size_t n_valid = size == 0 ? 0 : 1;
+    while (n_valid != 0 && n_valid < size && i + n_valid < utf8.size()) {
+      auto next = static_cast<unsigned char>(utf8[i + n_valid]);
+      if (next < (n_valid == 1 ? low : 0x80) ||
+          next > (n_valid == 1 ? high : 0xBF)) {
+        break;
+      }
+      c = c << 6 | (next & 0x3F);
+      ++n_valid;
+    }
+    if (size == 0 || n_valid < size) {
+      utf16 += u'\xFFFD';
+      i += std::max<size_t>(n_valid, 1);
+      continue;
+    }
+    if (c >= 0x10000) {
+      utf16 += static_cast<char16_t>(0xD800 + ((c - 0x10000) >> 10));
+      utf16 += static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+    } else {
+      utf16 += static_cast<char16_t>(c);
+    }
+    i += size;
+  }
+  return utf16;
+}
+
+std::string reference_to_utf8(std::u16string_view utf16) {
+  std::string utf8;
+  for (size_t i = 0; i < utf16.size(); ++i) {
+    char32_t c = utf16[i];
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < utf16.size() &&
+        utf16[i + 1] >= 0xDC00 && utf16[i + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (utf16[++i] - 0xDC00);
+    } else if (c >= 0xD800 && c <= 0xDFFF) {
+      c = 0xFFFD;
+    }
+    if (c < 0x80) {
+      utf8 += static_cast<char>(c);
+    } else if (c < 0x800) {
+      utf8 += static_cast<char>(0xC0 | c >> 6);
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      utf8 += static_cast<char>(0xE0 | c >> 12);
+      utf8 += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+      utf8 += static_cast<char>(0xF0 | c >> 18);
+      utf8 += static_cast<char>(0x80 | (c >> 12 & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  return utf8;
+}
+
+TEST(UtfConvert, ValidText) {
+  const std::string utf8 = "a\xC3\xA9\xD0\xBA\xE2\x82\xAC\xF0\x9F\x98\x80z";
+  const std::u16string utf16 = u"aéк€\xD83D\xDE00z";
+  EXPECT_EQ(to_utf16(utf8), utf16);
+  EXPECT_EQ(to_utf8(utf16), utf8);
+  EXPECT_EQ(to_utf16(""), u"");
+  EXPECT_EQ(to_utf8(u""), "");
+  // Границы диапазонов
+  EXPECT_EQ(to_utf16("\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF"),
+            u"\x7F\x80\x7FF\x800\xFFFF");
+  EXPECT_EQ(to_utf16("\xF0\x90\x80\x80\xF4\x8F\xBF\xBF"),
+            u"\xD800\xDC00\xDBFF\xDFFF");
+}
+
+// Примеры из раздела 3.9 стандарта Unicode: одна замена на каждый неверный
+// байт и на каждую максимальную часть оборванной последовательности
+TEST(UtfConvert, MaximalSubpartReplacement) {
+  EXPECT_EQ(to_utf16("\x80"), u"\xFFFD");
+  EXPECT_EQ(to_utf16("\xC0\xAF"), u"\xFFFD\xFFFD");
+  EXPECT_EQ(to_utf16("\xE0\x80\xAF"), u"\xFFFD\xFFFD\xFFFD");
+  EXPECT_EQ(to_utf16("\xED\xA0\x80"), u"\xFFFD\xFFFD\xFFFD");
+  EXPECT_EQ(to_utf16("\xF4\x90\x80\x80"), u"\xFFFD\xFFFD\xFFFD\xFFFD");
+  EXPECT_EQ(to_utf16("\xF8\x88\x80\x80\x80"),
+            u"\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD");
+  EXPECT_EQ(to_utf16("\xE1\x80" "A"), u"\xFFFD" u"A");
+  EXPECT_EQ(to_utf16("\xF1\x80\x80"), u"\xFFFD");
+  EXPECT_EQ(to_utf16("\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64"),
+            u"a\xFFFD\xFFFD\xFFFD" u"b\xFFFD" u"c\xFFFD\xFFFD" u"d");
+}
+
+TEST(UtfConvert, LoneSurrogatesToUtf8) {
+  EXPECT_EQ(to_utf8(u"\xD800"), "\xEF\xBF\xBD");
+  EXPECT_EQ(to_utf8(u"a\xDC00z"), "a\xEF\xBF\xBDz");
+  EXPECT_EQ(to_utf8(u"\xDE00\xD83D"), "\xEF\xBF\xBD\xEF\xBF\xBD");
+  EXPECT_EQ(to_utf8(u"\xD83D\xD83D\xDE00"),
+            "\xEF\xBF\xBD\xF0\x9F\x98\x80");
+}
+
+// Случайный текст из ASCII, кириллицы, эмодзи и неверных байтов: длина и
+// результат векторных проходов совпадают с посимвольным декодером на
+// любых границах блоков по 16 и 32 байта
+TEST(UtfConvert, MatchesReferenceOnRandomText) {
+  const std::string pieces[] = {"a",        "text ",    "\xD0\xBA",
+                                "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+                                "\x80",     "\xC3",     "\xE0\x80",
+                                "\xED\xA0\x80", "\xF4\x90", "\xFF"};
+  std::mt19937 random{48};
+  for (int iter = 0; iter < 50'000; ++iter) {
+    std::string utf8(random() % 40, 'x');
+    size_t n_pieces = random() % 24;
+    for (size_t i = 0; i < n_pieces; ++i) {
+      // Длинные участки ASCII проходят векторный путь
+      utf8 += random() % 4 == 0 ? std::string(random() % 40, 'y')
+                                : pieces[random() % std::size(pieces)];
+    }
+    std::u16string expected = reference_to_utf16(utf8);
+    ASSERT_EQ(utf16_size(utf8), expected.size());
+    ASSERT_EQ(to_utf16(utf8), expected);
+    // Результат без неверных последовательностей переводится обратно
+    // без изменений
+    ASSERT_EQ(to_utf16(to_utf8(expected)), expected);
+  }
+}
+
+TEST(UtfConvert, Utf16MatchesReferenceOnRandomText) {
+  const std::u16string units = u"az \x7F\x80\x7FF\x800\x43A\xD7FF\xD83D"
+                               u"\xDE00\xDBFF\xDC00\xE000\xFFFF";
+  std::mt19937 random{480};
+  for (int iter = 0; iter < 50'000; ++iter) {
+    std::u16string utf16(random() % 40, u'x');
+    size_t n_units = random() % 40;
+    for (size_t i = 0; i < n_units; ++i) {
+      utf16 += units[random() % units.size()];
+    }
+    std::string expected = reference_to_utf8(utf16);
+    ASSERT_EQ(utf8_size(utf16), expected.size());
+    ASSERT_EQ(to_utf8(utf16), expected);
+  }
+}
+} // namespace
+} // namespace winenv
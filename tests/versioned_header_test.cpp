@@ -0,0 +1,70 @@
+#include "versioned_header.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+namespace winenv {
+namespace {
+constexpr std::uint32_t magic = 0x54534554; // "TEST"
+
+// Первая версия структуры и вторая, дописавшая поле
+struct RecordV1 {
+  VersionedHeader m_header{magic, 1, sizeof(RecordV1)};
+  std::uint32_t m_value{0};
+};
+struct RecordV2 {
+  VersionedHeader m_header{magic, 2, sizeof(RecordV2)};
+  std::uint32_t m_value{0};
+  std::uint32_t m_added{0};
+};
+constexpr size_t added_end =
+    offsetof(RecordV2, m_added) + sizeof(std::uint32_t);
+
+void check(const VersionedHeader &header, size_t available) {
+  check_versioned_header(header, magic, sizeof(RecordV1), available, "Record");
+}
+
+TEST(VersionedHeader, NewerVersionIsReadByKnownFields) {
+  RecordV2 record;
+  record.m_header.m_version = 7;
+  record.m_header.m_size = sizeof(RecordV2) + 64;
+  EXPECT_NO_THROW(check(record.m_header, sizeof(RecordV2) + 64));
+  EXPECT_TRUE(record.m_header.has_field(added_end));
+}
+
+// Поле, которого нет в записавшей версии, не читается из чужих байтов
+TEST(VersionedHeader, OlderVersionLacksAddedField) {
+  RecordV1 record;
+  EXPECT_NO_THROW(check(record.m_header, sizeof(RecordV1)));
+  EXPECT_FALSE(record.m_header.has_field(added_end));
+  EXPECT_TRUE(RecordV2{}.m_header.has_field(added_end));
+}
+
+TEST(VersionedHeader, UnknownVersionIsRejected) {
+  RecordV1 record;
+  record.m_header.m_version = 0;
+  EXPECT_THROW(check(record.m_header, sizeof(RecordV1)), std::runtime_error);
+  // Размер меньше первой версии
+  record.m_header.m_version = 3;
+  record.m_header.m_size = sizeof(RecordV1) - 1;
+  EXPECT_THROW(check(record.m_header, sizeof(RecordV1)), std::runtime_error);
+  // Записавший процесс заявил больше, чем передал
+  record.m_header.m_size = sizeof(RecordV1) + 1;
+  EXPECT_THROW(check(record.m_header, sizeof(RecordV1)), std::runtime_error);
+}
+
+TEST(VersionedHeader, CorruptedRecordIsRejected) {
+  RecordV1 record;
+  EXPECT_THROW(check(record.m_header, sizeof(RecordV1) - 1),
+               std::runtime_error);
+  record.m_header.m_magic = ~magic;
+  try {
+    check(record.m_header, sizeof(RecordV1));
+    FAIL() << "Wrong magic is accepted";
+  } catch (std::runtime_error &err) {
+    EXPECT_STREQ(err.what(), "Record is corrupted");
+  }
+}
+} // namespace
+} // namespace winenv
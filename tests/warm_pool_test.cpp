@@ -0,0 +1,131 @@
+#include "process.hpp"
+#include "warm_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <fstream>
+#include <signal.h>
+#include <stdexcept>
+
+namespace winenv {
+namespace {
+using namespace std::chrono_literals;
+
+// Подготовленный процесс пула. Не выданный процесс завершается вместе с
+// объектом, как скрытая консоль
+class Sleeper {
+public:
+  Sleeper() {
+    Process::Constructor ctor;
+    ctor.set_command_line_arguments("sleep 30");
+    m_process = ctor.create({}, {});
+  }
+  ~Sleeper() {
+    if (m_process.get_id() != 0 && !m_process.wait_for(0)) {
+      kill(m_process.get_id(), SIGKILL);
+      m_process.wait_for(g_wait_infinite);
+    }
+  }
+  Sleeper(Sleeper &&other) = default;
+  Sleeper &operator=(Sleeper &&other) = default;
+
+  bool is_alive() { return m_process.get_id() != 0 && !m_process.wait_for(0); }
+  Process &process() { return m_process; }
+
+private:
+  Process m_process;
+};
+
+template <class Pred> bool wait_until(Pred pred) {
+  auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+TEST(WarmPool, KeepsTargetSizeOfLiveProcesses) {
+  WarmPool<Sleeper> pool{2, [] { return Sleeper{}; },
+                         [](Sleeper &s) { return s.is_alive(); }};
+  ASSERT_TRUE(wait_until([&] { return pool.get_stats().m_n_ready == 2; }));
+
+  std::optional<Sleeper> member = pool.acquire();
+  ASSERT_TRUE(member);
+  EXPECT_TRUE(member->is_alive());
+  ASSERT_TRUE(wait_until([&] { return pool.get_stats().m_n_created == 3; }));
+  WarmPoolStats stats = pool.get_stats();
+  EXPECT_EQ(stats.m_n_hits, 1u);
+  EXPECT_EQ(stats.m_n_ready, 2u);
+}
+
+TEST(WarmPool, DiscardsExitedProcesses) {
+  std::atomic_bool f_block{false};
+  std::vector<Process::NativeId> ids;
+  std::mutex ids_mutex;
+  WarmPool<Sleeper> pool{1,
+                         [&] {
+                           if (f_block) {
+                             throw std::runtime_error("blocked");
+                           }
+                           Sleeper s;
+                           std::lock_guard lock{ids_mutex};
+                           ids.push_back(s.process().get_id());
+                           return s;
+                         },
+                         [](Sleeper &s) { return s.is_alive(); }};
+  ASSERT_TRUE(wait_until([&] { return pool.get_stats().m_n_ready == 1; }));
+  f_block = true;
+  Process::NativeId id{0};
+  {
+    std::lock_guard lock{ids_mutex};
+    id = ids.front();
+  }
+  kill(id, SIGKILL);
+  // Процесс остается зомби, пока его не проверит is_alive
+  ASSERT_TRUE(wait_until([id] {
+    std::ifstream stat{"/proc/" + std::to_string(id) + "/stat"};
+    std::string line;
+    std::getline(stat, line);
+    return line.find(") Z ") != std::string::npos;
+  }));
+  EXPECT_FALSE(pool.acquire());
+  WarmPoolStats stats = pool.get_stats();
+  EXPECT_EQ(stats.m_n_discarded, 1u);
+  EXPECT_EQ(stats.m_n_misses, 1u);
+}
+
+TEST(WarmPool, RecordsFactoryErrors) {
+  WarmPool<Sleeper> pool{1, []() -> Sleeper {
+                           throw std::runtime_error("no console today");
+                         }};
+  ASSERT_TRUE(wait_until([&] { return pool.get_stats().m_n_failures > 0; }));
+  EXPECT_EQ(pool.get_stats().m_last_error, "no console today");
+  EXPECT_FALSE(pool.acquire());
+}
+
+// Владелец прерывает долгую фабрику, и пул уничтожается без ожидания
+TEST(WarmPool, OwnerCancelsFactoryBeforeDestruction) {
+  std::mutex mutex;
+  std::condition_variable cancel;
+  bool f_cancelled{false};
+  auto start = std::chrono::steady_clock::now();
+  {
+    WarmPool<Sleeper> pool{1, [&]() -> Sleeper {
+                             std::unique_lock lock{mutex};
+                             cancel.wait_for(lock, 10s,
+                                             [&] { return f_cancelled; });
+                             throw std::runtime_error("cancelled");
+                           }};
+    std::this_thread::sleep_for(10ms);
+    std::lock_guard lock{mutex};
+    f_cancelled = true;
+    cancel.notify_all();
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+}
+} // namespace
+} // namespace winenv